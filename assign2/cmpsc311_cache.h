@@ -0,0 +1,43 @@
+#ifndef CMPSC311_CACHE_INCLUDED
+#define CMPSC311_CACHE_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File          : cmpsc311_cache.h
+//  Description   : This is the interface to the generic object cache of the
+//                  CMPSC311 utility library.  Items are identified by a
+//                  32-bit object ID (OID), and the cache takes ownership of
+//                  the memory it is given (it is freed on eject/close).
+//
+//   Note: when the cache is full, a put ejects the least recently used
+//         items (by access time) to make space.
+//
+
+// Include files
+#include <stdint.h>
+
+//
+// Interface
+
+int init_cmpsc311_cache( uint32_t max_items, uint32_t max_size );
+	// Initialize the cache with a maximum number of items and bytes
+
+int close_cmpsc311_cache( void );
+	// Close the cache, freeing all of the items it holds
+
+int put_cmpsc311_cache( uint32_t oid, void *item, uint32_t len );
+	// Put an item into the cache, ejecting items to make space
+
+void * get_cmpsc311_cache( uint32_t oid );
+	// Get an item from the cache (NULL if not found)
+
+void * delete_cmpsc311_cache( uint32_t oid );
+	// Remove an item from the cache, returning it to the caller
+
+int eject_cmpsc311_cache( void );
+	// Eject (and free) the least recently used item in the cache
+
+int cmpsc311CacheUnitTest( void );
+	// Run the unit tests for the cache
+
+#endif
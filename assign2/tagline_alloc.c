@@ -0,0 +1,582 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_alloc.c
+//  Description    : This is the implementation of the free-space manager.
+//                   Each disk has a bitmap of its allocated blocks and a
+//                   next-fit cursor; allocation scans forward from the
+//                   cursor a word (64 blocks) at a time for a free run long
+//                   enough, so an append-mostly array allocates in O(1) and
+//                   the blocks of deleted taglines are reused as the cursor
+//                   comes round to them.  One thread allocates at a time;
+//                   the bitmap words and counters are changed atomically,
+//                   so they can be measured from any thread meanwhile.
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_alloc.h"
+#include "tagline_log.h"
+
+// Defines
+#define TAGLINE_ALLOC_WORDBITS 64     // blocks per bitmap word
+#define TAGLINE_ALLOC_TESTS    20000  // random operations of the unit test
+#define TAGLINE_ALLOC_TDISKS   2      // the disks of the unit test
+#define TAGLINE_ALLOC_TBLOCKS  200    // the blocks per disk of the unit test (not whole words)
+
+//
+// Global data
+
+static uint64_t *alloc_maps = NULL;     // the bitmaps of the disks, one after the other (atomic)
+static uint32_t *alloc_free = NULL;     // the free blocks of each disk (atomic)
+static uint32_t *alloc_cursor = NULL;   // where each disk's next search starts
+static uint32_t alloc_disks = 0;        // the number of disks
+static uint32_t alloc_blocks = 0;       // the blocks per disk
+static uint32_t alloc_words = 0;        // the bitmap words per disk
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_find
+// Description  : Find the first block at or after a block that is
+//                allocated (or free), skipping whole words at a time
+//
+// Inputs       : disk - the disk to search
+//                from - the block to start at
+//                limit - the block to stop at
+//                used - look for an allocated (1) or free (0) block
+// Outputs      : the block found, or limit if there is none before it
+
+static uint32_t tagline_alloc_find(RAIDDiskID disk, uint32_t from, uint32_t limit, int used) {
+
+	uint64_t *map = &alloc_maps[(size_t)disk * alloc_words];
+	uint32_t w = from / TAGLINE_ALLOC_WORDBITS, pos;
+	uint64_t word;
+
+	if (from >= limit) {
+		return(limit);
+	}
+	word = __atomic_load_n(&map[w], __ATOMIC_RELAXED);
+	word = (used ? word : ~word) & (~0ULL << (from % TAGLINE_ALLOC_WORDBITS));
+	while (word == 0) {
+		if (++w * TAGLINE_ALLOC_WORDBITS >= limit) {
+			return(limit);
+		}
+		word = __atomic_load_n(&map[w], __ATOMIC_RELAXED);
+		word = used ? word : ~word;
+	}
+	pos = w * TAGLINE_ALLOC_WORDBITS + __builtin_ctzll(word);
+	return((pos < limit) ? pos : limit);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_set
+// Description  : Set the bits of a run of blocks a word at a time, keeping
+//                the free count
+//
+// Inputs       : disk - the disk of the run
+//                rblock - the first block
+//                count - the number of blocks
+//                used - mark them allocated (1) or free (0)
+// Outputs      : none
+
+static void tagline_alloc_set(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, int used) {
+
+	uint64_t *map = &alloc_maps[(size_t)disk * alloc_words], bits, old;
+	uint32_t blk, n, changed = 0;
+
+	for (blk = rblock; blk < rblock + count; blk += n) {
+		n = TAGLINE_ALLOC_WORDBITS - blk % TAGLINE_ALLOC_WORDBITS;
+		if (n > rblock + count - blk) {
+			n = rblock + count - blk;
+		}
+		bits = ((n == TAGLINE_ALLOC_WORDBITS) ? ~0ULL : ((1ULL << n) - 1)) << (blk % TAGLINE_ALLOC_WORDBITS);
+		if (used) {
+			old = __atomic_fetch_or(&map[blk / TAGLINE_ALLOC_WORDBITS], bits, __ATOMIC_RELAXED);
+			changed += __builtin_popcountll(~old & bits);
+		} else {
+			old = __atomic_fetch_and(&map[blk / TAGLINE_ALLOC_WORDBITS], ~bits, __ATOMIC_RELAXED);
+			changed += __builtin_popcountll(old & bits);
+		}
+	}
+	if (used) {
+		__atomic_fetch_sub(&alloc_free[disk], changed, __ATOMIC_RELAXED);
+	} else {
+		__atomic_fetch_add(&alloc_free[disk], changed, __ATOMIC_RELAXED);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_init
+// Description  : Create the free-space maps with every block free
+//
+// Inputs       : disks - the number of disks
+//                blocks - the blocks per disk
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_alloc_init(uint32_t disks, uint32_t blocks) {
+
+	uint32_t d, tail;
+
+	tagline_alloc_close();
+	alloc_words = (blocks + TAGLINE_ALLOC_WORDBITS - 1) / TAGLINE_ALLOC_WORDBITS;
+	if (((alloc_maps = calloc((size_t)disks * alloc_words, sizeof(uint64_t))) == NULL) ||
+			((alloc_free = calloc(disks, sizeof(uint32_t))) == NULL) ||
+			((alloc_cursor = calloc(disks, sizeof(uint32_t))) == NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate free-space maps (%ux%u)", disks, blocks);
+		tagline_alloc_close();
+		return(-1);
+	}
+	alloc_disks = disks;
+	alloc_blocks = blocks;
+
+	// the bits past the end of a disk are never free
+	tail = blocks % TAGLINE_ALLOC_WORDBITS;
+	for (d = 0; d < disks; d++) {
+		alloc_free[d] = blocks;
+		if (tail) {
+			alloc_maps[(size_t)d * alloc_words + alloc_words - 1] = ~0ULL << tail;
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_close
+// Description  : Release the free-space maps
+//
+// Inputs       : none
+// Outputs      : none
+
+void tagline_alloc_close(void) {
+	free(alloc_maps);
+	free(alloc_free);
+	free(alloc_cursor);
+	alloc_maps = NULL;
+	alloc_free = alloc_cursor = NULL;
+	alloc_disks = alloc_blocks = alloc_words = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_disk
+// Description  : Pick the disk with the most free blocks (the lowest
+//                numbered one on a tie), spreading taglines over the array
+//
+// Inputs       : disk - the disk picked (returned)
+// Outputs      : 0 if successful, -1 if every disk is full
+
+int tagline_alloc_disk(RAIDDiskID *disk) {
+
+	uint32_t d, best = 0;
+
+	for (d = 1; d < alloc_disks; d++) {
+		if (alloc_free[d] > alloc_free[best]) {
+			best = d;
+		}
+	}
+	if ((alloc_disks == 0) || (alloc_free[best] == 0)) {
+		return(-1);
+	}
+	*disk = best;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_run
+// Description  : Allocate consecutive blocks on a disk.  The free runs from
+//                the cursor on are tried in order and the first one that is
+//                long enough is used; after TAGLINE_ALLOC_MAXPROBE runs (or
+//                once round the disk) the longest run seen is used instead,
+//                and the caller allocates the rest separately.
+//
+// Inputs       : disk - the disk to allocate on
+//                want - the number of blocks wanted
+//                rblock - the first block allocated (returned)
+// Outputs      : the number of blocks allocated (0 if the disk is full)
+
+uint32_t tagline_alloc_run(RAIDDiskID disk, uint32_t want, RAIDBlockID *rblock) {
+
+	uint32_t start, pos, end, limit, probes, best = 0, best_at = 0;
+	int wrapped = 0;
+
+	if ((disk >= alloc_disks) || (alloc_free[disk] == 0) || (want == 0)) {
+		return(0);
+	}
+
+	start = pos = alloc_cursor[disk];
+	for (probes = 0; probes < TAGLINE_ALLOC_MAXPROBE; probes++) {
+
+		// find the next free run, going round the disk once
+		limit = wrapped ? start : alloc_blocks;
+		if ((pos = tagline_alloc_find(disk, pos, limit, 0)) == limit) {
+			if (wrapped) {
+				break;
+			}
+			wrapped = 1;
+			pos = 0;
+			probes--;
+			continue;
+		}
+
+		// measure it, up to the length wanted
+		end = tagline_alloc_find(disk, pos, (pos + want < alloc_blocks) ? pos + want : alloc_blocks, 1);
+		if (end - pos > best) {
+			best = end - pos;
+			best_at = pos;
+			if (best == want) {
+				break;
+			}
+		}
+		pos = end;
+	}
+
+	tagline_alloc_set(disk, best_at, best, 1);
+	alloc_cursor[disk] = (best_at + best) % alloc_blocks;
+	*rblock = best_at;
+	return(best);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_aligned
+// Description  : Allocate a wholly free, aligned run of blocks (e.g., a
+//                track for a log segment).  The disk with the most free
+//                blocks is tried first, from its cursor, then the others.
+//
+// Inputs       : count - the blocks in the run (its alignment too)
+//                disk - the disk allocated on (returned)
+//                rblock - the first block allocated (returned)
+// Outputs      : 0 if successful, -1 if no disk has such a run free
+
+int tagline_alloc_aligned(uint32_t count, RAIDDiskID *disk, RAIDBlockID *rblock) {
+
+	RAIDDiskID first, d;
+	uint32_t runs, r, n, pos;
+
+	if ((count == 0) || (count > alloc_blocks) || tagline_alloc_disk(&first)) {
+		return(-1);
+	}
+	runs = alloc_blocks / count;
+	for (n = 0; n < alloc_disks; n++) {
+		d = (first + n) % alloc_disks;
+		if (alloc_free[d] < count) {
+			continue;
+		}
+		for (r = 0; r < runs; r++) {
+			pos = ((alloc_cursor[d] / count + r) % runs) * count;
+			if (tagline_alloc_find(d, pos, pos + count, 1) == pos + count) {
+				tagline_alloc_set(d, pos, count, 1);
+				alloc_cursor[d] = (pos + count) % alloc_blocks;
+				*disk = d;
+				*rblock = pos;
+				return(0);
+			}
+		}
+	}
+	return(-1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_at
+// Description  : Allocate the free blocks starting at a given block, e.g.,
+//                the place a tagline block has in its reserved track
+//
+// Inputs       : disk - the disk to allocate on
+//                rblock - the block to start at
+//                want - the most blocks wanted
+// Outputs      : the number of blocks allocated (0 if rblock is taken)
+
+uint32_t tagline_alloc_at(RAIDDiskID disk, RAIDBlockID rblock, uint32_t want) {
+
+	uint32_t end;
+
+	if ((disk >= alloc_disks) || (rblock >= alloc_blocks)) {
+		return(0);
+	}
+	end = tagline_alloc_find(disk, rblock, (rblock + want < alloc_blocks) ? rblock + want : alloc_blocks, 1);
+	tagline_alloc_set(disk, rblock, end - rblock, 1);
+	return(end - rblock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_is_free
+// Description  : Check if every block of a run is free
+//
+// Inputs       : disk - the disk of the run
+//                rblock - the first block
+//                count - the number of blocks
+// Outputs      : 1 if the run is free, 0 if not
+
+int tagline_alloc_is_free(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count) {
+	if ((disk >= alloc_disks) || (rblock + count > alloc_blocks)) {
+		return(0);
+	}
+	return(tagline_alloc_find(disk, rblock, rblock + count, 1) == rblock + count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_mark
+// Description  : Mark blocks allocated, e.g., the blocks of the taglines
+//                restored from a metadata image
+//
+// Inputs       : disk - the disk of the blocks
+//                rblock - the first block
+//                count - the number of blocks
+// Outputs      : none
+
+void tagline_alloc_mark(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count) {
+	if ((disk < alloc_disks) && (rblock + count <= alloc_blocks)) {
+		tagline_alloc_set(disk, rblock, count, 1);
+		if (rblock + count > alloc_cursor[disk]) {
+			alloc_cursor[disk] = (rblock + count) % alloc_blocks;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_free
+// Description  : Return blocks to the free space
+//
+// Inputs       : disk - the disk of the blocks
+//                rblock - the first block
+//                count - the number of blocks
+// Outputs      : none
+
+void tagline_alloc_free(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count) {
+	if ((disk < alloc_disks) && (rblock + count <= alloc_blocks)) {
+		tagline_alloc_set(disk, rblock, count, 0);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_stats
+// Description  : Measure the free space, walking the free runs of each disk.
+//                The fragmentation of the array is over the longest run of
+//                each disk, as no allocation spans disks.
+//
+// Inputs       : total - the counters for the whole array (returned)
+//                disks - the counters of each disk (returned, may be NULL)
+// Outputs      : none
+
+void tagline_alloc_stats(TaglineAllocStats *total, TaglineAllocStats *disks) {
+
+	TaglineAllocStats stats;
+	uint32_t d, pos, end;
+	uint64_t runs = 0;
+
+	memset(total, 0x0, sizeof(TaglineAllocStats));
+	for (d = 0; d < alloc_disks; d++) {
+		memset(&stats, 0x0, sizeof(stats));
+		for (pos = tagline_alloc_find(d, 0, alloc_blocks, 0); pos < alloc_blocks;
+				pos = tagline_alloc_find(d, end, alloc_blocks, 0)) {
+			end = tagline_alloc_find(d, pos, alloc_blocks, 1);
+			stats.free_runs++;
+			stats.free_blocks += end - pos;
+			if (end - pos > stats.largest_run) {
+				stats.largest_run = end - pos;
+			}
+		}
+		stats.fragmentation = (stats.free_blocks) ? 1.0 - (double)stats.largest_run / stats.free_blocks : 0.0;
+		if (disks != NULL) {
+			disks[d] = stats;
+		}
+		total->free_blocks += stats.free_blocks;
+		total->free_runs += stats.free_runs;
+		if (stats.largest_run > total->largest_run) {
+			total->largest_run = stats.largest_run;
+		}
+		runs += stats.largest_run;
+	}
+	total->fragmentation = (total->free_blocks) ? 1.0 - (double)runs / total->free_blocks : 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_taken
+// Description  : Record blocks the allocator handed out in the unit test's
+//                map of the blocks, checking they were free
+//
+// Inputs       : shadow - the allocated blocks of each disk, one byte each
+//                disk - the disk of the blocks
+//                rblock - the first block
+//                count - the number of blocks
+// Outputs      : 0 if they were all free, -1 if not
+
+static int tagline_alloc_taken(uint8_t *shadow, RAIDDiskID disk, RAIDBlockID rblock, uint32_t count) {
+
+	uint32_t b;
+
+	if (rblock + count > TAGLINE_ALLOC_TBLOCKS) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : allocated blocks %u+%u past the end of disk %u", rblock, count, disk);
+		return(-1);
+	}
+	for (b = rblock; b < rblock + count; b++) {
+		if (shadow[disk * TAGLINE_ALLOC_TBLOCKS + b]) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : allocated block %u of disk %u twice", b, disk);
+			return(-1);
+		}
+		shadow[disk * TAGLINE_ALLOC_TBLOCKS + b] = 1;
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_check
+// Description  : Check the free-space maps, counts and statistics agree
+//                with the unit test's map of the blocks
+//
+// Inputs       : shadow - the allocated blocks of each disk, one byte each
+// Outputs      : 0 if they agree, -1 if not
+
+static int tagline_alloc_check(uint8_t *shadow) {
+
+	TaglineAllocStats total, disks[TAGLINE_ALLOC_TDISKS];
+	uint32_t d, b, free, runs, run, largest;
+
+	tagline_alloc_stats(&total, disks);
+	for (d = 0; d < TAGLINE_ALLOC_TDISKS; d++) {
+		for (b = free = runs = run = largest = 0; b < TAGLINE_ALLOC_TBLOCKS; b++) {
+			if (tagline_alloc_is_free(d, b, 1) == shadow[d * TAGLINE_ALLOC_TBLOCKS + b]) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : block %u of disk %u is wrongly %s", b, d,
+						shadow[d * TAGLINE_ALLOC_TBLOCKS + b] ? "free" : "allocated");
+				return(-1);
+			}
+			if (shadow[d * TAGLINE_ALLOC_TBLOCKS + b]) {
+				run = 0;
+				continue;
+			}
+			free++;
+			runs += (run++ == 0);
+			largest = (run > largest) ? run : largest;
+		}
+		if ((alloc_free[d] != free) || (disks[d].free_blocks != free) || (disks[d].free_runs != runs) ||
+				(disks[d].largest_run != largest)) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : disk %u has %u free blocks (%u counted) in %u runs, largest %u;"
+					" expected %u in %u runs, largest %u", d, disks[d].free_blocks, alloc_free[d],
+					disks[d].free_runs, disks[d].largest_run, free, runs, largest);
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_alloc_unit_test
+// Description  : Allocate and free runs across bitmap words, whole words
+//                and up to the end of a disk that is not whole words, then
+//                make random allocations and frees, checking the maps
+//                against a map of the blocks after each
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_alloc_unit_test(void) {
+
+	uint8_t shadow[TAGLINE_ALLOC_TDISKS * TAGLINE_ALLOC_TBLOCKS];
+	uint32_t t, n, want, free;
+	RAIDDiskID disk;
+	RAIDBlockID rblock;
+	int failed = 0;
+
+	if (tagline_alloc_init(TAGLINE_ALLOC_TDISKS, TAGLINE_ALLOC_TBLOCKS)) {
+		return(-1);
+	}
+	memset(shadow, 0x0, sizeof(shadow));
+
+	// A run across the first word boundary, one block either side of it,
+	// then one reaching into the last (part) word
+	failed = (tagline_alloc_at(0, 60, 8) != 8) || tagline_alloc_taken(shadow, 0, 60, 8) ||
+			tagline_alloc_is_free(0, 56, 5) || (! tagline_alloc_is_free(0, 56, 4)) ||
+			(! tagline_alloc_is_free(0, 68, 60)) || tagline_alloc_check(shadow);
+	failed = failed || (tagline_alloc_at(0, 120, 20) != 20) || tagline_alloc_taken(shadow, 0, 120, 20) ||
+			(tagline_alloc_at(0, 100, 64) != 20) || tagline_alloc_taken(shadow, 0, 100, 20) ||
+			tagline_alloc_check(shadow);
+	tagline_alloc_free(0, 63, 2);
+	shadow[63] = shadow[64] = 0;
+	failed = failed || tagline_alloc_check(shadow);
+
+	// With no run free as long as wanted, the first of the longest (0-59
+	// and 140-199) is taken; the next reaches the end of the disk, the
+	// bits past it are never handed out; the cursor then wraps round to
+	// the two blocks at the word boundary
+	failed = failed || ((n = tagline_alloc_run(0, 100, &rblock)) != 60) || (rblock != 0) ||
+			tagline_alloc_taken(shadow, 0, rblock, n) ||
+			((n = tagline_alloc_run(0, 60, &rblock)) != 60) || (rblock != 140) ||
+			tagline_alloc_taken(shadow, 0, rblock, n) ||
+			((n = tagline_alloc_run(0, 2, &rblock)) != 2) || (rblock != 63) ||
+			tagline_alloc_taken(shadow, 0, rblock, n) || tagline_alloc_check(shadow);
+
+	// A whole word freed is one aligned run: the three of the emptier
+	// disk go first, then the word, then there are none
+	tagline_alloc_free(0, 64, 64);
+	memset(&shadow[64], 0x0, 64);
+	failed = failed || tagline_alloc_check(shadow);
+	for (t = 0; (t < 4) && (! failed); t++) {
+		failed = tagline_alloc_aligned(64, &disk, &rblock) || (disk != ((t < 3) ? 1 : 0)) ||
+				(rblock != ((t < 3) ? t * 64 : 64)) || tagline_alloc_taken(shadow, disk, rblock, 64);
+	}
+	failed = failed || (tagline_alloc_aligned(64, &disk, &rblock) == 0) || tagline_alloc_check(shadow);
+
+	// Random runs, exact places, aligned runs and frees; a run comes back
+	// short only when the longest free run seen is shorter
+	for (t = 0; (t < TAGLINE_ALLOC_TESTS) && (! failed); t++) {
+		disk = rand() % TAGLINE_ALLOC_TDISKS;
+		rblock = rand() % TAGLINE_ALLOC_TBLOCKS;
+		want = 1 + rand() % ((rand() % 4) ? 8 : 130);
+		for (n = free = 0; n < TAGLINE_ALLOC_TBLOCKS; n++) {
+			free += ! shadow[disk * TAGLINE_ALLOC_TBLOCKS + n];
+		}
+		switch (rand() % 4) {
+		case 0:
+			n = tagline_alloc_run(disk, want, &rblock);
+			if ((n > want) || ((n == 0) && (free > 0)) || tagline_alloc_taken(shadow, disk, rblock, n)) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : run of %u blocks on disk %u gave %u at %u (%u free)",
+						want, disk, n, rblock, free);
+				failed = 1;
+			}
+			break;
+		case 1:
+			n = tagline_alloc_at(disk, rblock, want);
+			failed = (n > want) || ((n == 0) && (! shadow[disk * TAGLINE_ALLOC_TBLOCKS + rblock])) ||
+					tagline_alloc_taken(shadow, disk, rblock, n);
+			break;
+		case 2:
+			want = 8 << (rand() % 4);
+			if (tagline_alloc_aligned(want, &disk, &rblock) == 0) {
+				failed = (rblock % want) || tagline_alloc_taken(shadow, disk, rblock, want);
+			}
+			break;
+		default:
+			n = (rblock + want > TAGLINE_ALLOC_TBLOCKS) ? TAGLINE_ALLOC_TBLOCKS - rblock : want;
+			tagline_alloc_free(disk, rblock, n);
+			memset(&shadow[disk * TAGLINE_ALLOC_TBLOCKS + rblock], 0x0, n);
+			break;
+		}
+		failed = failed || tagline_alloc_check(shadow);
+	}
+	tagline_alloc_close();
+	if (failed) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : free-space unit test failed");
+		return(-1);
+	}
+
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : free-space unit test passed (%d operations)", TAGLINE_ALLOC_TESTS);
+	return(0);
+}
@@ -0,0 +1,69 @@
+#ifndef TAGLINE_ALLOC_INCLUDED
+#define TAGLINE_ALLOC_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_alloc.h
+//  Description    : This is the header file for the free-space manager that
+//                   hands out the blocks of the RAID disks to taglines and
+//                   takes them back when taglines are deleted.
+//
+
+// Includes
+#include <stdint.h>
+#include "raid_bus.h"
+
+// Defines
+#define TAGLINE_ALLOC_MAXPROBE 64  // free runs looked at for a contiguous one
+
+//
+// Type definitions
+
+// Counters describing the free space of a disk (or of the array)
+typedef struct {
+	uint32_t free_blocks;    // the blocks not allocated
+	uint32_t free_runs;      // the maximal runs of free blocks
+	uint32_t largest_run;    // the blocks in the longest free run
+	double   fragmentation;  // 1 - largest_run / free_blocks (0 is one run per disk)
+} TaglineAllocStats;
+
+//
+// Interface functions
+
+int tagline_alloc_init(uint32_t disks, uint32_t blocks);
+	// Start with every block of every disk free
+
+void tagline_alloc_close(void);
+	// Release the free-space maps
+
+int tagline_alloc_disk(RAIDDiskID *disk);
+	// Pick the disk with the most free blocks (-1 if the array is full)
+
+uint32_t tagline_alloc_run(RAIDDiskID disk, uint32_t want, RAIDBlockID *rblock);
+	// Allocate up to want consecutive blocks, returning how many (0 if full)
+
+int tagline_alloc_aligned(uint32_t count, RAIDDiskID *disk, RAIDBlockID *rblock);
+	// Allocate a whole free run of count blocks starting on a multiple of count
+
+uint32_t tagline_alloc_at(RAIDDiskID disk, RAIDBlockID rblock, uint32_t want);
+	// Allocate up to want free blocks starting exactly at a block, returning how many
+
+int tagline_alloc_is_free(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count);
+	// Check if a run of blocks is wholly free
+
+void tagline_alloc_mark(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count);
+	// Mark blocks allocated (when rebuilding the maps from the taglines)
+
+void tagline_alloc_free(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count);
+	// Return blocks to the free space
+
+void tagline_alloc_stats(TaglineAllocStats *total, TaglineAllocStats *disks);
+	// Measure the free space of the array and (if not NULL) of each disk
+
+//
+// Unit test
+
+int tagline_alloc_unit_test(void);
+	// Allocate and free runs across bitmap words, checking the maps block by block
+
+#endif /* TAGLINE_ALLOC_INCLUDED */
@@ -0,0 +1,270 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_bench.c
+//  Description    : This is the implementation of the benchmark counters.
+//                   Latencies go into log-linear histograms (a power of two
+//                   range split into equal sub-buckets), so recording is a
+//                   few instructions and an atomic add, and percentiles
+//                   are accurate to the sub-bucket width.
+//
+
+// Include Files
+#include <string.h>
+#include <time.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_bench.h"
+#include "tagline_log.h"
+
+// Defines
+#define TAGLINE_BENCH_HALF (1 << (TAGLINE_BENCH_SUBBITS - 1))  // sub-buckets per power of two
+
+//
+// Type definitions
+
+// The counters of one operation type
+typedef struct {
+	uint64_t count;                            // operations recorded
+	uint64_t bytes;                            // bytes moved
+	uint64_t total;                            // sum of the latencies (ns)
+	uint64_t max;                              // largest latency (ns)
+	uint64_t buckets[TAGLINE_BENCH_BUCKETS];   // the latency histogram
+} TaglineBenchCounters;
+
+// The percentiles reported for each operation type
+static const double bench_percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+static const char *bench_percentile_labels[] = { "p50", "p90", "p99", "p99_9" };
+#define TAGLINE_BENCH_NPCT (sizeof(bench_percentiles) / sizeof(double))
+
+//
+// Global data
+
+const char *TAGLINE_BENCH_LABELS[TAGLINE_BENCH_MAXVAL] = { "read", "write", "bus" };
+int tagline_bench_enabled = 0;                                   // is recording on?
+static uint64_t bench_start, bench_end;                          // the recording period (ns)
+static TaglineBenchCounters bench_counters[TAGLINE_BENCH_MAXVAL];  // the counters by type
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bench_bucket
+// Description  : Find the histogram bucket of a latency
+//
+// Inputs       : nsecs - the latency
+// Outputs      : the bucket index
+
+static uint32_t tagline_bench_bucket(uint64_t nsecs) {
+
+	uint32_t shift;
+
+	if (nsecs < 2 * TAGLINE_BENCH_HALF) {
+		return(nsecs);
+	}
+	shift = (63 - __builtin_clzll(nsecs)) - TAGLINE_BENCH_SUBBITS + 1;
+	return(shift * TAGLINE_BENCH_HALF + (nsecs >> shift));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bench_value
+// Description  : Find the largest latency that falls in a histogram bucket
+//
+// Inputs       : bucket - the bucket index
+// Outputs      : the latency (ns)
+
+static uint64_t tagline_bench_value(uint32_t bucket) {
+
+	uint32_t shift;
+
+	if (bucket < 2 * TAGLINE_BENCH_HALF) {
+		return(bucket);
+	}
+	shift = bucket / TAGLINE_BENCH_HALF - 1;
+	return((((uint64_t)(bucket - shift * TAGLINE_BENCH_HALF) + 1) << shift) - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bench_percentile
+// Description  : Find a latency percentile of an operation type
+//
+// Inputs       : ctr - the counters of the operation type
+//                pct - the percentile (0-100)
+// Outputs      : the latency (ns), capped at the largest one recorded
+
+static uint64_t tagline_bench_percentile(TaglineBenchCounters *ctr, double pct) {
+
+	uint64_t rank, seen = 0, value;
+	uint32_t b;
+
+	if (ctr->count == 0) {
+		return(0);
+	}
+	rank = (uint64_t)((pct / 100.0) * ctr->count + 0.999999);
+	if (rank == 0) {
+		rank = 1;
+	}
+	for (b = 0; b < TAGLINE_BENCH_BUCKETS; b++) {
+		seen += ctr->buckets[b];
+		if (seen >= rank) {
+			break;
+		}
+	}
+	value = tagline_bench_value(b);
+	return((value > ctr->max) ? ctr->max : value);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bench_elapsed
+// Description  : Get the length of the recording period
+//
+// Inputs       : none
+// Outputs      : the seconds recorded (up to now if still recording)
+
+static double tagline_bench_elapsed(void) {
+	return(((tagline_bench_enabled ? tagline_bench_now() : bench_end) - bench_start) / 1e9);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bench_enable
+// Description  : Turn recording on or off; turning it on clears the counters
+//                and starts the recording period
+//
+// Inputs       : enable - non-zero to turn recording on
+// Outputs      : none
+
+void tagline_bench_enable(int enable) {
+	if (enable) {
+		memset(bench_counters, 0x0, sizeof(bench_counters));
+		bench_start = tagline_bench_now();
+	} else if (tagline_bench_enabled) {
+		bench_end = tagline_bench_now();
+	}
+	tagline_bench_enabled = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bench_now
+// Description  : Read the monotonic clock
+//
+// Inputs       : none
+// Outputs      : the time in nanoseconds
+
+uint64_t tagline_bench_now(void) {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bench_record
+// Description  : Record one operation (safe to call from any thread)
+//
+// Inputs       : op - the operation type
+//                nsecs - the latency of the operation
+//                bytes - the bytes the operation moved
+// Outputs      : none
+
+void tagline_bench_record(TaglineBenchOp op, uint64_t nsecs, uint64_t bytes) {
+
+	TaglineBenchCounters *ctr = &bench_counters[op];
+	uint64_t max = __atomic_load_n(&ctr->max, __ATOMIC_RELAXED);
+
+	__atomic_fetch_add(&ctr->count, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&ctr->bytes, bytes, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&ctr->total, nsecs, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&ctr->buckets[tagline_bench_bucket(nsecs)], 1, __ATOMIC_RELAXED);
+	while ((nsecs > max) && (! __atomic_compare_exchange_n(&ctr->max, &max, nsecs, 0,
+			__ATOMIC_RELAXED, __ATOMIC_RELAXED)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bench_report
+// Description  : Log the throughput and latency percentiles (usec) of each
+//                operation type that was recorded
+//
+// Inputs       : wload - the name of the workload benchmarked
+// Outputs      : none
+
+void tagline_bench_report(const char *wload) {
+
+	TaglineBenchCounters *ctr;
+	double secs = tagline_bench_elapsed();
+	int op;
+
+	TAGLINE_LOG(LOG_OUTPUT_LEVEL, "Benchmark [%s], %.6f sec", wload, secs);
+	TAGLINE_LOG(LOG_OUTPUT_LEVEL, "%-6s %10s %12s %10s %10s %10s %10s %10s %10s %10s", "op", "count",
+			"ops/sec", "MB/sec", "mean", "p50", "p90", "p99", "p99.9", "max");
+	for (op = 0; op < TAGLINE_BENCH_MAXVAL; op++) {
+		ctr = &bench_counters[op];
+		if (ctr->count == 0) {
+			continue;
+		}
+		TAGLINE_LOG(LOG_OUTPUT_LEVEL, "%-6s %10lu %12.0f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f",
+				TAGLINE_BENCH_LABELS[op], ctr->count,
+				(secs > 0) ? ctr->count / secs : 0.0,
+				(secs > 0) ? ctr->bytes / (secs * 1024 * 1024) : 0.0,
+				(ctr->total / 1e3) / ctr->count,
+				tagline_bench_percentile(ctr, 50.0) / 1e3,
+				tagline_bench_percentile(ctr, 90.0) / 1e3,
+				tagline_bench_percentile(ctr, 99.0) / 1e3,
+				tagline_bench_percentile(ctr, 99.9) / 1e3,
+				ctr->max / 1e3);
+	}
+	TAGLINE_LOG(LOG_OUTPUT_LEVEL, "(latencies in usec)");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bench_json
+// Description  : Write the throughput and latency percentiles (nsec) of
+//                each operation type as a JSON object
+//
+// Inputs       : wload - the name of the workload benchmarked
+//                out - the stream to write to
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_bench_json(const char *wload, FILE *out) {
+
+	TaglineBenchCounters *ctr;
+	double secs = tagline_bench_elapsed();
+	int op, p;
+	const char *c;
+
+	// The workload name, escaped for a JSON string
+	fprintf(out, "{\"workload\": \"");
+	for (c = wload; *c; c++) {
+		if ((*c == '"') || (*c == '\\')) {
+			fputc('\\', out);
+		}
+		fputc(*c, out);
+	}
+	fprintf(out, "\", \"seconds\": %.9f, \"ops\": {", secs);
+
+	// One object per operation type
+	for (op = 0; op < TAGLINE_BENCH_MAXVAL; op++) {
+		ctr = &bench_counters[op];
+		fprintf(out, "%s\n  \"%s\": {\"count\": %lu, \"bytes\": %lu, \"ops_per_sec\": %.3f, "
+				"\"mb_per_sec\": %.3f, \"mean_ns\": %.1f, ", (op > 0) ? "," : "",
+				TAGLINE_BENCH_LABELS[op], ctr->count, ctr->bytes,
+				(secs > 0) ? ctr->count / secs : 0.0,
+				(secs > 0) ? ctr->bytes / (secs * 1024 * 1024) : 0.0,
+				(ctr->count) ? (double)ctr->total / ctr->count : 0.0);
+		for (p = 0; p < TAGLINE_BENCH_NPCT; p++) {
+			fprintf(out, "\"%s_ns\": %lu, ", bench_percentile_labels[p],
+					tagline_bench_percentile(ctr, bench_percentiles[p]));
+		}
+		fprintf(out, "\"max_ns\": %lu}", ctr->max);
+	}
+	return((fprintf(out, "\n}}\n") < 0) ? -1 : 0);
+}
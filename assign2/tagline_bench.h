@@ -0,0 +1,55 @@
+#ifndef TAGLINE_BENCH_INCLUDED
+#define TAGLINE_BENCH_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_bench.h
+//  Description    : This is the header file for the benchmark counters:
+//                   per operation type latency histograms and throughput
+//                   taken with the monotonic clock.
+//
+
+// Includes
+#include <stdio.h>
+#include <stdint.h>
+
+// Defines
+#define TAGLINE_BENCH_SUBBITS 7     // histogram precision (2^-(bits-1), ~1.6%)
+#define TAGLINE_BENCH_BUCKETS 4096  // histogram buckets (covers 64-bit ns)
+
+//
+// Type definitions
+
+// The operations that are timed
+typedef enum {
+	TAGLINE_BENCH_READ   = 0,  // tagline_read (or an async read request)
+	TAGLINE_BENCH_WRITE  = 1,  // tagline_write (or an async write request)
+	TAGLINE_BENCH_BUS    = 2,  // raid_bus_request
+	TAGLINE_BENCH_MAXVAL = 3,  // the number of operation types
+} TaglineBenchOp;
+
+// The labels of the operation types
+extern const char *TAGLINE_BENCH_LABELS[TAGLINE_BENCH_MAXVAL];
+
+// Is the benchmark recording (checked before taking the clock)
+extern int tagline_bench_enabled;
+
+//
+// Interface functions
+
+void tagline_bench_enable(int enable);
+	// Turn recording on or off (turning it on clears the counters)
+
+uint64_t tagline_bench_now(void);
+	// Read the monotonic clock in nanoseconds
+
+void tagline_bench_record(TaglineBenchOp op, uint64_t nsecs, uint64_t bytes);
+	// Record one operation, its latency and the bytes it moved
+
+void tagline_bench_report(const char *wload);
+	// Log the throughput and latency percentiles of each operation type
+
+int tagline_bench_json(const char *wload, FILE *out);
+	// Write the throughput and latency percentiles as a JSON object
+
+#endif /* TAGLINE_BENCH_INCLUDED */
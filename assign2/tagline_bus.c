@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_bus.c
+//  Description    : This is the implementation of the RAID bus backend
+//                   interface and of its default backend, the RAID library
+//                   (an array in memory, saved to TAGLINE_RAID_STORE when
+//                   it is closed).
+//
+
+// Include Files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_bus.h"
+#include "tagline_log.h"
+
+//
+// Global data
+
+static const TaglineBusBackend *bus_backend = &tagline_bus_lib;  // the backend in use
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_lib_save
+// Description  : Save the array of the RAID library as a store
+//
+// Inputs       : path - the store file
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_bus_lib_save(const char *path) {
+	return(raid_save_store((char *)path) ? -1 : 0);
+}
+
+// The RAID library backend
+const TaglineBusBackend tagline_bus_lib = { "lib", raid_bus_request, tagline_bus_lib_save, NULL, 0 };
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_select
+// Description  : Choose the backend the bus requests go to (not while the
+//                array is open): "lib" (the RAID library), "file[:<path>]"
+//                (a store in a file, read and written in place) or
+//                "model[:<seek>:<track>:<block>]" (the RAID library, each
+//                request taking the time the disk model gives it, in usec)
+//                or "net[:<host>[:<port>]]" (the array of a tagline_server)
+//
+// Inputs       : spec - the backend and its parameters
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_bus_select(const char *spec) {
+
+	unsigned int seek, track, block, port = 0;
+	char host[64];
+
+	if (strcmp(spec, "lib") == 0) {
+		bus_backend = &tagline_bus_lib;
+	} else if ((strcmp(spec, "file") == 0) || (strncmp(spec, "file:", 5) == 0)) {
+		if (tagline_bus_file_path((spec[4] == ':') ? &spec[5] : TAGLINE_BUS_FILE)) {
+			return(-1);
+		}
+		bus_backend = &tagline_bus_file;
+	} else if (strcmp(spec, "model") == 0) {
+		tagline_bus_model_costs(TAGLINE_BUS_MODEL_SEEK, TAGLINE_BUS_MODEL_TRACK, TAGLINE_BUS_MODEL_BLOCK);
+		bus_backend = &tagline_bus_model;
+	} else if (sscanf(spec, "model:%u:%u:%u", &seek, &track, &block) == 3) {
+		tagline_bus_model_costs(seek, track, block);
+		bus_backend = &tagline_bus_model;
+	} else if ((strcmp(spec, "net") == 0) || (sscanf(spec, "net:%63[^:]:%u", host, &port) >= 1)) {
+		if ((port > UINT16_MAX) || tagline_bus_net_server((spec[3] == ':') ? host : NULL, port)) {
+			return(-1);
+		}
+		bus_backend = &tagline_bus_net;
+	} else {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unknown RAID bus backend [%s]", spec);
+		return(-1);
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_backend
+// Description  : Get the backend the bus requests go to
+//
+// Inputs       : none
+// Outputs      : the backend
+
+const TaglineBusBackend *tagline_bus_backend(void) {
+	return(bus_backend);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_save
+// Description  : Save the contents of the array as a store, written beside
+//                the file and renamed over it so a crash leaves the old one
+//
+// Inputs       : path - the store file
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_bus_save(const char *path) {
+
+	char tmp[FILENAME_MAX];
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	if (bus_backend->save(tmp) || rename(tmp, path)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure saving RAID store [%s]", path);
+		unlink(tmp);
+		return(-1);
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_wait
+// Description  : Wait for the monotonic clock to reach a time
+//
+// Inputs       : until - the time to wait for (ns)
+// Outputs      : none
+
+void tagline_bus_wait(uint64_t until) {
+
+	struct timespec ts;
+
+	ts.tv_sec = until / 1000000000ULL;
+	ts.tv_nsec = until % 1000000000ULL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
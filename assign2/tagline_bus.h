@@ -0,0 +1,80 @@
+#ifndef TAGLINE_BUS_INCLUDED
+#define TAGLINE_BUS_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_bus.h
+//  Description    : This is the header file for the RAID bus backends: the
+//                   interface every bus request of the driver goes through,
+//                   and its implementations (the RAID library, a store in a
+//                   file, a disk model that charges each request the
+//                   time a real disk would take, and a client of an array
+//                   hosted by tagline_server).
+//
+
+// Includes
+#include <stdint.h>
+#include "raid_bus.h"
+
+// Defines
+#define TAGLINE_BUS_FILE          "raid_disks.crd"  // the default file of the file backend
+#define TAGLINE_BUS_MODEL_SEEK    400               // default seek time (usec)
+#define TAGLINE_BUS_MODEL_TRACK   100               // default time per track transferred (usec)
+#define TAGLINE_BUS_MODEL_BLOCK   10                // default time per block transferred (usec)
+
+//
+// Type definitions
+
+// A RAID bus implementation
+typedef struct {
+	const char *name;                                  // the backend name
+	RAIDOpCode (*request)(RAIDOpCode req, void *buf);  // perform a request (one at a time)
+	int (*save)(const char *path);                     // save the contents of the array as a store
+	uint64_t (*schedule)(RAIDOpCode req);              // when a request performed completes (NULL: at once)
+	int concurrent;                                    // can requests be made at once (no bus lock)?
+} TaglineBusBackend;
+
+// The counters of one disk of the disk model
+typedef struct {
+	uint64_t requests;  // the transfers
+	uint64_t seeks;     // the transfers that had to seek
+	uint64_t tracks;    // the tracks transferred
+	uint64_t blocks;    // the blocks transferred
+	uint64_t busy;      // the time the disk was busy (ns)
+	uint64_t queued;    // the time transfers waited for the disk (ns)
+} TaglineBusModelStats;
+
+// The backends
+extern const TaglineBusBackend tagline_bus_lib;
+extern const TaglineBusBackend tagline_bus_file;
+extern const TaglineBusBackend tagline_bus_model;
+extern const TaglineBusBackend tagline_bus_net;
+
+//
+// Interface functions
+
+int tagline_bus_select(const char *spec);
+	// Choose the backend: lib, file[:<path>], model[:<seek>:<track>:<block>] or net[:<host>[:<port>]]
+
+const TaglineBusBackend *tagline_bus_backend(void);
+	// Get the backend in use
+
+int tagline_bus_save(const char *path);
+	// Save the contents of the array as a store (replacing path atomically)
+
+void tagline_bus_wait(uint64_t until);
+	// Wait for the monotonic clock to reach a time (ns)
+
+int tagline_bus_file_path(const char *path);
+	// Set the file of the file backend
+
+void tagline_bus_model_costs(uint32_t seek, uint32_t track, uint32_t block);
+	// Set the seek, per-track and per-block times of the disk model (usec)
+
+void tagline_bus_model_stats(TaglineBusModelStats *disks, uint32_t ndisks);
+	// Get the counters of the disks of the model
+
+int tagline_bus_net_server(const char *host, uint16_t port);
+	// Set the server the net backend connects to
+
+#endif /* TAGLINE_BUS_INCLUDED */
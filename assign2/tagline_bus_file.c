@@ -0,0 +1,257 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_bus_file.c
+//  Description    : This is the implementation of the file backend of the
+//                   RAID bus.  The array lives in a file laid out as a
+//                   store (one byte of disk count, the blocks per disk,
+//                   then the blocks of each disk in turn), read and written
+//                   in place with pread/pwrite, so an array larger than
+//                   memory can be used.  Like the RAID library, the array
+//                   starts empty at RAID_INIT and is saved to
+//                   TAGLINE_RAID_STORE at RAID_CLOSE.
+//
+
+// Include Files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_bus.h"
+#include "tagline_driver.h"
+#include "tagline_meta.h"
+#include "tagline_opcode.h"
+#include "tagline_log.h"
+
+//
+// Global data
+
+static char file_path[FILENAME_MAX] = TAGLINE_BUS_FILE;  // the file holding the array
+static int file_fd = -1;            // the open file (-1 if the array is closed)
+static uint32_t file_disks = 0;     // the disks of the array
+static uint32_t file_blocks = 0;    // the blocks of each disk
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_file_path
+// Description  : Set the file the array is kept in (not while it is open)
+//
+// Inputs       : path - the file
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_bus_file_path(const char *path) {
+	if ((*path == '\0') || (strlen(path) >= sizeof(file_path)) || (strcmp(path, TAGLINE_RAID_STORE) == 0)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad RAID bus file [%s]", path);
+		return(-1);
+	}
+	strcpy(file_path, path);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_file_offset
+// Description  : Get the offset in the file of a block
+//
+// Inputs       : disk - the disk of the block
+//                rblock - the block
+// Outputs      : the offset
+
+static off_t tagline_bus_file_offset(RAIDDiskID disk, RAIDBlockID rblock) {
+	return(TAGLINE_STORE_HDRSIZE + ((off_t)disk * file_blocks + rblock) * TAGLINE_BLOCK_SIZE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_file_io
+// Description  : Read or write a whole run of bytes of the file
+//
+// Inputs       : write - write (1) or read (0)
+//                buf - the memory to transfer from/to
+//                len - the bytes to transfer
+//                off - the offset in the file
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_bus_file_io(int write, char *buf, size_t len, off_t off) {
+
+	ssize_t done;
+
+	while (len > 0) {
+		done = write ? pwrite(file_fd, buf, len, off) : pread(file_fd, buf, len, off);
+		if (done <= 0) {
+			if ((done == -1) && (errno == EINTR)) {
+				continue;
+			}
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure %s RAID bus file [%s], error: %s.",
+					write ? "writing" : "reading", file_path, (done == 0) ? "short read" : strerror(errno));
+			return(-1);
+		}
+		buf += done;
+		len -= done;
+		off += done;
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_file_open
+// Description  : Create the array, empty, in the file
+//
+// Inputs       : disks - the disks of the array
+//                blocks - the blocks of each disk
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_bus_file_open(uint32_t disks, uint32_t blocks) {
+
+	char header[TAGLINE_STORE_HDRSIZE];
+
+	if ((file_fd != -1) || (disks == 0) || (disks > UINT8_MAX) || (blocks == 0)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad RAID bus file init [disks=%u, blocks=%u]", disks, blocks);
+		return(-1);
+	}
+	if ((file_fd = open(file_path, O_RDWR | O_CREAT | O_TRUNC, 0644)) == -1) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure creating RAID bus file [%s], error: %s.",
+				file_path, strerror(errno));
+		return(-1);
+	}
+	file_disks = disks;
+	file_blocks = blocks;
+	header[0] = (uint8_t)disks;
+	memcpy(&header[1], &blocks, sizeof(blocks));
+	if (tagline_bus_file_io(1, header, sizeof(header), 0) ||
+			ftruncate(file_fd, tagline_bus_file_offset(disks, 0))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure sizing RAID bus file [%s]", file_path);
+		close(file_fd);
+		file_fd = -1;
+		return(-1);
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_file_format
+// Description  : Zero a disk of the array
+//
+// Inputs       : disk - the disk
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_bus_file_format(RAIDDiskID disk) {
+
+	char zeros[RAID_TRACK_BLOCKS * TAGLINE_BLOCK_SIZE];
+	uint32_t blk;
+
+	memset(zeros, 0, sizeof(zeros));
+	for (blk = 0; blk < file_blocks; blk += RAID_TRACK_BLOCKS) {
+		size_t len = (size_t)((file_blocks - blk < RAID_TRACK_BLOCKS) ? file_blocks - blk : RAID_TRACK_BLOCKS);
+		if (tagline_bus_file_io(1, zeros, len * TAGLINE_BLOCK_SIZE, tagline_bus_file_offset(disk, blk))) {
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_file_save
+// Description  : Save the contents of the array as a store (a copy of the
+//                file)
+//
+// Inputs       : path - the store file
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_bus_file_save(const char *path) {
+
+	char buf[RAID_TRACK_BLOCKS * TAGLINE_BLOCK_SIZE];
+	off_t off, size;
+	int out, ret = 0;
+
+	if (file_fd == -1) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID bus file saved before init");
+		return(-1);
+	}
+	if ((out = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure creating RAID store [%s], error: %s.",
+				path, strerror(errno));
+		return(-1);
+	}
+	size = tagline_bus_file_offset(file_disks, 0);
+	for (off = 0; (ret == 0) && (off < size); off += sizeof(buf)) {
+		size_t len = (size - off < (off_t)sizeof(buf)) ? (size_t)(size - off) : sizeof(buf);
+		if (tagline_bus_file_io(0, buf, len, off) || (write(out, buf, len) != (ssize_t)len)) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure saving RAID store [%s]", path);
+			ret = -1;
+		}
+	}
+	if (close(out)) {
+		ret = -1;
+	}
+	return(ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_file_request
+// Description  : Perform a RAID bus request on the file
+//
+// Inputs       : req - the request opcode
+//                buf - the block memory of the request (may be NULL)
+// Outputs      : the response opcode (the result bit set on failure)
+
+static RAIDOpCode tagline_bus_file_request(RAIDOpCode req, void *buf) {
+
+	TaglineOpcode opc;
+	int ret = -1;
+
+	tagline_opcode_decode(req, &opc);
+	if ((opc.type != RAID_INIT) && (file_fd == -1)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID bus file request before init");
+		return(req | TAGLINE_OPC_SET(STATUS, 1));
+	}
+	switch (opc.type) {
+	case RAID_INIT:    // blocks is the tracks of each disk, disk the disks
+		ret = tagline_bus_file_open(opc.disk, (uint32_t)opc.blocks * RAID_TRACK_BLOCKS);
+		break;
+
+	case RAID_CLOSE:   // save the array, as the RAID library does
+		ret = tagline_bus_file_save(TAGLINE_RAID_STORE);
+		close(file_fd);
+		file_fd = -1;
+		break;
+
+	case RAID_FORMAT:
+		if (opc.disk < file_disks) {
+			ret = tagline_bus_file_format(opc.disk);
+		}
+		break;
+
+	case RAID_READ:
+	case RAID_WRITE:
+		if ((buf != NULL) && (opc.disk < file_disks) && (opc.blocks > 0) &&
+				((uint64_t)opc.blkid + opc.blocks <= file_blocks)) {
+			ret = tagline_bus_file_io(opc.type == RAID_WRITE, buf, (size_t)opc.blocks * TAGLINE_BLOCK_SIZE,
+					tagline_bus_file_offset(opc.disk, opc.blkid));
+		}
+		break;
+
+	default:           // no block hashes
+		break;
+	}
+	if (ret) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID bus file request failed [type=%u, disk=%u, block=%u, blocks=%u]",
+				opc.type, opc.disk, opc.blkid, opc.blocks);
+		return(req | TAGLINE_OPC_SET(STATUS, 1));
+	}
+	return(req & ~TAGLINE_OPC_MASK(STATUS));
+}
+
+// The file backend
+const TaglineBusBackend tagline_bus_file = { "file", tagline_bus_file_request, tagline_bus_file_save, NULL, 0 };
@@ -0,0 +1,205 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_bus_model.c
+//  Description    : This is the implementation of the disk model backend of
+//                   the RAID bus.  The blocks are kept by the RAID library;
+//                   each transfer is also charged the time a disk would
+//                   take (a seek if the head is on another track, then a
+//                   cost per track and per block moved), queued behind the
+//                   transfers already given to the same disk.  The bus
+//                   waits for that time outside its lock, so transfers to
+//                   different disks overlap as they would on real disks.
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_bus.h"
+#include "tagline_bench.h"
+#include "tagline_opcode.h"
+#include "tagline_log.h"
+
+// Defines
+#define TAGLINE_BUS_MODEL_DISKS 256  // the disks a request can address
+
+//
+// Type definitions
+
+// The state of one modelled disk
+typedef struct {
+	RAIDBlockID          head;        // the track the head is on
+	uint64_t             busy_until;  // when the last transfer queued completes (ns)
+	TaglineBusModelStats stats;       // the counters of the disk
+} TaglineModelDisk;
+
+//
+// Global data
+
+static uint64_t model_seek = TAGLINE_BUS_MODEL_SEEK * 1000ULL;    // the seek time (ns)
+static uint64_t model_track = TAGLINE_BUS_MODEL_TRACK * 1000ULL;  // the time per track moved (ns)
+static uint64_t model_block = TAGLINE_BUS_MODEL_BLOCK * 1000ULL;  // the time per block moved (ns)
+static TaglineModelDisk model_disks[TAGLINE_BUS_MODEL_DISKS];     // the disks of the array
+static uint32_t model_ndisks = 0;                                 // the disks initialized
+static uint32_t model_tracks = 0;                                 // the tracks of each disk
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_model_costs
+// Description  : Set the times the model charges transfers
+//
+// Inputs       : seek - the time to move the head to another track (usec)
+//                track - the time per track a transfer touches (usec)
+//                block - the time per block a transfer moves (usec)
+// Outputs      : none
+
+void tagline_bus_model_costs(uint32_t seek, uint32_t track, uint32_t block) {
+	model_seek = seek * 1000ULL;
+	model_track = track * 1000ULL;
+	model_block = block * 1000ULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_model_stats
+// Description  : Get the counters of the disks of the model
+//
+// Inputs       : disks - the counters (returned, zero for disks not used)
+//                ndisks - the number of disks to get
+// Outputs      : none
+
+void tagline_bus_model_stats(TaglineBusModelStats *disks, uint32_t ndisks) {
+
+	uint32_t d;
+
+	for (d = 0; d < ndisks; d++) {
+		if (d < model_ndisks) {
+			disks[d] = model_disks[d].stats;
+		} else {
+			memset(&disks[d], 0, sizeof(disks[d]));
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_model_report
+// Description  : Log the counters of the disks of the model
+//
+// Inputs       : none
+// Outputs      : none
+
+static void tagline_bus_model_report(void) {
+
+	TaglineBusModelStats *st;
+	uint32_t d;
+
+	for (d = 0; d < model_ndisks; d++) {
+		st = &model_disks[d].stats;
+		TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : disk %u model %lu transfers (%lu seeks, %lu tracks, %lu blocks), "
+				"busy %.3f sec, queued %.3f sec", d, st->requests, st->seeks, st->tracks, st->blocks,
+				st->busy / 1e9, st->queued / 1e9);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_model_save
+// Description  : Save the array of the RAID library as a store
+//
+// Inputs       : path - the store file
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_bus_model_save(const char *path) {
+	return(raid_save_store((char *)path) ? -1 : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_model_request
+// Description  : Perform a RAID bus request on the RAID library, starting
+//                the model with the array and reporting it when closed
+//
+// Inputs       : req - the request opcode
+//                buf - the block memory of the request (may be NULL)
+// Outputs      : the response opcode from the bus
+
+static RAIDOpCode tagline_bus_model_request(RAIDOpCode req, void *buf) {
+
+	RAIDOpCode resp = raid_bus_request(req, buf);
+
+	if (! raid_request_failed(resp)) {
+		switch (TAGLINE_OPC_GET(req, REQTYPE)) {
+		case RAID_INIT:
+			memset(model_disks, 0, sizeof(model_disks));
+			model_ndisks = TAGLINE_OPC_GET(req, DISKID);
+			model_tracks = TAGLINE_OPC_GET(req, BLOCKS);
+			break;
+
+		case RAID_CLOSE:
+			tagline_bus_model_report();
+			model_ndisks = 0;
+			break;
+		}
+	}
+	return(resp);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_model_schedule
+// Description  : Queue a request performed on its disk and get the time it
+//                completes.  Called holding the bus lock.
+//
+// Inputs       : req - the request opcode
+// Outputs      : the time the request completes (ns, monotonic clock)
+
+static uint64_t tagline_bus_model_schedule(RAIDOpCode req) {
+
+	TaglineModelDisk *dsk;
+	RAIDBlockID first, last;
+	uint64_t now, start, cost;
+	uint32_t blocks = TAGLINE_OPC_GET(req, BLOCKS);
+	uint8_t type = TAGLINE_OPC_GET(req, REQTYPE);
+
+	if ((TAGLINE_OPC_GET(req, DISKID) >= model_ndisks) ||
+			((type != RAID_READ) && (type != RAID_WRITE) && (type != RAID_FORMAT))) {
+		return(0);
+	}
+	dsk = &model_disks[TAGLINE_OPC_GET(req, DISKID)];
+
+	// a format sweeps every track of the disk
+	if (type == RAID_FORMAT) {
+		cost = model_tracks * model_track;
+		dsk->head = model_tracks - 1;
+	} else {
+		first = TAGLINE_OPC_GET(req, BLOCKID) / RAID_TRACK_BLOCKS;
+		last = (TAGLINE_OPC_GET(req, BLOCKID) + blocks - 1) / RAID_TRACK_BLOCKS;
+		cost = (last - first + 1) * model_track + blocks * model_block;
+		if (first != dsk->head) {
+			cost += model_seek;
+			dsk->stats.seeks++;
+		}
+		dsk->head = last;
+		dsk->stats.requests++;
+		dsk->stats.tracks += last - first + 1;
+		dsk->stats.blocks += blocks;
+	}
+
+	// the transfer starts when the disk finishes the ones ahead of it
+	now = tagline_bench_now();
+	start = (dsk->busy_until > now) ? dsk->busy_until : now;
+	dsk->busy_until = start + cost;
+	dsk->stats.queued += start - now;
+	dsk->stats.busy += cost;
+	return(dsk->busy_until);
+}
+
+// The disk model backend
+const TaglineBusBackend tagline_bus_model = { "model", tagline_bus_model_request, tagline_bus_model_save,
+		tagline_bus_model_schedule, 0 };
@@ -0,0 +1,492 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_bus_net.c
+//  Description    : This is the implementation of the net backend of the
+//                   RAID bus, a client of tagline_server (see tagline_net.h
+//                   for the protocol).  Callers queue their requests; the
+//                   first to find no frame being sent sends every request
+//                   queued (up to a frame) and keeps going while more
+//                   arrive.  Only TAGLINE_NET_WINDOW frames wait for
+//                   answers at once, so under load the requests made while
+//                   the window is full share the next frame.  A receiver
+//                   thread takes the responses in order, reading the
+//                   opcodes and blocks of a frame in one call and copying
+//                   the blocks of each read to the caller's memory.
+//                   Closing the array, or losing the server, takes the
+//                   connection down; the next request connects again.
+//
+
+// Include Files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_bus.h"
+#include "tagline_net.h"
+#include "tagline_log.h"
+
+//
+// Type definitions
+
+// A request waiting to be sent or answered
+typedef struct tagline_net_slot {
+	RAIDOpCode      req;    // the request
+	RAIDOpCode      resp;   // the response (once done)
+	void           *buf;    // the block memory of the request
+	int             done;   // has the response arrived?
+	pthread_cond_t  ready;  // signalled when done
+	struct tagline_net_slot *next;  // the next request queued
+} TaglineNetSlot;
+
+// A queue of requests
+typedef struct {
+	TaglineNetSlot *head;  // the oldest request
+	TaglineNetSlot *tail;  // the newest request
+} TaglineNetQueue;
+
+//
+// Global data
+
+static char net_host[64] = TAGLINE_NET_HOST;   // the server address
+static uint16_t net_port = TAGLINE_NET_PORT;   // the server port
+static pthread_mutex_t net_lock = PTHREAD_MUTEX_INITIALIZER;  // protects the state below
+static TaglineNetQueue net_pending;            // requests not yet sent
+static TaglineNetQueue net_inflight;           // requests sent, not yet answered
+static int net_sock = -1;                      // the connection (-1 if none)
+static int net_sending = 0;                    // is a caller sending frames?
+static uint32_t net_window = 0;                // frames sent, not yet answered
+static pthread_cond_t net_opened = PTHREAD_COND_INITIALIZER;  // signalled when a frame is answered
+static int net_broken = 0;                     // has the connection failed?
+static int net_closing = 0;                    // is a caller taking the connection down?
+static char *net_frame = NULL;                 // the frame being sent
+static char *net_answer = NULL;                // the opcodes and blocks of the frame answered
+static pthread_t net_receiver;                 // the thread taking the responses
+static uint64_t net_requests = 0;              // requests sent since RAID_INIT
+static uint64_t net_frames = 0;                // frames they were sent in
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_net_server
+// Description  : Set the server the net backend connects to (before its
+//                first request)
+//
+// Inputs       : host - the server address (NULL keeps the default)
+//                port - the server port (0 keeps the default)
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_bus_net_server(const char *host, uint16_t port) {
+	if (net_sock != -1) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID bus server changed while connected");
+		return(-1);
+	}
+	if (host != NULL) {
+		if ((*host == '\0') || (strlen(host) >= sizeof(net_host))) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad RAID bus server [%s]", host);
+			return(-1);
+		}
+		strcpy(net_host, host);
+	}
+	if (port != 0) {
+		net_port = port;
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_net_push
+// Description  : Add a request to the end of a queue
+//
+// Inputs       : queue - the queue
+//                slot - the request
+// Outputs      : none
+
+static void tagline_bus_net_push(TaglineNetQueue *queue, TaglineNetSlot *slot) {
+	slot->next = NULL;
+	if (queue->tail != NULL) {
+		queue->tail->next = slot;
+	} else {
+		queue->head = slot;
+	}
+	queue->tail = slot;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_net_pop
+// Description  : Take the request at the head of a queue
+//
+// Inputs       : queue - the queue
+// Outputs      : the request, or NULL if the queue is empty
+
+static TaglineNetSlot *tagline_bus_net_pop(TaglineNetQueue *queue) {
+
+	TaglineNetSlot *slot = queue->head;
+
+	if (slot != NULL) {
+		if ((queue->head = slot->next) == NULL) {
+			queue->tail = NULL;
+		}
+	}
+	return(slot);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_net_complete
+// Description  : Hand a response to the caller waiting for it (called
+//                holding net_lock)
+//
+// Inputs       : slot - the request
+//                resp - the response
+// Outputs      : none
+
+static void tagline_bus_net_complete(TaglineNetSlot *slot, RAIDOpCode resp) {
+	slot->resp = resp;
+	slot->done = 1;
+	pthread_cond_signal(&slot->ready);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_net_break
+// Description  : Give up on the connection, failing every request sent or
+//                queued (called holding net_lock)
+//
+// Inputs       : none
+// Outputs      : none
+
+static void tagline_bus_net_break(void) {
+
+	TaglineNetSlot *slot;
+
+	if (! net_broken) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : lost the RAID bus server [%s:%u]", net_host, net_port);
+		net_broken = 1;
+		shutdown(net_sock, SHUT_RDWR);
+		pthread_cond_broadcast(&net_opened);
+	}
+	while (((slot = tagline_bus_net_pop(&net_inflight)) != NULL) ||
+			((slot = tagline_bus_net_pop(&net_pending)) != NULL)) {
+		tagline_bus_net_complete(slot, slot->req | TAGLINE_OPC_SET(STATUS, 1));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_net_read
+// Description  : Read bytes of a response frame, the receiver thread being
+//                cancellable only while it waits for them
+//
+// Inputs       : buf - the memory to read into
+//                len - the bytes to read
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_bus_net_read(void *buf, uint32_t len) {
+
+	int result;
+
+	pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+	result = cmpsc311_read_bytes(net_sock, len, buf);
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+	return(result ? -1 : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_net_receive
+// Description  : The receiver thread: take the response frames and hand
+//                each response to its caller, in the order sent
+//
+// Inputs       : arg - unused
+// Outputs      : NULL
+
+static void *tagline_bus_net_receive(void *arg) {
+
+	uint64_t hdr, *ops = (uint64_t *)net_answer;
+	TaglineNetSlot *slot;
+	uint32_t count, bytes, i, len;
+	char *payload;
+	int failed = 0;
+
+	// only cancelled while waiting for a frame (see tagline_bus_net_disconnect)
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+	while ((! failed) && (tagline_bus_net_read(&hdr, sizeof(hdr)) == 0)) {
+		hdr = ntohll64(hdr);
+		count = TAGLINE_NET_COUNT(hdr);
+		bytes = TAGLINE_NET_BYTES(hdr);
+		if ((count == 0) || (count > TAGLINE_NET_BATCH) || (bytes > TAGLINE_NET_MAX_PAYLOAD) ||
+				tagline_bus_net_read(net_answer, count * sizeof(uint64_t) + bytes)) {
+			break;
+		}
+
+		// the frame answers the oldest requests sent; the blocks read
+		// are copied to their callers
+		payload = (char *)&ops[count];
+		pthread_mutex_lock(&net_lock);
+		for (i = 0; i < count; i++) {
+			if ((slot = tagline_bus_net_pop(&net_inflight)) == NULL) {
+				break;
+			}
+			if ((len = tagline_net_payload(slot->req, 1)) > bytes) {
+				tagline_bus_net_complete(slot, slot->req | TAGLINE_OPC_SET(STATUS, 1));
+				break;
+			}
+			if (len > 0) {
+				memcpy(slot->buf, payload, len);
+				payload += len;
+				bytes -= len;
+			}
+			tagline_bus_net_complete(slot, ntohll64(ops[i]));
+		}
+		if (! (failed = (i < count) || (bytes != 0))) {
+			net_window--;
+			pthread_cond_signal(&net_opened);
+		}
+		pthread_mutex_unlock(&net_lock);
+	}
+
+	pthread_mutex_lock(&net_lock);
+	tagline_bus_net_break();
+	pthread_mutex_unlock(&net_lock);
+	return(NULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_net_connect
+// Description  : Connect to the server and start the receiver (called
+//                holding net_lock)
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_bus_net_connect(void) {
+
+	int one = 1;
+
+	if (net_frame == NULL) {
+		if ((net_frame = malloc(sizeof(uint64_t) * (1 + TAGLINE_NET_BATCH) + TAGLINE_NET_MAX_PAYLOAD)) == NULL) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate RAID bus frame");
+			return(-1);
+		}
+	}
+	if (net_answer == NULL) {
+		if ((net_answer = malloc(sizeof(uint64_t) * TAGLINE_NET_BATCH + TAGLINE_NET_MAX_PAYLOAD)) == NULL) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate RAID bus answer");
+			return(-1);
+		}
+	}
+
+	// a server going away fails the requests, it does not kill us
+	signal(SIGPIPE, SIG_IGN);
+	if ((net_sock = cmpsc311_client_connect(net_host, net_port)) == -1) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to connect to RAID bus server [%s:%u]", net_host, net_port);
+		return(-1);
+	}
+	setsockopt(net_sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	net_broken = 0;
+	net_window = 0;
+	if (pthread_create(&net_receiver, NULL, tagline_bus_net_receive, NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to start RAID bus receiver");
+		cmpsc311_close(net_sock);
+		net_sock = -1;
+		return(-1);
+	}
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : connected to RAID bus server [%s:%u]", net_host, net_port);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_net_disconnect
+// Description  : Take the connection down once the array is closed or the
+//                connection has failed, so the next request connects again
+//                (called holding net_lock, which is dropped while the
+//                receiver is joined)
+//
+// Inputs       : none
+// Outputs      : none
+
+static void tagline_bus_net_disconnect(void) {
+
+	if ((net_sock == -1) || net_closing) {
+		return;
+	}
+	net_closing = 1;
+
+	// fail what is still queued and stop the receiver, which after a
+	// close is still waiting for a frame (not a lost server, so no error)
+	if (! net_broken) {
+		net_broken = 1;
+		pthread_cancel(net_receiver);
+	}
+	tagline_bus_net_break();
+	while (net_sending) {
+		pthread_cond_wait(&net_opened, &net_lock);
+	}
+	pthread_mutex_unlock(&net_lock);
+	pthread_join(net_receiver, NULL);
+	pthread_mutex_lock(&net_lock);
+
+	cmpsc311_close(net_sock);
+	net_sock = -1;
+	net_broken = 0;
+	net_window = 0;
+	net_closing = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_net_send
+// Description  : Send the queued requests, a frame at a time, until none
+//                are left (called holding net_lock, which is dropped while
+//                each frame is built and sent)
+//
+// Inputs       : none
+// Outputs      : none
+
+static void tagline_bus_net_send(void) {
+
+	TaglineNetSlot *batch[TAGLINE_NET_BATCH];
+	uint64_t *ops = (uint64_t *)net_frame;
+	uint32_t count, sent, returned, len, i;
+	char *payload;
+
+	net_sending = 1;
+	while ((net_pending.head != NULL) && (! net_broken)) {
+
+		// wait for room in the window, more requests queueing meanwhile
+		if (net_window >= TAGLINE_NET_WINDOW) {
+			pthread_cond_wait(&net_opened, &net_lock);
+			continue;
+		}
+
+		// take what fits in a frame; the responses come back in this order
+		count = sent = returned = 0;
+		while ((net_pending.head != NULL) && (count < TAGLINE_NET_BATCH) &&
+				(sent + tagline_net_payload(net_pending.head->req, 0) <= TAGLINE_NET_MAX_PAYLOAD) &&
+				(returned + tagline_net_payload(net_pending.head->req, 1) <= TAGLINE_NET_MAX_PAYLOAD)) {
+			batch[count] = tagline_bus_net_pop(&net_pending);
+			sent += tagline_net_payload(batch[count]->req, 0);
+			returned += tagline_net_payload(batch[count]->req, 1);
+			tagline_bus_net_push(&net_inflight, batch[count++]);
+		}
+		net_requests += count;
+		net_frames++;
+		net_window++;
+		pthread_mutex_unlock(&net_lock);
+
+		// one write per frame: header, opcodes, then the blocks written
+		ops[0] = htonll64(TAGLINE_NET_FRAME(count, sent));
+		payload = (char *)&ops[1 + count];
+		for (i = 0; i < count; i++) {
+			ops[1 + i] = htonll64(batch[i]->req);
+			if ((len = tagline_net_payload(batch[i]->req, 0)) > 0) {
+				memcpy(payload, batch[i]->buf, len);
+				payload += len;
+			}
+		}
+		len = payload - net_frame;
+		if (cmpsc311_send_bytes(net_sock, len, net_frame)) {
+			pthread_mutex_lock(&net_lock);
+			tagline_bus_net_break();
+			break;
+		}
+		pthread_mutex_lock(&net_lock);
+	}
+	net_sending = 0;
+	pthread_cond_broadcast(&net_opened);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_net_request
+// Description  : Perform a RAID bus request on the server, waiting for its
+//                response (any number of callers at once)
+//
+// Inputs       : req - the request opcode
+//                buf - the block memory of the request (may be NULL)
+// Outputs      : the response opcode (the result bit set on failure)
+
+static RAIDOpCode tagline_bus_net_request(RAIDOpCode req, void *buf) {
+
+	TaglineNetSlot slot;
+
+	if ((tagline_net_payload(req, 0) || tagline_net_payload(req, 1)) && (buf == NULL)) {
+		return(req | TAGLINE_OPC_SET(STATUS, 1));
+	}
+	slot.req = req;
+	slot.buf = buf;
+	slot.done = 0;
+	pthread_cond_init(&slot.ready, NULL);
+
+	pthread_mutex_lock(&net_lock);
+	if ((net_sock == -1) && tagline_bus_net_connect()) {
+		pthread_mutex_unlock(&net_lock);
+		pthread_cond_destroy(&slot.ready);
+		return(req | TAGLINE_OPC_SET(STATUS, 1));
+	}
+	if (net_broken) {
+		tagline_bus_net_complete(&slot, req | TAGLINE_OPC_SET(STATUS, 1));
+	} else {
+		tagline_bus_net_push(&net_pending, &slot);
+		if (! net_sending) {
+			tagline_bus_net_send();
+		}
+	}
+	while (! slot.done) {
+		pthread_cond_wait(&slot.ready, &net_lock);
+	}
+
+	// report how well the requests of the array were batched
+	if (! raid_request_failed(slot.resp)) {
+		if (TAGLINE_OPC_GET(req, REQTYPE) == RAID_INIT) {
+			net_requests = net_frames = 0;
+		} else if ((TAGLINE_OPC_GET(req, REQTYPE) == RAID_CLOSE) && (net_frames > 0)) {
+			TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : RAID bus client sent %lu requests in %lu frames (%.2f per frame)",
+					net_requests, net_frames, (double)net_requests / net_frames);
+		}
+	}
+
+	// a closed array or a failed connection is taken down, so the next
+	// RAID_INIT connects again
+	if (net_broken || (TAGLINE_OPC_GET(req, REQTYPE) == RAID_CLOSE)) {
+		tagline_bus_net_disconnect();
+	}
+	pthread_mutex_unlock(&net_lock);
+	pthread_cond_destroy(&slot.ready);
+	return(slot.resp);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_net_save
+// Description  : Have the server save the contents of the array as a store
+//
+// Inputs       : path - the store file (on the server)
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_bus_net_save(const char *path) {
+
+	uint32_t len = strlen(path);
+
+	if ((len == 0) || (len >= FILENAME_MAX)) {
+		return(-1);
+	}
+	RAIDOpCode req = TAGLINE_OPC_SET(REQTYPE, TAGLINE_NET_SAVE) | TAGLINE_OPC_SET(BLOCKID, len);
+	return(raid_request_failed(tagline_bus_net_request(req, (void *)path)) ? -1 : 0);
+}
+
+// The net backend (its requests need no bus lock, the server takes them in order)
+const TaglineBusBackend tagline_bus_net = { "net", tagline_bus_net_request, tagline_bus_net_save, NULL, 1 };
@@ -0,0 +1,364 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_cache.c
+//  Description    : This is the implementation of the write-back block cache
+//                   for the tagline driver.  Blocks are stored in frames
+//                   indexed by the cmpsc311 object cache (OID is the disk and
+//                   RAID block).  The victim is chosen by a pluggable
+//                   replacement policy (see tagline_policy.h) so that dirty
+//                   blocks can be written back before they leave the cache.
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+#include <cmpsc311_cache.h>
+
+// Project Includes
+#include "tagline_cache.h"
+#include "tagline_policy.h"
+#include "tagline_driver.h"
+#include "tagline_log.h"
+
+// Defines
+#define TAGLINE_CACHE_OID(dsk, blk) (((uint32_t)(dsk) * RAID_DISKBLOCKS) + (blk))
+#define TAGLINE_CACHE_DISK(oid)     ((RAIDDiskID)((oid) / RAID_DISKBLOCKS))
+#define TAGLINE_CACHE_BLOCK(oid)    ((RAIDBlockID)((oid) % RAID_DISKBLOCKS))
+
+//
+// Type definitions
+
+// A cached block
+typedef struct {
+	uint32_t oid;                       // the disk/block the frame holds
+	int      dirty;                     // not yet written to the array
+	char     data[TAGLINE_BLOCK_SIZE];  // the block contents
+} TaglineCacheFrame;
+
+//
+// Global data
+
+static uint32_t tagline_cache_size = TAGLINE_DEFAULT_CACHE_BLOCKS; // capacity for next init
+static uint32_t tagline_cache_capacity = 0;      // capacity of the open cache (0 is off)
+static TaglinePolicyType tagline_cache_policy_type = TAGLINE_POLICY_LRU; // policy for next init
+static const TaglinePolicy *cache_policy = NULL; // the policy of the open cache
+static uint32_t tagline_cache_items = 0;         // number of frames in the cache
+static TaglineCacheFrame **cache_frames = NULL;  // every frame in the cache
+static TaglineCacheWriteback cache_writeback = NULL; // write dirty data to the array
+static TaglineCacheStats cache_stats;            // the cache counters
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : frame_compare
+// Description  : Order frames by disk and block, for qsort
+//
+// Inputs       : a, b - pointers to the frame pointers to compare
+// Outputs      : <0, 0, >0 as a is before, the same as or after b
+
+static int frame_compare(const void *a, const void *b) {
+	uint32_t oa = (*(TaglineCacheFrame * const *)a)->oid;
+	uint32_t ob = (*(TaglineCacheFrame * const *)b)->oid;
+	return((oa > ob) - (oa < ob));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_tagline_cache_size
+// Description  : Set the capacity used by the next init_tagline_cache
+//
+// Inputs       : max_blocks - the number of blocks to cache (0 disables)
+// Outputs      : 0 if successful, -1 if failure
+
+int set_tagline_cache_size(uint32_t max_blocks) {
+	tagline_cache_size = max_blocks;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_tagline_cache_policy
+// Description  : Set the replacement policy used by the next init_tagline_cache
+//
+// Inputs       : type - the replacement policy
+// Outputs      : 0 if successful, -1 if failure
+
+int set_tagline_cache_policy(TaglinePolicyType type) {
+	if (tagline_policy(type) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad cache policy [%d]", type);
+		return(-1);
+	}
+	tagline_cache_policy_type = type;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : init_tagline_cache
+// Description  : Initialize the cache
+//
+// Inputs       : writeback - function writing dirty blocks to the array
+// Outputs      : 0 if successful, -1 if failure
+
+int init_tagline_cache(TaglineCacheWriteback writeback) {
+
+	memset(&cache_stats, 0x0, sizeof(cache_stats));
+	cache_writeback = writeback;
+	tagline_cache_items = 0;
+
+	// A zero sized cache leaves the driver talking to the bus directly
+	if (tagline_cache_size == 0) {
+		tagline_cache_capacity = 0;
+		return(0);
+	}
+	if (init_cmpsc311_cache(tagline_cache_size, tagline_cache_size * sizeof(TaglineCacheFrame))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to initialize block cache [%u]", tagline_cache_size);
+		return(-1);
+	}
+	cache_policy = tagline_policy(tagline_cache_policy_type);
+	if (cache_policy->init(tagline_cache_size)) {
+		close_cmpsc311_cache();
+		return(-1);
+	}
+	if ((cache_frames = malloc(tagline_cache_size * sizeof(TaglineCacheFrame *))) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate cache frame table");
+		cache_policy->close();
+		close_cmpsc311_cache();
+		return(-1);
+	}
+	tagline_cache_capacity = tagline_cache_size;
+
+	// Return successfully
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : block cache initialized (%u blocks, %s)", tagline_cache_capacity,
+			TAGLINE_POLICY_LABELS[tagline_cache_policy_type]);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : close_tagline_cache
+// Description  : Flush the dirty blocks and release the cache
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int close_tagline_cache(void) {
+
+	int result = 0;
+
+	if (tagline_cache_capacity == 0) {
+		return(0);
+	}
+
+	// A failed write back still releases the cache, so it can be set up
+	// again
+	if (flush_tagline_cache()) {
+		result = -1;
+	}
+
+	// The cmpsc311 cache frees the frames it holds
+	if (close_cmpsc311_cache()) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failed closing block cache");
+		result = -1;
+	}
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : block cache closed [hits=%lu, misses=%lu, evictions=%lu, writebacks=%lu]",
+			cache_stats.hits, cache_stats.misses, cache_stats.evictions, cache_stats.writebacks);
+	cache_policy->close();
+	free(cache_frames);
+	cache_frames = NULL;
+	tagline_cache_capacity = 0;
+	tagline_cache_items = 0;
+	return(result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_cache_enabled
+// Description  : Is there a cache between the driver and the bus?
+//
+// Inputs       : none
+// Outputs      : 1 if the cache is open, 0 otherwise
+
+int tagline_cache_enabled(void) {
+	return(tagline_cache_capacity > 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : get_tagline_cache
+// Description  : Copy a block out of the cache
+//
+// Inputs       : dsk - the disk of the block
+//                blk - the RAID block number
+//                buf - the memory to copy the block into
+// Outputs      : 1 if the block was found, 0 if not
+
+int get_tagline_cache(RAIDDiskID dsk, RAIDBlockID blk, char *buf) {
+
+	TaglineCacheFrame *frm = get_cmpsc311_cache(TAGLINE_CACHE_OID(dsk, blk));
+
+	if (frm == NULL) {
+		cache_stats.misses++;
+		return(0);
+	}
+	cache_stats.hits++;
+	cache_policy->hit(frm->oid);
+	memcpy(buf, frm->data, TAGLINE_BLOCK_SIZE);
+	return(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_cache_cluster
+// Description  : Write back a dirty victim together with the dirty blocks
+//                cached after it on the same disk, in one transfer; they
+//                stay cached, clean, so evicting them later writes nothing
+//
+// Inputs       : frm - the victim (no longer in the cache)
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_cache_cluster(TaglineCacheFrame *frm) {
+
+	TaglineCacheFrame *next;
+	char xfer[RAID_MAX_XFER * TAGLINE_BLOCK_SIZE];
+	uint32_t run;
+
+	memcpy(xfer, frm->data, TAGLINE_BLOCK_SIZE);
+	for (run = 1; (run < RAID_MAX_XFER) && (TAGLINE_CACHE_BLOCK(frm->oid) + run < RAID_DISKBLOCKS); run++) {
+		if (((next = get_cmpsc311_cache(frm->oid + run)) == NULL) || (! next->dirty)) {
+			break;
+		}
+		memcpy(&xfer[run * TAGLINE_BLOCK_SIZE], next->data, TAGLINE_BLOCK_SIZE);
+		next->dirty = 0;
+	}
+	if (cache_writeback(TAGLINE_CACHE_DISK(frm->oid), TAGLINE_CACHE_BLOCK(frm->oid), run, xfer)) {
+		return(-1);
+	}
+	cache_stats.writebacks += run;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : put_tagline_cache
+// Description  : Put a block into the cache, evicting the block chosen by
+//                the replacement policy (written back first if dirty) when full
+//
+// Inputs       : dsk - the disk of the block
+//                blk - the RAID block number
+//                buf - the block contents
+//                dirty - the block has not been written to the array
+// Outputs      : 0 if successful, -1 if failure
+
+int put_tagline_cache(RAIDDiskID dsk, RAIDBlockID blk, char *buf, int dirty) {
+
+	uint32_t oid = TAGLINE_CACHE_OID(dsk, blk), victim;
+	TaglineCacheFrame *frm = get_cmpsc311_cache(oid);
+
+	// Update a block that is already cached; a clean fill never replaces
+	// a cached copy, which may have been written since the fill was read
+	if (frm != NULL) {
+		if (dirty) {
+			memcpy(frm->data, buf, TAGLINE_BLOCK_SIZE);
+			frm->dirty = 1;
+		}
+		cache_policy->hit(oid);
+		return(0);
+	}
+
+	// Reuse the victim's frame if full, else make a new one
+	if (tagline_cache_items == tagline_cache_capacity) {
+		victim = cache_policy->replace(oid);
+		if ((frm = delete_cmpsc311_cache(victim)) == NULL) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : cache policy chose uncached victim [%u]", victim);
+			return(-1);
+		}
+		if (frm->dirty && tagline_cache_cluster(frm)) {
+			return(-1);
+		}
+		cache_stats.evictions++;
+	} else if ((frm = malloc(sizeof(TaglineCacheFrame))) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate cache frame");
+		return(-1);
+	} else {
+		cache_frames[tagline_cache_items++] = frm;
+	}
+
+	// Fill the frame and hand it to the cache
+	frm->oid = oid;
+	frm->dirty = dirty;
+	memcpy(frm->data, buf, TAGLINE_BLOCK_SIZE);
+	if (put_cmpsc311_cache(oid, frm, sizeof(TaglineCacheFrame))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failed putting block in cache [%u/%u]", dsk, blk);
+		return(-1);
+	}
+	cache_policy->insert(oid);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : flush_tagline_cache
+// Description  : Write all of the dirty blocks back to the array, in disk
+//                and block order so neighbouring blocks go in one transfer
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int flush_tagline_cache(void) {
+
+	TaglineCacheFrame **dirty, *frm;
+	char xfer[RAID_MAX_XFER * TAGLINE_BLOCK_SIZE];
+	uint32_t ndirty = 0, start, run, i;
+
+	if (tagline_cache_capacity == 0) {
+		return(0);
+	}
+	if ((dirty = malloc((tagline_cache_items + 1) * sizeof(TaglineCacheFrame *))) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate cache flush list");
+		return(-1);
+	}
+	for (i = 0; i < tagline_cache_items; i++) {
+		if (cache_frames[i]->dirty) {
+			dirty[ndirty++] = cache_frames[i];
+		}
+	}
+	qsort(dirty, ndirty, sizeof(TaglineCacheFrame *), frame_compare);
+
+	// Gather runs of consecutive blocks on the same disk
+	for (start = 0; start < ndirty; start += run) {
+		for (run = 0; (start + run < ndirty) && (run < RAID_MAX_XFER); run++) {
+			frm = dirty[start + run];
+			if ((run > 0) && ((frm->oid != dirty[start]->oid + run) ||
+					(TAGLINE_CACHE_DISK(frm->oid) != TAGLINE_CACHE_DISK(dirty[start]->oid)))) {
+				break;
+			}
+			memcpy(&xfer[run * TAGLINE_BLOCK_SIZE], frm->data, TAGLINE_BLOCK_SIZE);
+			frm->dirty = 0;
+		}
+		if (cache_writeback(TAGLINE_CACHE_DISK(dirty[start]->oid), TAGLINE_CACHE_BLOCK(dirty[start]->oid), run, xfer)) {
+			free(dirty);
+			return(-1);
+		}
+		cache_stats.writebacks += run;
+	}
+
+	// Return successfully
+	free(dirty);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_cache_stats
+// Description  : Get the counters for the cache
+//
+// Inputs       : stats - the structure to copy the counters into
+// Outputs      : none
+
+void tagline_cache_stats(TaglineCacheStats *stats) {
+	*stats = cache_stats;
+}
@@ -0,0 +1,63 @@
+#ifndef TAGLINE_CACHE_INCLUDED
+#define TAGLINE_CACHE_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_cache.h
+//  Description    : This is the header file for the write-back block cache
+//                   that sits between the tagline driver and the RAID bus.
+//
+
+// Includes
+#include <stdint.h>
+#include "raid_bus.h"
+#include "tagline_policy.h"
+
+// Defines
+#define TAGLINE_DEFAULT_CACHE_BLOCKS 1024  // default cache capacity (1k blocks)
+
+//
+// Type definitions
+
+// Function the cache calls to write dirty blocks back to the array
+typedef int (*TaglineCacheWriteback)(RAIDDiskID dsk, RAIDBlockID blk, uint32_t count, char *buf);
+
+// Counters describing the behaviour of the cache
+typedef struct {
+	uint64_t hits;        // lookups found in the cache
+	uint64_t misses;      // lookups not found in the cache
+	uint64_t evictions;   // blocks removed to make space
+	uint64_t writebacks;  // dirty blocks written back to the array
+} TaglineCacheStats;
+
+//
+// Interface functions
+
+int set_tagline_cache_size(uint32_t max_blocks);
+	// Set the capacity (in blocks) used by the next init_tagline_cache, 0 disables
+
+int set_tagline_cache_policy(TaglinePolicyType type);
+	// Set the replacement policy used by the next init_tagline_cache
+
+int init_tagline_cache(TaglineCacheWriteback writeback);
+	// Initialize the cache, writing dirty blocks back through the function
+
+int close_tagline_cache(void);
+	// Flush the dirty blocks and release the cache
+
+int tagline_cache_enabled(void);
+	// Is there a cache between the driver and the bus?
+
+int get_tagline_cache(RAIDDiskID dsk, RAIDBlockID blk, char *buf);
+	// Copy a block out of the cache (1 if found, 0 if not)
+
+int put_tagline_cache(RAIDDiskID dsk, RAIDBlockID blk, char *buf, int dirty);
+	// Put a block into the cache, marking it dirty if not yet on the array
+
+int flush_tagline_cache(void);
+	// Write all of the dirty blocks back to the array
+
+void tagline_cache_stats(TaglineCacheStats *stats);
+	// Get the counters for the cache
+
+#endif /* TAGLINE_CACHE_INCLUDED */
@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File          : tagline_convert.c
+//  Description   : This is a tool that converts tagline workloads between
+//                  the text (.dat) format and the binary trace format.
+//
+
+// Include Files
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+// Project Includes
+#include <cmpsc311_log.h>
+#include "tagline_trace.h"
+
+// Defines
+#define CONVERT_ARGUMENTS "hvzl:"
+#define CONVERT_CHUNK 65536
+#define USAGE \
+	"USAGE: tagline_convert [-h] [-v] [-z] [-l <logfile>] <input-file> <output-file>\n" \
+	"\n" \
+	"where:\n" \
+	"    -h - help mode (display this message)\n" \
+	"    -v - verbose output\n" \
+	"    -z - compress the binary trace\n" \
+	"    -l - write log messages to the filename <logfile>\n" \
+	"\n" \
+	"    A text workload is converted to a binary trace, a binary trace is\n" \
+	"    converted back to a text workload.\n" \
+	"\n" \
+
+//
+// Functional Prototypes
+
+int convert_to_binary(char *input, char *output, int compress);
+int convert_to_text(char *input, char *output);
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : main
+// Description  : The main function for the workload converter
+//
+// Inputs       : argc - the number of command line parameters
+//                argv - the parameters
+// Outputs      : 0 if successful, -1 if failure
+
+int main(int argc, char *argv[]) {
+
+	// Local variables
+	int ch, verbose = 0, log_initialized = 0, compress = 0;
+
+	// Process the command line parameters
+	while ((ch = getopt(argc, argv, CONVERT_ARGUMENTS)) != -1) {
+
+		switch (ch) {
+		case 'h': // Help, print usage
+			fprintf(stderr, USAGE);
+			return( -1 );
+
+		case 'v': // Verbose Flag
+			verbose = 1;
+			break;
+
+		case 'z': // Compress Flag
+			compress = 1;
+			break;
+
+		case 'l': // Set the log filename
+			initializeLogWithFilename(optarg);
+			log_initialized = 1;
+			break;
+
+		default:  // Default (unknown)
+			fprintf(stderr, "Unknown command line option (%c), aborting.\n", ch);
+			return( -1 );
+		}
+	}
+
+	// Setup the log as needed
+	if (! log_initialized) {
+		initializeLogWithFilehandle(CMPSC311_LOG_STDERR);
+	}
+	if (verbose) {
+		enableLogLevels(LOG_INFO_LEVEL);
+	}
+
+	// The input and output filenames should be the next options
+	if (optind + 2 != argc) {
+		fprintf( stderr, "Missing command line parameters, use -h to see usage, aborting.\n" );
+		return( -1 );
+	}
+
+	// Convert in whichever direction the input calls for
+	if (tagline_trace_is_binary(argv[optind])) {
+		return(convert_to_text(argv[optind], argv[optind + 1]));
+	}
+	return(convert_to_binary(argv[optind], argv[optind + 1], compress));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : convert_to_binary
+// Description  : Convert a text workload to a binary trace
+//
+// Inputs       : input - the text workload file
+//                output - the binary trace file to create
+//                compress - compress the trace if non-zero
+// Outputs      : 0 if successful, -1 if failure
+
+int convert_to_binary(char *input, char *output, int compress) {
+
+	TaglineTrace trace;
+	int err;
+
+	if (tagline_trace_load(input, &trace)) {
+		return(-1);
+	}
+	err = tagline_trace_save(output, &trace, compress);
+	tagline_trace_free(&trace);
+	return(err);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : convert_to_text
+// Description  : Convert a binary trace back to a text workload
+//
+// Inputs       : input - the binary trace file
+//                output - the text workload file to create
+// Outputs      : 0 if successful, -1 if failure
+
+int convert_to_text(char *input, char *output) {
+
+	TaglineTrace trace;
+	TaglineTraceFile tf;
+	TaglineTraceOp *op;
+	FILE *fhandle;
+	int n, i, err = 0;
+
+	if (tagline_trace_open(input, &tf)) {
+		return(-1);
+	}
+	if ((fhandle = fopen(output, "w")) == NULL) {
+		logMessage(LOG_ERROR_LEVEL, "Failure creating the workload file [%s], error: %s.",
+			output, strerror(errno));
+		tagline_trace_close(&tf);
+		return(-1);
+	}
+
+	// Stream the trace a chunk at a time, writing a line per operation
+	memset(&trace, 0x0, sizeof(trace));
+	while ((! err) && ((n = tagline_trace_read(&tf, &trace, CONVERT_CHUNK)) > 0)) {
+		for (i = 0; (i < n) && (! err); i++) {
+			op = &trace.ops[i];
+			err = (fprintf(fhandle, "%s %u %u %u %.*s\n", TAGLINE_OP_LABELS[op->cmd], op->tag,
+					(op->cmd == TAGLINE_OP_VALIDATE) ? op->length : op->blocks, op->start, (int)op->length, &trace.text[op->text]) < 0);
+		}
+	}
+	if (n < 0) {
+		err = 1;
+	}
+
+	// Clean up and return
+	if ((fclose(fhandle) != 0) || err) {
+		logMessage(LOG_ERROR_LEVEL, "Failure writing the workload file [%s]", output);
+		err = 1;
+	}
+	tagline_trace_close(&tf);
+	tagline_trace_free(&trace);
+	return(err ? -1 : 0);
+}
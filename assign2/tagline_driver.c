@@ -8,59 +8,1556 @@
 //  Created        : ?????
 
 // Include Files
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <cmpsc311_log.h>
 
 // Project Includes
 #include "raid_bus.h"
 #include "tagline_driver.h"
+#include "tagline_extent.h"
+#include "tagline_cache.h"
+#include "tagline_io.h"
+#include "tagline_log.h"
+#include "tagline_meta.h"
+#include "tagline_journal.h"
+#include "tagline_alloc.h"
+#include "tagline_segment.h"
+#include "tagline_stripe.h"
+#include "tagline_readahead.h"
+#include "tagline_bus.h"
 
 // Defines
-#define NUM_OF_TAGLINES		1  // number of taglines received
+#define TAGLINE_DIRECTORY_MAX	(UINT16_MAX + 1)  // size of the TagLineNumber space
+#define TAGLINE_CLEAN_TDEAD		24                // blocks of the unit test victim overwritten
 
 // Global declarations
-uint32_t current_filled[RAID_DISKS];					// records how much data is on each disk
-int i;											// loop variable
-int k;											// loop variable
+uint32_t current_filled[RAID_DISKS];					// records how much data is on each disk (atomic)
 
 // define a TAGLINE structure
 typedef struct
 {
 	int32_t tag_name;							// the name of the tagline
-	int64_t addresses[MAX_TAGLINE_BLOCK_NUMBER][2]; // the memory structure
+	TaglineExtentMap map;						// where the blocks of the line live
+	pthread_rwlock_t lock;						// held to read the map off the dispatcher, and to change it
+	uint32_t reads;								// reads of the line started but not finished
 } TAGLINE;
 
-TAGLINE *tags[NUM_OF_TAGLINES];			// an array of pointers to TAGLINE structures
+// The dispatcher is the only thread that changes the directory and the
+// maps; it publishes a new tagline with a release store, so lookups take
+// no lock.  Other threads walking the directory hold directory_lock, which
+// the dispatcher takes only to unpublish a tagline before freeing it.
+TAGLINE **tag_directory = NULL;				// direct-indexed table of taglines, by tag number
+uint32_t tag_directory_size = 0;			// number of slots in the tag directory
+pthread_rwlock_t directory_lock = PTHREAD_RWLOCK_INITIALIZER;	// keeps taglines alive for directory walks
+uint64_t blocked_tags[TAGLINE_DIRECTORY_MAX / 64];	// tags with a request held back (dispatcher only)
 
+// the states of an asynchronous request slot
+typedef enum {
+	TAGLINE_REQ_FREE     = 0,  // slot is unused
+	TAGLINE_REQ_QUEUED   = 1,  // submitted, waiting for the dispatcher
+	TAGLINE_REQ_INFLIGHT = 2,  // bus transfers are running
+	TAGLINE_REQ_DONE     = 3,  // complete, waiting for tagline_wait
+} TAGLINE_REQ_STATES;
+
+// the kinds of request
+typedef enum {
+	TAGLINE_REQ_READ   = 0,  // read blocks of a tagline
+	TAGLINE_REQ_WRITE  = 1,  // write blocks of a tagline
+	TAGLINE_REQ_DELETE = 2,  // delete a tagline, freeing its blocks
+} TAGLINE_REQ_TYPES;
+
+// define an asynchronous request structure
+typedef struct
+{
+	int state;									// the TAGLINE_REQ_STATES of the slot
+	int type;									// the TAGLINE_REQ_TYPES of the request
+	TagLineNumber tag;							// the tagline
+	TagLineBlockNumber bnum;					// the first block
+	uint8_t blks;								// the number of blocks
+	struct iovec iov[MAX_TAGLINE_BLOCK_NUMBER];	// the caller's memory, whole blocks per segment
+	int iovcnt;									// the number of segments
+	TaglineCompletion callback;					// called on completion (may be NULL)
+	void *arg;									// passed to the callback
+	int result;									// 0 if successful, -1 if failure
+	int32_t next;								// next slot in the free/submit/complete list
+	TAGLINE *line;								// the tagline a started read counts against (or NULL)
+	char *ahead;								// the readahead window a read goes through (or NULL)
+	uint32_t ahead_blk;							// the first block of the read in the window
+	pthread_cond_t done;						// signalled when the request completes
+	TaglineIoBatch batch;						// the bus transfers of the request
+} TAGLINE_REQUEST;
+
+uint32_t tagline_queue_depth = TAGLINE_DEFAULT_QUEUE_DEPTH;	// slots for the next init
+TAGLINE_REQUEST *requests = NULL;			// the request slots
+uint32_t num_requests = 0;					// the number of request slots
+int32_t free_head = -1;						// slots not in use
+int32_t submit_head = -1, submit_tail = -1;	// requests waiting for the dispatcher
+int32_t complete_head = -1;					// requests whose transfers have finished
+int32_t commit_head = -1;					// finished updates waiting for a journal commit
+uint32_t requests_inflight = 0;				// requests started but not finished
+int dispatcher_stop = 0;					// should the dispatcher exit?
+pthread_t dispatcher;						// the thread that runs the requests
+pthread_mutex_t request_lock = PTHREAD_MUTEX_INITIALIZER;	// protects the slots and lists
+pthread_cond_t dispatcher_wake = PTHREAD_COND_INITIALIZER;	// work for the dispatcher
+pthread_cond_t slot_free = PTHREAD_COND_INITIALIZER;		// a slot was freed
+
+char *tagline_meta_file = NULL;				// the metadata image (NULL if not persistent)
+TaglineMetaImage meta_image;				// the image the directory was loaded from
+TaglineInitMode tagline_init_mode = TAGLINE_INIT_AUTO;	// cold or warm start
+uint64_t tagline_journal_limit = TAGLINE_JOURNAL_DEFAULT_LIMIT;	// compaction size (0 is no journal)
+uint64_t journal_compact_at = 0;			// journal size that triggers the next compaction
+int journal_failed = 0;						// a commit failed, writes are no longer durable
+int tagline_log_structured = 0;				// log-structured writes for the next init
+int log_mode = 0;							// writes append to the segment log
+int cleaner_failed = 0;						// a segment could not be cleaned, stop cleaning
+TaglinePlaceType tagline_placement = TAGLINE_PLACE_TRACK;	// placement of new blocks for the next init
+TaglinePlaceType placement = TAGLINE_PLACE_TRACK;	// where new blocks go outside log mode
+uint32_t tagline_stripe_unit = 0;			// RAID-5 stripe unit for the next init (0 is no striping)
+uint32_t array_disks = RAID_DISKS;			// the disks blocks are allocated on (data disks if striped)
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_raid_writeback
+// Description  : Write dirty blocks evicted or flushed from the cache.  The
+//                write is posted to the disk's queue, so the dispatcher
+//                does not wait for it; reads of the blocks queue behind it.
+//
+// Inputs       : disk - the disk to write to
+//                rblock - the first RAID block to write
+//                count - the number of blocks to write
+//                buf - the block contents
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_raid_writeback(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, char *buf) {
+	return(tagline_io_post(disk, rblock, count, buf));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_cached_read
+// Description  : Read a run of consecutive blocks on one disk, taking the
+//                blocks found in the cache and adding a transfer to the
+//                batch for each run of missing blocks
+//
+// Inputs       : batch - the batch collecting the bus transfers
+//                disk - the disk to read from
+//                rblock - the first RAID block of the run
+//                count - the number of blocks (at most MAX_TAGLINE_BLOCK_NUMBER)
+//                buf - the memory to read into
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_cached_read(TaglineIoBatch *batch, RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, char *buf) {
+
+	uint8_t hit[MAX_TAGLINE_BLOCK_NUMBER];
+	uint32_t blk, miss;
+
+	if (! tagline_cache_enabled()) {
+		return(tagline_io_add(batch, RAID_READ, disk, rblock, count, buf));
+	}
+
+	// Pick up everything the cache has
+	for (blk = 0; blk < count; blk++) {
+		hit[blk] = get_tagline_cache(disk, rblock + blk, &buf[blk * TAGLINE_BLOCK_SIZE]);
+	}
+
+	// Read the holes from the bus
+	for (blk = 0; blk < count; blk += miss) {
+		if (hit[blk]) {
+			miss = 1;
+			continue;
+		}
+		for (miss = 1; (blk + miss < count) && (! hit[blk + miss]); miss++);
+		if (tagline_io_add(batch, RAID_READ, disk, rblock + blk, miss, &buf[blk * TAGLINE_BLOCK_SIZE])) {
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_cache_fill
+// Description  : Put the blocks read by a completed batch into the cache
+//
+// Inputs       : batch - the completed batch of reads
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_cache_fill(TaglineIoBatch *batch) {
+
+	TaglineIoRequest *req;
+	uint32_t r, blk;
+
+	if (! tagline_cache_enabled()) {
+		return(0);
+	}
+	for (r = 0; r < batch->nreqs; r++) {
+		req = &batch->reqs[r];
+		for (blk = 0; blk < req->count; blk++) {
+			if (put_tagline_cache(req->disk, req->rblock + blk, &req->buf[blk * TAGLINE_BLOCK_SIZE], 0)) {
+				return(-1);
+			}
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_cached_write
+// Description  : Write a run of consecutive blocks on one disk; with the
+//                cache enabled the blocks are only marked dirty in the cache
+//                and reach the bus when evicted or flushed, otherwise a
+//                transfer is added to the batch
+//
+// Inputs       : batch - the batch collecting the bus transfers
+//                disk - the disk to write to
+//                rblock - the first RAID block of the run
+//                count - the number of blocks in the run
+//                buf - the memory to write from
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_cached_write(TaglineIoBatch *batch, RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, char *buf) {
+
+	uint32_t blk;
+
+	if (! tagline_cache_enabled()) {
+		return(tagline_io_add(batch, RAID_WRITE, disk, rblock, count, buf));
+	}
+	for (blk = 0; blk < count; blk++) {
+		if (put_tagline_cache(disk, rblock + blk, &buf[blk * TAGLINE_BLOCK_SIZE], 1)) {
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_lookup
+// Description  : Find the tagline structure for a tag number in O(1)
+//
+// Inputs       : tag - the tag number to look up
+// Outputs      : pointer to the tagline, or NULL if the tag has no data
+
+static TAGLINE *tagline_lookup(TagLineNumber tag) {
+	if (tag >= tag_directory_size) {
+		return(NULL);
+	}
+	return(__atomic_load_n(&tag_directory[tag], __ATOMIC_ACQUIRE));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_create
+// Description  : Allocate the tagline structure for a new tag number
+//
+// Inputs       : tag - the tag number to create
+// Outputs      : pointer to the new tagline, or NULL if failure
+
+static TAGLINE *tagline_create(TagLineNumber tag) {
+
+	TAGLINE *line;
+
+	if (tag >= tag_directory_size) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : tag %u out of range (maxlines=%u)", tag, tag_directory_size);
+		return(NULL);
+	}
+	if ((line = malloc(sizeof(TAGLINE))) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate tagline %u", tag);
+		return(NULL);
+	}
+
+	// every block starts out unmapped; the line is published whole
+	line->tag_name = tag;
+	tagline_extent_init(&line->map);
+	pthread_rwlock_init(&line->lock, NULL);
+	line->reads = 0;
+	__atomic_store_n(&tag_directory[tag], line, __ATOMIC_RELEASE);
+	return(line);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_release
+// Description  : Give blocks that no longer hold tagline data back to the
+//                free space (through the segment log in log mode)
+//
+// Inputs       : disk - the disk of the blocks
+//                rblock - the first block
+//                count - the number of blocks
+// Outputs      : none
+
+static void tagline_release(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count) {
+	if (log_mode) {
+		tagline_segment_release(disk, rblock, count);
+	} else {
+		tagline_alloc_free(disk, rblock, count);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_claim
+// Description  : Record that a run of blocks now holds tagline data
+//
+// Inputs       : line - the tagline stored
+//                run - the tagline blocks and where they are
+// Outputs      : none
+
+static void tagline_claim(TAGLINE *line, TaglineExtent *run) {
+
+	uint32_t filled = __atomic_load_n(&current_filled[run->disk], __ATOMIC_RELAXED);
+
+	tagline_alloc_mark(run->disk, run->rblock, run->length);
+	if (log_mode) {
+		tagline_segment_own(run->disk, run->rblock, run->length, line->tag_name, run->lblock);
+	} else if (placement == TAGLINE_PLACE_TRACK) {
+		tagline_place_adopt(line->tag_name, run->lblock, run->disk, run->rblock, run->length);
+	}
+	while ((run->rblock + run->length > filled) && (! __atomic_compare_exchange_n(&current_filled[run->disk],
+			&filled, run->rblock + run->length, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_remove
+// Description  : Delete a tagline, returning its blocks to the free space;
+//                it is freed once no directory walk can be looking at it
+//
+// Inputs       : line - the tagline to delete
+// Outputs      : none
+
+static void tagline_remove(TAGLINE *line) {
+
+	uint32_t e;
+
+	for (e = 0; e < line->map.count; e++) {
+		tagline_release(line->map.extents[e].disk, line->map.extents[e].rblock, line->map.extents[e].length);
+	}
+	tagline_place_drop(line->tag_name);
+	pthread_rwlock_wrlock(&directory_lock);
+	__atomic_store_n(&tag_directory[line->tag_name], NULL, __ATOMIC_RELEASE);
+	pthread_rwlock_unlock(&directory_lock);
+	tagline_extent_free(&line->map);
+	pthread_rwlock_destroy(&line->lock);
+	free(line);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_request_memory
+// Description  : Find the caller's memory for a block of a request, and how
+//                many blocks from it on lie in the same segment
+//
+// Inputs       : req - the request
+//                blk - the block of the request
+//                count - the blocks left in the segment (returned)
+// Outputs      : the memory of the block
+
+static char *tagline_request_memory(TAGLINE_REQUEST *req, uint32_t blk, uint32_t *count) {
+
+	uint32_t seg, blocks;
+
+	for (seg = 0; blk >= (blocks = req->iov[seg].iov_len / TAGLINE_BLOCK_SIZE); seg++) {
+		blk -= blocks;
+	}
+	*count = blocks - blk;
+	return((char *)req->iov[seg].iov_base + blk * TAGLINE_BLOCK_SIZE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_request_copy
+// Description  : Copy blocks of a request from other memory (a readahead
+//                window) into the caller's segments
+//
+// Inputs       : req - the request
+//                blk - the first block of the request to copy
+//                count - the number of blocks to copy
+//                src - the blocks
+// Outputs      : none
+
+static void tagline_request_copy(TAGLINE_REQUEST *req, uint32_t blk, uint32_t count, char *src) {
+
+	uint32_t done, n;
+	char *mem;
+
+	for (done = 0; done < count; done += n) {
+		mem = tagline_request_memory(req, blk + done, &n);
+		if (n > count - done) {
+			n = count - done;
+		}
+		memcpy(mem, &src[done * TAGLINE_BLOCK_SIZE], n * TAGLINE_BLOCK_SIZE);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_read_ahead
+// Description  : Serve what a read can from the readahead window of its
+//                tagline, and if the rest carries on a sequential stream
+//                collect the transfers reading it and the blocks after it
+//                into a new window (copied out when the read finishes)
+//
+// Inputs       : req - the read request
+//                line - the tagline read
+// Outputs      : the blocks of the read taken care of, -1 if failure
+
+static int tagline_read_ahead(TAGLINE_REQUEST *req, TAGLINE *line) {
+
+	TaglineExtent run;
+	uint32_t blk, limit, window, off;
+	char *mem;
+
+	// take the leading blocks the window already has
+	blk = tagline_readahead_hit(req->tag, req->bnum, req->blks, &mem);
+	if (blk > 0) {
+		tagline_request_copy(req, 0, blk, mem);
+	}
+	if (blk == req->blks) {
+		return(blk);
+	}
+
+	// the window can cover the blocks of the tagline written from here on
+	for (limit = 0; (req->bnum + blk + limit < MAX_TAGLINE_BLOCK_NUMBER) &&
+			tagline_extent_lookup(&line->map, req->bnum + blk + limit, &run); limit += run.length);
+	if (req->bnum + blk + limit > MAX_TAGLINE_BLOCK_NUMBER) {
+		limit = MAX_TAGLINE_BLOCK_NUMBER - req->bnum - blk;
+	}
+	window = tagline_readahead_window(req->tag, req->bnum + blk, req->blks - blk, limit, &req->ahead);
+	if (window == 0) {
+		return(blk);
+	}
+	req->ahead_blk = blk;
+
+	// read the window a run at a time
+	for (off = 0; off < window; off += run.length) {
+		tagline_extent_lookup(&line->map, req->bnum + blk + off, &run);
+		if (run.length > window - off) {
+			run.length = window - off;
+		}
+		if (tagline_cached_read(&req->batch, run.disk, run.rblock, run.length,
+				&req->ahead[off * TAGLINE_BLOCK_SIZE])) {
+			return(-1);
+		}
+	}
+	return(req->blks);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_read_start
+// Description  : Resolve a read against the tag map and the cache, and
+//                collect the bus transfers for the blocks that missed
+//
+// Inputs       : req - the read request
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_read_start(TAGLINE_REQUEST *req) {
+
+	TaglineExtent run;
+	uint32_t done, count;
+	int32_t blk = 0;
+	char *mem;
+
+	// find the tag in the directory
+	TAGLINE *line = tagline_lookup(req->tag);
+	if (line == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : read from unknown tagline %u", req->tag);
+		return(-1);
+	}
+	if (req->bnum + req->blks > MAX_TAGLINE_BLOCK_NUMBER) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : read past end of tagline %u (%u+%u)", req->tag, req->bnum, req->blks);
+		return(-1);
+	}
+
+	// a sequential read goes through the readahead window
+	if (tagline_readahead_enabled() && (req->blks > 0) && ((blk = tagline_read_ahead(req, line)) == -1)) {
+		return(-1);
+	}
+
+	// collect the transfers for the other blocks a run at a time
+	for (; blk < req->blks; blk += run.length)
+	{
+		if (! tagline_extent_lookup(&line->map, req->bnum + blk, &run)) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : read of unwritten block %u of tagline %u", req->bnum + blk, req->tag);
+			return(-1);
+		}
+		if (run.length > req->blks - blk) {
+			run.length = req->blks - blk;
+		}
+
+		// read the run straight into the caller's memory, one bus transfer
+		// per segment it spans (segments adjacent in memory are merged)
+		for (done = 0; done < run.length; done += count) {
+			mem = tagline_request_memory(req, blk + done, &count);
+			if (count > run.length - done) {
+				count = run.length - done;
+			}
+			if (tagline_cached_read(&req->batch, run.disk, run.rblock + done, count, mem)) {
+				return(-1);
+			}
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_write_runs
+// Description  : Map the blocks of a write onto the array (allocating new
+//                blocks on the disk with the most free space, or in log
+//                mode appending every block to the log head), put them in
+//                the cache and collect the bus transfers that have to be
+//                made.  Called holding the lock of the tagline.
+//
+// Inputs       : req - the write request
+//                line - the tagline written
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_write_runs(TAGLINE_REQUEST *req, TAGLINE *line) {
+	
+	RAIDDiskID disk_to_write = 0;
+	TaglineExtent run, old, piece;
+	uint32_t blk, want, done, count;
+	int have_disk = 0;
+	char *mem;
+
+	// write the blocks a run at a time, overwriting mapped runs in place
+	// (outside log mode)
+	for (blk = 0; blk < req->blks; blk += run.length)
+	{
+		int mapped = tagline_extent_lookup(&line->map, req->bnum + blk, &run);
+		if (run.length > req->blks - blk) {
+			run.length = req->blks - blk;
+		}
+
+		if (log_mode)
+		{
+			// in log mode the run goes to the log head as one sequential
+			// transfer (split only at the end of a segment), and the
+			// blocks it overwrites die
+			old = run;
+			if ((run.length = tagline_segment_append(old.length, &run.disk, &run.rblock)) == 0) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID array full writing tagline %u", req->tag);
+				return(-1);
+			}
+			if (mapped) {
+				tagline_segment_release(old.disk, old.rblock, run.length);
+			}
+			if (tagline_extent_insert(&line->map, run.lblock, run.disk, run.rblock, run.length)) {
+				return(-1);
+			}
+			tagline_claim(line, &run);
+		}
+		else if (! mapped)
+		{
+			// an unmapped run goes to its place in the track reserved for
+			// its range of the tagline if it can (a short run leaves the
+			// rest unmapped for the next time round)
+			want = run.length;
+			run.length = 0;
+			if (placement == TAGLINE_PLACE_TRACK) {
+				run.length = tagline_place_track(req->tag, run.lblock, want, &run.disk, &run.rblock);
+			}
+
+			// otherwise it takes free blocks on the disk with the most
+			// free space, as few runs of them as the free space allows
+			if (run.length == 0) {
+				run.length = have_disk ? tagline_alloc_run(disk_to_write, want, &run.rblock) : 0;
+				if (run.length == 0) {
+					// pick a disk the first time, and again if it fills up
+					if (tagline_alloc_disk(&disk_to_write)) {
+						TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID array full writing tagline %u", req->tag);
+						return(-1);
+					}
+					have_disk = 1;
+					run.length = tagline_alloc_run(disk_to_write, want, &run.rblock);
+				}
+				run.disk = disk_to_write;
+			}
+			if (tagline_extent_insert(&line->map, run.lblock, run.disk, run.rblock, run.length)) {
+				return(-1);
+			}
+			tagline_claim(line, &run);
+		}
+
+		// journal the run, then write it straight from the caller's
+		// memory, one bus transfer per segment it spans
+		for (done = 0; done < run.length; done += piece.length) {
+			piece = run;
+			mem = tagline_request_memory(req, blk + done, &count);
+			piece.length = (count < run.length - done) ? count : run.length - done;
+			piece.lblock += done;
+			piece.rblock += done;
+			if (tagline_journal_add(req->tag, &piece, mem) ||
+					tagline_cached_write(&req->batch, piece.disk, piece.rblock, piece.length, mem)) {
+				return(-1);
+			}
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_write_start
+// Description  : Start a write: find or create the tagline and map the
+//                blocks onto the array with its lock held
+//
+// Inputs       : req - the write request
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_write_start(TAGLINE_REQUEST *req) {
+
+	TAGLINE *line;
+	int ret;
+
+	if (req->bnum + req->blks > MAX_TAGLINE_BLOCK_NUMBER) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : write past end of tagline %u (%u+%u)", req->tag, req->bnum, req->blks);
+		return(-1);
+	}
+
+	// figure out if the tag is old or new, creating it as needed
+	if (((line = tagline_lookup(req->tag)) == NULL) && ((line = tagline_create(req->tag)) == NULL)) {
+		return(-1);
+	}
+	tagline_readahead_forget(req->tag, req->bnum, req->blks, 0);
+	pthread_rwlock_wrlock(&line->lock);
+	ret = tagline_write_runs(req, line);
+	pthread_rwlock_unlock(&line->lock);
+	return(ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_delete_start
+// Description  : Delete a tagline: journal the delete and free its blocks.
+//                There is nothing to transfer; blocks of it still in the
+//                cache are replaced when the blocks are written again.
+//
+// Inputs       : req - the delete request
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_delete_start(TAGLINE_REQUEST *req) {
+
+	TaglineExtent none;
+
+	TAGLINE *line = tagline_lookup(req->tag);
+	if (line == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : delete of unknown tagline %u", req->tag);
+		return(-1);
+	}
+
+	// a run of no blocks journals the delete
+	memset(&none, 0x0, sizeof(none));
+	if (tagline_journal_add(req->tag, &none, NULL)) {
+		return(-1);
+	}
+	tagline_readahead_forget(req->tag, 0, 0, 1);
+	tagline_remove(line);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_lookup
+// Description  : Give the metadata image writer the extent map of a tag
+//
+// Inputs       : tag - the tag number
+// Outputs      : the extent map, or NULL if the tag has no data
+
+static TaglineExtentMap *tagline_meta_lookup(uint32_t tag) {
+	TAGLINE *line = tagline_lookup(tag);
+	return((line == NULL) ? NULL : &line->map);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_save_image
+// Description  : Save the metadata image of the taglines, fingerprinting the
+//                store last saved to TAGLINE_RAID_STORE
+//
+// Inputs       : checksum - the checksum of the new image (returned)
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_save_image(uint64_t *checksum) {
+
+	TaglineMetaHeader header;
+	uint32_t d;
+
+	memset(&header, 0x0, sizeof(header));
+	header.maxlines = tag_directory_size;
+	header.disks = RAID_DISKS;
+	header.diskblocks = RAID_DISKBLOCKS;
+	for (d = 0; d < RAID_DISKS; d++) {
+		header.filled[d] = __atomic_load_n(&current_filled[d], __ATOMIC_RELAXED);
+	}
+
+	// a striped array keeps the same stripes of every disk (and records
+	// the disk it is missing)
+	if (tagline_stripe_enabled()) {
+		for (d = 1; d < array_disks; d++) {
+			header.filled[0] = (current_filled[d] > header.filled[0]) ? current_filled[d] : header.filled[0];
+		}
+		header.filled[0] = tagline_stripe_span(header.filled[0]);
+		for (d = 1; d < RAID_DISKS; d++) {
+			header.filled[d] = header.filled[0];
+		}
+		header.stripe_unit = tagline_stripe_unit;
+		if (tagline_stripe_failed() != TAGLINE_STRIPE_NONE) {
+			header.failed = 1 << tagline_stripe_failed();
+		}
+	}
+	if (tagline_meta_stamp_store(TAGLINE_RAID_STORE, &header) ||
+			tagline_meta_save(tagline_meta_file, &header, tagline_meta_lookup)) {
+		return(-1);
+	}
+	*checksum = header.checksum;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_checkpoint
+// Description  : Compact the journal: save the store and a new metadata
+//                image holding everything journaled so far, then start an
+//                empty journal on the new image.  Runs on the dispatcher
+//                with no requests in flight.
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_checkpoint(void) {
+
+	uint64_t checksum;
+
+	// the cache (and the write-backs posted) hold blocks the store does
+	// not have yet
+	if (flush_tagline_cache() || tagline_io_drain() || tagline_bus_save(TAGLINE_RAID_STORE)) {
+		return(-1);
+	}
+	if (tagline_save_image(&checksum) || tagline_journal_reset(checksum)) {
+		return(-1);
+	}
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : checkpoint saved, journal compacted");
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_clean_segment
+// Description  : Clean a segment: read it with one transfer, append its
+//                live blocks to the log head (a run of one tagline stays
+//                a run) and remap them, leaving the segment free.  The
+//                moves are journaled like writes.  Runs on the dispatcher
+//                with no requests in flight.
+//
+// Inputs       : disk - the disk of the segment
+//                base - the first block of the segment
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_clean_segment(RAIDDiskID disk, RAIDBlockID base) {
+
+	static char data[TAGLINE_SEGMENT_BLOCKS * TAGLINE_BLOCK_SIZE];  // the segment (dispatcher only)
+	static TaglineIoBatch batch;                                     // the writes of the moved runs
+	TagLineNumber tag, next_tag;
+	uint32_t blk, len, done, lblock, next_lblock, moved = 0;
+	TaglineExtent run;
+	TAGLINE *line;
+
+	// read the whole segment, dead blocks and all, once the write-backs
+	// posted have landed, then take the newer copies of live blocks the
+	// cache has not written back (before the moves below can evict them)
+	if (tagline_io_drain() || tagline_raid_xfer(RAID_READ, disk, base, TAGLINE_SEGMENT_BLOCKS, data)) {
+		return(-1);
+	}
+	for (blk = 0; tagline_cache_enabled() && (blk < TAGLINE_SEGMENT_BLOCKS); blk++) {
+		if (tagline_segment_owner(disk, base + blk, &tag, &lblock)) {
+			get_tagline_cache(disk, base + blk, &data[blk * TAGLINE_BLOCK_SIZE]);
+		}
+	}
+	tagline_io_batch_init(&batch);
+
+	for (blk = 0; blk < TAGLINE_SEGMENT_BLOCKS; blk += len) {
+		len = 1;
+		if (! tagline_segment_owner(disk, base + blk, &tag, &lblock)) {
+			continue;
+		}
+
+		// gather the consecutive blocks of the tagline
+		while ((blk + len < TAGLINE_SEGMENT_BLOCKS) &&
+				tagline_segment_owner(disk, base + blk + len, &next_tag, &next_lblock) &&
+				(next_tag == tag) && (next_lblock == lblock + len)) {
+			len++;
+		}
+		if ((line = tagline_lookup(tag)) == NULL) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : segment [disk=%u, block=%u] holds unknown tagline %u", disk, base, tag);
+			return(-1);
+		}
+
+		// move the run to the log head, a piece per segment it lands in
+		for (done = 0; done < len; done += run.length) {
+			run.lblock = lblock + done;
+			if ((run.length = tagline_segment_append(len - done, &run.disk, &run.rblock)) == 0) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : no free segment to clean [disk=%u, block=%u] into", disk, base);
+				return(-1);
+			}
+			tagline_segment_release(disk, base + blk + done, run.length);
+			pthread_rwlock_wrlock(&line->lock);
+			if (tagline_extent_insert(&line->map, run.lblock, run.disk, run.rblock, run.length)) {
+				pthread_rwlock_unlock(&line->lock);
+				return(-1);
+			}
+			pthread_rwlock_unlock(&line->lock);
+			tagline_claim(line, &run);
+			if (tagline_journal_add(tag, &run, &data[(blk + done) * TAGLINE_BLOCK_SIZE]) ||
+					tagline_cached_write(&batch, run.disk, run.rblock, run.length, &data[(blk + done) * TAGLINE_BLOCK_SIZE])) {
+				return(-1);
+			}
+		}
+		moved += len;
+	}
+
+	// the moves are durable before the segment can be written again
+	if (tagline_io_run(&batch) || tagline_journal_commit()) {
+		return(-1);
+	}
+	tagline_segment_cleaned(moved);
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : cleaned segment [disk=%u, block=%u], %u live blocks moved", disk, base, moved);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_apply
+// Description  : Redo a journaled write run at init: map the blocks and
+//                write them to the array (a run of no blocks deletes the
+//                tagline)
+//
+// Inputs       : tag - the tagline written
+//                run - the tagline blocks and where they went
+//                data - the blocks written
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_journal_apply(TagLineNumber tag, TaglineExtent *run, char *data) {
+
+	TaglineExtent old;
+	uint32_t blk;
+	TAGLINE *line;
+
+	if (run->length == 0) {
+		if ((line = tagline_lookup(tag)) != NULL) {
+			tagline_remove(line);
+		}
+		return(0);
+	}
+	if ((run->disk >= array_disks) || (run->rblock + run->length > RAID_DISKBLOCKS)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad journal entry [disk=%u, block=%u]", run->disk, run->rblock);
+		return(-1);
+	}
+	if (((line = tagline_lookup(tag)) == NULL) && ((line = tagline_create(tag)) == NULL)) {
+		return(-1);
+	}
+
+	// the blocks the run was mapped to before die (a log-mode write moved it)
+	for (blk = 0; blk < run->length; blk += old.length) {
+		int mapped = tagline_extent_lookup(&line->map, run->lblock + blk, &old);
+		if (old.length > run->length - blk) {
+			old.length = run->length - blk;
+		}
+		if (mapped) {
+			tagline_release(old.disk, old.rblock, old.length);
+		}
+	}
+	if (tagline_extent_insert(&line->map, run->lblock, run->disk, run->rblock, run->length) ||
+			tagline_raid_xfer(RAID_WRITE, run->disk, run->rblock, run->length, data)) {
+		return(-1);
+	}
+	tagline_claim(line, run);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_batch_complete
+// Description  : Hand a request whose transfers finished back to the
+//                dispatcher (called from the disk workers)
+//
+// Inputs       : batch - the finished batch
+// Outputs      : none
+
+static void tagline_batch_complete(TaglineIoBatch *batch) {
+
+	TAGLINE_REQUEST *req = batch->arg;
+
+	pthread_mutex_lock(&request_lock);
+	req->next = complete_head;
+	complete_head = req - requests;
+	pthread_cond_signal(&dispatcher_wake);
+	pthread_mutex_unlock(&request_lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_slot_release
+// Description  : Put a request slot back on the free list, waking a
+//                submitter waiting for one.  Called with request_lock held.
+//
+// Inputs       : req - the slot to release
+// Outputs      : none
+
+static void tagline_slot_release(TAGLINE_REQUEST *req) {
+	req->state = TAGLINE_REQ_FREE;
+	req->next = free_head;
+	free_head = req - requests;
+	pthread_cond_signal(&slot_free);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_next_request
+// Description  : Pick the first submitted request that can start and take
+//                it off the submit list.  The requests of a tagline start
+//                in the order they were submitted, and a write or delete
+//                waits for the reads of its tagline to finish, so no read
+//                can fill the cache with data older than it (or read blocks
+//                that have been freed); requests of other taglines go
+//                past the ones held back.  Called with request_lock held.
+//
+// Inputs       : none
+// Outputs      : the slot of the request, -1 if none can start
+
+static int32_t tagline_next_request(void) {
+
+	TAGLINE_REQUEST *req;
+	TAGLINE *line;
+	int32_t slot, prev = -1;
+
+	// hold back each request behind one of its tagline already held back
+	for (slot = submit_head; slot != -1; prev = slot, slot = req->next) {
+		req = &requests[slot];
+		if (blocked_tags[req->tag / 64] & (1ULL << (req->tag % 64))) {
+			continue;
+		}
+		if ((req->type == TAGLINE_REQ_READ) || ((line = tagline_lookup(req->tag)) == NULL) || (line->reads == 0)) {
+			break;
+		}
+		blocked_tags[req->tag / 64] |= (1ULL << (req->tag % 64));
+	}
+
+	// forget the taglines held back, and unlink the request picked
+	for (req = (submit_head != slot) ? &requests[submit_head] : NULL; req != NULL;
+			req = (req->next != slot) ? &requests[req->next] : NULL) {
+		blocked_tags[req->tag / 64] &= ~(1ULL << (req->tag % 64));
+	}
+	if (slot != -1) {
+		req = &requests[slot];
+		if (prev == -1) {
+			submit_head = req->next;
+		} else {
+			requests[prev].next = req->next;
+		}
+		if (submit_tail == slot) {
+			submit_tail = prev;
+		}
+		req->next = -1;
+	}
+	return(slot);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_request_finish
+// Description  : Finish a request on the dispatcher: fill the cache with
+//                what a read fetched (copying a read through a readahead
+//                window out of it), record the result and notify the
+//                submitter.  Called with request_lock held.
+//
+// Inputs       : req - the request to finish
+//                result - 0 if the request succeeded so far, -1 if not
+// Outputs      : none
+
+static void tagline_request_finish(TAGLINE_REQUEST *req, int result) {
+
+	// complete the request outside the lock (the cache is dispatcher only)
+	pthread_mutex_unlock(&request_lock);
+	if ((result == 0) && (req->batch.failed || ((req->type == TAGLINE_REQ_READ) && tagline_cache_fill(&req->batch)))) {
+		result = -1;
+	}
+	if (req->ahead != NULL) {
+		if (result == 0) {
+			tagline_request_copy(req, req->ahead_blk, req->blks - req->ahead_blk, req->ahead);
+		}
+		tagline_readahead_filled(req->tag, result != 0);
+		req->ahead = NULL;
+	}
+	if ((result == 0) && (req->type == TAGLINE_REQ_DELETE)) {
+		TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : deleted tagline %u.", req->tag);
+	} else if (result == 0) {
+		TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : %s %u blocks %s tagline %u, starting block %u.",
+				(req->type == TAGLINE_REQ_WRITE) ? "wrote" : "read", req->blks,
+				(req->type == TAGLINE_REQ_WRITE) ? "to" : "from", req->tag, req->bnum);
+	}
+	if (req->callback != NULL) {
+		req->callback(req - requests, result, req->arg);
+	}
+	pthread_mutex_lock(&request_lock);
+
+	// requests with a callback are released, the others wait for the caller
+	if (req->line != NULL) {
+		req->line->reads--;
+		req->line = NULL;
+	}
+	requests_inflight--;
+	req->result = result;
+	if (req->callback != NULL) {
+		tagline_slot_release(req);
+	} else {
+		req->state = TAGLINE_REQ_DONE;
+		pthread_cond_signal(&req->done);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_dispatcher
+// Description  : The dispatcher thread.  Requests are started in submission
+//                order; each one is resolved against the tag map and cache
+//                and its bus transfers are queued on the disks without
+//                waiting, so the transfers of many requests are in flight
+//                at once.  Finished transfers are completed as they arrive.
+//                A write or delete is held back until the reads of its
+//                tagline ahead of it finish (see tagline_next_request).
+//                With a journal, finished updates are acknowledged once
+//                the dispatcher runs out of requests to start, after one
+//                commit for all of them (group commit).  In log mode the
+//                dispatcher also cleans segments: before starting more
+//                requests when free segments run low, and one at a time
+//                when it is idle.  All of the map, cache and allocator work
+//                runs on this thread; the clients only overlap their waits
+//                on the disks.
+//
+// Inputs       : arg - unused
+// Outputs      : NULL
+
+static void *tagline_dispatcher(void *arg) {
+
+	TAGLINE_REQUEST *req;
+	RAIDDiskID victim_disk;
+	RAIDBlockID victim_block;
+	int32_t slot;
+	int compacting, cleaning;
+
+	pthread_mutex_lock(&request_lock);
+	while (1) {
+
+		// complete whatever has finished; journaled updates wait for the
+		// next group commit
+		while (complete_head != -1) {
+			req = &requests[complete_head];
+			complete_head = req->next;
+			if ((req->type != TAGLINE_REQ_READ) && tagline_journal_pending()) {
+				req->next = commit_head;
+				commit_head = req - requests;
+			} else {
+				tagline_request_finish(req, 0);
+			}
+		}
+
+		// compact a full journal, or clean a segment if few are free, once
+		// the requests in flight have drained
+		compacting = (journal_compact_at > 0) && (tagline_journal_size() >= journal_compact_at);
+		cleaning = log_mode && (! cleaner_failed) && (tagline_segment_free() < TAGLINE_SEGMENT_RESERVE) &&
+				(tagline_segment_victim(TAGLINE_SEGMENT_BLOCKS, &victim_disk, &victim_block) == 0);
+		if (compacting || cleaning) {
+			if (requests_inflight == 0) {
+				pthread_mutex_unlock(&request_lock);
+				if (compacting) {
+					if (tagline_checkpoint()) {
+						// keep journaling, try again when it has doubled
+						journal_compact_at *= 2;
+					}
+				} else if (tagline_clean_segment(victim_disk, victim_block)) {
+					TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : segment cleaning failed, cleaner stopped");
+					cleaner_failed = 1;
+				}
+				pthread_mutex_lock(&request_lock);
+				continue;
+			}
+		}
+
+		// start the next submitted request that can go, a read counting
+		// against its tagline until it finishes
+		if ((! compacting) && (! cleaning) && ((slot = tagline_next_request()) != -1)) {
+			req = &requests[slot];
+			req->state = TAGLINE_REQ_INFLIGHT;
+			requests_inflight++;
+			if ((req->type == TAGLINE_REQ_READ) && ((req->line = tagline_lookup(req->tag)) != NULL)) {
+				req->line->reads++;
+			}
+			pthread_mutex_unlock(&request_lock);
+
+			tagline_io_batch_init(&req->batch);
+			if ((req->type == TAGLINE_REQ_READ) ? tagline_read_start(req) :
+					(req->type == TAGLINE_REQ_WRITE) ? tagline_write_start(req) : tagline_delete_start(req)) {
+				pthread_mutex_lock(&request_lock);
+				tagline_request_finish(req, -1);
+			} else {
+				tagline_io_start(&req->batch, tagline_batch_complete, req);
+				pthread_mutex_lock(&request_lock);
+			}
+			continue;
+		}
+
+		// nothing more can start: make the waiting updates durable together
+		if (commit_head != -1) {
+			pthread_mutex_unlock(&request_lock);
+			if (tagline_journal_commit() && (! journal_failed)) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : journal commit failed, failing writes");
+				journal_failed = 1;
+			}
+			pthread_mutex_lock(&request_lock);
+			while (commit_head != -1) {
+				req = &requests[commit_head];
+				commit_head = req->next;
+				tagline_request_finish(req, journal_failed ? -1 : 0);
+			}
+			continue;
+		}
+
+		// wait for more work, leave once everything has drained; an idle
+		// dispatcher cleans the mostly dead segments meanwhile
+		if ((submit_head == -1) && (complete_head == -1)) {
+			if ((requests_inflight == 0) && dispatcher_stop) {
+				break;
+			}
+			if ((requests_inflight == 0) && log_mode && (! cleaner_failed) &&
+					(tagline_segment_victim(TAGLINE_SEGMENT_CLEAN_LIVE, &victim_disk, &victim_block) == 0)) {
+				pthread_mutex_unlock(&request_lock);
+				if (tagline_clean_segment(victim_disk, victim_block)) {
+					TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : segment cleaning failed, cleaner stopped");
+					cleaner_failed = 1;
+				}
+				pthread_mutex_lock(&request_lock);
+				continue;
+			}
+		}
+		pthread_cond_wait(&dispatcher_wake, &request_lock);
+	}
+	pthread_mutex_unlock(&request_lock);
+	return(NULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_submit
+// Description  : Put a request in a free slot and queue it for the
+//                dispatcher, waiting for a slot if the queue is full
+//
+// Inputs       : type - the TAGLINE_REQ_TYPES of the request
+//                tag, bnum, blks - the request (see tagline_read)
+//                iov, iovcnt - the memory of the blocks (see tagline_readv)
+//                callback - called when the request completes (may be NULL)
+//                arg - passed to the callback
+// Outputs      : the request handle, -1 if failure
+
+static TagLineRequest tagline_submit(int type, TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks,
+		const struct iovec *iov, int iovcnt, TaglineCompletion callback, void *arg) {
+
+	TAGLINE_REQUEST *req;
+	int32_t slot;
+
+	pthread_mutex_lock(&request_lock);
+	if (requests == NULL) {
+		pthread_mutex_unlock(&request_lock);
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : request submitted to an uninitialized driver");
+		return(-1);
+	}
+	while (free_head == -1) {
+		pthread_cond_wait(&slot_free, &request_lock);
+	}
+
+	// fill in the slot and put it at the end of the submit list
+	slot = free_head;
+	req = &requests[slot];
+	free_head = req->next;
+	req->state = TAGLINE_REQ_QUEUED;
+	req->type = type;
+	req->tag = tag;
+	req->bnum = bnum;
+	req->blks = blks;
+	memcpy(req->iov, iov, iovcnt * sizeof(struct iovec));
+	req->iovcnt = iovcnt;
+	req->ahead = NULL;
+	req->callback = callback;
+	req->arg = arg;
+	req->result = 0;
+	req->next = -1;
+	req->line = NULL;
+	if (submit_tail != -1) {
+		requests[submit_tail].next = slot;
+	} else {
+		submit_head = slot;
+	}
+	submit_tail = slot;
+	pthread_cond_signal(&dispatcher_wake);
+	pthread_mutex_unlock(&request_lock);
+	return(slot);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_free_requests
+// Description  : Release the request slots (the dispatcher has stopped)
+//
+// Inputs       : none
+// Outputs      : none
+
+static void tagline_free_requests(void) {
+
+	uint32_t slot;
+
+	for (slot = 0; slot < num_requests; slot++) {
+		pthread_cond_destroy(&requests[slot].done);
+	}
+	free(requests);
+	requests = NULL;
+	num_requests = 0;
+	free_head = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_free_directory
+// Description  : Release the taglines and the tag directory
+//
+// Inputs       : none
+// Outputs      : none
+
+static void tagline_free_directory(void) {
+
+	uint32_t tag;
+
+	for (tag = 0; tag < tag_directory_size; tag++)
+	{
+		if (tag_directory[tag] != NULL) {
+			tagline_extent_free(&tag_directory[tag]->map);
+			pthread_rwlock_destroy(&tag_directory[tag]->lock);
+			free(tag_directory[tag]);
+		}
+	}
+	free(tag_directory);
+	tag_directory = NULL;
+	tag_directory_size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_warm_start
+// Description  : Restore the store saved by the last close and rebuild the
+//                tag directory from the mapped metadata image; the extent
+//                maps point into the image, so nothing is copied.  Disks
+//                that are new, or that changed since the image was saved,
+//                are left for the caller to format and lose their extents.
+//
+// Inputs       : maxlines - the maximum number of tag lines in the system
+//                format - the disks to format, a bit per disk (returned)
+// Outputs      : 1 if started warm, 0 if the image cannot be used, -1 if failure
+
+static int tagline_warm_start(uint32_t maxlines, uint32_t *format) {
+
+	TaglineMetaHeader *header = meta_image.header;
+	TaglineMetaTag *rec;
+	TAGLINE *line;
+	uint32_t t, d, untrusted, lost = 0;
+
+	// The image must describe this array (or fewer of its disks) and fit
+	// the directory
+	if ((header->disks > RAID_DISKS) || (header->diskblocks != RAID_DISKBLOCKS)) {
+		TAGLINE_LOG(LOG_WARNING_LEVEL, "TAGLINE : metadata image is for a %ux%u array, starting cold",
+				header->disks, header->diskblocks);
+		return(0);
+	}
+	if ((header->stripe_unit != tagline_stripe_unit) ||
+			(tagline_stripe_enabled() && (header->disks != RAID_DISKS))) {
+		TAGLINE_LOG(LOG_WARNING_LEVEL, "TAGLINE : metadata image is for stripe units of %u blocks, starting cold",
+				header->stripe_unit);
+		return(0);
+	}
+	for (t = 0; t < header->ntags; t++) {
+		rec = &meta_image.tags[t];
+		if ((rec->tag >= maxlines) || ((uint64_t)rec->first + rec->count > header->nextents)) {
+			TAGLINE_LOG(LOG_WARNING_LEVEL, "TAGLINE : metadata image does not fit maxlines=%u, starting cold", maxlines);
+			return(0);
+		}
+	}
+	if (tagline_meta_check_extents(&meta_image, (header->disks < array_disks) ? header->disks : array_disks,
+			RAID_DISKBLOCKS)) {
+		TAGLINE_LOG(LOG_WARNING_LEVEL, "TAGLINE : metadata image does not fit the array, starting cold");
+		return(0);
+	}
+
+	if (tagline_meta_restore_store(TAGLINE_RAID_STORE, header, &untrusted)) {
+		TAGLINE_LOG(LOG_WARNING_LEVEL, "TAGLINE : unable to restore the saved RAID store, starting cold");
+		return(0);
+	}
+
+	// a striped array rebuilds a missing or changed disk from the others,
+	// and keeps every disk
+	if (tagline_stripe_enabled()) {
+		if (untrusted & (untrusted - 1)) {
+			TAGLINE_LOG(LOG_WARNING_LEVEL, "TAGLINE : more than one disk of the striped store lost, starting cold");
+			return(0);
+		}
+		for (d = 0; untrusted && (d < RAID_DISKS); d++) {
+			if (untrusted & (1 << d)) {
+				RAIDOpCode fmt = make_raid_request(RAID_FORMAT, 0, d, 0);
+				if (raid_request_failed(tagline_bus_request(fmt, NULL)) ||
+						tagline_stripe_rebuild(d, header->filled[(d + 1) % RAID_DISKS])) {
+					TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to rebuild disk %u of the striped store", d);
+					return(-1);
+				}
+			}
+		}
+		untrusted = 0;
+	}
+
+	for (t = 0; t < header->ntags; t++) {
+		rec = &meta_image.tags[t];
+		if ((line = tagline_create(rec->tag)) == NULL) {
+			return(-1);
+		}
+		tagline_extent_attach(&line->map, &meta_image.extents[rec->first], rec->count);
+		for (d = 0; untrusted && (d < header->disks); d++) {
+			if (untrusted & (1 << d)) {
+				lost += tagline_extent_drop_disk(&line->map, d);
+			}
+		}
+	}
+
+	// Only the new and the changed disks are formatted (the extents of a
+	// striped array give the blocks of each data disk filled)
+	*format = 0;
+	for (d = 0; d < RAID_DISKS; d++) {
+		if ((d >= header->disks) || (untrusted & (1 << d))) {
+			*format |= (1 << d);
+			current_filled[d] = 0;
+		} else {
+			current_filled[d] = tagline_stripe_enabled() ? 0 : header->filled[d];
+		}
+	}
+	if (lost > 0) {
+		TAGLINE_LOG(LOG_WARNING_LEVEL, "TAGLINE : %u tagline blocks lost on changed disks", lost);
+	}
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : warm start, %u taglines restored", header->ntags);
+	return(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_tagline_metadata_file
+// Description  : Make the driver persistent: tagline_close saves the tag
+//                directory to a metadata image and the next
+//                tagline_driver_init restarts from it and the saved store
+//
+// Inputs       : path - the metadata image file (NULL to not persist)
+// Outputs      : 0 if successful, -1 if failure
+
+int set_tagline_metadata_file(const char *path) {
+	free(tagline_meta_file);
+	tagline_meta_file = NULL;
+	if ((path != NULL) && ((tagline_meta_file = strdup(path)) == NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to set metadata file [%s]", path);
+		return(-1);
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_tagline_init_mode
+// Description  : Choose how the next tagline_driver_init treats the saved
+//                store and metadata image
+//
+// Inputs       : mode - the TaglineInitMode
+// Outputs      : 0 if successful, -1 if failure
+
+int set_tagline_init_mode(TaglineInitMode mode) {
+	if ((mode < TAGLINE_INIT_AUTO) || (mode > TAGLINE_INIT_WARM)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad init mode (%d)", mode);
+		return(-1);
+	}
+	tagline_init_mode = mode;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_tagline_journal_limit
+// Description  : Set the size the write-ahead journal may grow to before it
+//                is compacted into a new metadata image (used with a
+//                metadata file, takes effect at the next init)
+//
+// Inputs       : bytes - the journal size limit (0 turns the journal off)
+// Outputs      : 0 if successful, -1 if failure
+
+int set_tagline_journal_limit(uint64_t bytes) {
+	tagline_journal_limit = bytes;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_tagline_log_structured
+// Description  : Choose the write path of the next tagline_driver_init: in
+//                place, or log-structured (every write appends to an open
+//                segment the size of a track, overwrites are remapped and
+//                mostly dead segments are cleaned)
+//
+// Inputs       : enabled - log-structured (1) or in place (0)
+// Outputs      : 0 if successful, -1 if failure
+
+int set_tagline_log_structured(int enabled) {
+	tagline_log_structured = (enabled != 0);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_tagline_placement
+// Description  : Choose where the next tagline_driver_init puts new blocks
+//                outside log mode: next fit on the disk with the most free
+//                space, or at their place in a track reserved for each
+//                track-sized range of a tagline (falling back to next fit
+//                when no track is free)
+//
+// Inputs       : type - the placement policy
+// Outputs      : 0 if successful, -1 if failure
+
+int set_tagline_placement(TaglinePlaceType type) {
+	if ((type < 0) || (type >= TAGLINE_PLACE_MAXVAL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad placement policy (%d)", type);
+		return(-1);
+	}
+	tagline_placement = type;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
 //
-// Functions
+// Function     : set_tagline_stripe_unit
+// Description  : Choose the layout of the next tagline_driver_init: each
+//                block on one disk, or RAID-5 (the driver sees one data
+//                disk less and each stripe of units across the disks gets
+//                a parity unit, on a different disk from stripe to stripe)
+//
+// Inputs       : blocks - the blocks per stripe unit, the data units of a
+//                         stripe dividing a track (0 is no striping)
+// Outputs      : 0 if successful, -1 if failure
 
-RAIDOpCode make_raid_request(uint8_t request_type, uint8_t num_of_blks, uint8_t disk_num, uint32_t block_ID)
-{
-	
-	RAIDOpCode result = 0;
-	uint8_t unused = 0;
-	result |=  request_type;
-	result <<= 8;
-	result |=  num_of_blks;
-	result <<= 8;
-	result |= disk_num;
-	result <<= 8;
-	result |= unused;
-	result <<= 32;
-	result |= block_ID;
-	return(result);
+int set_tagline_stripe_unit(uint32_t blocks) {
+	if (blocks && (RAID_TRACK_BLOCKS % (blocks * (RAID_DISKS - 1)))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad stripe unit (%u blocks)", blocks);
+		return(-1);
+	}
+	tagline_stripe_unit = blocks;
+	return(0);
 }
 
-int extract_raid_response(RAIDOpCode resp, uint8_t *request_type, uint8_t *num_of_blks, uint8_t *disk_num, uint32_t *block_ID)
-{
-	*block_ID = (resp & 0xffffffff);
-	*disk_num = ((resp & 0xff0000000000) >> 40);
-	*num_of_blks = ((resp & 0xff000000000000) >> 48);
-	*request_type  = ((resp & 0xff00000000000000) >> 54);
-	int success_bit = ((resp & 0x100000000) >> 32);
-	return success_bit;
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_tagline_bus_backend
+// Description  : Choose what serves the RAID bus from the next
+//                tagline_driver_init: the RAID library, an array kept in a
+//                file, the RAID library behind a model of disk timing, or
+//                an array hosted by tagline_server
+//
+// Inputs       : spec - lib, file[:<path>], model[:<seek>:<track>:<block>]
+//                       (model times in usec) or net[:<host>[:<port>]]
+// Outputs      : 0 if successful, -1 if failure
+
+int set_tagline_bus_backend(const char *spec) {
+	if (tag_directory != NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID bus backend changed on an initialized driver");
+		return(-1);
+	}
+	return(tagline_bus_select(spec));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_fail_disk
+// Description  : Lose a disk of a RAID-5 array (with no requests
+//                outstanding): the disk is wiped, its blocks are rebuilt
+//                from the other disks when read, and writes leave it out
+//
+// Inputs       : disk - the disk lost
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_fail_disk(RAIDDiskID disk) {
+	if (tag_directory == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : disk lost on an uninitialized driver");
+		return(-1);
+	}
+	return(tagline_stripe_fail(disk));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_tagline_queue_depth
+// Description  : Set the number of requests that can be outstanding at once
+//                (takes effect at the next tagline_driver_init)
+//
+// Inputs       : depth - the queue depth
+// Outputs      : 0 if successful, -1 if failure
+
+int set_tagline_queue_depth(uint32_t depth) {
+	if ((depth == 0) || (depth > TAGLINE_MAX_QUEUE_DEPTH)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad queue depth (%u)", depth);
+		return(-1);
+	}
+	tagline_queue_depth = depth;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_init_failed
+// Description  : Undo a driver init that failed part way: stop whatever was
+//                started (the close functions skip what was not), keep the
+//                journal for the next init, close the array if it was
+//                opened and release the tag directory and the image
+//
+// Inputs       : opened - was the array opened (RAID_INIT)?
+// Outputs      : -1 (the result of the init)
+
+static int tagline_init_failed(int opened) {
+
+	tagline_io_close();
+	close_tagline_cache();
+	tagline_readahead_close();
+	tagline_journal_close(0);
+	if (log_mode) {
+		tagline_segment_close();
+		log_mode = 0;
+	}
+	tagline_place_close();
+	tagline_alloc_close();
+	tagline_stripe_close();
+	if (opened && raid_request_failed(tagline_bus_request(make_raid_request(RAID_CLOSE, 0, 0, 0), NULL))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID close failed after failed init");
+	}
+	tagline_free_directory();
+	tagline_meta_release(&meta_image);
+	return(-1);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -73,40 +1570,319 @@ int extract_raid_response(RAIDOpCode resp, uint8_t *request_type, uint8_t *num_o
 
 int tagline_driver_init(uint32_t maxlines) {
 
-	RAIDOpCode init = make_raid_request(RAID_INIT, 1, RAID_DISKS, 0);
-	RAIDOpCode init_response = raid_bus_request(init, NULL);
-	
-	for (i = 0; i < RAID_DISKS; i++)
+	uint32_t format = (1 << RAID_DISKS) - 1;  // the disks to format
+	uint32_t d, t, e;
+	int32_t slot;
+	int warm = 0;
+
+	if ((maxlines == 0) || (maxlines > TAGLINE_DIRECTORY_MAX)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad maxlines in init (%u)", maxlines);
+		return(-1);
+	}
+
+	// create the tag directory, one slot per possible tag number; taglines
+	// are allocated lazily on their first write
+	if ((tag_directory = calloc(maxlines, sizeof(TAGLINE *))) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate tag directory (%u)", maxlines);
+		return(-1);
+	}
+	tag_directory_size = maxlines;
+
+	RAIDOpCode init = make_raid_request(RAID_INIT, RAID_DISKBLOCKS / RAID_TRACK_BLOCKS, RAID_DISKS, 0);
+	if (raid_request_failed(tagline_bus_request(init, NULL))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID init failed");
+		return(tagline_init_failed(0));
+	}
+
+	// stripe the array if asked to; blocks are then allocated on the data
+	// disks the stripes make up
+	if (tagline_stripe_init(RAID_DISKS, RAID_DISKBLOCKS, tagline_stripe_unit)) {
+		return(tagline_init_failed(1));
+	}
+	array_disks = tagline_stripe_enabled() ? tagline_stripe_data_disks() : RAID_DISKS;
+
+	// restart from the metadata image if there is a good one
+	if ((tagline_init_mode != TAGLINE_INIT_COLD) && (tagline_meta_file != NULL) &&
+			(tagline_meta_load(tagline_meta_file, &meta_image) == 0)) {
+		if ((warm = tagline_warm_start(maxlines, &format)) == -1) {
+			return(tagline_init_failed(1));
+		}
+		if (! warm) {
+			tagline_meta_release(&meta_image);
+		}
+	}
+	if ((! warm) && (tagline_init_mode == TAGLINE_INIT_WARM)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : no usable metadata image for a warm start");
+		return(tagline_init_failed(1));
+	}
+
+	// format the disks with nothing to keep, and record them as empty
+	for (d = 0; d < RAID_DISKS; d++)
 	{
-		RAIDOpCode format = make_raid_request(RAID_FORMAT, 0, i, 0);
-		RAIDOpCode format_response = raid_bus_request(format, NULL);	
+		if (format & (1 << d)) {
+			RAIDOpCode fmt = make_raid_request(RAID_FORMAT, 0, d, 0);
+			if (raid_request_failed(tagline_bus_request(fmt, NULL))) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID format failed on disk %u", d);
+				return(tagline_init_failed(1));
+			}
+			current_filled[d] = 0;
+		}
 	}
-	
-	//record the disks as empty
-	for (i = 0; i < RAID_DISKS; i++)
+
+	// build the free-space maps, the track reservations (and in log mode
+	// the segment log) from the taglines kept
+	log_mode = tagline_log_structured;
+	placement = tagline_placement;
+	cleaner_failed = 0;
+	if (tagline_alloc_init(array_disks, RAID_DISKBLOCKS) ||
+			tagline_place_init(maxlines, array_disks, RAID_DISKBLOCKS) ||
+			(log_mode && tagline_segment_init(array_disks, RAID_DISKBLOCKS))) {
+		return(tagline_init_failed(1));
+	}
+	for (t = 0; t < tag_directory_size; t++)
 	{
-		current_filled[i] = 0;
+		if (tag_directory[t] != NULL) {
+			for (e = 0; e < tag_directory[t]->map.count; e++) {
+				tagline_claim(tag_directory[t], &tag_directory[t]->map.extents[e]);
+			}
+		}
 	}
-	
-	// create new TAGLINES for each pointer in the array
-	for (i = 0; i < maxlines; i++)
-	{	
-		TAGLINE new_tag;
-		tags[i] = &new_tag;
-		tags[i]->tag_name = -1; 						// default name is 65535
-		
-		//set 
-		for(k = 0; k < MAX_TAGLINE_BLOCK_NUMBER; k++)
-			tags[i]->addresses[k][0] = -1;			// initialize the disk used to 65535
-		logMessage(LOG_INFO_LEVEL, "tags[0]->tag_name = %d", tags[0]->tag_name);
+
+	// a cold start leaves nothing for the old image to describe
+	if ((tagline_meta_file != NULL) && (! warm)) {
+		unlink(tagline_meta_file);
+	}
+
+	// redo the writes journaled since the image was saved (or since the
+	// array was formatted), then keep journaling
+	journal_compact_at = 0;
+	journal_failed = 0;
+	if ((tagline_meta_file != NULL) && (tagline_journal_limit > 0)) {
+		char path[FILENAME_MAX];
+		snprintf(path, sizeof(path), "%s.journal", tagline_meta_file);
+		if (tagline_journal_open(path, warm ? meta_image.header->checksum : 0,
+				(tagline_init_mode == TAGLINE_INIT_COLD) ? NULL : tagline_journal_apply)) {
+			return(tagline_init_failed(1));
+		}
+		journal_compact_at = tagline_journal_limit;
+	}
+
+	// put the block cache (and the readahead) in front of the bus, start
+	// the disk workers
+	if (init_tagline_cache(tagline_raid_writeback) || tagline_readahead_init() || tagline_io_init()) {
+		return(tagline_init_failed(1));
+	}
+
+	// create the request slots and start the dispatcher
+	if ((requests = calloc(tagline_queue_depth, sizeof(TAGLINE_REQUEST))) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate request queue (%u)", tagline_queue_depth);
+		return(tagline_init_failed(1));
+	}
+	num_requests = tagline_queue_depth;
+	free_head = submit_head = submit_tail = complete_head = commit_head = -1;
+	for (slot = num_requests - 1; slot >= 0; slot--) {
+		pthread_cond_init(&requests[slot].done, NULL);
+		requests[slot].next = free_head;
+		free_head = slot;
+	}
+	requests_inflight = 0;
+	dispatcher_stop = 0;
+	if (pthread_create(&dispatcher, NULL, tagline_dispatcher, NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to start request dispatcher");
+		tagline_free_requests();
+		return(tagline_init_failed(1));
 	}
-	
 	
 	// Return successfully
-	logMessage(LOG_INFO_LEVEL, "TAGLINE: initialized storage (maxline=%u)", maxlines);
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE: initialized storage (maxline=%u)", maxlines);
 	return(0);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_read_async
+// Description  : Submit a read of a number of blocks from the tagline driver
+//
+// Inputs       : tag - the number of the tagline to read from
+//                bnum - the starting block to read from
+//                blks - the number of blocks to read
+//                buf - memory block to read the blocks into
+//                callback - called when the read completes (may be NULL)
+//                arg - passed to the callback
+// Outputs      : the request handle, -1 if failure
+
+TagLineRequest tagline_read_async(TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks, char *buf,
+		TaglineCompletion callback, void *arg) {
+
+	struct iovec iov = { buf, (size_t)blks * TAGLINE_BLOCK_SIZE };
+
+	return(tagline_submit(TAGLINE_REQ_READ, tag, bnum, blks, &iov, (blks > 0), callback, arg));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_write_async
+// Description  : Submit a write of a number of blocks to the tagline driver;
+//                the caller's buffer must not change until it completes
+//
+// Inputs       : tag - the number of the tagline to write to
+//                bnum - the starting block to write to
+//                blks - the number of blocks to write
+//                buf - memory block holding the blocks to write
+//                callback - called when the write completes (may be NULL)
+//                arg - passed to the callback
+// Outputs      : the request handle, -1 if failure
+
+TagLineRequest tagline_write_async(TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks, char *buf,
+		TaglineCompletion callback, void *arg) {
+
+	struct iovec iov = { buf, (size_t)blks * TAGLINE_BLOCK_SIZE };
+
+	return(tagline_submit(TAGLINE_REQ_WRITE, tag, bnum, blks, &iov, (blks > 0), callback, arg));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_iov_blocks
+// Description  : Count the blocks of a vector of memory segments, each of
+//                which must hold whole blocks
+//
+// Inputs       : iov - the segments
+//                iovcnt - the number of segments
+// Outputs      : the number of blocks, -1 if the vector is bad
+
+static int tagline_iov_blocks(const struct iovec *iov, int iovcnt) {
+
+	uint64_t bytes = 0;
+	int seg;
+
+	if ((iov == NULL) || (iovcnt <= 0) || (iovcnt > MAX_TAGLINE_BLOCK_NUMBER)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad segment count %d in vectored request", iovcnt);
+		return(-1);
+	}
+	for (seg = 0; seg < iovcnt; seg++) {
+		if ((iov[seg].iov_base == NULL) || (iov[seg].iov_len == 0) || (iov[seg].iov_len % TAGLINE_BLOCK_SIZE)) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : segment %d of vectored request is not whole blocks (%zu bytes)",
+					seg, iov[seg].iov_len);
+			return(-1);
+		}
+		bytes += iov[seg].iov_len;
+	}
+	if (bytes > MAX_TAGLINE_BLOCK_NUMBER * TAGLINE_BLOCK_SIZE) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : vectored request of %lu bytes is longer than a tagline", bytes);
+		return(-1);
+	}
+	return(bytes / TAGLINE_BLOCK_SIZE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readv_async
+// Description  : Submit a read of blocks from the tagline driver into a
+//                vector of memory segments (e.g., pooled block buffers).
+//                The blocks go straight from the bus (or cache) into the
+//                segments, a transfer per run of blocks in one segment;
+//                the vector is copied, only the segments must be kept.
+//
+// Inputs       : tag - the number of the tagline to read from
+//                bnum - the starting block to read from
+//                iov - the segments to read into, in order, each a
+//                      multiple of TAGLINE_BLOCK_SIZE bytes
+//                iovcnt - the number of segments
+//                callback - called when the read completes (may be NULL)
+//                arg - passed to the callback
+// Outputs      : the request handle, -1 if failure
+
+TagLineRequest tagline_readv_async(TagLineNumber tag, TagLineBlockNumber bnum, const struct iovec *iov, int iovcnt,
+		TaglineCompletion callback, void *arg) {
+
+	int blks = tagline_iov_blocks(iov, iovcnt);
+
+	if (blks == -1) {
+		return(-1);
+	}
+	return(tagline_submit(TAGLINE_REQ_READ, tag, bnum, blks, iov, iovcnt, callback, arg));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_writev_async
+// Description  : Submit a write of blocks gathered from a vector of memory
+//                segments to the tagline driver; the blocks go straight to
+//                the bus (or cache), and the segments must not change
+//                until it completes
+//
+// Inputs       : tag - the number of the tagline to write to
+//                bnum - the starting block to write to
+//                iov - the segments holding the blocks, in order, each a
+//                      multiple of TAGLINE_BLOCK_SIZE bytes
+//                iovcnt - the number of segments
+//                callback - called when the write completes (may be NULL)
+//                arg - passed to the callback
+// Outputs      : the request handle, -1 if failure
+
+TagLineRequest tagline_writev_async(TagLineNumber tag, TagLineBlockNumber bnum, const struct iovec *iov, int iovcnt,
+		TaglineCompletion callback, void *arg) {
+
+	int blks = tagline_iov_blocks(iov, iovcnt);
+
+	if (blks == -1) {
+		return(-1);
+	}
+	return(tagline_submit(TAGLINE_REQ_WRITE, tag, bnum, blks, iov, iovcnt, callback, arg));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_poll
+// Description  : Check if a request (submitted without a callback) is done
+//
+// Inputs       : req - the request handle
+// Outputs      : 1 if complete, 0 if still running, -1 if bad handle
+
+int tagline_poll(TagLineRequest req) {
+
+	int state;
+
+	if ((req < 0) || (req >= num_requests)) {
+		return(-1);
+	}
+	pthread_mutex_lock(&request_lock);
+	state = requests[req].state;
+	pthread_mutex_unlock(&request_lock);
+	return((state == TAGLINE_REQ_FREE) ? -1 : (state == TAGLINE_REQ_DONE));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_wait
+// Description  : Wait for a request (submitted without a callback) to
+//                complete and release its slot
+//
+// Inputs       : req - the request handle
+// Outputs      : 0 if the request succeeded, -1 if it (or the handle) failed
+
+int tagline_wait(TagLineRequest req) {
+
+	int result;
+
+	if ((req < 0) || (req >= num_requests)) {
+		return(-1);
+	}
+	pthread_mutex_lock(&request_lock);
+	while ((requests[req].state == TAGLINE_REQ_QUEUED) || (requests[req].state == TAGLINE_REQ_INFLIGHT)) {
+		pthread_cond_wait(&requests[req].done, &request_lock);
+	}
+	if (requests[req].state != TAGLINE_REQ_DONE) {
+		pthread_mutex_unlock(&request_lock);
+		return(-1);
+	}
+	result = requests[req].result;
+	tagline_slot_release(&requests[req]);
+	pthread_mutex_unlock(&request_lock);
+	return(result);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Function     : tagline_read
@@ -119,32 +1895,7 @@ int tagline_driver_init(uint32_t maxlines) {
 // Outputs      : 0 if successful, -1 if failure
 
 int tagline_read(TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks, char *buf) {
-
-	// find the tag index in the memory structure
-	int tag_index = -1;
-	int curr_tag_index = 0;
-	while (tags[curr_tag_index]->tag_name != -1)
-	{
-		if (tags[curr_tag_index]->tag_name == tag)
-			tag_index = curr_tag_index;
-		curr_tag_index++;
-	}
-	
-	// read the blocks one at a time
-	for (i = 0; i < blks; i++)
-	{
-		// get the right memory location from the memory structure
-		uint8_t disk_to_write = tags[tag_index]->addresses[0][bnum + i];
-		uint32_t blk_to_read = tags[tag_index]->addresses[1][bnum + i];
-		// make the RAID call
-		RAIDOpCode read = make_raid_request(RAID_READ, 1, disk_to_write, blk_to_read);
-		RAIDOpCode read_response = raid_bus_request(read, buf);
-	}
-	
-	// Return successfully
-	logMessage(LOG_INFO_LEVEL, "TAGLINE : read %u blocks from tagline %u, starting block %u.",
-			blks, tag, bnum);
-	return(0);
+	return(tagline_wait(tagline_read_async(tag, bnum, blks, buf, NULL, NULL)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -159,78 +1910,149 @@ int tagline_read(TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks, char
 // Outputs      : 0 if successful, -1 if failure
 
 int tagline_write(TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks, char *buf) {
-	
-	uint8_t disk_to_write = 0;
+	return(tagline_wait(tagline_write_async(tag, bnum, blks, buf, NULL, NULL)));
+}
 
-	// figure out which disk has least written to it and use it
-	for (i = 0; i < RAID_DISKS; i++)
-    {
-		if (current_filled[i] == 0)
-	    {
-			disk_to_write = i;
-			i = RAID_DISKS;
-		}
-		else if (current_filled[i] < current_filled[disk_to_write])
-			disk_to_write = i;
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readv
+// Description  : Read blocks from the tagline driver into a vector of
+//                memory segments
+//
+// Inputs       : tag - the number of the tagline to read from
+//                bnum - the starting block to read from
+//                iov - the segments to read into (whole blocks each)
+//                iovcnt - the number of segments
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_readv(TagLineNumber tag, TagLineBlockNumber bnum, const struct iovec *iov, int iovcnt) {
+	return(tagline_wait(tagline_readv_async(tag, bnum, iov, iovcnt, NULL, NULL)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_writev
+// Description  : Write blocks gathered from a vector of memory segments to
+//                the tagline driver
+//
+// Inputs       : tag - the number of the tagline to write to
+//                bnum - the starting block to write to
+//                iov - the segments holding the blocks (whole blocks each)
+//                iovcnt - the number of segments
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_writev(TagLineNumber tag, TagLineBlockNumber bnum, const struct iovec *iov, int iovcnt) {
+	return(tagline_wait(tagline_writev_async(tag, bnum, iov, iovcnt, NULL, NULL)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_delete_async
+// Description  : Submit the delete of a tagline; its blocks are reused by
+//                later writes
+//
+// Inputs       : tag - the number of the tagline to delete
+//                callback - called when the delete completes (may be NULL)
+//                arg - passed to the callback
+// Outputs      : the request handle, -1 if failure
+
+TagLineRequest tagline_delete_async(TagLineNumber tag, TaglineCompletion callback, void *arg) {
+	return(tagline_submit(TAGLINE_REQ_DELETE, tag, 0, 0, NULL, 0, callback, arg));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_delete
+// Description  : Delete a tagline and free its blocks
+//
+// Inputs       : tag - the number of the tagline to delete
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_delete(TagLineNumber tag) {
+	return(tagline_wait(tagline_delete_async(tag, NULL, NULL)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_space_stats
+// Description  : Measure the free space of the array (the driver must be
+//                initialized; with requests running, the counters are of
+//                a moment while they ran)
+//
+// Inputs       : total - the counters for the whole array (returned)
+//                disks - the counters of each disk (returned, may be NULL)
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_space_stats(TaglineAllocStats *total, TaglineAllocStats *disks) {
+	if (tag_directory == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : space stats of an uninitialized driver");
+		return(-1);
 	}
+	tagline_alloc_stats(total, disks);
+	return(0);
+}
 
-	// figure out if the tag/bnum is old or new
-	int tag_index = -1;
-	int next_tag_index = 0;
-	while (tags[next_tag_index]->tag_name != -1)
-	{
-		if (tags[next_tag_index]->tag_name == tag)
-			tag_index = next_tag_index;	
-		next_tag_index++;
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_layout_stats
+// Description  : Measure how the taglines are laid out on the array: how
+//                many transfers and tracks it takes to read each of them
+//                whole, against one track per track-sized range (the
+//                driver must be initialized; each tagline is measured
+//                holding its lock, so requests may be running)
+//
+// Inputs       : stats - the layout counters (returned)
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_layout_stats(TaglineLayoutStats *stats) {
+
+	uint32_t tracks[MAX_TAGLINE_BLOCK_NUMBER], ntracks, trk, e, t, blk, tag;
+	uint8_t ranges[MAX_TAGLINE_BLOCK_NUMBER / RAID_TRACK_BLOCKS];
+	TaglineExtent *ext;
+	TAGLINE *line;
+
+	if (tag_directory == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : layout stats of an uninitialized driver");
+		return(-1);
 	}
-	// if the tagline is new make a request to the least filled disk
-	if (tag_index == -1)
+	memset(stats, 0x0, sizeof(TaglineLayoutStats));
+	pthread_rwlock_rdlock(&directory_lock);
+	for (tag = 0; tag < tag_directory_size; tag++)
 	{
-		RAIDOpCode write = make_raid_request(RAID_WRITE, blks, disk_to_write, current_filled[disk_to_write]);
-		RAIDOpCode write_response = raid_bus_request(write, buf);
-
-		// this tag is new, so record the name in the next null index of tags	
-		tags[next_tag_index]->tag_name = tag;
-		// log the locations
-		for (k = 0; i < blks; i++)
-		{
-			tags[next_tag_index]->addresses[0][bnum + k] = disk_to_write;
-			tags[next_tag_index]->addresses[1][bnum + k] = (current_filled[disk_to_write] + i);
+		if ((line = tagline_lookup(tag)) == NULL) {
+			continue;
 		}
-		// increment the array for counting memory
-		current_filled[disk_to_write] += blks;
-	}
+		pthread_rwlock_rdlock(&line->lock);
+		if (line->map.count == 0) {
+			pthread_rwlock_unlock(&line->lock);
+			continue;
+		}
+		stats->taglines++;
+		stats->extents += line->map.count;
 
-	// otherwise check the tagblocks
-	else
-	{	
-		int counter = 0;
-		for (i = 0; i < blks; i++)
-		{
-			// if there is an entry for this block, overwrite
-			if (tags[tag_index]->addresses[0][bnum + i] != -1)
-			{
-				uint8_t this_disk = tags[tag_index]->addresses[0][bnum + i];
-				uint32_t this_block = tags[tag_index]->addresses[1][bnum + i];
-				RAIDOpCode write = make_raid_request(RAID_WRITE, 1, this_disk, this_block);
-				RAIDOpCode write_response = raid_bus_request(write, buf);
-			}
-			
-			// it should be new blocks from now on
-			else
-			{
-				RAIDOpCode write = make_raid_request(RAID_WRITE, 1, disk_to_write, current_filled[disk_to_write]);
-				RAIDOpCode write_response = raid_bus_request(write, buf);
-				tags[tag_index]->addresses[0][bnum + i] = disk_to_write;
-				tags[tag_index]->addresses[1][bnum + i] = (current_filled[disk_to_write] + counter);
-				counter++;
+		// collect the distinct tracks (and ranges) the blocks sit in
+		ntracks = 0;
+		memset(ranges, 0x0, sizeof(ranges));
+		for (e = 0; e < line->map.count; e++) {
+			ext = &line->map.extents[e];
+			stats->blocks += ext->length;
+			for (blk = 0; blk < ext->length; blk++) {
+				ranges[(ext->lblock + blk) / RAID_TRACK_BLOCKS] = 1;
+				trk = ((ext->rblock + blk) / RAID_TRACK_BLOCKS) * array_disks + ext->disk;
+				for (t = 0; (t < ntracks) && (tracks[t] != trk); t++);
+				if (t == ntracks) {
+					tracks[ntracks++] = trk;
+				}
 			}
 		}
+		pthread_rwlock_unlock(&line->lock);
+		stats->tracks += ntracks;
+		for (t = 0; t < sizeof(ranges); t++) {
+			stats->min_tracks += ranges[t];
+		}
 	}
-
-	// Return successfully
-	logMessage(LOG_INFO_LEVEL, "TAGLINE : wrote %u blocks to tagline %u, starting block %u.",
-			blks, tag, bnum);
+	pthread_rwlock_unlock(&directory_lock);
+	stats->reserved = tagline_place_reserved();
 	return(0);
 }
 
@@ -243,9 +2065,164 @@ int tagline_write(TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks, char
 // Outputs      : 0 if successful, -1 if failure
 
 int tagline_close(void) {
+
+	TaglineAllocStats space;
+	TaglineLayoutStats layout;
+	TaglineSegmentStats segs;
+	TaglineStripeStats stripes;
+	TaglineReadaheadStats ahead;
+	uint64_t checksum;
+	int result = 0, flushed;
+
+	// let the outstanding requests drain, then stop the dispatcher
+	if (requests != NULL) {
+		pthread_mutex_lock(&request_lock);
+		dispatcher_stop = 1;
+		pthread_cond_signal(&dispatcher_wake);
+		pthread_mutex_unlock(&request_lock);
+		pthread_join(dispatcher, NULL);
+		tagline_free_requests();
+	}
+
+	// write back everything still dirty in the cache; a failure here or
+	// below still tears everything down, so the driver can be set up again
+	flushed = close_tagline_cache();
+	if (tagline_io_drain() || flushed) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failed flushing block cache on close");
+		result = -1;
+	}
+	tagline_io_close();
+
+	// RAID_CLOSE saves the store, so the image written after it never
+	// refers to data the store does not have
 	RAIDOpCode close = make_raid_request(RAID_CLOSE, 0, 0, 0);
-	RAIDOpCode close_response = raid_bus_request(close, NULL);
-	// Return successfully
-	logMessage(LOG_INFO_LEVEL, "TAGLINE storage device: closing completed.");
+	if (raid_request_failed(tagline_bus_request(close, NULL))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID close failed");
+		result = -1;
+	}
+	if ((result == 0) && (tagline_meta_file != NULL) && tagline_save_image(&checksum)) {
+		result = -1;
+	}
+
+	// the journal is only needed if the image could not be saved
+	tagline_journal_close(result == 0);
+
+	// report the layout, the segment log, the readahead and the free space
+	// left, then release them and the tag directory
+	tagline_layout_stats(&layout);
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : layout %u taglines in %lu extents on %lu tracks (%lu at best)",
+			layout.taglines, layout.extents, layout.tracks, layout.min_tracks);
+	tagline_place_close();
+	if (log_mode) {
+		tagline_segment_stats(&segs);
+		TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : segment log %lu blocks appended, %lu segments cleaned (%lu blocks moved)",
+				segs.appended, segs.cleaned, segs.moved);
+		tagline_segment_close();
+		log_mode = 0;
+	}
+	if (tagline_stripe_enabled()) {
+		tagline_stripe_stats(&stripes);
+		TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : stripes %lu written whole, %lu read-modify-write, %lu reconstruct-write, %lu parity blocks",
+				stripes.full_writes, stripes.rmw_writes, stripes.rcw_writes, stripes.parity_blocks);
+		TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : degraded %lu stripe writes, %lu blocks rebuilt on read",
+				stripes.degraded_writes, stripes.degraded_reads);
+		tagline_stripe_close();
+	}
+	if (tagline_readahead_enabled()) {
+		tagline_readahead_close();
+		tagline_readahead_stats(&ahead);
+		TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : readahead %lu streams, %lu windows, %lu blocks read ahead (%lu read, %lu wasted, %.1f%% useful)",
+				ahead.streams, ahead.windows, ahead.prefetched, ahead.hits, ahead.wasted,
+				ahead.prefetched ? (100.0 * ahead.hits) / ahead.prefetched : 0.0);
+	}
+	tagline_alloc_stats(&space, NULL);
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : free space %u blocks in %u runs (largest %u, fragmentation %.1f%%)",
+			space.free_blocks, space.free_runs, space.largest_run, space.fragmentation * 100.0);
+	tagline_alloc_close();
+	tagline_free_directory();
+	tagline_meta_release(&meta_image);
+
+	// Return the result
+	if (result == 0) {
+		TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE storage device: closing completed.");
+	}
+	return(result);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_clean_unit_test
+// Description  : Fill three segments in log mode and overwrite part of the
+//                first, too little of it for the idle cleaner to take, then
+//                clean it: the live blocks must be remapped to the log head,
+//                owned there by the same tagline blocks, the victim left
+//                dead, and every block read back with its newest contents
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_clean_unit_test(void) {
+
+	static char data[MAX_TAGLINE_BLOCK_NUMBER * TAGLINE_BLOCK_SIZE], check[MAX_TAGLINE_BLOCK_NUMBER * TAGLINE_BLOCK_SIZE];
+	int enabled = tagline_log_structured, failed;
+	TaglineSegmentStats segs;
+	TagLineNumber owner;
+	RAIDDiskID disk;
+	RAIDBlockID base;
+	TaglineExtent run;
+	TAGLINE *line;
+	uint32_t blk, lblock;
+
+	// Tagline 0 fills two segments and tagline 1 a third; tagline 2 opens
+	// the next, then part of the first segment is overwritten
+	for (blk = 0; blk < MAX_TAGLINE_BLOCK_NUMBER; blk++) {
+		memset(&data[blk * TAGLINE_BLOCK_SIZE], 'a' + blk % 26, TAGLINE_BLOCK_SIZE);
+	}
+	set_tagline_log_structured(1);
+	if (tagline_driver_init(4)) {
+		set_tagline_log_structured(enabled);
+		return(-1);
+	}
+	failed = tagline_write(0, 0, MAX_TAGLINE_BLOCK_NUMBER, data) ||
+			tagline_write(1, 0, TAGLINE_SEGMENT_BLOCKS, data) || tagline_write(2, 0, 8, data);
+	for (blk = 8; blk < 8 + TAGLINE_CLEAN_TDEAD; blk++) {
+		memset(&data[blk * TAGLINE_BLOCK_SIZE], 'A' + blk % 26, TAGLINE_BLOCK_SIZE);
+	}
+	failed = failed || tagline_write(0, 8, TAGLINE_CLEAN_TDEAD, &data[8 * TAGLINE_BLOCK_SIZE]);
+
+	// The first segment has the fewest live blocks; clean it (nothing is
+	// in flight, and it is too full for the idle dispatcher to clean)
+	line = tagline_lookup(0);
+	failed = failed || (line == NULL) || (tagline_extent_lookup(&line->map, 0, &run) != 1);
+	if (! failed) {
+		disk = run.disk;
+		base = run.rblock - run.rblock % TAGLINE_SEGMENT_BLOCKS;
+		failed = tagline_segment_victim(TAGLINE_SEGMENT_BLOCKS, &disk, &base) || (disk != run.disk) ||
+				(base != run.rblock - run.rblock % TAGLINE_SEGMENT_BLOCKS) || tagline_clean_segment(disk, base);
+	}
+
+	// Nothing maps into the victim or is owned there; every block of the
+	// tagline is owned where its map says it is
+	for (blk = 0; (blk < TAGLINE_SEGMENT_BLOCKS) && (! failed); blk++) {
+		failed = tagline_segment_owner(disk, base + blk, &owner, &lblock);
+	}
+	for (blk = 0; (blk < MAX_TAGLINE_BLOCK_NUMBER) && (! failed); blk++) {
+		failed = (tagline_extent_lookup(&line->map, blk, &run) != 1) ||
+				((run.disk == disk) && (run.rblock >= base) && (run.rblock < base + TAGLINE_SEGMENT_BLOCKS)) ||
+				(tagline_segment_owner(run.disk, run.rblock, &owner, &lblock) != 1) || (owner != 0) || (lblock != blk);
+	}
+	tagline_segment_stats(&segs);
+	failed = failed || (segs.cleaned != 1) || (segs.moved != TAGLINE_SEGMENT_BLOCKS - TAGLINE_CLEAN_TDEAD);
+	failed = failed || tagline_read(0, 0, MAX_TAGLINE_BLOCK_NUMBER, check) || memcmp(check, data, sizeof(data)) ||
+			tagline_read(1, 0, TAGLINE_SEGMENT_BLOCKS, check) || memcmp(check, data, 8 * TAGLINE_BLOCK_SIZE);
+
+	failed = tagline_close() || failed;
+	set_tagline_log_structured(enabled);
+	if (failed) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : segment cleaner unit test failed");
+		return(-1);
+	}
+
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : segment cleaner unit test passed (%lu blocks moved)", segs.moved);
 	return(0);
 }
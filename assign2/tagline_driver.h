@@ -1,28 +1,49 @@
-#ifndef RAID_DRIVER_INCLUDED
+#ifndef TAGLINE_DRIVER_INCLUDED
 #define TAGLINE_DRIVER_INCLUDED
 
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  File           : tagline_driver.h
 //  Description    : This is the header file for the driver interface between
-//                   the OS and the low-level driver.
+//                   the OS and the low-level driver.  Between init and
+//                   close the request and stats functions may be called
+//                   from any number of threads at once.  The requests are
+//                   all run by one dispatcher thread, so clients overlap
+//                   the time spent waiting on the disks, not the mapping
+//                   and cache work.
 //
 //  Author         : Patrick McDaniel
 //  Creates        : Mon Jun 15 07:51:29 EDT 2015
 //
 
 // Includes
+#include <sys/uio.h>
 #include "raid_bus.h"
+#include "tagline_alloc.h"
+#include "tagline_place.h"
 
 // Project Includes
 #define MAX_TAGLINE_BLOCK_NUMBER  128
 #define TAGLINE_BLOCK_SIZE        RAID_BLOCK_SIZE
 #define RAID_DISKS                5
 #define RAID_DISKBLOCKS           8192
+#define TAGLINE_DEFAULT_QUEUE_DEPTH 32
+#define TAGLINE_MAX_QUEUE_DEPTH   1024
 
 // Type definitions
 typedef uint16_t TagLineNumber;
 typedef uint32_t TagLineBlockNumber;
+typedef int32_t  TagLineRequest;
+
+// How tagline_driver_init treats the saved store and metadata image
+typedef enum {
+	TAGLINE_INIT_AUTO = 0,  // restart warm if the image is usable, else cold
+	TAGLINE_INIT_COLD = 1,  // format every disk and start empty
+	TAGLINE_INIT_WARM = 2,  // restart warm, failing if the image is unusable
+} TaglineInitMode;
+
+// Function called when an asynchronous request completes
+typedef void (*TaglineCompletion)(TagLineRequest req, int result, void *arg);
 
 //
 // Interface functions
@@ -36,7 +57,83 @@ int tagline_read(TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks, char
 int tagline_write(TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks, char *buf);
 	// Write a number of blocks from the tagline driver
 
+int tagline_readv(TagLineNumber tag, TagLineBlockNumber bnum, const struct iovec *iov, int iovcnt);
+	// Read blocks into a vector of memory segments (each whole blocks), without copying through a buffer
+
+int tagline_writev(TagLineNumber tag, TagLineBlockNumber bnum, const struct iovec *iov, int iovcnt);
+	// Write blocks gathered from a vector of memory segments (each whole blocks)
+
+int tagline_delete(TagLineNumber tag);
+	// Delete a tagline, freeing its blocks for reuse
+
+int tagline_space_stats(TaglineAllocStats *total, TaglineAllocStats *disks);
+	// Measure the free space and fragmentation of the array (disks may be NULL)
+
+int tagline_layout_stats(TaglineLayoutStats *stats);
+	// Measure the extents and tracks the taglines are spread over
+
 int tagline_close(void);
 	// Close the tagline interface
 
-#endif /* RAID_DRIVER_INCLUDED */
+int set_tagline_metadata_file(const char *path);
+	// Persist the taglines in a metadata image across close and init
+
+int set_tagline_init_mode(TaglineInitMode mode);
+	// Choose a cold or warm start for the next init
+
+int set_tagline_journal_limit(uint64_t bytes);
+	// Set the journal size that triggers compaction (0 is no journal)
+
+int set_tagline_log_structured(int enabled);
+	// Append every write to a segment log (cleaned in the background) from the next init
+
+int set_tagline_placement(TaglinePlaceType type);
+	// Choose where new blocks go (next fit or track-aligned) from the next init
+
+int set_tagline_stripe_unit(uint32_t blocks);
+	// Stripe the array as RAID-5 with units of blocks from the next init (0 is no striping)
+
+int set_tagline_bus_backend(const char *spec);
+	// Choose the RAID bus backend (lib, file[:path], model[:seek:track:block] or net[:host[:port]]) before init
+
+int tagline_fail_disk(RAIDDiskID disk);
+	// Lose a disk of a RAID-5 array, reading its blocks from the others from now on
+
+//
+// Asynchronous interface functions
+
+int set_tagline_queue_depth(uint32_t depth);
+	// Set the maximum number of outstanding requests (before init)
+
+TagLineRequest tagline_read_async(TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks, char *buf,
+		TaglineCompletion callback, void *arg);
+	// Submit a read, returning a handle (callback may be NULL)
+
+TagLineRequest tagline_write_async(TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks, char *buf,
+		TaglineCompletion callback, void *arg);
+	// Submit a write, returning a handle (callback may be NULL)
+
+TagLineRequest tagline_readv_async(TagLineNumber tag, TagLineBlockNumber bnum, const struct iovec *iov, int iovcnt,
+		TaglineCompletion callback, void *arg);
+	// Submit a vectored read, returning a handle (the vector is copied, the segments must be kept)
+
+TagLineRequest tagline_writev_async(TagLineNumber tag, TagLineBlockNumber bnum, const struct iovec *iov, int iovcnt,
+		TaglineCompletion callback, void *arg);
+	// Submit a vectored write, returning a handle (the segments must not change until it completes)
+
+TagLineRequest tagline_delete_async(TagLineNumber tag, TaglineCompletion callback, void *arg);
+	// Submit a tagline delete, returning a handle (callback may be NULL)
+
+int tagline_poll(TagLineRequest req);
+	// Check if a request is complete (1 done, 0 running, -1 bad handle)
+
+int tagline_wait(TagLineRequest req);
+	// Wait for a request to complete and release it, returning its result
+
+//
+// Unit test
+
+int tagline_clean_unit_test(void);
+	// Clean a segment in log mode, checking the moved blocks are remapped
+
+#endif /* TAGLINE_DRIVER_INCLUDED */
@@ -0,0 +1,524 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_extent.c
+//  Description    : This is the implementation of the tagline extent map.
+//                   Each tagline keeps a small sorted array of extents
+//                   (disk, start block, length) rather than one address
+//                   pair per block, so runs of blocks cost one entry.
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_extent.h"
+#include "tagline_driver.h"
+#include "tagline_log.h"
+
+// Defines
+#define TAGLINE_EXTENT_MINCAP 4     // initial number of extents allocated
+#define TAGLINE_EXTENT_TESTS  2000  // random maps built by the unit test
+#define TAGLINE_EXTENT_EDITS  64    // random inserts into each map
+
+// A tagline block as the unit test expects it mapped
+typedef struct {
+	int         mapped;  // is the block mapped?
+	RAIDDiskID  disk;    // the disk holding it
+	RAIDBlockID rblock;  // the RAID block holding it
+} TaglineExtentShadow;
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_find
+// Description  : Binary search for the first extent ending after a block
+//
+// Inputs       : map - the extent map to search
+//                lblock - the tagline block to search for
+// Outputs      : index of the extent (count if there is none)
+
+static uint16_t tagline_extent_find(TaglineExtentMap *map, uint32_t lblock) {
+
+	uint16_t lo = 0, hi = map->count, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if ((uint32_t)map->extents[mid].lblock + map->extents[mid].length <= lblock) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return(lo);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_open
+// Description  : Open a gap of n slots in the extent array at an index
+//
+// Inputs       : map - the extent map
+//                idx - the index to open the gap at
+//                n - the number of slots to open
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_extent_open(TaglineExtentMap *map, uint16_t idx, uint16_t n) {
+
+	TaglineExtent *grown;
+	uint16_t newcap;
+
+	if (map->count + n > map->capacity) {
+		newcap = (map->capacity == 0) ? TAGLINE_EXTENT_MINCAP : map->capacity * 2;
+		while (newcap < map->count + n) {
+			newcap *= 2;
+		}
+		if ((grown = realloc((map->capacity == 0) ? NULL : map->extents, newcap * sizeof(TaglineExtent))) == NULL) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to grow extent map to %u", newcap);
+			return(-1);
+		}
+		if (map->capacity == 0) {
+			// a borrowed array is copied out on first growth
+			memcpy(grown, map->extents, map->count * sizeof(TaglineExtent));
+		}
+		map->extents = grown;
+		map->capacity = newcap;
+	}
+	memmove(&map->extents[idx + n], &map->extents[idx],
+			(map->count - idx) * sizeof(TaglineExtent));
+	map->count += n;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_close
+// Description  : Remove n slots from the extent array at an index
+//
+// Inputs       : map - the extent map
+//                idx - the index of the first slot to remove
+//                n - the number of slots to remove
+// Outputs      : none
+
+static void tagline_extent_close(TaglineExtentMap *map, uint16_t idx, uint16_t n) {
+	memmove(&map->extents[idx], &map->extents[idx + n],
+			(map->count - idx - n) * sizeof(TaglineExtent));
+	map->count -= n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_adjacent
+// Description  : Check if extent b continues extent a, logically and on disk
+//
+// Inputs       : a, b - the extents to check (a before b)
+// Outputs      : 1 if b continues a, 0 otherwise
+
+static int tagline_extent_adjacent(TaglineExtent *a, TaglineExtent *b) {
+	return((a->disk == b->disk) &&
+		((uint32_t)a->lblock + a->length == b->lblock) &&
+		(a->rblock + a->length == b->rblock) &&
+		((uint32_t)a->length + b->length <= UINT8_MAX));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_init
+// Description  : Initialize an empty extent map
+//
+// Inputs       : map - the extent map to initialize
+// Outputs      : none
+
+void tagline_extent_init(TaglineExtentMap *map) {
+	map->count = 0;
+	map->capacity = 0;
+	map->extents = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_free
+// Description  : Release the memory held by an extent map
+//
+// Inputs       : map - the extent map to release
+// Outputs      : none
+
+void tagline_extent_free(TaglineExtentMap *map) {
+	if (map->capacity > 0) {
+		free(map->extents);
+	}
+	tagline_extent_init(map);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_attach
+// Description  : Make an extent map use an array it does not own (e.g., a
+//                mapped metadata image).  The map edits the array in place
+//                and copies it to its own memory the first time it grows.
+//
+// Inputs       : map - the extent map to set
+//                extents - the sorted extents
+//                count - the number of extents
+// Outputs      : none
+
+void tagline_extent_attach(TaglineExtentMap *map, TaglineExtent *extents, uint16_t count) {
+	map->count = count;
+	map->capacity = 0;
+	map->extents = extents;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_lookup
+// Description  : Find the run of blocks starting at a tagline block.  If the
+//                block is mapped, run describes the rest of its extent.  If
+//                it is not, run->length is the number of unmapped blocks
+//                before the next extent (or the end of the tagline).
+//
+// Inputs       : map - the extent map to search
+//                lblock - the tagline block to look up
+//                run - the run found (returned)
+// Outputs      : 1 if the block is mapped, 0 if it is not
+
+int tagline_extent_lookup(TaglineExtentMap *map, uint32_t lblock, TaglineExtent *run) {
+
+	uint16_t idx = tagline_extent_find(map, lblock);
+	TaglineExtent *ext = &map->extents[idx];
+	uint32_t offset;
+
+	// Unmapped: measure the hole up to the next extent
+	if ((idx == map->count) || (ext->lblock > lblock)) {
+		run->lblock = lblock;
+		run->length = ((idx == map->count) ? MAX_TAGLINE_BLOCK_NUMBER : ext->lblock) - lblock;
+		run->disk = 0;
+		run->rblock = 0;
+		return(0);
+	}
+
+	// Mapped: trim the extent to start at the block
+	offset = lblock - ext->lblock;
+	run->lblock = lblock;
+	run->length = ext->length - offset;
+	run->disk = ext->disk;
+	run->rblock = ext->rblock + offset;
+	return(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_insert
+// Description  : Map a range of tagline blocks onto consecutive blocks of a
+//                disk, replacing any previous mapping of those blocks and
+//                merging with neighbouring extents that it continues.
+//
+// Inputs       : map - the extent map to update
+//                lblock - the first tagline block of the range
+//                disk - the disk holding the range
+//                rblock - the first RAID block of the range
+//                length - the number of blocks in the range
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_extent_insert(TaglineExtentMap *map, uint32_t lblock, RAIDDiskID disk,
+		RAIDBlockID rblock, uint32_t length) {
+
+	TaglineExtent *ext, tail;
+	uint32_t end = lblock + length, ext_end;
+	uint16_t idx, first, last;
+
+	if ((length == 0) || (end > MAX_TAGLINE_BLOCK_NUMBER)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad extent [%u+%u]", lblock, length);
+		return(-1);
+	}
+
+	// Split an extent that straddles the start of the range
+	idx = tagline_extent_find(map, lblock);
+	ext = &map->extents[idx];
+	if ((idx < map->count) && (ext->lblock < lblock)) {
+		ext_end = ext->lblock + ext->length;
+		tail = *ext;
+		ext->length = lblock - ext->lblock;
+		if (ext_end > end) {
+			// The range is strictly inside the extent, keep its tail
+			tail.rblock += end - tail.lblock;
+			tail.lblock = end;
+			tail.length = ext_end - end;
+			if (tagline_extent_open(map, idx + 1, 1)) {
+				return(-1);
+			}
+			map->extents[idx + 1] = tail;
+		}
+		idx++;
+	}
+
+	// Drop extents wholly covered by the range, trim one overlapping its end
+	first = idx;
+	for (last = first; (last < map->count) && (map->extents[last].lblock + map->extents[last].length <= end); last++);
+	if ((last < map->count) && (map->extents[last].lblock < end)) {
+		ext = &map->extents[last];
+		ext->rblock += end - ext->lblock;
+		ext->length -= end - ext->lblock;
+		ext->lblock = end;
+	}
+
+	// Put the new extent in place of the covered ones
+	if (last > first) {
+		tagline_extent_close(map, first + 1, last - first - 1);
+	} else if (tagline_extent_open(map, first, 1)) {
+		return(-1);
+	}
+	ext = &map->extents[first];
+	ext->lblock = lblock;
+	ext->length = length;
+	ext->disk = disk;
+	ext->unused = 0;
+	ext->rblock = rblock;
+
+	// Merge with the neighbours it continues
+	if ((first + 1 < map->count) && tagline_extent_adjacent(ext, ext + 1)) {
+		ext->length += ext[1].length;
+		tagline_extent_close(map, first + 1, 1);
+	}
+	if ((first > 0) && tagline_extent_adjacent(ext - 1, ext)) {
+		ext[-1].length += ext->length;
+		tagline_extent_close(map, first, 1);
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_drop_disk
+// Description  : Remove every extent on a disk (e.g., one that was lost or
+//                reformatted), leaving its tagline blocks unmapped
+//
+// Inputs       : map - the extent map to update
+//                disk - the disk to drop
+// Outputs      : the number of tagline blocks unmapped
+
+uint32_t tagline_extent_drop_disk(TaglineExtentMap *map, RAIDDiskID disk) {
+
+	uint32_t dropped = 0;
+	uint16_t from, to;
+
+	for (from = to = 0; from < map->count; from++) {
+		if (map->extents[from].disk == disk) {
+			dropped += map->extents[from].length;
+		} else {
+			map->extents[to++] = map->extents[from];
+		}
+	}
+	map->count = to;
+	return(dropped);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_check
+// Description  : Check an extent map is sorted, non-overlapping and fully
+//                merged, and maps every block as the shadow map does
+//
+// Inputs       : map - the extent map to check
+//                shadow - the mapping expected of each tagline block
+//                count - the number of extents expected (-1 for any)
+// Outputs      : 0 if they agree, -1 if not
+
+static int tagline_extent_check(TaglineExtentMap *map, TaglineExtentShadow *shadow, int count) {
+
+	TaglineExtent run;
+	uint32_t b, i;
+	int mapped;
+
+	if ((count != -1) && (map->count != count)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : extent map has %u extents, expected %d", map->count, count);
+		return(-1);
+	}
+	for (i = 0; i < map->count; i++) {
+		if ((map->extents[i].length == 0) ||
+				((uint32_t)map->extents[i].lblock + map->extents[i].length > MAX_TAGLINE_BLOCK_NUMBER) ||
+				((i > 0) && (((uint32_t)map->extents[i-1].lblock + map->extents[i-1].length > map->extents[i].lblock) ||
+				tagline_extent_adjacent(&map->extents[i-1], &map->extents[i])))) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad extent %u [%u+%u]", i, map->extents[i].lblock, map->extents[i].length);
+			return(-1);
+		}
+	}
+
+	// every block must look up as expected, and so must the rest of its run
+	for (b = 0; b < MAX_TAGLINE_BLOCK_NUMBER; b++) {
+		mapped = tagline_extent_lookup(map, b, &run);
+		if ((mapped != shadow[b].mapped) || (run.lblock != b) || (run.length == 0) ||
+				(b + run.length > MAX_TAGLINE_BLOCK_NUMBER)) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : extent lookup of block %u mismatch", b);
+			return(-1);
+		}
+		for (i = 0; i < run.length; i++) {
+			if ((shadow[b + i].mapped != mapped) || (mapped && ((shadow[b + i].disk != run.disk) ||
+					(shadow[b + i].rblock != run.rblock + i)))) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : extent run of block %u mismatch at %u", b, b + i);
+				return(-1);
+			}
+		}
+		if ((b + run.length < MAX_TAGLINE_BLOCK_NUMBER) && (shadow[b + run.length].mapped == mapped) &&
+				((! mapped) || ((shadow[b + run.length].disk == run.disk) &&
+				(shadow[b + run.length].rblock == run.rblock + run.length)))) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : extent run of block %u ends early", b);
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_shadow
+// Description  : Map a range of blocks in the unit test's shadow map
+//
+// Inputs       : shadow - the shadow map
+//                lblock - the first tagline block of the range
+//                disk - the disk holding the range
+//                rblock - the first RAID block of the range
+//                length - the number of blocks in the range
+// Outputs      : none
+
+static void tagline_extent_shadow(TaglineExtentShadow *shadow, uint32_t lblock, RAIDDiskID disk,
+		RAIDBlockID rblock, uint32_t length) {
+
+	uint32_t i;
+
+	for (i = 0; i < length; i++) {
+		shadow[lblock + i].mapped = 1;
+		shadow[lblock + i].disk = disk;
+		shadow[lblock + i].rblock = rblock + i;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_extent_unit_test
+// Description  : Split, trim and merge extents, grow a borrowed array, then
+//                build random maps with inserts and dropped disks and
+//                check each against a map of every block
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_extent_unit_test(void) {
+
+	TaglineExtentShadow shadow[MAX_TAGLINE_BLOCK_NUMBER];
+	TaglineExtent borrowed[2], saved[2];
+	TaglineExtentMap map;
+	uint32_t lblock, length, dropped, expect, b;
+	RAIDDiskID disk;
+	RAIDBlockID rblock;
+	int t, e;
+
+	// Split: a range inside an extent leaves its head and tail around it
+	tagline_extent_init(&map);
+	memset(shadow, 0x0, sizeof(shadow));
+	tagline_extent_shadow(shadow, 10, 1, 100, 20);
+	tagline_extent_shadow(shadow, 15, 2, 500, 5);
+	if (tagline_extent_insert(&map, 10, 1, 100, 20) || tagline_extent_insert(&map, 15, 2, 500, 5) ||
+			tagline_extent_check(&map, shadow, 3)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : extent split failed");
+		tagline_extent_free(&map);
+		return(-1);
+	}
+
+	// Trim and cover: a range over the end of one extent, the whole of the
+	// next and the start of the last
+	tagline_extent_shadow(shadow, 12, 3, 700, 10);
+	if (tagline_extent_insert(&map, 12, 3, 700, 10) || tagline_extent_check(&map, shadow, 3)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : extent trim failed");
+		tagline_extent_free(&map);
+		return(-1);
+	}
+
+	// Merge: filling the gap with the blocks that continue the disk joins
+	// the range with the extents on both sides
+	tagline_extent_shadow(shadow, 12, 1, 102, 10);
+	if (tagline_extent_insert(&map, 12, 1, 102, 10) || tagline_extent_check(&map, shadow, 1)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : extent merge failed");
+		tagline_extent_free(&map);
+		return(-1);
+	}
+	tagline_extent_free(&map);
+
+	// Growth: a borrowed array is copied on the first insert needing room,
+	// and is not freed with the map
+	memset(shadow, 0x0, sizeof(shadow));
+	borrowed[0].lblock = 0;
+	borrowed[0].length = 8;
+	borrowed[0].disk = 0;
+	borrowed[0].unused = 0;
+	borrowed[0].rblock = 40;
+	borrowed[1] = borrowed[0];
+	borrowed[1].lblock = 16;
+	borrowed[1].disk = 4;
+	tagline_extent_shadow(shadow, 0, 0, 40, 8);
+	tagline_extent_shadow(shadow, 16, 4, 40, 8);
+	memcpy(saved, borrowed, sizeof(saved));
+	tagline_extent_attach(&map, borrowed, 2);
+	if (tagline_extent_check(&map, shadow, 2)) {
+		return(-1);
+	}
+	tagline_extent_shadow(shadow, 10, 2, 60, 2);
+	if (tagline_extent_insert(&map, 10, 2, 60, 2) || (map.capacity == 0) || (map.extents == borrowed) ||
+			memcmp(borrowed, saved, sizeof(saved)) || tagline_extent_check(&map, shadow, 3)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : extent growth of a borrowed array failed");
+		tagline_extent_free(&map);
+		return(-1);
+	}
+	tagline_extent_free(&map);
+
+	// Random inserts, some continuing the block before them on disk, and
+	// now and then a lost disk
+	for (t = 0; t < TAGLINE_EXTENT_TESTS; t++) {
+		tagline_extent_init(&map);
+		memset(shadow, 0x0, sizeof(shadow));
+		for (e = 0; e < TAGLINE_EXTENT_EDITS; e++) {
+			lblock = rand() % MAX_TAGLINE_BLOCK_NUMBER;
+			length = 1 + rand() % ((rand() % 4) ? 8 : MAX_TAGLINE_BLOCK_NUMBER - lblock);
+			if (lblock + length > MAX_TAGLINE_BLOCK_NUMBER) {
+				length = MAX_TAGLINE_BLOCK_NUMBER - lblock;
+			}
+			if ((lblock > 0) && shadow[lblock - 1].mapped && (rand() % 2)) {
+				disk = shadow[lblock - 1].disk;
+				rblock = shadow[lblock - 1].rblock + 1;
+			} else {
+				disk = rand() % RAID_DISKS;
+				rblock = rand() % (RAID_DISKBLOCKS - MAX_TAGLINE_BLOCK_NUMBER);
+			}
+			if ((rand() % 16) == 0) {
+				for (b = 0, expect = 0; b < MAX_TAGLINE_BLOCK_NUMBER; b++) {
+					if (shadow[b].mapped && (shadow[b].disk == disk)) {
+						shadow[b].mapped = 0;
+						expect++;
+					}
+				}
+				if ((dropped = tagline_extent_drop_disk(&map, disk)) != expect) {
+					TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : extent drop of disk %u unmapped %u blocks, expected %u",
+							disk, dropped, expect);
+					tagline_extent_free(&map);
+					return(-1);
+				}
+			} else {
+				tagline_extent_shadow(shadow, lblock, disk, rblock, length);
+				if (tagline_extent_insert(&map, lblock, disk, rblock, length)) {
+					tagline_extent_free(&map);
+					return(-1);
+				}
+			}
+			if (tagline_extent_check(&map, shadow, -1)) {
+				tagline_extent_free(&map);
+				return(-1);
+			}
+		}
+		tagline_extent_free(&map);
+	}
+
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : extent map unit test passed (%d maps)", TAGLINE_EXTENT_TESTS);
+	return(0);
+}
@@ -0,0 +1,62 @@
+#ifndef TAGLINE_EXTENT_INCLUDED
+#define TAGLINE_EXTENT_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_extent.h
+//  Description    : This is the header file for the extent map that records
+//                   where the blocks of a tagline live in the RAID array.
+//
+
+// Includes
+#include <stdint.h>
+#include "raid_bus.h"
+
+//
+// Type definitions
+
+// A run of tagline blocks stored in consecutive blocks of one disk
+typedef struct {
+	uint8_t     lblock;  // first tagline block of the run
+	uint8_t     length;  // number of blocks in the run
+	RAIDDiskID  disk;    // disk holding the run
+	uint8_t     unused;  // padding (keeps the extent at 8 bytes)
+	RAIDBlockID rblock;  // first RAID block of the run
+} TaglineExtent;
+
+// The sorted (by lblock) set of non-overlapping extents of one tagline
+typedef struct {
+	uint16_t       count;     // number of extents in use
+	uint16_t       capacity;  // number of extents allocated (0 if borrowed)
+	TaglineExtent *extents;   // the extents, sorted by lblock
+} TaglineExtentMap;
+
+//
+// Interface functions
+
+void tagline_extent_init(TaglineExtentMap *map);
+	// Initialize an empty extent map
+
+void tagline_extent_free(TaglineExtentMap *map);
+	// Release the memory held by an extent map
+
+void tagline_extent_attach(TaglineExtentMap *map, TaglineExtent *extents, uint16_t count);
+	// Use an array of extents owned by someone else (copied on growth)
+
+int tagline_extent_lookup(TaglineExtentMap *map, uint32_t lblock, TaglineExtent *run);
+	// Find the run starting at a tagline block (1 mapped, 0 unmapped)
+
+int tagline_extent_insert(TaglineExtentMap *map, uint32_t lblock, RAIDDiskID disk,
+		RAIDBlockID rblock, uint32_t length);
+	// Map a range of tagline blocks onto consecutive blocks of a disk
+
+uint32_t tagline_extent_drop_disk(TaglineExtentMap *map, RAIDDiskID disk);
+	// Unmap every block held by a disk, returning the number of blocks
+
+//
+// Unit test
+
+int tagline_extent_unit_test(void);
+	// Split, trim, merge and grow extent maps, checking them block by block
+
+#endif /* TAGLINE_EXTENT_INCLUDED */
@@ -0,0 +1,420 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File          : tagline_gen.c
+//  Description   : This is a tool that generates synthetic tagline workloads
+//                  in the tagline_sim text format, with a configurable
+//                  number of taglines, block count distribution, read/write
+//                  mix, tagline access pattern and rate of tagline deletes.
+//                  Every read is of blocks already written, the writes never
+//                  leave holes or overflow the array, and the final contents
+//                  of every tagline are emitted as validation lines.
+//
+
+// Include Files
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+
+// Project Includes
+#include <cmpsc311_log.h>
+#include "tagline_driver.h"
+
+// Defines
+#define GEN_ARGUMENTS "ht:n:w:x:a:z:d:s:o:"
+#define USAGE \
+	"USAGE: tagline_gen [-h] [-t <tags>] [-n <ops>] [-w <pct>] [-x <pct>] [-a <access>] [-z <theta>]\n" \
+	"                   [-d <dist>] [-s <seed>] [-o <outfile>]\n" \
+	"\n" \
+	"where:\n" \
+	"    -h - help mode (display this message)\n" \
+	"    -t - the number of taglines, 1-65535 (default 16)\n" \
+	"    -n - the number of read/write operations (default 10000)\n" \
+	"    -w - the percentage of operations that are writes (default 50)\n" \
+	"    -x - the percentage of operations that delete the tagline (default 0)\n" \
+	"    -a - the tagline access pattern: uniform, zipf or seq (default uniform)\n" \
+	"    -z - the zipf skew (default 0.99)\n" \
+	"    -d - the block count distribution (default uniform:1:16):\n" \
+	"             fixed:<n>          - always n blocks\n" \
+	"             uniform:<lo>:<hi>  - uniformly between lo and hi blocks\n" \
+	"             exp:<mean>         - geometric with the given mean\n" \
+	"    -s - the random seed (default 1)\n" \
+	"    -o - write the workload to <outfile> (default standard output)\n" \
+	"\n" \
+
+// The generator never fills the array past this many blocks, leaving one
+// maximum-sized run of slack on every disk for the driver's allocator
+#define GEN_BLOCK_BUDGET (RAID_DISKS * (RAID_DISKBLOCKS - MAX_TAGLINE_BLOCK_NUMBER))
+
+//
+// Type definitions
+
+// The tagline access patterns
+typedef enum {
+	GEN_ACCESS_UNIFORM = 0,  // every tagline equally likely
+	GEN_ACCESS_ZIPF    = 1,  // tagline k chosen with weight 1/(k+1)^theta
+	GEN_ACCESS_SEQ     = 2,  // taglines in turn, blocks in order within each
+	GEN_ACCESS_MAXVAL  = 3,
+} GenAccessType;
+
+// The block count distributions
+typedef enum {
+	GEN_DIST_FIXED   = 0,
+	GEN_DIST_UNIFORM = 1,
+	GEN_DIST_EXP     = 2,
+} GenDistType;
+
+// The state of one generated tagline
+typedef struct {
+	uint8_t length;                          // blocks written so far (no holes)
+	uint8_t cursor;                          // next block for sequential access
+	char    text[MAX_TAGLINE_BLOCK_NUMBER];  // the pattern byte of each block
+} GenTagline;
+
+//
+// Global data
+
+static const char *GEN_ACCESS_LABELS[GEN_ACCESS_MAXVAL] = { "uniform", "zipf", "seq" };
+static const char GEN_PATTERN[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+static uint64_t gen_state;     // the random number generator state
+static double *zipf_cdf;       // the cumulative zipf distribution over taglines
+
+//
+// Functional Prototypes
+
+int generate_workload(FILE *out, uint32_t tags, uint64_t ops, uint32_t write_pct, uint32_t delete_pct,
+		GenAccessType access, double theta, GenDistType dist, uint32_t dist_a, uint32_t dist_b);
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : gen_random
+// Description  : Draw the next 64-bit random number (xorshift64*)
+//
+// Inputs       : none
+// Outputs      : the random number
+
+static uint64_t gen_random(void) {
+	gen_state ^= gen_state >> 12;
+	gen_state ^= gen_state << 25;
+	gen_state ^= gen_state >> 27;
+	return(gen_state * 0x2545F4914F6CDD1DULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : gen_uniform
+// Description  : Draw a random number in a range
+//
+// Inputs       : lo, hi - the range (inclusive)
+// Outputs      : the random number
+
+static uint32_t gen_uniform(uint32_t lo, uint32_t hi) {
+	return(lo + (uint32_t)(gen_random() % ((uint64_t)hi - lo + 1)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : gen_blocks
+// Description  : Draw a block count from the block count distribution
+//
+// Inputs       : dist - the distribution
+//                a, b - the parameters of the distribution
+// Outputs      : the block count (1 - MAX_TAGLINE_BLOCK_NUMBER)
+
+static uint32_t gen_blocks(GenDistType dist, uint32_t a, uint32_t b) {
+
+	double u;
+	uint32_t n;
+
+	switch (dist) {
+	case GEN_DIST_FIXED:
+		n = a;
+		break;
+
+	case GEN_DIST_UNIFORM:
+		n = gen_uniform(a, b);
+		break;
+
+	default:
+		// Geometric with mean a: 1 + floor(ln(u) / ln(1 - 1/a))
+		u = (gen_random() >> 11) * (1.0 / 9007199254740992.0);
+		n = (a <= 1) ? 1 : 1 + (uint32_t)(log(1.0 - u) / log(1.0 - 1.0 / a));
+		break;
+	}
+	return((n > MAX_TAGLINE_BLOCK_NUMBER) ? MAX_TAGLINE_BLOCK_NUMBER : n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : gen_tagline
+// Description  : Choose the tagline of the next operation
+//
+// Inputs       : access - the access pattern
+//                tags - the number of taglines
+//                last - the previous tagline chosen
+// Outputs      : the tagline number
+
+static uint32_t gen_tagline(GenAccessType access, uint32_t tags, uint32_t last) {
+
+	uint32_t lo = 0, hi = tags - 1, mid;
+	double u;
+
+	switch (access) {
+	case GEN_ACCESS_ZIPF:
+		// Binary search of the cumulative distribution
+		u = (gen_random() >> 11) * (1.0 / 9007199254740992.0);
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (zipf_cdf[mid] < u) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return(lo);
+
+	case GEN_ACCESS_SEQ:
+		return((last + 1) % tags);
+
+	default:
+		return(gen_uniform(0, tags - 1));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : main
+// Description  : The main function for the workload generator
+//
+// Inputs       : argc - the number of command line parameters
+//                argv - the parameters
+// Outputs      : 0 if successful, -1 if failure
+
+int main(int argc, char *argv[]) {
+
+	// Local variables
+	uint32_t tags = 16, write_pct = 50, delete_pct = 0, dist_a = 1, dist_b = 16, i;
+	uint64_t ops = 10000;
+	GenAccessType access = GEN_ACCESS_UNIFORM;
+	GenDistType dist = GEN_DIST_UNIFORM;
+	double theta = 0.99;
+	FILE *out = stdout;
+	char *outfile = NULL;
+	int ch, ret, ok = 1;
+
+	gen_state = 1;
+	initializeLogWithFilehandle(CMPSC311_LOG_STDERR);
+
+	// Process the command line parameters
+	while ((ch = getopt(argc, argv, GEN_ARGUMENTS)) != -1) {
+
+		switch (ch) {
+		case 'h': // Help, print usage
+			fprintf(stderr, USAGE);
+			return( -1 );
+
+		case 't': // Number of taglines
+			tags = strtoul(optarg, NULL, 10);
+			ok = (tags >= 1) && (tags <= UINT16_MAX);
+			break;
+
+		case 'n': // Number of operations
+			ops = strtoull(optarg, NULL, 10);
+			break;
+
+		case 'w': // Write percentage
+			write_pct = strtoul(optarg, NULL, 10);
+			ok = (write_pct <= 100);
+			break;
+
+		case 'x': // Delete percentage
+			delete_pct = strtoul(optarg, NULL, 10);
+			ok = (delete_pct <= 100);
+			break;
+
+		case 'a': // Access pattern
+			for (i = 0; (i < GEN_ACCESS_MAXVAL) && strcmp(optarg, GEN_ACCESS_LABELS[i]); i++);
+			access = i;
+			ok = (i < GEN_ACCESS_MAXVAL);
+			break;
+
+		case 'z': // Zipf skew
+			theta = atof(optarg);
+			ok = (theta > 0.0);
+			break;
+
+		case 'd': // Block count distribution
+			if (sscanf(optarg, "fixed:%u", &dist_a) == 1) {
+				dist = GEN_DIST_FIXED;
+				ok = (dist_a >= 1) && (dist_a <= MAX_TAGLINE_BLOCK_NUMBER);
+			} else if (sscanf(optarg, "uniform:%u:%u", &dist_a, &dist_b) == 2) {
+				dist = GEN_DIST_UNIFORM;
+				ok = (dist_a >= 1) && (dist_a <= dist_b) && (dist_b <= MAX_TAGLINE_BLOCK_NUMBER);
+			} else if (sscanf(optarg, "exp:%u", &dist_a) == 1) {
+				dist = GEN_DIST_EXP;
+				ok = (dist_a >= 1) && (dist_a <= MAX_TAGLINE_BLOCK_NUMBER);
+			} else {
+				ok = 0;
+			}
+			break;
+
+		case 's': // Random seed
+			gen_state = strtoull(optarg, NULL, 10);
+			gen_state = (gen_state == 0) ? 1 : gen_state;
+			break;
+
+		case 'o': // Output file
+			outfile = optarg;
+			break;
+
+		default:  // Default (unknown)
+			fprintf(stderr, "Unknown command line option (%c), aborting.\n", ch);
+			return( -1 );
+		}
+
+		if (! ok) {
+			fprintf(stderr, "Bad value for option (%c) [%s], aborting.\n", ch, optarg);
+			return( -1 );
+		}
+	}
+
+	// Generate the workload
+	if ((outfile != NULL) && ((out = fopen(outfile, "w")) == NULL)) {
+		logMessage(LOG_ERROR_LEVEL, "Failure creating the workload file [%s], error: %s.",
+			outfile, strerror(errno));
+		return( -1 );
+	}
+	ret = generate_workload(out, tags, ops, write_pct, delete_pct, access, theta, dist, dist_a, dist_b);
+	if ((fclose(out) != 0) || ret) {
+		logMessage(LOG_ERROR_LEVEL, "Failure generating the workload");
+		return( -1 );
+	}
+	return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : generate_workload
+// Description  : Write a synthetic workload: INIT, the operations, a
+//                validation line per written tagline and CLOSE
+//
+// Inputs       : out - the stream to write to
+//                tags - the number of taglines
+//                ops - the number of read/write operations
+//                write_pct - the percentage of operations that are writes
+//                delete_pct - the percentage of operations that are deletes
+//                access - the tagline access pattern
+//                theta - the zipf skew
+//                dist, dist_a, dist_b - the block count distribution
+// Outputs      : 0 if successful, -1 if failure
+
+int generate_workload(FILE *out, uint32_t tags, uint64_t ops, uint32_t write_pct, uint32_t delete_pct,
+		GenAccessType access, double theta, GenDistType dist, uint32_t dist_a, uint32_t dist_b) {
+
+	GenTagline *lines, *line;
+	uint64_t op, allocated = 0;
+	uint32_t tag = tags - 1, start, count, grow, k;
+	double sum = 0.0;
+	int write;
+
+	// Set up the taglines and the zipf distribution
+	if ((lines = calloc(tags, sizeof(GenTagline))) == NULL) {
+		logMessage(LOG_ERROR_LEVEL, "Unable to allocate %u generator taglines", tags);
+		return(-1);
+	}
+	if (access == GEN_ACCESS_ZIPF) {
+		if ((zipf_cdf = malloc(tags * sizeof(double))) == NULL) {
+			logMessage(LOG_ERROR_LEVEL, "Unable to allocate zipf distribution (%u)", tags);
+			free(lines);
+			return(-1);
+		}
+		for (k = 0; k < tags; k++) {
+			sum += 1.0 / pow(k + 1, theta);
+			zipf_cdf[k] = sum;
+		}
+		for (k = 0; k < tags; k++) {
+			zipf_cdf[k] /= sum;
+		}
+	}
+
+	fprintf(out, "INIT %u 0 0 X\n", tags);
+	for (op = 0; op < ops; op++) {
+
+		// Pick a tagline that can take an operation (one with data, or any
+		// while the array has room for more)
+		do {
+			tag = gen_tagline(access, tags, tag);
+			line = &lines[tag];
+		} while ((line->length == 0) && (allocated >= GEN_BLOCK_BUDGET));
+
+		// Delete a tagline with data, freeing its blocks
+		if ((delete_pct > 0) && (line->length > 0) && (gen_uniform(1, 100) <= delete_pct)) {
+			fprintf(out, "DELETE %u 0 0 X\n", tag);
+			allocated -= line->length;
+			line->length = line->cursor = 0;
+			continue;
+		}
+		write = (line->length == 0) || (gen_uniform(1, 100) <= write_pct);
+		count = gen_blocks(dist, dist_a, dist_b);
+
+		// Place the operation: sequential access continues where the last
+		// one on the tagline stopped, the others start anywhere valid
+		if (write) {
+			start = (access == GEN_ACCESS_SEQ) ? line->cursor : gen_uniform(0, line->length);
+			if (start >= MAX_TAGLINE_BLOCK_NUMBER) {
+				start = 0;
+			}
+			if (count > MAX_TAGLINE_BLOCK_NUMBER - start) {
+				count = MAX_TAGLINE_BLOCK_NUMBER - start;
+			}
+
+			// Only grow the tagline as far as the array has room for
+			grow = (start + count > line->length) ? start + count - line->length : 0;
+			if (allocated + grow > GEN_BLOCK_BUDGET) {
+				grow = GEN_BLOCK_BUDGET - allocated;
+				if (line->length + grow <= start) {
+					start = 0;
+				}
+				count = line->length + grow - start;
+			}
+			for (k = start; k < start + count; k++) {
+				line->text[k] = GEN_PATTERN[gen_uniform(0, sizeof(GEN_PATTERN) - 2)];
+			}
+			if (start + count > line->length) {
+				allocated += start + count - line->length;
+				line->length = start + count;
+			}
+		} else {
+			start = (access == GEN_ACCESS_SEQ) ? line->cursor : gen_uniform(0, line->length - 1);
+			if (start >= line->length) {
+				start = 0;
+			}
+			if (count > line->length - start) {
+				count = line->length - start;
+			}
+		}
+		line->cursor = start + count;
+
+		fprintf(out, "%s %u %u %u %.*s\n", write ? "WRITE" : "READ", tag, count, start,
+				(int)count, &line->text[start]);
+	}
+
+	// Emit the final contents of every tagline for validation
+	for (k = 0; k < tags; k++) {
+		if (lines[k].length > 0) {
+			fprintf(out, "tagline %u %u 0 %.*s\n", k, lines[k].length, (int)lines[k].length, lines[k].text);
+		}
+	}
+	fprintf(out, "CLOSE 0 0 0 X\n");
+
+	free(zipf_cdf);
+	zipf_cdf = NULL;
+	free(lines);
+	return(ferror(out) ? -1 : 0);
+}
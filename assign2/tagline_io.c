@@ -0,0 +1,525 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_io.c
+//  Description    : This is the implementation of the RAID bus I/O layer of
+//                   the tagline driver.  Each disk has a submission queue
+//                   served by its own worker thread; a batch of transfers
+//                   is split by disk, queued, and complete when every
+//                   disk's share has finished.  Writes can also be posted
+//                   alone (e.g., cache write-backs), the caller going on
+//                   at once; they are drained before the array is saved.
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_io.h"
+#include "tagline_bench.h"
+#include "tagline_bus.h"
+#include "tagline_stripe.h"
+#include "tagline_log.h"
+
+//
+// Type definitions
+
+// The submission queue and worker of one disk
+typedef struct {
+	TaglineIoRequest *head;    // next transfer to perform
+	TaglineIoRequest *tail;    // last transfer queued
+	int               stop;    // should the worker exit?
+	pthread_mutex_t   lock;    // protects the queue
+	pthread_cond_t    ready;   // signalled when work is queued
+	pthread_t         worker;  // the worker thread
+} TaglineDiskQueue;
+
+//
+// Global data
+
+static pthread_mutex_t raid_bus_lock = PTHREAD_MUTEX_INITIALIZER; // the bus takes one request at a time
+static TaglineDiskQueue disk_queues[RAID_DISKS];  // the per-disk queues
+static int io_workers_running = 0;                // are the workers started?
+static pthread_mutex_t post_lock = PTHREAD_MUTEX_INITIALIZER;  // protects the posted write counters
+static pthread_cond_t post_done = PTHREAD_COND_INITIALIZER;    // a posted write finished
+static uint32_t io_posted = 0;                    // posted writes not yet performed
+static int io_post_failed = 0;                    // did a posted write fail since the last drain?
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_bus_request
+// Description  : Send one request over the RAID bus (which takes only one
+//                request at a time) to the backend in use, timing it when
+//                benchmarking.  A backend that models the time a disk
+//                takes is waited for after the bus is released, so the
+//                disks work in parallel; one that takes requests at once
+//                (the net backend pipelines them) is not locked at all.
+//
+// Inputs       : req - the request opcode
+//                buf - the block memory of the request (may be NULL)
+// Outputs      : the response opcode from the bus
+
+RAIDOpCode tagline_bus_request(RAIDOpCode req, void *buf) {
+
+	const TaglineBusBackend *bus = tagline_bus_backend();
+	RAIDOpCode resp;
+	uint64_t start = 0, done = 0;
+
+	if (tagline_bench_enabled) {
+		start = tagline_bench_now();
+	}
+	if (bus->concurrent) {
+		resp = bus->request(req, buf);
+	} else {
+		pthread_mutex_lock(&raid_bus_lock);
+		resp = bus->request(req, buf);
+		if ((bus->schedule != NULL) && (! raid_request_failed(resp))) {
+			done = bus->schedule(req);
+		}
+		pthread_mutex_unlock(&raid_bus_lock);
+	}
+	if (done) {
+		tagline_bus_wait(done);
+	}
+	if (tagline_bench_enabled) {
+		tagline_bench_record(TAGLINE_BENCH_BUS, tagline_bench_now() - start,
+				(buf != NULL) ? TAGLINE_OPC_GET(req, BLOCKS) * TAGLINE_BLOCK_SIZE : 0);
+	}
+	return(resp);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_disk_xfer
+// Description  : Transfer a run of consecutive blocks on one disk, splitting
+//                it into as few bus requests as RAID_MAX_XFER allows
+//
+// Inputs       : type - RAID_READ or RAID_WRITE
+//                disk - the disk to transfer from/to
+//                rblock - the first RAID block of the run
+//                count - the number of blocks in the run
+//                buf - the memory to transfer from/to
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_disk_xfer(uint8_t type, RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, char *buf) {
+
+	uint32_t xfer;
+	RAIDOpCode resp;
+
+	while (count > 0) {
+		xfer = (count > RAID_MAX_XFER) ? RAID_MAX_XFER : count;
+		RAIDOpCode req = make_raid_request(type, xfer, disk, rblock);
+		resp = tagline_bus_request(req, buf);
+		if (raid_request_failed(resp)) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID %s failed [disk=%u, block=%u, blocks=%u]",
+					(type == RAID_READ) ? "read" : "write", disk, rblock, xfer);
+			return(-1);
+		}
+		rblock += xfer;
+		buf += xfer * TAGLINE_BLOCK_SIZE;
+		count -= xfer;
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_raid_xfer
+// Description  : Transfer a run of consecutive blocks of one of the disks
+//                the driver sees: a disk of the array, or on a striped
+//                array a data disk spread over all of them
+//
+// Inputs       : type - RAID_READ or RAID_WRITE
+//                disk - the disk to transfer from/to
+//                rblock - the first block of the run
+//                count - the number of blocks in the run
+//                buf - the memory to transfer from/to
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_raid_xfer(uint8_t type, RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, char *buf) {
+	if (tagline_stripe_enabled()) {
+		return(tagline_stripe_xfer(type, disk, rblock, count, buf));
+	}
+	return(tagline_disk_xfer(type, disk, rblock, count, buf));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_io_complete
+// Description  : Record the completion of a transfer in its batch
+//
+// Inputs       : req - the transfer completed
+//                failed - did the transfer fail?
+// Outputs      : none
+
+static void tagline_io_complete(TaglineIoRequest *req, int failed) {
+
+	TaglineIoBatch *batch = req->batch;
+
+	int finished;
+
+	// A posted write is the worker's to free
+	if (batch == NULL) {
+		pthread_mutex_lock(&post_lock);
+		io_post_failed |= failed;
+		io_posted--;
+		pthread_cond_broadcast(&post_done);
+		pthread_mutex_unlock(&post_lock);
+		free(req);
+		return;
+	}
+
+	pthread_mutex_lock(&batch->lock);
+	batch->failed |= failed;
+	finished = (--batch->pending == 0);
+	if (finished && (batch->complete == NULL)) {
+		pthread_cond_signal(&batch->done);
+	}
+	pthread_mutex_unlock(&batch->lock);
+
+	// A started batch is handed back to its owner (who may reuse it)
+	if (finished && (batch->complete != NULL)) {
+		pthread_mutex_destroy(&batch->lock);
+		batch->complete(batch);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_io_worker
+// Description  : The worker thread of a disk, performing queued transfers
+//
+// Inputs       : arg - the disk queue served
+// Outputs      : NULL
+
+static void *tagline_io_worker(void *arg) {
+
+	TaglineDiskQueue *dq = arg;
+	TaglineIoRequest *req;
+
+	pthread_mutex_lock(&dq->lock);
+	while (1) {
+
+		// Wait for work or shutdown
+		while ((dq->head == NULL) && (! dq->stop)) {
+			pthread_cond_wait(&dq->ready, &dq->lock);
+		}
+		if (dq->head == NULL) {
+			break;
+		}
+		req = dq->head;
+		dq->head = req->next;
+		if (dq->head == NULL) {
+			dq->tail = NULL;
+		}
+
+		// Perform the transfer without holding the queue
+		pthread_mutex_unlock(&dq->lock);
+		tagline_io_complete(req, tagline_raid_xfer(req->type, req->disk, req->rblock, req->count, req->buf) != 0);
+		pthread_mutex_lock(&dq->lock);
+	}
+	pthread_mutex_unlock(&dq->lock);
+	return(NULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_io_init
+// Description  : Start the per-disk worker threads
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_io_init(void) {
+
+	int d;
+
+	if (io_workers_running) {
+		return(0);
+	}
+	for (d = 0; d < RAID_DISKS; d++) {
+		disk_queues[d].head = disk_queues[d].tail = NULL;
+		disk_queues[d].stop = 0;
+		pthread_mutex_init(&disk_queues[d].lock, NULL);
+		pthread_cond_init(&disk_queues[d].ready, NULL);
+		if (pthread_create(&disk_queues[d].worker, NULL, tagline_io_worker, &disk_queues[d])) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to start worker for disk %d", d);
+			io_workers_running = d;
+			tagline_io_close();
+			return(-1);
+		}
+	}
+	io_workers_running = RAID_DISKS;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_io_close
+// Description  : Stop the per-disk worker threads (after their queued work)
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_io_close(void) {
+
+	int d;
+
+	for (d = 0; d < io_workers_running; d++) {
+		pthread_mutex_lock(&disk_queues[d].lock);
+		disk_queues[d].stop = 1;
+		pthread_cond_signal(&disk_queues[d].ready);
+		pthread_mutex_unlock(&disk_queues[d].lock);
+		pthread_join(disk_queues[d].worker, NULL);
+		pthread_mutex_destroy(&disk_queues[d].lock);
+		pthread_cond_destroy(&disk_queues[d].ready);
+	}
+	io_workers_running = 0;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_io_batch_init
+// Description  : Start an empty batch of transfers
+//
+// Inputs       : batch - the batch to initialize
+// Outputs      : none
+
+void tagline_io_batch_init(TaglineIoBatch *batch) {
+	batch->nreqs = 0;
+	batch->pending = 0;
+	batch->failed = 0;
+	batch->complete = NULL;
+	batch->arg = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_io_add
+// Description  : Add a transfer to a batch; a transfer that continues the
+//                previous one on disk and in memory is merged into it
+//
+// Inputs       : batch - the batch to add to
+//                type - RAID_READ or RAID_WRITE
+//                disk - the disk to transfer from/to
+//                rblock - the first RAID block of the transfer
+//                count - the number of blocks to transfer
+//                buf - the memory to transfer from/to
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_io_add(TaglineIoBatch *batch, uint8_t type, RAIDDiskID disk, RAIDBlockID rblock,
+		uint32_t count, char *buf) {
+
+	TaglineIoRequest *req = (batch->nreqs > 0) ? &batch->reqs[batch->nreqs - 1] : NULL;
+
+	if ((req != NULL) && (req->type == type) && (req->disk == disk) &&
+			(req->rblock + req->count == rblock) && (req->buf + req->count * TAGLINE_BLOCK_SIZE == buf)) {
+		req->count += count;
+		return(0);
+	}
+	if (batch->nreqs == TAGLINE_IO_MAX_REQUESTS) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : too many transfers in one batch");
+		return(-1);
+	}
+	req = &batch->reqs[batch->nreqs++];
+	req->type = type;
+	req->disk = disk;
+	req->rblock = rblock;
+	req->count = count;
+	req->buf = buf;
+	req->batch = batch;
+	req->next = NULL;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_io_queue
+// Description  : Put each transfer of a batch on the queue of its disk
+//
+// Inputs       : batch - the batch to queue
+// Outputs      : none
+
+static void tagline_io_queue(TaglineIoBatch *batch) {
+
+	TaglineDiskQueue *dq;
+	uint32_t r;
+
+	pthread_mutex_init(&batch->lock, NULL);
+	batch->pending = batch->nreqs;
+	for (r = 0; r < batch->nreqs; r++) {
+		dq = &disk_queues[batch->reqs[r].disk];
+		batch->reqs[r].next = NULL;
+		pthread_mutex_lock(&dq->lock);
+		if (dq->tail != NULL) {
+			dq->tail->next = &batch->reqs[r];
+		} else {
+			dq->head = &batch->reqs[r];
+		}
+		dq->tail = &batch->reqs[r];
+		pthread_cond_signal(&dq->ready);
+		pthread_mutex_unlock(&dq->lock);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_io_run
+// Description  : Run the transfers of a batch and wait for them all.  A
+//                batch touching a single disk runs on the calling thread;
+//                otherwise each transfer goes to its disk's worker, so the
+//                batch takes about as long as the busiest disk's share.
+//
+// Inputs       : batch - the batch to run
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_io_run(TaglineIoBatch *batch) {
+
+	uint32_t r;
+	int spread = 0;
+
+	for (r = 1; r < batch->nreqs; r++) {
+		spread |= (batch->reqs[r].disk != batch->reqs[0].disk);
+	}
+
+	// Nothing to gain from the workers, do it here
+	if ((! spread) || (! io_workers_running)) {
+		for (r = 0; r < batch->nreqs; r++) {
+			TaglineIoRequest *req = &batch->reqs[r];
+			if (tagline_raid_xfer(req->type, req->disk, req->rblock, req->count, req->buf)) {
+				return(-1);
+			}
+		}
+		return(0);
+	}
+
+	// Fan out by disk, then wait for every disk to finish its share
+	pthread_cond_init(&batch->done, NULL);
+	tagline_io_queue(batch);
+	pthread_mutex_lock(&batch->lock);
+	while (batch->pending > 0) {
+		pthread_cond_wait(&batch->done, &batch->lock);
+	}
+	pthread_mutex_unlock(&batch->lock);
+	pthread_mutex_destroy(&batch->lock);
+	pthread_cond_destroy(&batch->done);
+	return(batch->failed ? -1 : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_io_start
+// Description  : Queue the transfers of a batch on the disks without waiting.
+//                The completion function is called (on a worker thread, or
+//                here if there is nothing to queue) once every transfer is
+//                done; the disk queues are FIFO, so transfers to the same
+//                block complete in the order their batches were started.
+//
+// Inputs       : batch - the batch to start
+//                complete - the function to call when the batch is done
+//                arg - context for the completion function
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_io_start(TaglineIoBatch *batch, void (*complete)(TaglineIoBatch *batch), void *arg) {
+
+	uint32_t r;
+
+	batch->complete = complete;
+	batch->arg = arg;
+
+	// Without workers (or work) the batch completes right here
+	if ((batch->nreqs == 0) || (! io_workers_running)) {
+		for (r = 0; (r < batch->nreqs) && (! batch->failed); r++) {
+			TaglineIoRequest *req = &batch->reqs[r];
+			batch->failed = (tagline_raid_xfer(req->type, req->disk, req->rblock, req->count, req->buf) != 0);
+		}
+		complete(batch);
+		return(0);
+	}
+	tagline_io_queue(batch);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_io_post
+// Description  : Queue a write of a run of blocks on its disk and return
+//                without waiting for it; the blocks are copied, so the
+//                caller may reuse its memory at once.  Later transfers of
+//                the same disk are queued behind it.  Waits while
+//                TAGLINE_IO_MAX_POSTED writes are already queued.
+//
+// Inputs       : disk - the disk to write to
+//                rblock - the first block of the run
+//                count - the number of blocks in the run
+//                buf - the blocks to write
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_io_post(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, char *buf) {
+
+	TaglineDiskQueue *dq = &disk_queues[disk];
+	TaglineIoRequest *req;
+
+	// Without workers the write is made here
+	if (! io_workers_running) {
+		return(tagline_raid_xfer(RAID_WRITE, disk, rblock, count, buf));
+	}
+	if ((req = malloc(sizeof(TaglineIoRequest) + (size_t)count * TAGLINE_BLOCK_SIZE)) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate posted write (%u blocks)", count);
+		return(-1);
+	}
+	req->type = RAID_WRITE;
+	req->disk = disk;
+	req->rblock = rblock;
+	req->count = count;
+	req->buf = (char *)&req[1];
+	req->batch = NULL;
+	req->next = NULL;
+	memcpy(req->buf, buf, (size_t)count * TAGLINE_BLOCK_SIZE);
+
+	pthread_mutex_lock(&post_lock);
+	while (io_posted >= TAGLINE_IO_MAX_POSTED) {
+		pthread_cond_wait(&post_done, &post_lock);
+	}
+	io_posted++;
+	pthread_mutex_unlock(&post_lock);
+
+	pthread_mutex_lock(&dq->lock);
+	if (dq->tail != NULL) {
+		dq->tail->next = req;
+	} else {
+		dq->head = req;
+	}
+	dq->tail = req;
+	pthread_cond_signal(&dq->ready);
+	pthread_mutex_unlock(&dq->lock);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_io_drain
+// Description  : Wait for every posted write to be performed
+//
+// Inputs       : none
+// Outputs      : 0 if they all succeeded, -1 if one failed since the last drain
+
+int tagline_io_drain(void) {
+
+	int failed;
+
+	pthread_mutex_lock(&post_lock);
+	while (io_posted > 0) {
+		pthread_cond_wait(&post_done, &post_lock);
+	}
+	failed = io_post_failed;
+	io_post_failed = 0;
+	pthread_mutex_unlock(&post_lock);
+	return(failed ? -1 : 0);
+}
@@ -0,0 +1,88 @@
+#ifndef TAGLINE_IO_INCLUDED
+#define TAGLINE_IO_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_io.h
+//  Description    : This is the header file for the RAID bus I/O layer of the
+//                   tagline driver: bus requests, block transfers and the
+//                   per-disk worker pool that runs transfers in parallel.
+//
+
+// Includes
+#include <stdint.h>
+#include <pthread.h>
+#include "raid_bus.h"
+#include "tagline_driver.h"
+#include "tagline_opcode.h"
+
+// Defines
+#define TAGLINE_IO_MAX_REQUESTS MAX_TAGLINE_BLOCK_NUMBER  // max transfers in one batch
+#define TAGLINE_IO_MAX_POSTED   256                       // posted writes queued before posting waits
+
+//
+// Type definitions
+
+struct tagline_io_batch;
+
+// One transfer of consecutive blocks on one disk
+typedef struct tagline_io_request {
+	uint8_t     type;     // RAID_READ or RAID_WRITE
+	RAIDDiskID  disk;     // the disk to transfer from/to
+	RAIDBlockID rblock;   // the first RAID block of the transfer
+	uint32_t    count;    // the number of blocks to transfer
+	char       *buf;      // the memory to transfer from/to
+	struct tagline_io_batch   *batch;  // the batch the transfer belongs to (NULL if posted)
+	struct tagline_io_request *next;   // next transfer in the disk queue
+} TaglineIoRequest;
+
+// A set of transfers that complete together (e.g., one tagline read)
+typedef struct tagline_io_batch {
+	TaglineIoRequest reqs[TAGLINE_IO_MAX_REQUESTS]; // the transfers
+	uint32_t         nreqs;    // the number of transfers
+	uint32_t         pending;  // the transfers not yet completed
+	int              failed;   // did any transfer fail?
+	pthread_mutex_t  lock;     // protects pending and failed
+	pthread_cond_t   done;     // signalled when pending reaches zero
+	void (*complete)(struct tagline_io_batch *batch); // called when a started batch finishes
+	void            *arg;      // context for the completion function
+} TaglineIoBatch;
+
+//
+// Interface functions
+
+RAIDOpCode tagline_bus_request(RAIDOpCode req, void *buf);
+	// Send one request over the RAID bus
+
+int tagline_disk_xfer(uint8_t type, RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, char *buf);
+	// Transfer a run of consecutive blocks on one disk of the array
+
+int tagline_raid_xfer(uint8_t type, RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, char *buf);
+	// Transfer a run of consecutive blocks on one disk the driver sees (striped or not)
+
+int tagline_io_init(void);
+	// Start the per-disk worker threads
+
+int tagline_io_close(void);
+	// Stop the per-disk worker threads
+
+void tagline_io_batch_init(TaglineIoBatch *batch);
+	// Start an empty batch of transfers
+
+int tagline_io_add(TaglineIoBatch *batch, uint8_t type, RAIDDiskID disk, RAIDBlockID rblock,
+		uint32_t count, char *buf);
+	// Add a transfer to a batch (merged with the previous one if adjacent)
+
+int tagline_io_run(TaglineIoBatch *batch);
+	// Run the transfers of a batch across the disks and wait for them all
+
+int tagline_io_start(TaglineIoBatch *batch, void (*complete)(TaglineIoBatch *batch), void *arg);
+	// Queue the transfers of a batch on the disks, calling complete when done
+
+int tagline_io_post(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, char *buf);
+	// Queue a write of a copy of the blocks on their disk without waiting for it
+
+int tagline_io_drain(void);
+	// Wait for the posted writes, returning -1 if any failed since the last drain
+
+#endif /* TAGLINE_IO_INCLUDED */
@@ -0,0 +1,565 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_journal.c
+//  Description    : This is the implementation of the write-ahead journal.
+//                   Write runs are collected in memory and written out as
+//                   one record with one flush (a group commit), so many
+//                   writes share the cost of a sync.
+//
+
+// Include Files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_journal.h"
+#include "tagline_meta.h"
+#include "tagline_log.h"
+
+// Defines
+#define TAGLINE_JOURNAL_MINGROUP (64 * 1024)  // initial bytes of the group buffer
+#define TAGLINE_JOURNAL_TPATH    "tagline_unit.journal"  // the journal of the unit test
+#define TAGLINE_JOURNAL_TBASE    0x5441474c494e4531ULL   // the image checksum of the unit test
+#define TAGLINE_JOURNAL_TRECORDS 8                       // the records of the unit test
+#define TAGLINE_JOURNAL_TENTRIES 3                       // the write runs in each of them
+
+//
+// Global data
+
+static int journal_fd = -1;                 // the open journal (-1 if none)
+static char *journal_path = NULL;           // the journal file
+static uint64_t journal_size = 0;           // the bytes in the journal file
+static uint64_t journal_seq = 0;            // the sequence number of the next record
+static char *journal_group = NULL;          // the record being collected
+static size_t journal_grouplen = 0;         // the bytes in the record, with its header
+static size_t journal_groupcap = 0;         // the bytes allocated for the record
+static uint32_t journal_entries = 0;        // the write runs in the record
+static uint32_t journal_test_applied = 0;   // the write runs the unit test replay applied
+static int journal_test_bad = 0;            // did the unit test replay apply a wrong run?
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_create
+// Description  : Write an empty journal on a base to a temporary file and
+//                rename it over the old one, leaving it open for appending
+//
+// Inputs       : base - the checksum of the image the journal continues
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_journal_create(uint64_t base) {
+
+	TaglineJournalHeader header;
+	char tmp[FILENAME_MAX];
+	int fd;
+
+	memset(&header, 0x0, sizeof(header));
+	memcpy(header.magic, TAGLINE_JOURNAL_MAGIC, sizeof(header.magic));
+	header.version = TAGLINE_JOURNAL_VERSION;
+	header.base = base;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", journal_path);
+	if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure creating journal [%s], error: %s.", tmp, strerror(errno));
+		return(-1);
+	}
+	if ((write(fd, &header, sizeof(header)) != sizeof(header)) || fsync(fd) || rename(tmp, journal_path)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure writing journal [%s], error: %s.", journal_path, strerror(errno));
+		close(fd);
+		unlink(tmp);
+		return(-1);
+	}
+	if (journal_fd != -1) {
+		close(journal_fd);
+	}
+	journal_fd = fd;
+	journal_size = sizeof(header);
+	journal_seq = 0;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_replay
+// Description  : Apply the whole records of a journal on a base, in order
+//
+// Inputs       : base - the checksum of the image the taglines came from
+//                apply - applies each write run
+// Outputs      : the bytes of the journal that were replayed (0 if the
+//                journal is missing or not on the base), -1 if failure
+
+static int64_t tagline_journal_replay(uint64_t base, TaglineJournalApply apply) {
+
+	TaglineJournalHeader *header;
+	TaglineJournalRecord *rec;
+	TaglineJournalEntry entry;
+	struct stat st;
+	uint64_t pos, off, records = 0, runs = 0;
+	uint32_t e;
+	char *map;
+	int fd, ret = 0;
+
+	if ((fd = open(journal_path, O_RDONLY)) == -1) {
+		return(0);
+	}
+	if (fstat(fd, &st) || (st.st_size < sizeof(TaglineJournalHeader))) {
+		close(fd);
+		return(0);
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure mapping journal [%s], error: %s.", journal_path, strerror(errno));
+		return(-1);
+	}
+	header = (TaglineJournalHeader *)map;
+	if (memcmp(header->magic, TAGLINE_JOURNAL_MAGIC, sizeof(header->magic)) ||
+			(header->version != TAGLINE_JOURNAL_VERSION) || (header->base != base)) {
+		TAGLINE_LOG(LOG_WARNING_LEVEL, "TAGLINE : journal [%s] does not continue the metadata image, discarded", journal_path);
+		munmap(map, st.st_size);
+		return(0);
+	}
+
+	// Apply the records until the first one that is not whole
+	for (pos = sizeof(TaglineJournalHeader); pos + sizeof(TaglineJournalRecord) <= st.st_size; pos = off) {
+		rec = (TaglineJournalRecord *)&map[pos];
+		off = pos + sizeof(TaglineJournalRecord);
+		if ((rec->magic != TAGLINE_JOURNAL_RECMAGIC) || (rec->seq != journal_seq) ||
+				(rec->bytes > st.st_size - off) ||
+				(tagline_meta_fasthash(&map[off], rec->bytes) != rec->checksum)) {
+			break;
+		}
+		for (e = 0; (e < rec->entries) && (ret == 0); e++) {
+			memcpy(&entry, &map[off], sizeof(entry));
+			off += sizeof(entry);
+			ret = apply(entry.tag, &entry.run, &map[off]);
+			off += (uint64_t)entry.run.length * TAGLINE_BLOCK_SIZE;
+		}
+		if (ret) {
+			munmap(map, st.st_size);
+			return(-1);
+		}
+		journal_seq++;
+		records++;
+		runs += rec->entries;
+	}
+	munmap(map, st.st_size);
+
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : replayed journal [%s], %lu records, %lu write runs%s",
+			journal_path, records, runs, (pos < st.st_size) ? " (torn tail dropped)" : "");
+	return(pos);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_open
+// Description  : Replay the journal if it continues the image the taglines
+//                were loaded from, then keep appending to it; otherwise
+//                start an empty journal on the base
+//
+// Inputs       : path - the journal file
+//                base - the checksum of the image (0 if the array is empty)
+//                apply - applies each replayed write run (NULL discards the
+//                        old journal)
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_journal_open(const char *path, uint64_t base, TaglineJournalApply apply) {
+
+	int64_t end = 0;
+
+	if ((journal_path = strdup(path)) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to open journal [%s]", path);
+		return(-1);
+	}
+	journal_seq = 0;
+	journal_grouplen = sizeof(TaglineJournalRecord);
+	journal_entries = 0;
+
+	if ((apply != NULL) && ((end = tagline_journal_replay(base, apply)) == -1)) {
+		return(-1);
+	}
+	if (end == 0) {
+		return(tagline_journal_create(base));
+	}
+
+	// Append after the last whole record
+	if (((journal_fd = open(journal_path, O_WRONLY)) == -1) || ftruncate(journal_fd, end) ||
+			(lseek(journal_fd, end, SEEK_SET) != end)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure opening journal [%s], error: %s.", journal_path, strerror(errno));
+		return(-1);
+	}
+	journal_size = end;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_add
+// Description  : Copy a write run and its blocks into the record being
+//                collected; it is durable once the record is committed
+//
+// Inputs       : tag - the tagline written
+//                run - the tagline blocks and where they went (no blocks
+//                      records a delete of the tagline)
+//                data - the blocks written (NULL for a delete)
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_journal_add(TagLineNumber tag, TaglineExtent *run, char *data) {
+
+	TaglineJournalEntry entry;
+	size_t need, newcap;
+	char *grown;
+
+	if (journal_fd == -1) {
+		return(0);
+	}
+
+	need = journal_grouplen + sizeof(entry) + (size_t)run->length * TAGLINE_BLOCK_SIZE;
+	if (need > journal_groupcap) {
+		newcap = (journal_groupcap == 0) ? TAGLINE_JOURNAL_MINGROUP : journal_groupcap * 2;
+		while (newcap < need) {
+			newcap *= 2;
+		}
+		if ((grown = realloc(journal_group, newcap)) == NULL) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to grow journal record to %lu bytes", newcap);
+			return(-1);
+		}
+		journal_group = grown;
+		journal_groupcap = newcap;
+	}
+
+	entry.tag = tag;
+	entry.unused = 0;
+	entry.run = *run;
+	entry.run.unused = 0;
+	memcpy(&journal_group[journal_grouplen], &entry, sizeof(entry));
+	if (run->length > 0) {
+		memcpy(&journal_group[journal_grouplen + sizeof(entry)], data, (size_t)run->length * TAGLINE_BLOCK_SIZE);
+	}
+	journal_grouplen = need;
+	journal_entries++;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_pending
+// Description  : Check if there are write runs waiting for a commit
+//
+// Inputs       : none
+// Outputs      : 1 if there are, 0 if not
+
+int tagline_journal_pending(void) {
+	return(journal_entries > 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_commit
+// Description  : Seal the collected write runs into a record, append it and
+//                flush it to disk with one sync
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_journal_commit(void) {
+
+	TaglineJournalRecord rec;
+
+	if ((journal_fd == -1) || (journal_entries == 0)) {
+		return(0);
+	}
+
+	rec.magic = TAGLINE_JOURNAL_RECMAGIC;
+	rec.entries = journal_entries;
+	rec.bytes = journal_grouplen - sizeof(rec);
+	rec.seq = journal_seq;
+	rec.checksum = tagline_meta_fasthash(&journal_group[sizeof(rec)], rec.bytes);
+	memcpy(journal_group, &rec, sizeof(rec));
+
+	if ((write(journal_fd, journal_group, journal_grouplen) != journal_grouplen) || fdatasync(journal_fd)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure writing journal [%s], error: %s.", journal_path, strerror(errno));
+		// leave the file ending at the last whole record
+		if (ftruncate(journal_fd, journal_size) || (lseek(journal_fd, journal_size, SEEK_SET) != journal_size)) {
+			close(journal_fd);
+			journal_fd = -1;
+		}
+		journal_grouplen = sizeof(rec);
+		journal_entries = 0;
+		return(-1);
+	}
+
+	journal_size += journal_grouplen;
+	journal_seq++;
+	journal_grouplen = sizeof(rec);
+	journal_entries = 0;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_size
+// Description  : Get the size of the journal file
+//
+// Inputs       : none
+// Outputs      : the bytes in the journal (0 if it is not open)
+
+uint64_t tagline_journal_size(void) {
+	return((journal_fd == -1) ? 0 : journal_size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_reset
+// Description  : Start an empty journal once everything in the old one is
+//                in a new metadata image
+//
+// Inputs       : base - the checksum of the new image
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_journal_reset(uint64_t base) {
+	if (journal_path == NULL) {
+		return(0);
+	}
+	journal_grouplen = sizeof(TaglineJournalRecord);
+	journal_entries = 0;
+	return(tagline_journal_create(base));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_close
+// Description  : Close the journal and release its memory
+//
+// Inputs       : remove - delete the journal (its contents are in an image)
+// Outputs      : none
+
+void tagline_journal_close(int remove) {
+	if (journal_fd != -1) {
+		close(journal_fd);
+		journal_fd = -1;
+	}
+	if ((journal_path != NULL) && remove) {
+		unlink(journal_path);
+	}
+	free(journal_path);
+	free(journal_group);
+	journal_path = journal_group = NULL;
+	journal_size = journal_grouplen = journal_groupcap = 0;
+	journal_entries = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_test_entry
+// Description  : Make write run number n of the unit test; every fifth one
+//                is a delete, the others write 1 to 4 blocks of a pattern
+//
+// Inputs       : n - the number of the write run
+//                tag - the tagline (returned)
+//                run - the run (returned)
+//                data - the blocks written (returned)
+// Outputs      : none
+
+static void tagline_journal_test_entry(uint32_t n, TagLineNumber *tag, TaglineExtent *run, char *data) {
+
+	uint32_t b;
+
+	*tag = (n * 7) % 100;
+	memset(run, 0x0, sizeof(TaglineExtent));
+	run->lblock = n % MAX_TAGLINE_BLOCK_NUMBER;
+	run->length = n % 5;
+	run->disk = n % RAID_DISKS;
+	run->rblock = n * 3;
+	for (b = 0; b < run->length; b++) {
+		memset(&data[b * TAGLINE_BLOCK_SIZE], (char)(n * 13 + b), TAGLINE_BLOCK_SIZE);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_test_apply
+// Description  : Check a write run replayed by the unit test against the
+//                one that was journaled in its place
+//
+// Inputs       : tag - the tagline written
+//                run - the tagline blocks and where they went
+//                data - the blocks written
+// Outputs      : 0 (a wrong run is counted, not failed)
+
+static int tagline_journal_test_apply(TagLineNumber tag, TaglineExtent *run, char *data) {
+
+	char want[4 * TAGLINE_BLOCK_SIZE];
+	TaglineExtent wrun;
+	TagLineNumber wtag;
+
+	tagline_journal_test_entry(journal_test_applied++, &wtag, &wrun, want);
+	if ((tag != wtag) || memcmp(run, &wrun, sizeof(wrun)) ||
+			((run->length > 0) && memcmp(data, want, (size_t)run->length * TAGLINE_BLOCK_SIZE))) {
+		journal_test_bad = 1;
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_test_replay
+// Description  : Replay the unit test journal and check what was applied
+//
+// Inputs       : base - the image checksum to replay on
+//                records - the number of whole records expected
+//                size - the size of the journal left for appending
+// Outputs      : 0 if the records and size are right, -1 if not
+
+static int tagline_journal_test_replay(uint64_t base, uint32_t records, uint64_t size) {
+
+	struct stat st;
+	int ret;
+
+	journal_test_applied = 0;
+	journal_test_bad = 0;
+	ret = tagline_journal_open(TAGLINE_JOURNAL_TPATH, base, tagline_journal_test_apply);
+	tagline_journal_close(0);
+	if (ret || journal_test_bad || (journal_test_applied != records * TAGLINE_JOURNAL_TENTRIES) ||
+			stat(TAGLINE_JOURNAL_TPATH, &st) || (st.st_size != size)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : journal replay applied %u write runs%s, expected %u records",
+				journal_test_applied, journal_test_bad ? " (some wrong)" : "", records);
+		return(-1);
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_test_append
+// Description  : Append records of the unit test write runs to the journal
+//
+// Inputs       : base - the image checksum the journal continues
+//                first - the first record to append
+//                last - the record after the last to append
+//                ends - the size of the journal after each record (returned)
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_journal_test_append(uint64_t base, uint32_t first, uint32_t last, uint64_t *ends) {
+
+	char data[4 * TAGLINE_BLOCK_SIZE];
+	TaglineExtent run;
+	TagLineNumber tag;
+	uint32_t r, e;
+
+	journal_test_applied = 0;
+	if (tagline_journal_open(TAGLINE_JOURNAL_TPATH, base, tagline_journal_test_apply) ||
+			(journal_test_applied != first * TAGLINE_JOURNAL_TENTRIES)) {
+		tagline_journal_close(0);
+		return(-1);
+	}
+	for (r = first; r < last; r++) {
+		for (e = 0; e < TAGLINE_JOURNAL_TENTRIES; e++) {
+			tagline_journal_test_entry(r * TAGLINE_JOURNAL_TENTRIES + e, &tag, &run, data);
+			if (tagline_journal_add(tag, &run, data)) {
+				tagline_journal_close(0);
+				return(-1);
+			}
+		}
+		if (tagline_journal_commit()) {
+			tagline_journal_close(0);
+			return(-1);
+		}
+		ends[r] = tagline_journal_size();
+	}
+	tagline_journal_close(0);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_test_flip
+// Description  : Corrupt a byte of the unit test journal
+//
+// Inputs       : pos - the offset of the byte
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_journal_test_flip(uint64_t pos) {
+
+	char byte;
+	int fd, ret;
+
+	if ((fd = open(TAGLINE_JOURNAL_TPATH, O_RDWR)) == -1) {
+		return(-1);
+	}
+	ret = (pread(fd, &byte, 1, pos) != 1);
+	byte ^= 0x5a;
+	ret = ret || (pwrite(fd, &byte, 1, pos) != 1);
+	close(fd);
+	return(ret ? -1 : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_journal_unit_test
+// Description  : Journal group commits of writes and deletes, then replay
+//                the journal after tearing its last record (in its blocks
+//                and in its header), after corrupting the last and a
+//                middle record, and on the wrong image.  Each replay must
+//                apply exactly the whole records before the damage, in
+//                order, and leave the journal ending after them so the
+//                next record appends cleanly.
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_journal_unit_test(void) {
+
+	uint64_t ends[TAGLINE_JOURNAL_TRECORDS];
+	uint32_t last = TAGLINE_JOURNAL_TRECORDS - 1;
+	int failed;
+
+	// Write the records, close without removing, and replay them all
+	unlink(TAGLINE_JOURNAL_TPATH);
+	failed = tagline_journal_test_append(TAGLINE_JOURNAL_TBASE, 0, TAGLINE_JOURNAL_TRECORDS, ends) ||
+			tagline_journal_test_replay(TAGLINE_JOURNAL_TBASE, TAGLINE_JOURNAL_TRECORDS, ends[last]);
+
+	// A last record torn in its blocks is dropped, and the record written
+	// again in its place follows on; then the same torn in its header
+	failed = failed || truncate(TAGLINE_JOURNAL_TPATH, ends[last] - 100) ||
+			tagline_journal_test_replay(TAGLINE_JOURNAL_TBASE, last, ends[last - 1]) ||
+			tagline_journal_test_append(TAGLINE_JOURNAL_TBASE, last, TAGLINE_JOURNAL_TRECORDS, ends) ||
+			tagline_journal_test_replay(TAGLINE_JOURNAL_TBASE, TAGLINE_JOURNAL_TRECORDS, ends[last]);
+	failed = failed || truncate(TAGLINE_JOURNAL_TPATH, ends[last - 1] + sizeof(TaglineJournalRecord) / 2) ||
+			tagline_journal_test_replay(TAGLINE_JOURNAL_TBASE, last, ends[last - 1]);
+
+	// A corrupt last record is dropped; a corrupt middle record drops it
+	// and everything after it
+	failed = failed || tagline_journal_test_append(TAGLINE_JOURNAL_TBASE, last, TAGLINE_JOURNAL_TRECORDS, ends) ||
+			tagline_journal_test_flip(ends[last] - 1) ||
+			tagline_journal_test_replay(TAGLINE_JOURNAL_TBASE, last, ends[last - 1]);
+	failed = failed || tagline_journal_test_flip(ends[1] - TAGLINE_BLOCK_SIZE) ||
+			tagline_journal_test_replay(TAGLINE_JOURNAL_TBASE, 1, ends[0]);
+
+	// A journal on another image is discarded for an empty one
+	failed = failed || tagline_journal_test_replay(TAGLINE_JOURNAL_TBASE + 1, 0, sizeof(TaglineJournalHeader)) ||
+			tagline_journal_test_replay(TAGLINE_JOURNAL_TBASE, 0, sizeof(TaglineJournalHeader));
+
+	// Closing with its contents saved removes it
+	journal_test_applied = 0;
+	failed = failed || tagline_journal_open(TAGLINE_JOURNAL_TPATH, TAGLINE_JOURNAL_TBASE + 1, tagline_journal_test_apply);
+	tagline_journal_close(1);
+	failed = failed || (access(TAGLINE_JOURNAL_TPATH, F_OK) == 0);
+	unlink(TAGLINE_JOURNAL_TPATH);
+	if (failed) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : journal unit test failed");
+		return(-1);
+	}
+
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : journal unit test passed (%d records)", TAGLINE_JOURNAL_TRECORDS);
+	return(0);
+}
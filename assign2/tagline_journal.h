@@ -0,0 +1,101 @@
+#ifndef TAGLINE_JOURNAL_INCLUDED
+#define TAGLINE_JOURNAL_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_journal.h
+//  Description    : This is the header file for the write-ahead journal
+//                   that records tagline writes between metadata images,
+//                   so a crash loses nothing that was acknowledged.
+//
+
+// Includes
+#include <stdint.h>
+
+// Project Includes
+#include "tagline_driver.h"
+#include "tagline_extent.h"
+
+// Defines
+#define TAGLINE_JOURNAL_MAGIC         "TAGJRNL"   // first bytes of a journal
+#define TAGLINE_JOURNAL_VERSION       1           // the newest journal version
+#define TAGLINE_JOURNAL_RECMAGIC      0x4a524543  // first word of a record ("JREC")
+#define TAGLINE_JOURNAL_DEFAULT_LIMIT (64 << 20)  // bytes before the journal is compacted
+
+//
+// The journal is a header followed by group-commit records, in host byte
+// order like the metadata image:
+//
+//   header : TaglineJournalHeader
+//   record : TaglineJournalRecord, then per write run a
+//            TaglineJournalEntry followed by its blocks
+//
+// An entry with a run of no blocks records the delete of its tagline.
+//
+// The base is the checksum of the metadata image the journal continues (0
+// if it continues an empty, freshly formatted array); it is only replayed
+// on top of that image.  A record is replayed only if it is whole, has the
+// next sequence number and matches its checksum, so a torn last record
+// is dropped.
+
+//
+// Type definitions
+
+// The journal file header
+typedef struct {
+	char     magic[8];  // TAGLINE_JOURNAL_MAGIC
+	uint32_t version;   // the journal version
+	uint32_t unused;    // padding (aligns the base)
+	uint64_t base;      // checksum of the image the journal continues
+} TaglineJournalHeader;
+
+// One group commit
+typedef struct {
+	uint32_t magic;     // TAGLINE_JOURNAL_RECMAGIC
+	uint32_t entries;   // the number of write runs in the record
+	uint64_t bytes;     // the bytes of the record after this header
+	uint64_t seq;       // the sequence number of the record
+	uint64_t checksum;  // hash of the bytes after this header
+} TaglineJournalRecord;
+
+// One write run
+typedef struct {
+	TagLineNumber tag;     // the tagline written
+	uint16_t      unused;  // padding (keeps the entry at 12 bytes)
+	TaglineExtent run;     // the tagline blocks and where they went
+} TaglineJournalEntry;
+
+// Function applying a replayed write run (0 if successful, -1 if failure)
+typedef int (*TaglineJournalApply)(TagLineNumber tag, TaglineExtent *run, char *data);
+
+//
+// Interface functions
+
+int tagline_journal_open(const char *path, uint64_t base, TaglineJournalApply apply);
+	// Replay a journal on a base (apply NULL discards it), then append to it
+
+int tagline_journal_add(TagLineNumber tag, TaglineExtent *run, char *data);
+	// Add a write run to the next group commit
+
+int tagline_journal_pending(void);
+	// Check if there are write runs waiting for a commit
+
+int tagline_journal_commit(void);
+	// Write the pending write runs as one record and flush it to disk
+
+uint64_t tagline_journal_size(void);
+	// Get the size of the journal file (0 if not open)
+
+int tagline_journal_reset(uint64_t base);
+	// Start an empty journal on a new base (after an image is saved)
+
+void tagline_journal_close(int remove);
+	// Close the journal, deleting it if its contents are in an image
+
+//
+// Unit test
+
+int tagline_journal_unit_test(void);
+	// Replay journals with torn and corrupt records, checking what is applied
+
+#endif /* TAGLINE_JOURNAL_INCLUDED */
@@ -0,0 +1,229 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_log.c
+//  Description    : This is the implementation of the logging front-end.
+//                   The asynchronous sink is a bounded ring of message
+//                   slots; each slot carries a sequence number so any
+//                   thread can claim one with a single compare-and-swap,
+//                   and the sink thread writes the slots out in order.  A
+//                   message is dropped (and counted) rather than block the
+//                   caller when the ring is full.
+//
+
+// Include Files
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+// Project Includes
+#include "tagline_log.h"
+
+//
+// Type definitions
+
+// One message in the ring
+typedef struct {
+	uint64_t      seq;                       // slot position (free) or position + 1 (full)
+	unsigned long level;                     // the level of the message
+	char          msg[TAGLINE_LOG_RING_MSG]; // the formatted message
+} TaglineLogSlot;
+
+//
+// Global data
+
+unsigned long tagline_log_levels = DEFAULT_LOG_LEVEL;  // the enabled levels
+static TaglineLogSlot *log_ring = NULL;   // the message ring (NULL if synchronous)
+static uint64_t log_head = 0;             // next position to claim (callers)
+static uint64_t log_tail = 0;             // next position to write (sink)
+static uint64_t log_dropped = 0;          // messages lost to a full ring
+static int log_sink_stop = 0;             // should the sink exit?
+static pthread_t log_sink;                // the sink thread
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_log_drain
+// Description  : Write out the messages waiting in the ring
+//
+// Inputs       : none
+// Outputs      : the number of messages written
+
+static int tagline_log_drain(void) {
+
+	TaglineLogSlot *slot;
+	int written = 0;
+
+	while (1) {
+		slot = &log_ring[log_tail & (TAGLINE_LOG_RING_SLOTS - 1)];
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != log_tail + 1) {
+			return(written);
+		}
+		logMessage(slot->level, "%s", slot->msg);
+		__atomic_store_n(&slot->seq, log_tail + TAGLINE_LOG_RING_SLOTS, __ATOMIC_RELEASE);
+		log_tail++;
+		written++;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_log_sink
+// Description  : The sink thread: write out the ring, napping when empty
+//
+// Inputs       : arg - unused
+// Outputs      : NULL
+
+static void *tagline_log_sink(void *arg) {
+
+	struct timespec nap = { 0, 1000000 };
+
+	while (! __atomic_load_n(&log_sink_stop, __ATOMIC_ACQUIRE)) {
+		if (tagline_log_drain() == 0) {
+			nanosleep(&nap, NULL);
+		}
+	}
+	tagline_log_drain();
+	return(NULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_log_enable
+// Description  : Turn on log levels
+//
+// Inputs       : lvl - the levels to turn on
+// Outputs      : none
+
+void tagline_log_enable(unsigned long lvl) {
+	enableLogLevels(lvl);
+	tagline_log_levels |= lvl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_log_disable
+// Description  : Turn off log levels
+//
+// Inputs       : lvl - the levels to turn off
+// Outputs      : none
+
+void tagline_log_disable(unsigned long lvl) {
+	disableLogLevels(lvl);
+	tagline_log_levels &= ~lvl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_log_message
+// Description  : Log a "printf"-style message; with the sink running the
+//                message is formatted into a ring slot and written later
+//
+// Inputs       : lvl - the level of the message
+//                fmt - the format of the message
+// Outputs      : 0 if successful, -1 if the message was dropped
+
+int tagline_log_message(unsigned long lvl, const char *fmt, ...) {
+
+	TaglineLogSlot *slot;
+	uint64_t pos, seq;
+	va_list args;
+
+	// Without the sink, hand the message straight to the log
+	va_start(args, fmt);
+	if (__atomic_load_n(&log_ring, __ATOMIC_ACQUIRE) == NULL) {
+		vlogMessage(lvl, fmt, args);
+		va_end(args);
+		return(0);
+	}
+
+	// Claim the next free slot, or drop the message if the ring is full
+	pos = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+	while (1) {
+		slot = &log_ring[pos & (TAGLINE_LOG_RING_SLOTS - 1)];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if (seq == pos) {
+			if (__atomic_compare_exchange_n(&log_head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if ((int64_t)(seq - pos) < 0) {
+			__atomic_fetch_add(&log_dropped, 1, __ATOMIC_RELAXED);
+			va_end(args);
+			return(-1);
+		} else {
+			pos = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+		}
+	}
+
+	// Fill the slot and hand it to the sink
+	slot->level = lvl;
+	vsnprintf(slot->msg, TAGLINE_LOG_RING_MSG, fmt, args);
+	va_end(args);
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_log_start_async
+// Description  : Start the sink thread; from now on messages are queued in
+//                the ring and written by the sink
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_log_start_async(void) {
+
+	TaglineLogSlot *ring;
+	uint64_t i;
+
+	if (log_ring != NULL) {
+		return(0);
+	}
+	if ((ring = malloc(TAGLINE_LOG_RING_SLOTS * sizeof(TaglineLogSlot))) == NULL) {
+		logMessage(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate log ring");
+		return(-1);
+	}
+	for (i = 0; i < TAGLINE_LOG_RING_SLOTS; i++) {
+		ring[i].seq = i;
+	}
+	log_head = log_tail = log_dropped = 0;
+	log_sink_stop = 0;
+	log_ring = ring;
+	if (pthread_create(&log_sink, NULL, tagline_log_sink, NULL)) {
+		log_ring = NULL;
+		free(ring);
+		logMessage(LOG_ERROR_LEVEL, "TAGLINE : unable to start log sink");
+		return(-1);
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_log_stop_async
+// Description  : Drain the ring, stop the sink thread and go back to
+//                writing messages directly (callers must have stopped
+//                logging through the ring)
+//
+// Inputs       : none
+// Outputs      : none
+
+void tagline_log_stop_async(void) {
+
+	TaglineLogSlot *ring = log_ring;
+
+	if (ring == NULL) {
+		return;
+	}
+	__atomic_store_n(&log_sink_stop, 1, __ATOMIC_RELEASE);
+	pthread_join(log_sink, NULL);
+	__atomic_store_n(&log_ring, NULL, __ATOMIC_RELEASE);
+	free(ring);
+	if (log_dropped > 0) {
+		logMessage(LOG_WARNING_LEVEL, "TAGLINE : log ring overflowed, %lu messages dropped", log_dropped);
+	}
+}
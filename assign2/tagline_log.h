@@ -0,0 +1,60 @@
+#ifndef TAGLINE_LOG_INCLUDED
+#define TAGLINE_LOG_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_log.h
+//  Description    : This is the header file for the logging front-end of
+//                   the tagline driver.  TAGLINE_LOG is compiled out for
+//                   levels outside TAGLINE_LOG_COMPILED, and otherwise tests
+//                   a local copy of the enabled levels (predicted false)
+//                   before any argument is evaluated, so a disabled level
+//                   costs one load and branch.  Messages can optionally go
+//                   through a ring buffer drained by a sink thread.
+//
+
+// Includes
+#include <stdint.h>
+#include <cmpsc311_log.h>
+
+// Defines
+#ifndef TAGLINE_LOG_COMPILED
+#define TAGLINE_LOG_COMPILED (LOG_ERROR_LEVEL|LOG_WARNING_LEVEL|LOG_INFO_LEVEL|LOG_OUTPUT_LEVEL)
+#endif
+#define TAGLINE_LOG_RING_SLOTS 4096  // messages the async ring holds (power of 2)
+#define TAGLINE_LOG_RING_MSG   240   // longest message the async ring holds
+
+// Log a message if its level is compiled in and enabled
+#define TAGLINE_LOG(lvl, ...) \
+	do { \
+		if (((lvl) & TAGLINE_LOG_COMPILED) && __builtin_expect((tagline_log_levels & (lvl)) != 0, 0)) { \
+			tagline_log_message((lvl), __VA_ARGS__); \
+		} \
+	} while (0)
+
+// Is a level compiled in and enabled (to guard work done only for a log)
+#define TAGLINE_LOG_ENABLED(lvl) \
+	(((lvl) & TAGLINE_LOG_COMPILED) && __builtin_expect((tagline_log_levels & (lvl)) != 0, 0))
+
+// The enabled levels (kept in step with the cmpsc311 log)
+extern unsigned long tagline_log_levels;
+
+//
+// Interface functions
+
+void tagline_log_enable(unsigned long lvl);
+	// Turn on log levels
+
+void tagline_log_disable(unsigned long lvl);
+	// Turn off log levels
+
+int tagline_log_message(unsigned long lvl, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+	// Log a message, through the ring buffer if the sink is running
+
+int tagline_log_start_async(void);
+	// Start the sink thread; messages are queued rather than written
+
+void tagline_log_stop_async(void);
+	// Drain the ring buffer and stop the sink thread
+
+#endif /* TAGLINE_LOG_INCLUDED */
@@ -0,0 +1,610 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_meta.c
+//  Description    : This is the implementation of the tagline metadata
+//                   image.  The image is written to a temporary file and
+//                   renamed over the old one, so a crash leaves either the
+//                   old or the new image, and is mapped back in place (the
+//                   extent arrays are used directly from the mapping).
+//
+
+// Include Files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_meta.h"
+#include "tagline_log.h"
+#include "tagline_io.h"
+
+// Defines
+#define TAGLINE_META_FNV_BASIS 0xcbf29ce484222325ULL  // FNV-1a offset basis
+#define TAGLINE_META_FNV_PRIME 0x100000001b3ULL       // FNV-1a prime
+#define TAGLINE_META_TPATH     "tagline_unit.meta"    // the image of the unit test
+#define TAGLINE_META_TLINES    64                     // the tag directory of the unit test
+
+//
+// Global data
+
+static TaglineExtentMap meta_test_maps[TAGLINE_META_TLINES];  // the taglines of the unit test
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_hash
+// Description  : Continue an FNV-1a hash over a range of bytes
+//
+// Inputs       : hash - the hash so far
+//                data - the bytes to hash
+//                len - the number of bytes
+// Outputs      : the new hash
+
+static uint64_t tagline_meta_hash(uint64_t hash, const void *data, size_t len) {
+
+	const uint8_t *p = data;
+	size_t b;
+
+	for (b = 0; b < len; b++) {
+		hash = (hash ^ p[b]) * TAGLINE_META_FNV_PRIME;
+	}
+	return(hash);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_put
+// Description  : Write bytes to the image file and add them to the hash
+//
+// Inputs       : fp - the image file
+//                hash - the running hash (updated)
+//                data - the bytes to write
+//                len - the number of bytes
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_meta_put(FILE *fp, uint64_t *hash, const void *data, size_t len) {
+	*hash = tagline_meta_hash(*hash, data, len);
+	return((fwrite(data, 1, len, fp) == len) ? 0 : -1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_save
+// Description  : Write an image of the taglines to a temporary file, flush
+//                it to disk and rename it over the old image
+//
+// Inputs       : path - the image file
+//                header - the directory size and disk state (the counts,
+//                         magic and checksum are filled in)
+//                lookup - returns the extent map of each tag
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_meta_save(const char *path, TaglineMetaHeader *header, TaglineMetaLookup lookup) {
+
+	TaglineExtentMap *map;
+	TaglineMetaTag rec;
+	char tmp[FILENAME_MAX];
+	uint64_t hash = TAGLINE_META_FNV_BASIS;
+	uint32_t tag;
+	FILE *fp;
+
+	// Size the body, so the header can be hashed first
+	header->ntags = header->nextents = 0;
+	for (tag = 0; tag < header->maxlines; tag++) {
+		if (((map = lookup(tag)) != NULL) && (map->count > 0)) {
+			header->ntags++;
+			header->nextents += map->count;
+		}
+	}
+	memcpy(header->magic, TAGLINE_META_MAGIC, sizeof(header->magic));
+	header->version = TAGLINE_META_VERSION;
+	header->checksum = 0;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	if ((fp = fopen(tmp, "wb")) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure creating metadata image [%s], error: %s.",
+				tmp, strerror(errno));
+		return(-1);
+	}
+
+	// Header, then the tag records, then the extents in the same order
+	if (tagline_meta_put(fp, &hash, header, sizeof(TaglineMetaHeader))) {
+		goto failed;
+	}
+	rec.first = 0;
+	for (tag = 0; tag < header->maxlines; tag++) {
+		if (((map = lookup(tag)) != NULL) && (map->count > 0)) {
+			rec.tag = tag;
+			rec.count = map->count;
+			if (tagline_meta_put(fp, &hash, &rec, sizeof(rec))) {
+				goto failed;
+			}
+			rec.first += map->count;
+		}
+	}
+	for (tag = 0; tag < header->maxlines; tag++) {
+		if (((map = lookup(tag)) != NULL) && (map->count > 0) &&
+				tagline_meta_put(fp, &hash, map->extents, map->count * sizeof(TaglineExtent))) {
+			goto failed;
+		}
+	}
+
+	// Seal the header, make the image durable and put it in place
+	header->checksum = hash;
+	if (fseek(fp, 0, SEEK_SET) || (fwrite(header, sizeof(TaglineMetaHeader), 1, fp) != 1) ||
+			fflush(fp) || fsync(fileno(fp))) {
+		goto failed;
+	}
+	fclose(fp);
+	if (rename(tmp, path)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure installing metadata image [%s], error: %s.",
+				path, strerror(errno));
+		unlink(tmp);
+		return(-1);
+	}
+
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : saved metadata image [%s], %u taglines, %u extents",
+			path, header->ntags, header->nextents);
+	return(0);
+
+failed:
+	TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure writing metadata image [%s]", tmp);
+	fclose(fp);
+	unlink(tmp);
+	return(-1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_load
+// Description  : Map a metadata image into memory and check it; nothing is
+//                parsed or copied, the caller uses the records in place
+//
+// Inputs       : path - the image file
+//                image - the mapped image (returned)
+// Outputs      : 0 if loaded, 1 if there is no image, -1 if it is bad
+
+int tagline_meta_load(const char *path, TaglineMetaImage *image) {
+
+	TaglineMetaHeader *header, sealed;
+	struct stat st;
+	uint64_t hash;
+	size_t need;
+	int fd;
+
+	memset(image, 0x0, sizeof(TaglineMetaImage));
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		if (errno == ENOENT) {
+			return(1);
+		}
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure opening metadata image [%s], error: %s.",
+				path, strerror(errno));
+		return(-1);
+	}
+	if (fstat(fd, &st) || (st.st_size < sizeof(TaglineMetaHeader))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : metadata image [%s] is truncated", path);
+		close(fd);
+		return(-1);
+	}
+
+	// Private and writable, so the extent maps can be edited in place
+	image->base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (image->base == MAP_FAILED) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure mapping metadata image [%s], error: %s.",
+				path, strerror(errno));
+		image->base = NULL;
+		return(-1);
+	}
+	image->size = st.st_size;
+	header = image->header = image->base;
+	image->tags = (TaglineMetaTag *)&header[1];
+	image->extents = (TaglineExtent *)&image->tags[header->ntags];
+
+	// Check the format, the size and the checksum
+	need = sizeof(TaglineMetaHeader) + (size_t)header->ntags * sizeof(TaglineMetaTag) +
+			(size_t)header->nextents * sizeof(TaglineExtent);
+	if (memcmp(header->magic, TAGLINE_META_MAGIC, sizeof(header->magic)) ||
+			(header->version != TAGLINE_META_VERSION) || (image->size != need)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : metadata image [%s] has a bad format", path);
+		tagline_meta_release(image);
+		return(-1);
+	}
+	sealed = *header;
+	sealed.checksum = 0;
+	hash = tagline_meta_hash(TAGLINE_META_FNV_BASIS, &sealed, sizeof(sealed));
+	hash = tagline_meta_hash(hash, &header[1], image->size - sizeof(TaglineMetaHeader));
+	if (hash != header->checksum) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : metadata image [%s] fails its checksum", path);
+		tagline_meta_release(image);
+		return(-1);
+	}
+
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : mapped metadata image [%s], %u taglines, %u extents",
+			path, header->ntags, header->nextents);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_release
+// Description  : Unmap a loaded image
+//
+// Inputs       : image - the image to release
+// Outputs      : none
+
+void tagline_meta_release(TaglineMetaImage *image) {
+	if (image->base != NULL) {
+		munmap(image->base, image->size);
+	}
+	memset(image, 0x0, sizeof(TaglineMetaImage));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_check_extents
+// Description  : Check that every extent of a loaded image lies inside the
+//                array and its tagline, and that each tag's extents are
+//                sorted and do not overlap.  The checksum only shows the image is intact; a
+//                stale image, or one saved with other settings, can still
+//                point outside the array.
+//
+// Inputs       : image - the loaded image
+//                disks - the disks the extents may be on
+//                diskblocks - the number of blocks per disk
+// Outputs      : 0 if the extents are good, -1 if not
+
+int tagline_meta_check_extents(TaglineMetaImage *image, uint32_t disks, uint32_t diskblocks) {
+
+	TaglineMetaTag *rec;
+	TaglineExtent *ext;
+	uint32_t t, e, next;
+
+	for (t = 0; t < image->header->ntags; t++) {
+		rec = &image->tags[t];
+		if ((uint64_t)rec->first + rec->count > image->header->nextents) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : metadata image tag %u has extents past the end", rec->tag);
+			return(-1);
+		}
+		for (e = 0, next = 0; e < rec->count; e++) {
+			ext = &image->extents[rec->first + e];
+			if ((ext->disk >= disks) || (ext->length == 0) ||
+					((uint32_t)ext->lblock + ext->length > MAX_TAGLINE_BLOCK_NUMBER) ||
+					((uint64_t)ext->rblock + ext->length > diskblocks) || (ext->lblock < next)) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : metadata image tag %u has a bad extent [lblock=%u, length=%u, disk=%u, block=%u]",
+						rec->tag, ext->lblock, ext->length, ext->disk, ext->rblock);
+				return(-1);
+			}
+			next = ext->lblock + ext->length;
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_fasthash
+// Description  : Hash a range of bytes a 64-bit word at a time (much faster
+//                than the byte-wise image checksum, for block data)
+//
+// Inputs       : data - the bytes to hash
+//                len - the number of bytes
+// Outputs      : the hash
+
+uint64_t tagline_meta_fasthash(const void *data, size_t len) {
+
+	const char *p = data;
+	uint64_t hash = TAGLINE_META_FNV_BASIS, word;
+	size_t w, words = len / sizeof(uint64_t);
+
+	for (w = 0; w < words; w++) {
+		memcpy(&word, &p[w * sizeof(uint64_t)], sizeof(word));
+		hash = (hash ^ word) * TAGLINE_META_FNV_PRIME;
+		hash ^= hash >> 29;
+	}
+	return(tagline_meta_hash(hash, &p[words * sizeof(uint64_t)], len % sizeof(uint64_t)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_map_store
+// Description  : Map the store saved by RAID_CLOSE and check that it has the
+//                geometry of an image.  (raid_load_store cannot be used, it
+//                misreads the store header.)  The store is one byte of disk
+//                count, the blocks per disk (32 bits), then the blocks of
+//                each disk in turn.
+//
+// Inputs       : path - the saved store
+//                header - the image header (geometry)
+//                st - the status of the store (returned)
+// Outputs      : the mapping, or NULL if failure
+
+static char *tagline_meta_map_store(const char *path, TaglineMetaHeader *header, struct stat *st) {
+
+	uint32_t blocks;
+	char *base;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure opening RAID store [%s], error: %s.",
+				path, strerror(errno));
+		return(NULL);
+	}
+	if (fstat(fd, st) || (st->st_size != TAGLINE_STORE_HDRSIZE +
+			(off_t)header->disks * header->diskblocks * TAGLINE_BLOCK_SIZE)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID store [%s] does not match the metadata image", path);
+		close(fd);
+		return(NULL);
+	}
+	base = mmap(NULL, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : failure mapping RAID store [%s], error: %s.",
+				path, strerror(errno));
+		return(NULL);
+	}
+	memcpy(&blocks, &base[1], sizeof(blocks));
+	if (((uint8_t)base[0] != header->disks) || (blocks != header->diskblocks)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID store [%s] does not match the metadata image", path);
+		munmap(base, st->st_size);
+		return(NULL);
+	}
+	return(base);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_stamp_store
+// Description  : Record the size, modification time and per-disk block
+//                hashes of the saved store in an image header
+//
+// Inputs       : path - the saved store
+//                header - the image header (geometry and allocation)
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_meta_stamp_store(const char *path, TaglineMetaHeader *header) {
+
+	struct stat st;
+	uint32_t d;
+	char *base;
+
+	if ((base = tagline_meta_map_store(path, header, &st)) == NULL) {
+		return(-1);
+	}
+	header->store_size = st.st_size;
+	header->store_mtime = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+	for (d = 0; d < header->disks; d++) {
+		header->disk_hash[d] = tagline_meta_fasthash(
+				&base[TAGLINE_STORE_HDRSIZE + (size_t)d * header->diskblocks * TAGLINE_BLOCK_SIZE],
+				(size_t)header->filled[d] * TAGLINE_BLOCK_SIZE);
+	}
+	munmap(base, st.st_size);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_restore_store
+// Description  : Put the contents of the store saved by RAID_CLOSE back into
+//                a freshly initialized array.  Only the blocks the image says
+//                are allocated are written, straight from the mapped file.
+//                If the store has changed since the image was saved, each
+//                disk is checked against its hash and the disks that fail
+//                are left out (the caller formats them), as are the disks
+//                missing from the array when it was saved.
+//
+// Inputs       : path - the saved store
+//                header - the image header (geometry and allocation)
+//                untrusted - the disks not restored, a bit per disk (returned)
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_meta_restore_store(const char *path, TaglineMetaHeader *header, uint32_t *untrusted) {
+
+	struct stat st;
+	uint32_t d;
+	int64_t mtime;
+	char *base, *disk;
+	int ret = 0;
+
+	if ((base = tagline_meta_map_store(path, header, &st)) == NULL) {
+		return(-1);
+	}
+
+	// The fingerprint matches unless the store was saved without the image
+	mtime = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+	*untrusted = header->failed;
+	for (d = 0; (d < header->disks) && (ret == 0); d++) {
+		disk = &base[TAGLINE_STORE_HDRSIZE + (size_t)d * header->diskblocks * TAGLINE_BLOCK_SIZE];
+		if (header->failed & (1 << d)) {
+			continue;
+		}
+		if (((st.st_size != header->store_size) || (mtime != header->store_mtime)) &&
+				(tagline_meta_fasthash(disk, (size_t)header->filled[d] * TAGLINE_BLOCK_SIZE) != header->disk_hash[d])) {
+			TAGLINE_LOG(LOG_WARNING_LEVEL, "TAGLINE : disk %u of RAID store [%s] has changed", d, path);
+			*untrusted |= (1 << d);
+			continue;
+		}
+		ret = tagline_disk_xfer(RAID_WRITE, d, 0, header->filled[d], disk);
+	}
+	munmap(base, st.st_size);
+	return(ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_test_lookup
+// Description  : Return the extent map of a unit test tagline
+//
+// Inputs       : tag - the tag number
+// Outputs      : the extent map, NULL if the tag is past the directory
+
+static TaglineExtentMap *tagline_meta_test_lookup(uint32_t tag) {
+	return((tag < TAGLINE_META_TLINES) ? &meta_test_maps[tag] : NULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_test_flip
+// Description  : Corrupt a byte of the unit test image
+//
+// Inputs       : pos - the offset of the byte
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_meta_test_flip(off_t pos) {
+
+	char byte;
+	int fd, ret;
+
+	if ((fd = open(TAGLINE_META_TPATH, O_RDWR)) == -1) {
+		return(-1);
+	}
+	ret = (pread(fd, &byte, 1, pos) != 1);
+	byte ^= 0x01;
+	ret = ret || (pwrite(fd, &byte, 1, pos) != 1);
+	close(fd);
+	return(ret ? -1 : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_test_bad_extent
+// Description  : Damage one extent of a loaded image, check that the extent
+//                check rejects it, then put the extent back
+//
+// Inputs       : image - the loaded image
+//                ext - the extent to damage
+//                bad - the damaged extent
+// Outputs      : 0 if the damage was caught, -1 if not
+
+static int tagline_meta_test_bad_extent(TaglineMetaImage *image, TaglineExtent *ext, TaglineExtent bad) {
+
+	TaglineExtent good = *ext;
+	int ret;
+
+	*ext = bad;
+	ret = tagline_meta_check_extents(image, RAID_DISKS, RAID_DISKBLOCKS);
+	*ext = good;
+	return((ret == -1) ? 0 : -1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_meta_unit_test
+// Description  : Save an image of random taglines and map it back, checking
+//                the header, the tag records and the extents; then check
+//                that a missing image, a flipped bit in the body or the
+//                header, and a truncated image are refused, and that the
+//                extent check catches extents off the array, past a disk,
+//                past the tagline or overlapping
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_meta_unit_test(void) {
+
+	TaglineMetaHeader header;
+	TaglineMetaImage image;
+	TaglineExtentMap *map;
+	TaglineExtent *ext, bad;
+	uint32_t t, d, k, ntags = 0, nextents = 0, lblock, length;
+	struct stat st;
+	int failed = 0;
+
+	// Random taglines on every third tag, each with at least two extents
+	for (t = 0; t < TAGLINE_META_TLINES; t++) {
+		tagline_extent_init(&meta_test_maps[t]);
+		for (k = 0; (t % 3 == 0) && (k < 2 + rand() % 6) && (! failed); k++) {
+			lblock = (k * 16) + rand() % 8;
+			length = 1 + rand() % 8;
+			failed = tagline_extent_insert(&meta_test_maps[t], lblock, (t + k) % RAID_DISKS,
+					rand() % (RAID_DISKBLOCKS - length + 1), length);
+		}
+		if (meta_test_maps[t].count > 0) {
+			ntags++;
+			nextents += meta_test_maps[t].count;
+		}
+	}
+	memset(&header, 0x0, sizeof(header));
+	header.maxlines = TAGLINE_META_TLINES;
+	header.disks = RAID_DISKS;
+	header.diskblocks = RAID_DISKBLOCKS;
+	for (d = 0; d < RAID_DISKS; d++) {
+		header.filled[d] = d * 100;
+	}
+
+	// Round trip the image
+	unlink(TAGLINE_META_TPATH);
+	failed = failed || (tagline_meta_load(TAGLINE_META_TPATH, &image) != 1) ||
+			tagline_meta_save(TAGLINE_META_TPATH, &header, tagline_meta_test_lookup) ||
+			tagline_meta_load(TAGLINE_META_TPATH, &image);
+	if (! failed) {
+		failed = (image.header->ntags != ntags) || (image.header->nextents != nextents) ||
+				(image.header->maxlines != TAGLINE_META_TLINES) ||
+				(image.header->filled[RAID_DISKS - 1] != (RAID_DISKS - 1) * 100);
+		for (t = k = 0; (k < ntags) && (! failed); t++) {
+			map = &meta_test_maps[t];
+			if (map->count > 0) {
+				failed = (image.tags[k].tag != t) || (image.tags[k].count != map->count) ||
+						memcmp(&image.extents[image.tags[k].first], map->extents, map->count * sizeof(TaglineExtent));
+				k++;
+			}
+		}
+
+		// The extent check passes the image, and catches each kind of bad
+		// extent (the second extent of the first tag overlaps the first)
+		failed = failed || tagline_meta_check_extents(&image, RAID_DISKS, RAID_DISKBLOCKS);
+		ext = &image.extents[1];
+		bad = *ext;
+		bad.disk = RAID_DISKS;
+		failed = failed || tagline_meta_test_bad_extent(&image, ext, bad);
+		bad = *ext;
+		bad.rblock = RAID_DISKBLOCKS - bad.length + 1;
+		failed = failed || tagline_meta_test_bad_extent(&image, ext, bad);
+		bad = *ext;
+		bad.lblock = MAX_TAGLINE_BLOCK_NUMBER - bad.length + 1;
+		failed = failed || tagline_meta_test_bad_extent(&image, ext, bad);
+		bad = *ext;
+		bad.lblock = image.extents[0].lblock + image.extents[0].length - 1;
+		failed = failed || tagline_meta_test_bad_extent(&image, ext, bad);
+		bad = *ext;
+		bad.length = 0;
+		failed = failed || tagline_meta_test_bad_extent(&image, ext, bad);
+		failed = failed || tagline_meta_check_extents(&image, RAID_DISKS, RAID_DISKBLOCKS) ||
+				(tagline_meta_check_extents(&image, 1, RAID_DISKBLOCKS) != -1);
+		tagline_meta_release(&image);
+	}
+
+	// A flipped bit in the extents or the header fails the checksum, a
+	// short image fails its size, and a failed load leaves nothing mapped
+	failed = failed || stat(TAGLINE_META_TPATH, &st) ||
+			tagline_meta_test_flip(st.st_size - 3) ||
+			(tagline_meta_load(TAGLINE_META_TPATH, &image) != -1) || (image.base != NULL) ||
+			tagline_meta_test_flip(st.st_size - 3) ||
+			tagline_meta_load(TAGLINE_META_TPATH, &image);
+	tagline_meta_release(&image);
+	failed = failed || tagline_meta_test_flip(offsetof(TaglineMetaHeader, filled)) ||
+			(tagline_meta_load(TAGLINE_META_TPATH, &image) != -1) ||
+			tagline_meta_test_flip(offsetof(TaglineMetaHeader, filled)) ||
+			truncate(TAGLINE_META_TPATH, st.st_size - 1) ||
+			(tagline_meta_load(TAGLINE_META_TPATH, &image) != -1);
+
+	for (t = 0; t < TAGLINE_META_TLINES; t++) {
+		tagline_extent_free(&meta_test_maps[t]);
+	}
+	unlink(TAGLINE_META_TPATH);
+	if (failed) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : metadata image unit test failed");
+		return(-1);
+	}
+
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : metadata image unit test passed (%u taglines, %u extents)", ntags, nextents);
+	return(0);
+}
@@ -0,0 +1,113 @@
+#ifndef TAGLINE_META_INCLUDED
+#define TAGLINE_META_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_meta.h
+//  Description    : This is the header file for the tagline metadata image,
+//                   the on-disk checkpoint of the tag directory, the extent
+//                   maps and the disk allocation state that lets the driver
+//                   restart without rebuilding or reformatting.
+//
+
+// Includes
+#include <stdint.h>
+#include <stddef.h>
+
+// Project Includes
+#include "tagline_driver.h"
+#include "tagline_extent.h"
+
+// Defines
+#define TAGLINE_META_MAGIC    "TAGMETA"  // first bytes of a metadata image
+#define TAGLINE_META_VERSION  1          // the newest image version
+#define TAGLINE_META_MAXDISKS 16         // disk slots in the image header
+#define TAGLINE_RAID_STORE    "raid_content.crd"  // the store RAID_CLOSE saves
+#define TAGLINE_STORE_HDRSIZE 5          // bytes before the blocks of the store
+
+_Static_assert(RAID_DISKS <= TAGLINE_META_MAXDISKS, "metadata image has too few disk slots");
+
+//
+// The image is mapped straight into memory on restart, so it is written in
+// host byte order and layout and is not portable between machines:
+//
+//   header  : TaglineMetaHeader
+//   tags    : TaglineMetaTag[ntags], sorted by tag number
+//   extents : TaglineExtent[nextents], each tag's extents contiguous
+//
+// The checksum covers the header (with the checksum zeroed) and the body.
+// The header also fingerprints the store saved with the image: its size
+// and modification time, and a hash of the allocated blocks of each disk,
+// which is only checked when the fingerprint does not match.
+
+//
+// Type definitions
+
+// The fixed header of a metadata image
+typedef struct {
+	char     magic[8];                        // TAGLINE_META_MAGIC
+	uint32_t version;                         // the image version
+	uint32_t failed;                          // the disks missing from a striped array, a bit per disk
+	uint32_t maxlines;                        // the size of the tag directory
+	uint32_t ntags;                           // the number of tag records
+	uint32_t nextents;                        // the number of extents
+	uint32_t disks;                           // the number of disks
+	uint32_t diskblocks;                      // the number of blocks per disk
+	uint32_t filled[TAGLINE_META_MAXDISKS];   // the blocks allocated on each disk
+	uint32_t stripe_unit;                     // the blocks per stripe unit (0 if not striped)
+	uint64_t store_size;                      // the size of the saved store
+	int64_t  store_mtime;                     // its modification time (ns)
+	uint64_t disk_hash[TAGLINE_META_MAXDISKS]; // hash of the allocated blocks of each disk
+	uint64_t checksum;                        // FNV-1a of the image
+} TaglineMetaHeader;
+
+// One tagline in the image
+typedef struct {
+	TagLineNumber tag;    // the tag number
+	uint16_t      count;  // the number of extents of the tag
+	uint32_t      first;  // the index of its first extent
+} TaglineMetaTag;
+
+// A metadata image mapped into memory
+typedef struct {
+	void              *base;     // the start of the mapping (NULL if none)
+	size_t             size;     // the length of the mapping
+	TaglineMetaHeader *header;   // the image header
+	TaglineMetaTag    *tags;     // the tag records
+	TaglineExtent     *extents;  // the extents of all tags
+} TaglineMetaImage;
+
+// Function returning the extent map of a tag (NULL if the tag has none)
+typedef TaglineExtentMap *(*TaglineMetaLookup)(uint32_t tag);
+
+//
+// Interface functions
+
+int tagline_meta_save(const char *path, TaglineMetaHeader *header, TaglineMetaLookup lookup);
+	// Write an image of the taglines, replacing the old one atomically
+
+int tagline_meta_load(const char *path, TaglineMetaImage *image);
+	// Map and check an image (0 loaded, 1 no image, -1 bad image)
+
+void tagline_meta_release(TaglineMetaImage *image);
+	// Unmap a loaded image
+
+int tagline_meta_check_extents(TaglineMetaImage *image, uint32_t disks, uint32_t diskblocks);
+	// Check the extents of an image lie inside the array (0 good, -1 bad)
+
+uint64_t tagline_meta_fasthash(const void *data, size_t len);
+	// Hash a range of bytes a word at a time
+
+int tagline_meta_stamp_store(const char *path, TaglineMetaHeader *header);
+	// Record the fingerprint of a saved store in an image header
+
+int tagline_meta_restore_store(const char *path, TaglineMetaHeader *header, uint32_t *untrusted);
+	// Write the allocated blocks of a saved store back to the array
+
+//
+// Unit test
+
+int tagline_meta_unit_test(void);
+	// Round trip an image, checking that damaged images and extents are refused
+
+#endif /* TAGLINE_META_INCLUDED */
@@ -0,0 +1,85 @@
+#ifndef TAGLINE_NET_INCLUDED
+#define TAGLINE_NET_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_net.h
+//  Description    : This is the header file for the remote RAID bus
+//                   protocol, spoken between the net backend of the driver
+//                   and tagline_server, which hosts the array.  Requests
+//                   are pipelined: the client sends frames without waiting
+//                   for the answers to the ones before (up to a window),
+//                   and the server answers them in order.
+//
+//                   A frame (either way) is 64-bit words in network order:
+//
+//                     header  : count << 32 | payload bytes
+//                     opcodes : count RAID opcodes (responses carry the
+//                               result bit)
+//                     payload : the blocks of the requests, in order: the
+//                               blocks written going to the server, the
+//                               blocks read coming back
+//
+
+// Includes
+#include <stdint.h>
+#include "raid_bus.h"
+#include "tagline_opcode.h"
+
+// Defines
+#define TAGLINE_NET_HOST        "127.0.0.1"  // the default server address
+#define TAGLINE_NET_PORT        22887        // the default server port
+#define TAGLINE_NET_BATCH       64           // the most requests in a frame
+#define TAGLINE_NET_WINDOW      2            // the most frames awaiting answers
+#define TAGLINE_NET_MAX_PAYLOAD (4 * RAID_MAX_XFER * RAID_BLOCK_SIZE)  // the most payload either way
+#define TAGLINE_NET_SAVE        RAID_MAXVAL  // save the store (payload: blkid bytes of path)
+
+// Pack and unpack a frame header
+#define TAGLINE_NET_FRAME(count, bytes) (((uint64_t)(count) << 32) | (uint32_t)(bytes))
+#define TAGLINE_NET_COUNT(hdr)          ((uint32_t)((hdr) >> 32))
+#define TAGLINE_NET_BYTES(hdr)          ((uint32_t)(hdr))
+
+//
+// The cmpsc311 network layer (libcmpsc311.a ships no header for it)
+
+int cmpsc311_connect_server(uint16_t port);
+	// Listen for connections on a port, returning the socket
+
+int cmpsc311_accept_connection(int server);
+	// Accept a connection on a listening socket
+
+int cmpsc311_client_connect(const char *ip, uint16_t port);
+	// Connect to a server, returning the socket
+
+int cmpsc311_send_bytes(int sock, int len, void *buf);
+	// Send a whole buffer
+
+int cmpsc311_read_bytes(int sock, int len, void *buf);
+	// Read a whole buffer
+
+void cmpsc311_close(int sock);
+	// Close a socket
+
+uint64_t htonll64(uint64_t val);
+	// Convert a 64-bit value to network order
+
+uint64_t ntohll64(uint64_t val);
+	// Convert a 64-bit value from network order
+
+//
+// Inline functions
+
+// Get the payload bytes a request sends (response 0) or its response returns (response 1)
+static inline uint32_t tagline_net_payload(RAIDOpCode req, int response) {
+	switch (TAGLINE_OPC_GET(req, REQTYPE)) {
+	case RAID_READ:
+		return(response ? TAGLINE_OPC_GET(req, BLOCKS) * RAID_BLOCK_SIZE : 0);
+	case RAID_WRITE:
+		return(response ? 0 : TAGLINE_OPC_GET(req, BLOCKS) * RAID_BLOCK_SIZE);
+	case TAGLINE_NET_SAVE:
+		return(response ? 0 : TAGLINE_OPC_GET(req, BLOCKID));
+	}
+	return(0);
+}
+
+#endif /* TAGLINE_NET_INCLUDED */
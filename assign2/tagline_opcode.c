@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_opcode.c
+//  Description    : This is the unit test of the header-only RAID opcode
+//                   codec (see tagline_opcode.h), which checks it against
+//                   the opcode functions of the RAID library.
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_opcode.h"
+
+// Defines
+#define TAGLINE_OPCODE_TESTS 100000  // random opcodes to cross-check
+#define TAGLINE_OPCODE_BATCH 64      // opcodes per batch test
+
+// The opcode functions of the RAID library (not in raid_bus.h)
+RAIDOpCode construct_RAID_opcode(RAID_REQUEST_TYPES type, uint8_t blocks, RAIDDiskID did,
+		uint8_t status, RAIDBlockID bid);
+int deconstruct_RAID_opcode(RAIDOpCode op, RAID_REQUEST_TYPES *type, uint8_t *blocks,
+		RAIDDiskID *did, uint8_t *status, RAIDBlockID *bid);
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_opcode_unit_test
+// Description  : Pack and unpack random opcodes with the codec and with the
+//                RAID library, singly and in batches, and check they agree
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_opcode_unit_test(void) {
+
+	TaglineOpcode opcs[TAGLINE_OPCODE_BATCH], out[TAGLINE_OPCODE_BATCH];
+	RAIDOpCode ops[TAGLINE_OPCODE_BATCH], lib;
+	RAID_REQUEST_TYPES type;
+	uint8_t blocks, disk, status, rtype;
+	RAIDBlockID bid;
+	int i, k, f;
+
+	// The field table must tile the opcode with no gaps or overlaps
+	for (f = 0, k = 0; f < RAID_OPCODE_MAXVAL; f++) {
+		k += tagline_opcode_fields[f].width;
+	}
+	if (k != 64) {
+		logMessage(LOG_ERROR_LEVEL, "TAGLINE : opcode fields cover %d bits", k);
+		return(-1);
+	}
+
+	for (i = 0; i < TAGLINE_OPCODE_TESTS; i += TAGLINE_OPCODE_BATCH) {
+
+		// Make up a batch of random requests
+		for (k = 0; k < TAGLINE_OPCODE_BATCH; k++) {
+			opcs[k].type = rand() % RAID_MAXVAL;
+			opcs[k].blocks = rand() & 0xff;
+			opcs[k].disk = rand() & 0xff;
+			opcs[k].status = rand() & 0x1;
+			opcs[k].blkid = ((uint32_t)rand() << 16) ^ rand();
+		}
+		tagline_opcode_encode_batch(opcs, ops, TAGLINE_OPCODE_BATCH);
+		tagline_opcode_decode_batch(ops, out, TAGLINE_OPCODE_BATCH);
+
+		for (k = 0; k < TAGLINE_OPCODE_BATCH; k++) {
+
+			// Packing must match the library, unpacking must round trip
+			lib = construct_RAID_opcode(opcs[k].type, opcs[k].blocks, opcs[k].disk, opcs[k].status, opcs[k].blkid);
+			if ((ops[k] != lib) || (tagline_opcode_encode(&opcs[k]) != lib) ||
+					memcmp(&opcs[k], &out[k], sizeof(TaglineOpcode))) {
+				logMessage(LOG_ERROR_LEVEL, "TAGLINE : opcode encode mismatch [%016lx != %016lx]", ops[k], lib);
+				return(-1);
+			}
+
+			// Unpacking must match the library, field by field
+			deconstruct_RAID_opcode(lib, &type, &blocks, &disk, &status, &bid);
+			if ((out[k].type != type) || (out[k].blocks != blocks) || (out[k].disk != disk) ||
+					(out[k].status != status) || (out[k].blkid != bid) ||
+					(tagline_opcode_field(lib, RAID_OPCODE_BLOCKID) != bid) ||
+					(tagline_opcode_field(lib, RAID_OPCODE_REQTYPE) != type)) {
+				logMessage(LOG_ERROR_LEVEL, "TAGLINE : opcode decode mismatch [%016lx]", lib);
+				return(-1);
+			}
+
+			// The request helpers leave the status clear and read it back
+			if ((make_raid_request(opcs[k].type, opcs[k].blocks, opcs[k].disk, opcs[k].blkid) !=
+					construct_RAID_opcode(opcs[k].type, opcs[k].blocks, opcs[k].disk, 0, opcs[k].blkid)) ||
+					(extract_raid_response(lib, &rtype, &blocks, &disk, &bid) != opcs[k].status) ||
+					(rtype != opcs[k].type) || (raid_request_failed(lib) != opcs[k].status)) {
+				logMessage(LOG_ERROR_LEVEL, "TAGLINE : opcode request helper mismatch [%016lx]", lib);
+				return(-1);
+			}
+		}
+	}
+
+	logMessage(LOG_INFO_LEVEL, "TAGLINE : opcode codec unit test passed (%d opcodes)", TAGLINE_OPCODE_TESTS);
+	return(0);
+}
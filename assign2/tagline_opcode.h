@@ -0,0 +1,144 @@
+#ifndef TAGLINE_OPCODE_INCLUDED
+#define TAGLINE_OPCODE_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_opcode.h
+//  Description    : This is the header-only codec for RAID bus opcodes.  The
+//                   field layout (see raid_bus.h) is written down once, in
+//                   TAGLINE_OPCODE_FIELDS, and the shifts and masks of every
+//                   field are computed from it at compile time, so packing
+//                   or unpacking a field is a shift and a mask.
+//
+
+// Includes
+#include <stddef.h>
+#include <stdint.h>
+#include "raid_bus.h"
+
+//
+// The opcode fields, least significant first: X(name, width, field below)
+
+#define TAGLINE_OPCODE_FIELDS(X) \
+	X(BLOCKID, 32, NONE)    \
+	X(STATUS,   1, BLOCKID) \
+	X(UNUSED,   7, STATUS)  \
+	X(DISKID,   8, UNUSED)  \
+	X(BLOCKS,   8, DISKID)  \
+	X(REQTYPE,  8, BLOCKS)
+
+// The width, shift and end bit of each field (TAGLINE_OPC_<name>_SHIFT...)
+enum {
+	TAGLINE_OPC_NONE_END = 0,
+#define TAGLINE_OPC_LAYOUT(name, width, below) \
+	TAGLINE_OPC_##name##_WIDTH = (width), \
+	TAGLINE_OPC_##name##_SHIFT = TAGLINE_OPC_##below##_END, \
+	TAGLINE_OPC_##name##_END   = TAGLINE_OPC_##below##_END + (width),
+	TAGLINE_OPCODE_FIELDS(TAGLINE_OPC_LAYOUT)
+#undef TAGLINE_OPC_LAYOUT
+};
+_Static_assert(TAGLINE_OPC_REQTYPE_END == 64, "RAID opcode fields must fill 64 bits");
+
+// The mask of a field (in place), and a field's value in an opcode
+#define TAGLINE_OPC_MASK(name) \
+	((((uint64_t)1 << TAGLINE_OPC_##name##_WIDTH) - 1) << TAGLINE_OPC_##name##_SHIFT)
+#define TAGLINE_OPC_GET(op, name) \
+	(((op) & TAGLINE_OPC_MASK(name)) >> TAGLINE_OPC_##name##_SHIFT)
+#define TAGLINE_OPC_SET(name, val) \
+	((((uint64_t)(val)) << TAGLINE_OPC_##name##_SHIFT) & TAGLINE_OPC_MASK(name))
+
+//
+// Type definitions
+
+// The placement of one field, indexed by RAID_OPCODE_FIELDS
+typedef struct {
+	uint8_t shift;  // the bit position of the least significant bit
+	uint8_t width;  // the number of bits
+} TaglineOpcodeField;
+
+// The fields of an opcode, unpacked
+typedef struct {
+	uint8_t     type;    // the RAID_REQUEST_TYPES of the request
+	uint8_t     blocks;  // the number of blocks (tracks for RAID_INIT)
+	RAIDDiskID  disk;    // the disk of the request
+	uint8_t     status;  // the result bit (0 success, 1 failure)
+	RAIDBlockID blkid;   // the first block of the request
+} TaglineOpcode;
+
+// The placement of every field, from the same table
+static const TaglineOpcodeField tagline_opcode_fields[RAID_OPCODE_MAXVAL] = {
+#define TAGLINE_OPC_ENTRY(name, width, below) \
+	[RAID_OPCODE_##name] = { TAGLINE_OPC_##name##_SHIFT, TAGLINE_OPC_##name##_WIDTH },
+	TAGLINE_OPCODE_FIELDS(TAGLINE_OPC_ENTRY)
+#undef TAGLINE_OPC_ENTRY
+};
+
+//
+// Inline codec functions
+
+// Get any field of an opcode (folds to a shift and mask for a constant field)
+static inline uint64_t tagline_opcode_field(RAIDOpCode op, RAID_OPCODE_FIELDS field) {
+	return((op >> tagline_opcode_fields[field].shift) &
+			(((uint64_t)1 << tagline_opcode_fields[field].width) - 1));
+}
+
+// Pack the fields of an opcode
+static inline RAIDOpCode tagline_opcode_encode(const TaglineOpcode *opc) {
+	return(TAGLINE_OPC_SET(REQTYPE, opc->type) | TAGLINE_OPC_SET(BLOCKS, opc->blocks) |
+			TAGLINE_OPC_SET(DISKID, opc->disk) | TAGLINE_OPC_SET(STATUS, opc->status) |
+			TAGLINE_OPC_SET(BLOCKID, opc->blkid));
+}
+
+// Unpack the fields of an opcode
+static inline void tagline_opcode_decode(RAIDOpCode op, TaglineOpcode *opc) {
+	opc->type = TAGLINE_OPC_GET(op, REQTYPE);
+	opc->blocks = TAGLINE_OPC_GET(op, BLOCKS);
+	opc->disk = TAGLINE_OPC_GET(op, DISKID);
+	opc->status = TAGLINE_OPC_GET(op, STATUS);
+	opc->blkid = TAGLINE_OPC_GET(op, BLOCKID);
+}
+
+// Pack an array of opcodes
+static inline void tagline_opcode_encode_batch(const TaglineOpcode *opcs, RAIDOpCode *ops, size_t n) {
+	size_t i;
+	for (i = 0; i < n; i++) {
+		ops[i] = tagline_opcode_encode(&opcs[i]);
+	}
+}
+
+// Unpack an array of opcodes
+static inline void tagline_opcode_decode_batch(const RAIDOpCode *ops, TaglineOpcode *opcs, size_t n) {
+	size_t i;
+	for (i = 0; i < n; i++) {
+		tagline_opcode_decode(ops[i], &opcs[i]);
+	}
+}
+
+// Pack the fields of a RAID bus request
+static inline RAIDOpCode make_raid_request(uint8_t request_type, uint8_t num_of_blks, uint8_t disk_num, uint32_t block_ID) {
+	return(TAGLINE_OPC_SET(REQTYPE, request_type) | TAGLINE_OPC_SET(BLOCKS, num_of_blks) |
+			TAGLINE_OPC_SET(DISKID, disk_num) | TAGLINE_OPC_SET(BLOCKID, block_ID));
+}
+
+// Unpack the fields of a RAID bus response, returning the result bit
+static inline int extract_raid_response(RAIDOpCode resp, uint8_t *request_type, uint8_t *num_of_blks,
+		uint8_t *disk_num, uint32_t *block_ID) {
+	*request_type = TAGLINE_OPC_GET(resp, REQTYPE);
+	*num_of_blks = TAGLINE_OPC_GET(resp, BLOCKS);
+	*disk_num = TAGLINE_OPC_GET(resp, DISKID);
+	*block_ID = TAGLINE_OPC_GET(resp, BLOCKID);
+	return(TAGLINE_OPC_GET(resp, STATUS));
+}
+
+// Check the result bit of a RAID bus response (1 if the bus reported a failure)
+static inline int raid_request_failed(RAIDOpCode resp) {
+	return(TAGLINE_OPC_GET(resp, STATUS) != 0);
+}
+
+//
+// Unit test
+
+int tagline_opcode_unit_test(void);
+	// Cross-check the codec against the RAID library's opcode functions
+
+#endif /* TAGLINE_OPCODE_INCLUDED */
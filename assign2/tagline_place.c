@@ -0,0 +1,247 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_place.c
+//  Description    : This is the implementation of the placement engine.
+//                   A tagline's blocks fall into track-sized ranges (block
+//                   b is in range b / RAID_TRACK_BLOCKS).  The first write
+//                   to a range reserves a free track for it, and every
+//                   block of the range goes to the same offset in that
+//                   track, so a range is read with one transfer from one
+//                   track.  Reservations are soft: the free blocks of a
+//                   reserved track stay free space, and when no track can
+//                   be reserved the driver falls back to next fit.
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_place.h"
+#include "tagline_alloc.h"
+#include "tagline_driver.h"
+#include "tagline_log.h"
+
+// Defines
+#define TAGLINE_PLACE_RANGES (MAX_TAGLINE_BLOCK_NUMBER / TAGLINE_PLACE_TRACK_BLOCKS)  // ranges per tagline
+#define TAGLINE_PLACE_NONE   UINT32_MAX  // a range with no track
+
+//
+// Global data
+
+// The placement policy names
+const char *TAGLINE_PLACE_LABELS[TAGLINE_PLACE_MAXVAL] = { "fit", "track" };
+
+static uint32_t *place_range = NULL;  // the track of each tagline range (or TAGLINE_PLACE_NONE)
+static uint32_t *place_owner = NULL;  // the tagline range + 1 holding each track (0 if none)
+static uint32_t place_lines = 0;      // the number of taglines
+static uint32_t place_disks = 0;      // the number of disks
+static uint32_t place_tracks = 0;     // the number of tracks (of all disks)
+static uint32_t place_cursor = 0;     // where the next search for a track starts
+static uint32_t place_reserved = 0;   // the tracks reserved
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_place_type
+// Description  : Find a placement policy by its label
+//
+// Inputs       : label - the policy label ("fit", "track")
+//                type - the policy type (returned)
+// Outputs      : 0 if found, -1 if not
+
+int tagline_place_type(const char *label, TaglinePlaceType *type) {
+
+	int p;
+
+	for (p = 0; p < TAGLINE_PLACE_MAXVAL; p++) {
+		if (strcmp(label, TAGLINE_PLACE_LABELS[p]) == 0) {
+			*type = p;
+			return(0);
+		}
+	}
+	return(-1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_place_init
+// Description  : Create the reservation tables with no track reserved.
+//                Tracks are numbered across the disks in turn (track t of
+//                disk d is t * disks + d), so reservations spread the
+//                taglines over the array.
+//
+// Inputs       : maxlines - the number of taglines
+//                disks - the number of disks
+//                blocks - the blocks per disk
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_place_init(uint32_t maxlines, uint32_t disks, uint32_t blocks) {
+
+	tagline_place_close();
+	place_tracks = disks * (blocks / TAGLINE_PLACE_TRACK_BLOCKS);
+	if (((place_range = malloc((size_t)maxlines * TAGLINE_PLACE_RANGES * sizeof(uint32_t))) == NULL) ||
+			((place_owner = calloc(place_tracks, sizeof(uint32_t))) == NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate track reservations (%u taglines)", maxlines);
+		tagline_place_close();
+		return(-1);
+	}
+	memset(place_range, 0xff, (size_t)maxlines * TAGLINE_PLACE_RANGES * sizeof(uint32_t));
+	place_lines = maxlines;
+	place_disks = disks;
+	place_cursor = 0;
+	place_reserved = 0;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_place_close
+// Description  : Release the reservation tables
+//
+// Inputs       : none
+// Outputs      : none
+
+void tagline_place_close(void) {
+	free(place_range);
+	free(place_owner);
+	place_range = place_owner = NULL;
+	place_lines = place_disks = place_tracks = place_cursor = place_reserved = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_place_reserve
+// Description  : Reserve a track for a tagline range: the next track from
+//                the cursor that is wholly free and not reserved
+//
+// Inputs       : slot - the tagline range (tag * TAGLINE_PLACE_RANGES + range)
+// Outputs      : the track reserved, TAGLINE_PLACE_NONE if there is none
+
+static uint32_t tagline_place_reserve(uint32_t slot) {
+
+	uint32_t n, trk;
+
+	for (n = 0; n < place_tracks; n++) {
+		trk = (place_cursor + n) % place_tracks;
+		if ((place_owner[trk] == 0) && tagline_alloc_is_free(trk % place_disks,
+				(trk / place_disks) * TAGLINE_PLACE_TRACK_BLOCKS, TAGLINE_PLACE_TRACK_BLOCKS)) {
+			place_owner[trk] = slot + 1;
+			place_range[slot] = trk;
+			place_cursor = (trk + 1) % place_tracks;
+			place_reserved++;
+			return(trk);
+		}
+	}
+	return(TAGLINE_PLACE_NONE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_place_track
+// Description  : Allocate blocks for an unmapped run of a tagline at their
+//                place in the track of its range, reserving the track on
+//                the first write to the range.  The run is cut at the end
+//                of the range and at the first block already taken.
+//
+// Inputs       : tag - the tagline
+//                lblock - the first tagline block of the run
+//                want - the number of blocks wanted
+//                disk - the disk allocated on (returned)
+//                rblock - the first block allocated (returned)
+// Outputs      : the number of blocks allocated (0 if there is no place)
+
+uint32_t tagline_place_track(uint16_t tag, uint32_t lblock, uint32_t want, RAIDDiskID *disk, RAIDBlockID *rblock) {
+
+	uint32_t slot, trk, offset = lblock % TAGLINE_PLACE_TRACK_BLOCKS, count;
+
+	if ((tag >= place_lines) || (lblock >= MAX_TAGLINE_BLOCK_NUMBER)) {
+		return(0);
+	}
+	slot = tag * TAGLINE_PLACE_RANGES + lblock / TAGLINE_PLACE_TRACK_BLOCKS;
+	if (((trk = place_range[slot]) == TAGLINE_PLACE_NONE) &&
+			((trk = tagline_place_reserve(slot)) == TAGLINE_PLACE_NONE)) {
+		return(0);
+	}
+	if (want > TAGLINE_PLACE_TRACK_BLOCKS - offset) {
+		want = TAGLINE_PLACE_TRACK_BLOCKS - offset;
+	}
+	*disk = trk % place_disks;
+	*rblock = (trk / place_disks) * TAGLINE_PLACE_TRACK_BLOCKS + offset;
+	count = tagline_alloc_at(*disk, *rblock, want);
+	return(count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_place_adopt
+// Description  : Reserve the tracks that hold a run of a tagline at their
+//                place (e.g., when rebuilding the reservations from the
+//                taglines at init).  Misplaced pieces are left alone.
+//
+// Inputs       : tag - the tagline
+//                lblock - the first tagline block of the run
+//                disk - the disk of the run
+//                rblock - the first block of the run
+//                count - the number of blocks
+// Outputs      : none
+
+void tagline_place_adopt(uint16_t tag, uint32_t lblock, RAIDDiskID disk, RAIDBlockID rblock, uint32_t count) {
+
+	uint32_t slot, trk, blk;
+
+	if ((tag >= place_lines) || (disk >= place_disks) || (lblock % TAGLINE_PLACE_TRACK_BLOCKS != rblock % TAGLINE_PLACE_TRACK_BLOCKS)) {
+		return;
+	}
+
+	// a run at its place covers one track per range it touches
+	for (blk = 0; (blk < count) && (lblock + blk < MAX_TAGLINE_BLOCK_NUMBER);
+			blk += TAGLINE_PLACE_TRACK_BLOCKS - (lblock + blk) % TAGLINE_PLACE_TRACK_BLOCKS) {
+		slot = tag * TAGLINE_PLACE_RANGES + (lblock + blk) / TAGLINE_PLACE_TRACK_BLOCKS;
+		trk = ((rblock + blk) / TAGLINE_PLACE_TRACK_BLOCKS) * place_disks + disk;
+		if ((place_range[slot] == TAGLINE_PLACE_NONE) && (trk < place_tracks) && (place_owner[trk] == 0)) {
+			place_owner[trk] = slot + 1;
+			place_range[slot] = trk;
+			place_reserved++;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_place_drop
+// Description  : Give up the tracks reserved for a (deleted) tagline
+//
+// Inputs       : tag - the tagline
+// Outputs      : none
+
+void tagline_place_drop(uint16_t tag) {
+
+	uint32_t slot;
+
+	if (tag >= place_lines) {
+		return;
+	}
+	for (slot = tag * TAGLINE_PLACE_RANGES; slot < (tag + 1) * TAGLINE_PLACE_RANGES; slot++) {
+		if (place_range[slot] != TAGLINE_PLACE_NONE) {
+			place_owner[place_range[slot]] = 0;
+			place_range[slot] = TAGLINE_PLACE_NONE;
+			place_reserved--;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_place_reserved
+// Description  : Get the number of tracks reserved for taglines
+//
+// Inputs       : none
+// Outputs      : the number of tracks reserved
+
+uint32_t tagline_place_reserved(void) {
+	return(place_reserved);
+}
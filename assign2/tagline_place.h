@@ -0,0 +1,64 @@
+#ifndef TAGLINE_PLACE_INCLUDED
+#define TAGLINE_PLACE_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_place.h
+//  Description    : This is the header file for the placement engine that
+//                   decides where new tagline blocks go, keeping each
+//                   track-sized range of a tagline in one track.
+//
+
+// Includes
+#include <stdint.h>
+#include "raid_bus.h"
+
+// Defines
+#define TAGLINE_PLACE_TRACK_BLOCKS RAID_TRACK_BLOCKS  // blocks per track
+
+//
+// Type definitions
+
+// The placement policies for new tagline blocks
+typedef enum {
+	TAGLINE_PLACE_FIT    = 0,  // next fit on the disk with the most free blocks
+	TAGLINE_PLACE_TRACK  = 1,  // a reserved track per track-sized range of a tagline
+	TAGLINE_PLACE_MAXVAL = 2,  // Max value
+} TaglinePlaceType;
+extern const char *TAGLINE_PLACE_LABELS[TAGLINE_PLACE_MAXVAL];
+
+// Counters describing the layout of the taglines
+typedef struct {
+	uint32_t taglines;    // the taglines with data
+	uint64_t blocks;      // the tagline blocks mapped
+	uint64_t extents;     // the extents (the transfers to read every tagline cold)
+	uint64_t tracks;      // the tracks holding each tagline's blocks, summed
+	uint64_t min_tracks;  // the tracks if each range of a tagline sat in one track
+	uint32_t reserved;    // the tracks reserved for taglines
+} TaglineLayoutStats;
+
+//
+// Interface functions
+
+int tagline_place_type(const char *label, TaglinePlaceType *type);
+	// Find a placement policy by its label (0 if found, -1 if not)
+
+int tagline_place_init(uint32_t maxlines, uint32_t disks, uint32_t blocks);
+	// Start with no tracks reserved
+
+void tagline_place_close(void);
+	// Release the track reservations
+
+uint32_t tagline_place_track(uint16_t tag, uint32_t lblock, uint32_t want, RAIDDiskID *disk, RAIDBlockID *rblock);
+	// Allocate blocks for a tagline in its track for the range (0 if it cannot)
+
+void tagline_place_adopt(uint16_t tag, uint32_t lblock, RAIDDiskID disk, RAIDBlockID rblock, uint32_t count);
+	// Reserve the tracks a run of a tagline sits at its place in
+
+void tagline_place_drop(uint16_t tag);
+	// Give up the tracks reserved for a tagline
+
+uint32_t tagline_place_reserved(void);
+	// Get the number of tracks reserved
+
+#endif /* TAGLINE_PLACE_INCLUDED */
@@ -0,0 +1,689 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_policy.c
+//  Description    : This is the implementation of the replacement policies
+//                   for the tagline block cache (LRU, 2Q and ARC).  The OID
+//                   space is small (every block of every disk), so the
+//                   policy queues are intrusive lists threaded through
+//                   arrays indexed by OID, which makes ghost (history-only)
+//                   entries as cheap to find as resident ones.
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_policy.h"
+#include "tagline_driver.h"
+#include "tagline_log.h"
+
+// Defines
+#define POLICY_OIDS    (RAID_DISKS * RAID_DISKBLOCKS)  // number of possible OIDs
+#define POLICY_QUEUES  4                               // max queues per policy
+#define POLICY_TESTS   20000                           // random references per policy and size
+#define POLICY_CACHED  2                               // queues 1 and 2 hold the cached blocks (LRU uses 1)
+
+//
+// Type definitions
+
+// An OID-indexed doubly linked queue (head is most recent)
+typedef struct {
+	uint32_t head;  // most recently added OID
+	uint32_t tail;  // least recently added OID
+	uint32_t size;  // number of OIDs in the queue
+} PolicyQueue;
+
+//
+// Global data
+
+const char *TAGLINE_POLICY_LABELS[TAGLINE_POLICY_MAXVAL] = { "lru", "2q", "arc" };
+
+static uint32_t *oid_prev = NULL;              // next more recent OID in its queue
+static uint32_t *oid_next = NULL;              // next less recent OID in its queue
+static uint8_t  *oid_queue = NULL;             // queue holding the OID (0 is none)
+static PolicyQueue queues[POLICY_QUEUES + 1];  // the queues (index 0 unused)
+static uint32_t policy_capacity;               // capacity of the cache in blocks
+
+//
+// Queue functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : queue_close
+// Description  : Release the OID tables
+//
+// Inputs       : none
+// Outputs      : none
+
+static void queue_close(void) {
+	free(oid_prev);
+	free(oid_next);
+	free(oid_queue);
+	oid_prev = oid_next = NULL;
+	oid_queue = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : queue_init
+// Description  : Allocate the OID tables and empty all of the queues
+//
+// Inputs       : capacity - capacity of the cache in blocks
+// Outputs      : 0 if successful, -1 if failure
+
+static int queue_init(uint32_t capacity) {
+
+	int q;
+
+	oid_prev = malloc(POLICY_OIDS * sizeof(uint32_t));
+	oid_next = malloc(POLICY_OIDS * sizeof(uint32_t));
+	oid_queue = calloc(POLICY_OIDS, sizeof(uint8_t));
+	if ((oid_prev == NULL) || (oid_next == NULL) || (oid_queue == NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate cache policy tables");
+		queue_close();
+		return(-1);
+	}
+	for (q = 0; q <= POLICY_QUEUES; q++) {
+		queues[q].head = queues[q].tail = TAGLINE_POLICY_NONE;
+		queues[q].size = 0;
+	}
+	policy_capacity = capacity;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : queue_remove
+// Description  : Take an OID out of whatever queue holds it
+//
+// Inputs       : oid - the OID to remove
+// Outputs      : none
+
+static void queue_remove(uint32_t oid) {
+
+	PolicyQueue *q;
+
+	if (oid_queue[oid] == 0) {
+		return;
+	}
+	q = &queues[oid_queue[oid]];
+	if (oid_prev[oid] != TAGLINE_POLICY_NONE) {
+		oid_next[oid_prev[oid]] = oid_next[oid];
+	} else {
+		q->head = oid_next[oid];
+	}
+	if (oid_next[oid] != TAGLINE_POLICY_NONE) {
+		oid_prev[oid_next[oid]] = oid_prev[oid];
+	} else {
+		q->tail = oid_prev[oid];
+	}
+	q->size--;
+	oid_queue[oid] = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : queue_push
+// Description  : Put an OID at the head of a queue (removing it from any
+//                queue it is already in)
+//
+// Inputs       : qid - the queue to add to
+//                oid - the OID to add
+// Outputs      : none
+
+static void queue_push(uint8_t qid, uint32_t oid) {
+
+	PolicyQueue *q = &queues[qid];
+
+	queue_remove(oid);
+	oid_prev[oid] = TAGLINE_POLICY_NONE;
+	oid_next[oid] = q->head;
+	if (q->head != TAGLINE_POLICY_NONE) {
+		oid_prev[q->head] = oid;
+	} else {
+		q->tail = oid;
+	}
+	q->head = oid;
+	q->size++;
+	oid_queue[oid] = qid;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : queue_pop
+// Description  : Remove the least recent OID from a queue
+//
+// Inputs       : qid - the queue to take from
+// Outputs      : the OID removed, TAGLINE_POLICY_NONE if the queue is empty
+
+static uint32_t queue_pop(uint8_t qid) {
+
+	uint32_t oid = queues[qid].tail;
+
+	if (oid != TAGLINE_POLICY_NONE) {
+		queue_remove(oid);
+	}
+	return(oid);
+}
+
+//
+// LRU policy: one queue of resident blocks, evict the least recently used
+
+#define LRU_RESIDENT 1
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lru_init
+// Description  : Start the LRU policy with an empty queue
+//
+// Inputs       : capacity - capacity of the cache in blocks
+// Outputs      : 0 if successful, -1 if failure
+
+static int lru_init(uint32_t capacity) {
+	return(queue_init(capacity));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lru_hit
+// Description  : Note a hit, making the block the most recently used
+//
+// Inputs       : oid - the OID referenced
+// Outputs      : none
+
+static void lru_hit(uint32_t oid) {
+	queue_push(LRU_RESIDENT, oid);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lru_replace
+// Description  : Choose the least recently used block to evict
+//
+// Inputs       : oid - the OID being brought into the cache
+// Outputs      : the OID to evict, TAGLINE_POLICY_NONE if none
+
+static uint32_t lru_replace(uint32_t oid) {
+	return(queue_pop(LRU_RESIDENT));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lru_insert
+// Description  : Note a block brought into the cache as the most recently
+//                used
+//
+// Inputs       : oid - the OID brought into the cache
+// Outputs      : none
+
+static void lru_insert(uint32_t oid) {
+	queue_push(LRU_RESIDENT, oid);
+}
+
+//
+// 2Q policy (Johnson & Shasha): first references go to a FIFO probation
+// queue (A1in); blocks evicted from it are remembered in a ghost queue
+// (A1out), and only a re-reference while remembered promotes a block to
+// the LRU main queue (Am).  A scan therefore passes through A1in without
+// displacing the hot blocks in Am.
+
+#define TWOQ_A1IN  1
+#define TWOQ_AM    2
+#define TWOQ_A1OUT 3
+
+static uint32_t twoq_kin;   // target size of A1in (25% of the cache)
+static uint32_t twoq_kout;  // size of the A1out history (50% of the cache)
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : twoq_init
+// Description  : Start the 2Q policy, sizing A1in and the A1out history
+//
+// Inputs       : capacity - capacity of the cache in blocks
+// Outputs      : 0 if successful, -1 if failure
+
+static int twoq_init(uint32_t capacity) {
+	twoq_kin = (capacity / 4) ? (capacity / 4) : 1;
+	twoq_kout = (capacity / 2) ? (capacity / 2) : 1;
+	return(queue_init(capacity));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : twoq_hit
+// Description  : Note a hit, refreshing the block if it is in Am
+//
+// Inputs       : oid - the OID referenced
+// Outputs      : none
+
+static void twoq_hit(uint32_t oid) {
+	// Hits in A1in are deliberately ignored (correlated references)
+	if (oid_queue[oid] == TWOQ_AM) {
+		queue_push(TWOQ_AM, oid);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : twoq_replace
+// Description  : Choose the block to evict, from A1in (remembering it in
+//                A1out) while A1in is over its target, else from Am
+//
+// Inputs       : oid - the OID being brought into the cache
+// Outputs      : the OID to evict, TAGLINE_POLICY_NONE if none
+
+static uint32_t twoq_replace(uint32_t oid) {
+
+	uint32_t victim;
+
+	// Age out of probation first, remembering what was evicted
+	if ((queues[TWOQ_A1IN].size > twoq_kin) || (queues[TWOQ_AM].size == 0)) {
+		victim = queue_pop(TWOQ_A1IN);
+		queue_push(TWOQ_A1OUT, victim);
+		if (queues[TWOQ_A1OUT].size > twoq_kout) {
+			queue_pop(TWOQ_A1OUT);
+		}
+		return(victim);
+	}
+	return(queue_pop(TWOQ_AM));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : twoq_insert
+// Description  : Note a block brought into the cache: into Am if A1out
+//                remembers it, else into A1in
+//
+// Inputs       : oid - the OID brought into the cache
+// Outputs      : none
+
+static void twoq_insert(uint32_t oid) {
+	queue_push((oid_queue[oid] == TWOQ_A1OUT) ? TWOQ_AM : TWOQ_A1IN, oid);
+}
+
+//
+// ARC policy (Megiddo & Modha): T1 holds blocks seen once recently, T2
+// blocks seen at least twice; B1/B2 remember what was evicted from each.
+// Ghost hits move the target size p of T1 towards whichever side would
+// have kept the block, so the cache adapts between recency and frequency.
+
+#define ARC_T1 1
+#define ARC_T2 2
+#define ARC_B1 3
+#define ARC_B2 4
+
+static uint32_t arc_p;  // target size of T1
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : arc_init
+// Description  : Start the ARC policy with no target size for T1
+//
+// Inputs       : capacity - capacity of the cache in blocks
+// Outputs      : 0 if successful, -1 if failure
+
+static int arc_init(uint32_t capacity) {
+	arc_p = 0;
+	return(queue_init(capacity));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : arc_hit
+// Description  : Note a hit, moving the block to the head of T2
+//
+// Inputs       : oid - the OID referenced
+// Outputs      : none
+
+static void arc_hit(uint32_t oid) {
+	queue_push(ARC_T2, oid);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : arc_replace
+// Description  : Adapt the target size of T1 on a ghost hit, trim the
+//                ghost queues, then choose the block to evict from T1 or T2
+//                (remembering it in B1 or B2)
+//
+// Inputs       : oid - the OID being brought into the cache
+// Outputs      : the OID to evict, TAGLINE_POLICY_NONE if none
+
+static uint32_t arc_replace(uint32_t oid) {
+
+	uint32_t c = policy_capacity, delta, victim;
+	uint32_t t1 = queues[ARC_T1].size, b1 = queues[ARC_B1].size, b2 = queues[ARC_B2].size;
+
+	// Adapt the target on a ghost hit
+	if (oid_queue[oid] == ARC_B1) {
+		delta = (b1 >= b2) ? 1 : b2 / b1;
+		arc_p = (arc_p + delta > c) ? c : arc_p + delta;
+	} else if (oid_queue[oid] == ARC_B2) {
+		delta = (b2 >= b1) ? 1 : b1 / b2;
+		arc_p = (arc_p > delta) ? arc_p - delta : 0;
+	} else if (t1 + b1 >= c) {
+		// Keep L1 = T1 + B1 within the cache size
+		if (b1 > 0) {
+			queue_pop(ARC_B1);
+		} else {
+			return(queue_pop(ARC_T1));
+		}
+	} else if (t1 + b1 + queues[ARC_T2].size + b2 >= 2 * c) {
+		// Keep the whole directory within twice the cache size
+		queue_pop(ARC_B2);
+	}
+
+	// Evict from T1 or T2 depending on the target, remembering the block
+	t1 = queues[ARC_T1].size;
+	if ((t1 > 0) && ((t1 > arc_p) || ((oid_queue[oid] == ARC_B2) && (t1 == arc_p)))) {
+		victim = queue_pop(ARC_T1);
+		queue_push(ARC_B1, victim);
+	} else {
+		victim = queue_pop(ARC_T2);
+		queue_push(ARC_B2, victim);
+	}
+	return(victim);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : arc_insert
+// Description  : Note a block brought into the cache: into T2 on a ghost
+//                hit, else into T1
+//
+// Inputs       : oid - the OID brought into the cache
+// Outputs      : none
+
+static void arc_insert(uint32_t oid) {
+
+	uint8_t q = oid_queue[oid];
+
+	queue_push(((q == ARC_B1) || (q == ARC_B2)) ? ARC_T2 : ARC_T1, oid);
+}
+
+//
+// Policy table
+
+static const TaglinePolicy tagline_policies[TAGLINE_POLICY_MAXVAL] = {
+	{ lru_init,  queue_close, lru_hit,  lru_replace,  lru_insert },
+	{ twoq_init, queue_close, twoq_hit, twoq_replace, twoq_insert },
+	{ arc_init,  queue_close, arc_hit,  arc_replace,  arc_insert },
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_policy
+// Description  : Get the operations for a replacement policy
+//
+// Inputs       : type - the policy wanted
+// Outputs      : pointer to the policy operations, NULL if bad type
+
+const TaglinePolicy *tagline_policy(TaglinePolicyType type) {
+	if (type >= TAGLINE_POLICY_MAXVAL) {
+		return(NULL);
+	}
+	return(&tagline_policies[type]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_policy_type
+// Description  : Find a policy by its label
+//
+// Inputs       : label - the policy label ("lru", "2q", "arc")
+//                type - the policy type (returned)
+// Outputs      : 0 if found, -1 if not
+
+int tagline_policy_type(const char *label, TaglinePolicyType *type) {
+
+	int p;
+
+	for (p = 0; p < TAGLINE_POLICY_MAXVAL; p++) {
+		if (strcmp(label, TAGLINE_POLICY_LABELS[p]) == 0) {
+			*type = p;
+			return(0);
+		}
+	}
+	return(-1);
+}
+
+//
+// Unit test
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : policy_test_reference
+// Description  : Reference a block the way the cache does: a hit if it is
+//                resident, else insert it, evicting the victim chosen by
+//                the policy if the cache is full
+//
+// Inputs       : pol - the policy
+//                resident - which OIDs are cached (updated)
+//                count - the number of OIDs cached (updated)
+//                oid - the block referenced
+// Outputs      : 0 if successful, -1 if the policy chose a bad victim
+
+static int policy_test_reference(const TaglinePolicy *pol, uint8_t *resident, uint32_t *count, uint32_t oid) {
+
+	uint32_t victim;
+
+	if (resident[oid]) {
+		pol->hit(oid);
+		return(0);
+	}
+	if (*count == policy_capacity) {
+		victim = pol->replace(oid);
+		if ((victim == TAGLINE_POLICY_NONE) || (victim == oid) || (! resident[victim])) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : policy evicted uncached block %u for %u", victim, oid);
+			return(-1);
+		}
+		resident[victim] = 0;
+		(*count)--;
+	}
+	pol->insert(oid);
+	resident[oid] = 1;
+	(*count)++;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : policy_test_queues
+// Description  : Check the queues are well formed, hold exactly the cached
+//                blocks in the resident queues and keep within the sizes
+//                the policy allows
+//
+// Inputs       : type - the policy
+//                resident - which OIDs are cached
+//                count - the number of OIDs cached
+// Outputs      : 0 if they are, -1 if not
+
+static int policy_test_queues(TaglinePolicyType type, uint8_t *resident, uint32_t count) {
+
+	uint32_t oid, prev, n, cached = 0, c = policy_capacity;
+	uint8_t q;
+
+	for (q = 1; q <= POLICY_QUEUES; q++) {
+		for (n = 0, prev = TAGLINE_POLICY_NONE, oid = queues[q].head; oid != TAGLINE_POLICY_NONE;
+				prev = oid, oid = oid_next[oid], n++) {
+			if ((n > POLICY_OIDS) || (oid_queue[oid] != q) || (oid_prev[oid] != prev)) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : policy queue %u broken at %u", q, oid);
+				return(-1);
+			}
+			if (q <= POLICY_CACHED) {
+				if (! resident[oid]) {
+					TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : policy queue %u holds uncached block %u", q, oid);
+					return(-1);
+				}
+				cached++;
+			} else if (resident[oid]) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : policy history %u holds cached block %u", q, oid);
+				return(-1);
+			}
+		}
+		if ((n != queues[q].size) || (prev != queues[q].tail)) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : policy queue %u size %u, walked %u", q, queues[q].size, n);
+			return(-1);
+		}
+	}
+	if (cached != count) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : policy queues hold %u blocks, %u cached", cached, count);
+		return(-1);
+	}
+	if (((type == TAGLINE_POLICY_2Q) && (queues[TWOQ_A1OUT].size > twoq_kout)) ||
+			((type == TAGLINE_POLICY_ARC) && ((arc_p > c) || (queues[ARC_T1].size + queues[ARC_B1].size > c) ||
+			(queues[ARC_T1].size + queues[ARC_T2].size + queues[ARC_B1].size + queues[ARC_B2].size > 2 * c)))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : %s policy history over its bounds", TAGLINE_POLICY_LABELS[type]);
+		return(-1);
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : policy_test_scan
+// Description  : Make a few blocks hot, scan many blocks once, and check the
+//                hot blocks are still cached (2Q and ARC resist scans)
+//
+// Inputs       : type - the policy
+//                resident - which OIDs are cached (updated)
+//                count - the number of OIDs cached (updated)
+// Outputs      : 0 if they are, -1 if not
+
+static int policy_test_scan(TaglinePolicyType type, uint8_t *resident, uint32_t *count) {
+
+	const TaglinePolicy *pol = &tagline_policies[type];
+	uint32_t oid;
+
+	// 2Q promotes a block re-referenced after leaving probation, ARC one
+	// referenced twice
+	for (oid = 0; oid < 4; oid++) {
+		if (policy_test_reference(pol, resident, count, oid)) {
+			return(-1);
+		}
+	}
+	for (oid = 100; oid < 100 + policy_capacity; oid++) {
+		if (policy_test_reference(pol, resident, count, oid)) {
+			return(-1);
+		}
+	}
+	for (oid = 0; oid < 4; oid++) {
+		if (policy_test_reference(pol, resident, count, oid) || policy_test_reference(pol, resident, count, oid)) {
+			return(-1);
+		}
+	}
+	for (oid = 1000; oid < 1000 + 8 * policy_capacity; oid++) {
+		if (policy_test_reference(pol, resident, count, oid)) {
+			return(-1);
+		}
+	}
+	for (oid = 0; oid < 4; oid++) {
+		if (! resident[oid]) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : %s policy let a scan evict hot block %u",
+					TAGLINE_POLICY_LABELS[type], oid);
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : policy_test_run
+// Description  : Start a policy on an empty cache and reference blocks in
+//                turn, checking the queues after each (and ARC's target of
+//                T1 against what is expected)
+//
+// Inputs       : type - the policy
+//                capacity - the size of the cache
+//                resident - which OIDs are cached (cleared first)
+//                oids - the blocks to reference (NULL for random ones)
+//                nrefs - the number of references
+//                arc_target - ARC's target after each reference (NULL, or
+//                             TAGLINE_POLICY_NONE for any)
+//                scan - then check hot blocks stay cached through a scan?
+// Outputs      : 0 if successful, -1 if failure
+
+static int policy_test_run(TaglinePolicyType type, uint32_t capacity, uint8_t *resident,
+		const uint32_t *oids, uint32_t nrefs, const uint32_t *arc_target, int scan) {
+
+	const TaglinePolicy *pol = &tagline_policies[type];
+	uint32_t count = 0, oid, i;
+	int failed = 0;
+
+	memset(resident, 0x0, POLICY_OIDS);
+	if (pol->init(capacity)) {
+		return(-1);
+	}
+	for (i = 0; (i < nrefs) && (! failed); i++) {
+
+		// random references go half to a hot set of half the cache and
+		// half over four times the cache, so history blocks come back
+		if (oids != NULL) {
+			oid = oids[i];
+		} else {
+			oid = (rand() % 2) ? rand() % (capacity / 2 + 1) : rand() % (4 * capacity);
+		}
+		failed = policy_test_reference(pol, resident, &count, oid) || policy_test_queues(type, resident, count);
+		if ((! failed) && (arc_target != NULL) && (arc_target[i] != TAGLINE_POLICY_NONE) && (arc_p != arc_target[i])) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : arc policy target %u after block %u, expected %u",
+					arc_p, oid, arc_target[i]);
+			failed = 1;
+		}
+	}
+	if ((! failed) && scan) {
+		failed = policy_test_scan(type, resident, &count) || policy_test_queues(type, resident, count);
+	}
+	pol->close();
+	return(failed ? -1 : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_policy_unit_test
+// Description  : Check LRU order, that ARC's target follows the ghost hits
+//                and that 2Q and ARC keep hot blocks through a scan, then
+//                drive every policy at several sizes with random
+//                references, checking the queues after each
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_policy_unit_test(void) {
+
+	// LRU: 1 is used longest ago when 4 comes in.  ARC: 0-3 are seen twice
+	// (T2), 10 evicts 0 to B2, 11 evicts 10 to B1; the B1 hit on 10 raises
+	// the target, the B2 hit on 0 lowers it again
+	static const uint32_t lru_oids[] = { 0, 1, 2, 3, 0, 4 };
+	static const uint32_t arc_oids[] = { 0, 1, 2, 3, 0, 1, 2, 3, 10, 11, 10, 0 };
+	static const uint32_t arc_targets[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0 };
+	static const uint32_t sizes[] = { 1, 7, 16, 64 };
+	uint8_t *resident;
+	uint32_t s;
+	int type, failed;
+
+	if ((resident = calloc(POLICY_OIDS, sizeof(uint8_t))) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate policy test map");
+		return(-1);
+	}
+	failed = policy_test_run(TAGLINE_POLICY_LRU, 4, resident, lru_oids, 6, NULL, 0) || resident[1] || (! resident[0]);
+	failed = failed || policy_test_run(TAGLINE_POLICY_ARC, 4, resident, arc_oids, 12, arc_targets, 0) ||
+			(! resident[0]) || resident[1] || resident[11];
+	failed = failed || policy_test_run(TAGLINE_POLICY_2Q, 16, resident, NULL, 0, NULL, 1) ||
+			policy_test_run(TAGLINE_POLICY_ARC, 16, resident, NULL, 0, NULL, 1);
+	for (type = 0; (type < TAGLINE_POLICY_MAXVAL) && (! failed); type++) {
+		for (s = 0; (s < sizeof(sizes) / sizeof(sizes[0])) && (! failed); s++) {
+			failed = policy_test_run(type, sizes[s], resident, NULL, POLICY_TESTS, NULL, 0);
+		}
+	}
+	free(resident);
+	if (failed) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : cache policy unit test failed");
+		return(-1);
+	}
+
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : cache policy unit test passed (%d references per policy and size)", POLICY_TESTS);
+	return(0);
+}
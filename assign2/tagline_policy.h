@@ -0,0 +1,54 @@
+#ifndef TAGLINE_POLICY_INCLUDED
+#define TAGLINE_POLICY_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_policy.h
+//  Description    : This is the header file for the replacement policies of
+//                   the tagline block cache.  A policy only sees block OIDs
+//                   (disk and RAID block), the cache itself holds the data.
+//
+
+// Includes
+#include <stdint.h>
+
+// Defines
+#define TAGLINE_POLICY_NONE UINT32_MAX  // no block (e.g., nothing to evict)
+
+//
+// Type definitions
+
+// The replacement policies available to the cache
+typedef enum {
+	TAGLINE_POLICY_LRU    = 0,  // least recently used
+	TAGLINE_POLICY_2Q     = 1,  // 2Q (FIFO probation queue, LRU main queue)
+	TAGLINE_POLICY_ARC    = 2,  // adaptive replacement cache
+	TAGLINE_POLICY_MAXVAL = 3,  // Max value
+} TaglinePolicyType;
+extern const char *TAGLINE_POLICY_LABELS[TAGLINE_POLICY_MAXVAL];
+
+// The operations a replacement policy provides to the cache
+typedef struct {
+	int      (*init)(uint32_t capacity);  // set up for a cache of capacity blocks
+	void     (*close)(void);              // release the policy state
+	void     (*hit)(uint32_t oid);        // a cached block was referenced
+	uint32_t (*replace)(uint32_t oid);    // cache is full, pick a block to evict for oid
+	void     (*insert)(uint32_t oid);     // oid is now cached
+} TaglinePolicy;
+
+//
+// Interface functions
+
+const TaglinePolicy *tagline_policy(TaglinePolicyType type);
+	// Get the operations for a replacement policy
+
+int tagline_policy_type(const char *label, TaglinePolicyType *type);
+	// Find a policy by its label (0 if found, -1 if not)
+
+//
+// Unit test
+
+int tagline_policy_unit_test(void);
+	// Check the policies' choices and queues against the cache they serve
+
+#endif /* TAGLINE_POLICY_INCLUDED */
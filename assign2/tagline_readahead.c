@@ -0,0 +1,457 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_readahead.c
+//  Description    : This is the implementation of the readahead of the
+//                   tagline driver.  A tagline read TAGLINE_READAHEAD_TRIGGER
+//                   times in a row from the block after the one its last
+//                   read ended at is a sequential stream: from then on each
+//                   read the window misses is fetched together with the
+//                   blocks after it, as few bus transfers as the tagline's
+//                   extents allow, into the window of the stream.
+//                   Each window reads twice as far ahead as the last when
+//                   that one was read to the end, and half as far when
+//                   less than half of it was read.  Called only from the
+//                   dispatcher, like the cache.
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_readahead.h"
+#include "tagline_driver.h"
+#include "tagline_log.h"
+
+//
+// Type definitions
+
+// A tagline being followed
+typedef struct {
+	int32_t  tag;      // the tagline (-1 if the stream is unused)
+	uint32_t next;     // the block a sequential read starts at
+	uint32_t run;      // the sequential reads in a row
+	uint32_t ahead;    // the blocks the next window reads ahead (0 until sequential)
+	uint32_t start;    // the first block in the window
+	uint32_t count;    // the blocks in the window (0 if empty)
+	uint32_t used;     // the blocks of the window read, from its start
+	int      filling;  // is the window being read from the bus?
+	uint64_t last;     // when the stream was last read (the oldest is reused)
+	char    *buf;      // the blocks of the window
+} TaglineReadaheadStream;
+
+// A read of the unit test and the window it should read
+typedef struct {
+	uint32_t lblock;  // the block read (one at a time)
+	uint32_t window;  // the blocks the window reads (0 if none)
+} TaglineReadaheadTestRead;
+
+//
+// Global data
+
+static uint32_t readahead_size = TAGLINE_DEFAULT_READAHEAD;  // most blocks read ahead for the next init
+static uint32_t readahead_max = 0;                           // most blocks read ahead (0 is off)
+static TaglineReadaheadStream ra_streams[TAGLINE_READAHEAD_STREAMS];  // the taglines followed
+static uint64_t ra_clock = 0;                                // counts the reads of streams
+static TaglineReadaheadStats ra_stats;                       // the readahead counters
+
+// The reads of the unit test (16 blocks ahead at most): a stream starts on
+// the third sequential read and its windows double as they are read to the
+// end; a jump after a window barely read halves the next window, and below
+// TAGLINE_READAHEAD_MIN the stream has to start over
+static const TaglineReadaheadTestRead ra_test_reads[] = {
+	{ 0, 0 }, { 1, 0 }, { 2, 5 }, { 7, 9 }, { 16, 17 }, { 33, 17 }, { 50, 17 },
+	{ 100, 0 }, { 101, 9 }, { 0, 0 }, { 1, 5 }, { 50, 0 }, { 51, 0 }, { 52, 5 },
+};
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : set_tagline_readahead
+// Description  : Set the most blocks read ahead by the next init
+//
+// Inputs       : blocks - the most blocks read ahead (0 disables)
+// Outputs      : 0 if successful, -1 if failure
+
+int set_tagline_readahead(uint32_t blocks) {
+	if ((blocks > 0) && ((blocks < TAGLINE_READAHEAD_MIN) || (blocks >= MAX_TAGLINE_BLOCK_NUMBER))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : bad readahead %u (%u to %u blocks)", blocks,
+				TAGLINE_READAHEAD_MIN, MAX_TAGLINE_BLOCK_NUMBER - 1);
+		return(-1);
+	}
+	readahead_size = blocks;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readahead_init
+// Description  : Start following streams, with none known (the windows are
+//                allocated as streams are found)
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_readahead_init(void) {
+
+	uint32_t s;
+
+	memset(&ra_stats, 0x0, sizeof(ra_stats));
+	memset(ra_streams, 0x0, sizeof(ra_streams));
+	for (s = 0; s < TAGLINE_READAHEAD_STREAMS; s++) {
+		ra_streams[s].tag = -1;
+	}
+	ra_clock = 0;
+	readahead_max = readahead_size;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readahead_drop
+// Description  : Empty the window of a stream, counting what was not read
+//
+// Inputs       : st - the stream
+// Outputs      : none
+
+static void tagline_readahead_drop(TaglineReadaheadStream *st) {
+	if (st->count > st->used) {
+		ra_stats.wasted += st->count - st->used;
+	}
+	st->count = st->used = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readahead_close
+// Description  : Forget the streams and release their windows
+//
+// Inputs       : none
+// Outputs      : none
+
+void tagline_readahead_close(void) {
+
+	uint32_t s;
+
+	for (s = 0; s < TAGLINE_READAHEAD_STREAMS; s++) {
+		tagline_readahead_drop(&ra_streams[s]);
+		free(ra_streams[s].buf);
+		ra_streams[s].buf = NULL;
+		ra_streams[s].tag = -1;
+	}
+	readahead_max = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readahead_enabled
+// Description  : Is the driver reading ahead?
+//
+// Inputs       : none
+// Outputs      : 1 if reading ahead, 0 if not
+
+int tagline_readahead_enabled(void) {
+	return(readahead_max > 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readahead_stream
+// Description  : Find the stream following a tagline
+//
+// Inputs       : tag - the tagline
+// Outputs      : the stream, NULL if the tagline is not followed
+
+static TaglineReadaheadStream *tagline_readahead_stream(uint16_t tag) {
+
+	uint32_t s;
+
+	for (s = 0; s < TAGLINE_READAHEAD_STREAMS; s++) {
+		if (ra_streams[s].tag == tag) {
+			return(&ra_streams[s]);
+		}
+	}
+	return(NULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readahead_hit
+// Description  : Take the leading blocks of a read from the window of its
+//                tagline; a window still being read is not used
+//
+// Inputs       : tag - the tagline read
+//                lblock - the first block of the read
+//                count - the blocks of the read
+//                mem - the window memory of the first block (returned)
+// Outputs      : the leading blocks found in the window (0 if none)
+
+uint32_t tagline_readahead_hit(uint16_t tag, uint32_t lblock, uint32_t count, char **mem) {
+
+	TaglineReadaheadStream *st;
+	uint32_t found;
+
+	if ((readahead_max == 0) || ((st = tagline_readahead_stream(tag)) == NULL) || st->filling ||
+			(lblock < st->start) || (lblock >= st->start + st->count)) {
+		return(0);
+	}
+	found = st->start + st->count - lblock;
+	if (found > count) {
+		found = count;
+	}
+	*mem = &st->buf[(lblock - st->start) * TAGLINE_BLOCK_SIZE];
+	if (lblock + found - st->start > st->used) {
+		st->used = lblock + found - st->start;
+	}
+	st->next = lblock + found;
+	st->last = ++ra_clock;
+	ra_stats.hits += found;
+	return(found);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readahead_window
+// Description  : Note a read the window of its tagline missed.  If the read
+//                carries on a sequential stream, its blocks and the ones
+//                after are to be read into the window (which is then being
+//                filled until tagline_readahead_filled); a tagline not yet
+//                followed takes the stream read longest ago.
+//
+// Inputs       : tag - the tagline read
+//                lblock - the first block of the read
+//                count - the blocks of the read
+//                limit - the blocks from lblock on that can be read (mapped)
+//                mem - the window to read the blocks into (returned)
+// Outputs      : the blocks to read into the window, 0 to read as usual
+
+uint32_t tagline_readahead_window(uint16_t tag, uint32_t lblock, uint32_t count, uint32_t limit, char **mem) {
+
+	TaglineReadaheadStream *st;
+	uint32_t s, want;
+
+	if (readahead_max == 0) {
+		return(0);
+	}
+
+	// start following the tagline in the stream read longest ago
+	if ((st = tagline_readahead_stream(tag)) == NULL) {
+		for (s = 0; s < TAGLINE_READAHEAD_STREAMS; s++) {
+			if ((! ra_streams[s].filling) && ((st == NULL) || (ra_streams[s].last < st->last))) {
+				st = &ra_streams[s];
+			}
+		}
+		if (st == NULL) {
+			return(0);
+		}
+		tagline_readahead_drop(st);
+		st->tag = tag;
+		st->ahead = st->run = 0;
+		st->next = lblock + count;
+		st->last = ++ra_clock;
+		return(0);
+	}
+	if (st->filling) {
+		return(0);
+	}
+	st->run = (lblock == st->next) ? st->run + 1 : 0;
+	st->next = lblock + count;
+	st->last = ++ra_clock;
+
+	// size the next window by how much of the last one was read
+	if (st->count > 0) {
+		if (st->used >= st->count) {
+			st->ahead = (st->ahead * 2 < readahead_max) ? st->ahead * 2 : readahead_max;
+		} else if (st->used < st->count / 2) {
+			st->ahead /= 2;
+		}
+		tagline_readahead_drop(st);
+	}
+	if (st->ahead < TAGLINE_READAHEAD_MIN) {
+		st->ahead = 0;
+	}
+	if ((st->run == 0) || ((st->ahead == 0) && (st->run < TAGLINE_READAHEAD_TRIGGER))) {
+		return(0);
+	}
+	if (st->ahead == 0) {
+		st->ahead = TAGLINE_READAHEAD_MIN;
+		ra_stats.streams++;
+	}
+
+	// read the blocks asked for and as many of the ones after as there are
+	want = (count + st->ahead < limit) ? count + st->ahead : limit;
+	if (want <= count) {
+		return(0);
+	}
+	if ((st->buf == NULL) && ((st->buf = malloc(MAX_TAGLINE_BLOCK_NUMBER * TAGLINE_BLOCK_SIZE)) == NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate readahead window");
+		return(0);
+	}
+	st->start = lblock;
+	st->count = want;
+	st->used = count;
+	st->filling = 1;
+	ra_stats.windows++;
+	ra_stats.prefetched += want - count;
+	if (want - count > ra_stats.largest) {
+		ra_stats.largest = want - count;
+	}
+	*mem = st->buf;
+	return(want);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readahead_filled
+// Description  : Finish reading the window of a tagline; a window that
+//                could not be read is dropped and the stream starts over
+//
+// Inputs       : tag - the tagline
+//                failed - did reading the window fail?
+// Outputs      : none
+
+void tagline_readahead_filled(uint16_t tag, int failed) {
+
+	TaglineReadaheadStream *st = tagline_readahead_stream(tag);
+
+	if ((st == NULL) || (! st->filling)) {
+		return;
+	}
+	st->filling = 0;
+	if (failed) {
+		st->count = st->used = 0;
+		st->ahead = st->run = 0;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readahead_forget
+// Description  : Drop the window of a tagline if blocks in it are changing;
+//                a deleted tagline is no longer followed.  The driver holds
+//                the update back until the reads of the tagline finish,
+//                so the window is never being filled here.
+//
+// Inputs       : tag - the tagline written or deleted
+//                lblock - the first block written
+//                count - the blocks written
+//                removed - was the tagline deleted?
+// Outputs      : none
+
+void tagline_readahead_forget(uint16_t tag, uint32_t lblock, uint32_t count, int removed) {
+
+	TaglineReadaheadStream *st;
+
+	if ((readahead_max == 0) || ((st = tagline_readahead_stream(tag)) == NULL)) {
+		return;
+	}
+	if (removed || ((lblock < st->start + st->count) && (lblock + count > st->start))) {
+		tagline_readahead_drop(st);
+	}
+	if (removed) {
+		st->tag = -1;
+		st->ahead = st->run = 0;
+		st->last = 0;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readahead_stats
+// Description  : Get the counters for the readahead
+//
+// Inputs       : stats - the counters (returned)
+// Outputs      : none
+
+void tagline_readahead_stats(TaglineReadaheadStats *stats) {
+	*stats = ra_stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readahead_test_read
+// Description  : Read a block of a unit test tagline the way the driver
+//                does: from the window if it has it, otherwise noting the
+//                miss and filling the window it asks for
+//
+// Inputs       : tag - the tagline read
+//                lblock - the block read
+// Outputs      : the blocks the window read (0 if none)
+
+static uint32_t tagline_readahead_test_read(uint16_t tag, uint32_t lblock) {
+
+	uint32_t window;
+	char *mem;
+
+	if (tagline_readahead_hit(tag, lblock, 1, &mem) == 1) {
+		return(0);
+	}
+	window = tagline_readahead_window(tag, lblock, 1, MAX_TAGLINE_BLOCK_NUMBER - lblock, &mem);
+	if (window > 0) {
+		tagline_readahead_filled(tag, 0);
+	}
+	return(window);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_readahead_unit_test
+// Description  : Read a tagline sequentially, then jump about it, checking
+//                the window read for each miss (see ra_test_reads); then
+//                check that a write into the window drops it and a delete
+//                ends the stream, and that the counters add up
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_readahead_unit_test(void) {
+
+	uint32_t size = readahead_size, r, b, window;
+	const TaglineReadaheadTestRead *rd;
+	int failed = 0;
+	char *mem;
+
+	set_tagline_readahead(16);
+	tagline_readahead_init();
+
+	// The reads of the table miss the windows before them; a read starting
+	// where the window before ends has the blocks of that window read first
+	for (r = 0; (r < sizeof(ra_test_reads) / sizeof(TaglineReadaheadTestRead)) && (! failed); r++) {
+		rd = &ra_test_reads[r];
+		if ((r > 0) && (rd[-1].window > 0) && (rd->lblock == rd[-1].lblock + rd[-1].window)) {
+			for (b = rd[-1].lblock + 1; (b < rd->lblock) && (! failed); b++) {
+				failed = (tagline_readahead_test_read(7, b) != 0);
+			}
+		}
+		if ((window = tagline_readahead_test_read(7, rd->lblock)) != rd->window) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : readahead of block %u read %u blocks, expected %u",
+					rd->lblock, window, rd->window);
+			failed = 1;
+		}
+	}
+
+	// A write into the window [52,57) drops it, the stream carries on;
+	// a delete ends the stream, which then has to start over
+	tagline_readahead_forget(7, 55, 1, 0);
+	failed = failed || (tagline_readahead_hit(7, 53, 1, &mem) != 0) || (tagline_readahead_test_read(7, 53) != 5);
+	tagline_readahead_forget(7, 0, 0, 1);
+	failed = failed || (tagline_readahead_hit(7, 54, 1, &mem) != 0) || (tagline_readahead_test_read(7, 54) != 0) ||
+			(tagline_readahead_test_read(7, 55) != 0) || (tagline_readahead_test_read(7, 56) != 5);
+
+	// 3 streams and 10 windows; the blocks dropped unread are the windows
+	// left by the jumps, the write and the delete
+	failed = failed || (ra_stats.streams != 3) || (ra_stats.windows != 10) || (ra_stats.largest != 16) ||
+			(ra_stats.wasted != 16 + 8 + 4 + 4 + 4) || (ra_stats.hits != ra_stats.prefetched - ra_stats.wasted - 4);
+	tagline_readahead_close();
+	readahead_size = size;
+	if (failed) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : readahead unit test failed");
+		return(-1);
+	}
+
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : readahead unit test passed (%lu windows)", ra_stats.windows);
+	return(0);
+}
@@ -0,0 +1,72 @@
+#ifndef TAGLINE_READAHEAD_INCLUDED
+#define TAGLINE_READAHEAD_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_readahead.h
+//  Description    : This is the header file for the readahead of the
+//                   tagline driver: it follows the taglines being read
+//                   sequentially and reads the blocks after a read into a
+//                   window, so the reads that follow take no bus transfer.
+//
+
+// Includes
+#include <stdint.h>
+#include "raid_bus.h"
+
+// Defines
+#define TAGLINE_READAHEAD_STREAMS 32                 // the taglines followed at once
+#define TAGLINE_READAHEAD_TRIGGER 2                  // the sequential reads in a row that start a stream
+#define TAGLINE_READAHEAD_MIN     4                  // the blocks read ahead when a stream starts
+#define TAGLINE_DEFAULT_READAHEAD RAID_TRACK_BLOCKS  // the most blocks read ahead by default
+
+//
+// Type definitions
+
+// Counters describing how useful the readahead was
+typedef struct {
+	uint64_t streams;     // sequential streams detected
+	uint64_t windows;     // windows read
+	uint64_t prefetched;  // blocks read ahead of the reads asking for them
+	uint64_t hits;        // blocks of reads taken from a window
+	uint64_t wasted;      // blocks read ahead but dropped unread
+	uint32_t largest;     // the most blocks read ahead at once
+} TaglineReadaheadStats;
+
+//
+// Interface functions
+
+int set_tagline_readahead(uint32_t blocks);
+	// Set the most blocks read ahead by the next tagline_readahead_init, 0 disables
+
+int tagline_readahead_init(void);
+	// Start following streams, with none known
+
+void tagline_readahead_close(void);
+	// Forget the streams and release their windows
+
+int tagline_readahead_enabled(void);
+	// Is the driver reading ahead?
+
+uint32_t tagline_readahead_hit(uint16_t tag, uint32_t lblock, uint32_t count, char **mem);
+	// Take the leading blocks of a read from the window of its tagline (0 if none)
+
+uint32_t tagline_readahead_window(uint16_t tag, uint32_t lblock, uint32_t count, uint32_t limit, char **mem);
+	// Note a read the window missed, getting a window to read it and the blocks after into (0 if not sequential)
+
+void tagline_readahead_filled(uint16_t tag, int failed);
+	// Finish reading the window of a tagline
+
+void tagline_readahead_forget(uint16_t tag, uint32_t lblock, uint32_t count, int removed);
+	// Drop the window of a tagline if blocks of it are written, and the stream of one deleted
+
+void tagline_readahead_stats(TaglineReadaheadStats *stats);
+	// Get the counters for the readahead
+
+//
+// Unit test
+
+int tagline_readahead_unit_test(void);
+	// Follow a stream as it is read and jumped about, checking each window
+
+#endif /* TAGLINE_READAHEAD_INCLUDED */
@@ -0,0 +1,336 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_segment.c
+//  Description    : This is the implementation of the segment log.  The
+//                   disks are cut into track-sized segments; the log head
+//                   is one open segment, taken whole from the free-space
+//                   manager and filled front to back.  Each block records
+//                   the tagline block stored in it, so the cleaner can find
+//                   and move the live blocks of a segment, and each segment
+//                   counts its live blocks.  A dead block goes back to the
+//                   free space at once; a segment is free again when all of
+//                   its blocks are.
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_segment.h"
+#include "tagline_alloc.h"
+#include "tagline_log.h"
+
+// Defines
+#define TAGLINE_SEGMENT_DEAD UINT32_MAX  // the owner of a block holding nothing
+#define TAGLINE_SEGMENT_OWNER(tag, lblock) (((uint32_t)(tag) << 8) | (lblock))
+
+//
+// Global data
+
+static uint32_t *seg_owner = NULL;    // the tagline block in each block (or TAGLINE_SEGMENT_DEAD)
+static uint8_t *seg_live = NULL;      // the live blocks of each segment
+static uint32_t seg_disks = 0;        // the number of disks
+static uint32_t seg_blocks = 0;       // the blocks per disk
+static uint32_t seg_count = 0;        // the number of segments
+static int32_t seg_open = -1;         // the open segment (-1 if there is none)
+static uint32_t seg_next = 0;         // the next block of the open segment to append
+static TaglineSegmentStats seg_stats; // the segment counters
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_segment_index
+// Description  : Find the segment holding a block
+//
+// Inputs       : disk - the disk of the block
+//                rblock - the block
+// Outputs      : the segment number
+
+static uint32_t tagline_segment_index(RAIDDiskID disk, RAIDBlockID rblock) {
+	return(disk * (seg_blocks / TAGLINE_SEGMENT_BLOCKS) + rblock / TAGLINE_SEGMENT_BLOCKS);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_segment_init
+// Description  : Create the segment log with every block dead and no open
+//                segment; the caller then owns the blocks of the taglines
+//                it keeps
+//
+// Inputs       : disks - the number of disks
+//                blocks - the blocks per disk (a multiple of a segment)
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_segment_init(uint32_t disks, uint32_t blocks) {
+
+	tagline_segment_close();
+	if ((blocks == 0) || (blocks % TAGLINE_SEGMENT_BLOCKS)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : disks of %u blocks do not hold whole segments", blocks);
+		return(-1);
+	}
+	seg_count = disks * (blocks / TAGLINE_SEGMENT_BLOCKS);
+	if (((seg_owner = malloc((size_t)disks * blocks * sizeof(uint32_t))) == NULL) ||
+			((seg_live = calloc(seg_count, sizeof(uint8_t))) == NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate segment log (%ux%u)", disks, blocks);
+		tagline_segment_close();
+		return(-1);
+	}
+	memset(seg_owner, 0xff, (size_t)disks * blocks * sizeof(uint32_t));
+	seg_disks = disks;
+	seg_blocks = blocks;
+	seg_open = -1;
+	seg_next = 0;
+	memset(&seg_stats, 0x0, sizeof(seg_stats));
+	seg_stats.segments = seg_count;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_segment_close
+// Description  : Give the unwritten end of the open segment back to the
+//                free space and release the segment log
+//
+// Inputs       : none
+// Outputs      : none
+
+void tagline_segment_close(void) {
+	if ((seg_open != -1) && (seg_next < TAGLINE_SEGMENT_BLOCKS)) {
+		tagline_alloc_free(seg_open / (seg_blocks / TAGLINE_SEGMENT_BLOCKS),
+				(seg_open % (seg_blocks / TAGLINE_SEGMENT_BLOCKS)) * TAGLINE_SEGMENT_BLOCKS + seg_next,
+				TAGLINE_SEGMENT_BLOCKS - seg_next);
+	}
+	free(seg_owner);
+	free(seg_live);
+	seg_owner = NULL;
+	seg_live = NULL;
+	seg_disks = seg_blocks = seg_count = 0;
+	seg_open = -1;
+	seg_next = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_segment_append
+// Description  : Take blocks at the head of the log, opening a new segment
+//                when the open one is full.  The blocks run to the end of
+//                the open segment at most; the caller appends the rest.
+//
+// Inputs       : want - the number of blocks wanted
+//                disk - the disk of the blocks (returned)
+//                rblock - the first block (returned)
+// Outputs      : the number of blocks taken (0 if there is no free segment)
+
+uint32_t tagline_segment_append(uint32_t want, RAIDDiskID *disk, RAIDBlockID *rblock) {
+
+	uint32_t per_disk = seg_blocks / TAGLINE_SEGMENT_BLOCKS, count;
+	RAIDDiskID sdisk;
+	RAIDBlockID sblock;
+
+	if ((seg_owner == NULL) || (want == 0)) {
+		return(0);
+	}
+
+	// open a segment, taking it whole from the free space
+	if (seg_open == -1) {
+		if (tagline_alloc_aligned(TAGLINE_SEGMENT_BLOCKS, &sdisk, &sblock)) {
+			return(0);
+		}
+		seg_open = tagline_segment_index(sdisk, sblock);
+		seg_next = 0;
+		seg_stats.in_use++;
+	}
+
+	count = TAGLINE_SEGMENT_BLOCKS - seg_next;
+	if (count > want) {
+		count = want;
+	}
+	*disk = seg_open / per_disk;
+	*rblock = (seg_open % per_disk) * TAGLINE_SEGMENT_BLOCKS + seg_next;
+	seg_next += count;
+	seg_stats.appended += count;
+
+	// a full segment is closed; it may already be all dead
+	if (seg_next == TAGLINE_SEGMENT_BLOCKS) {
+		if (seg_live[seg_open] == 0) {
+			seg_stats.in_use--;
+		}
+		seg_open = -1;
+	}
+	return(count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_segment_own
+// Description  : Record the tagline blocks stored in a run of blocks,
+//                making them live
+//
+// Inputs       : disk - the disk of the run
+//                rblock - the first block of the run
+//                count - the number of blocks
+//                tag - the tagline stored in them
+//                lblock - the first tagline block stored in them
+// Outputs      : none
+
+void tagline_segment_own(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, TagLineNumber tag, uint32_t lblock) {
+
+	uint32_t blk, seg;
+	size_t at;
+
+	if ((disk >= seg_disks) || (rblock + count > seg_blocks)) {
+		return;
+	}
+	for (blk = 0; blk < count; blk++) {
+		at = (size_t)disk * seg_blocks + rblock + blk;
+		if (seg_owner[at] == TAGLINE_SEGMENT_DEAD) {
+			seg = tagline_segment_index(disk, rblock + blk);
+			if ((seg_live[seg]++ == 0) && (seg != seg_open)) {
+				seg_stats.in_use++;
+			}
+		}
+		seg_owner[at] = TAGLINE_SEGMENT_OWNER(tag, lblock + blk);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_segment_release
+// Description  : Mark blocks dead (overwritten elsewhere or deleted) and
+//                give them back to the free space
+//
+// Inputs       : disk - the disk of the blocks
+//                rblock - the first block
+//                count - the number of blocks
+// Outputs      : none
+
+void tagline_segment_release(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count) {
+
+	uint32_t blk, seg;
+	size_t at;
+
+	if ((disk >= seg_disks) || (rblock + count > seg_blocks)) {
+		return;
+	}
+	for (blk = 0; blk < count; blk++) {
+		at = (size_t)disk * seg_blocks + rblock + blk;
+		if (seg_owner[at] != TAGLINE_SEGMENT_DEAD) {
+			seg_owner[at] = TAGLINE_SEGMENT_DEAD;
+			seg = tagline_segment_index(disk, rblock + blk);
+			if ((--seg_live[seg] == 0) && (seg != seg_open)) {
+				seg_stats.in_use--;
+			}
+		}
+	}
+	tagline_alloc_free(disk, rblock, count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_segment_owner
+// Description  : Find the tagline block stored in a block
+//
+// Inputs       : disk - the disk of the block
+//                rblock - the block
+//                tag - the tagline (returned)
+//                lblock - the tagline block (returned)
+// Outputs      : 1 if the block is live, 0 if it is dead
+
+int tagline_segment_owner(RAIDDiskID disk, RAIDBlockID rblock, TagLineNumber *tag, uint32_t *lblock) {
+
+	uint32_t owner;
+
+	if ((disk >= seg_disks) || (rblock >= seg_blocks)) {
+		return(0);
+	}
+	owner = seg_owner[(size_t)disk * seg_blocks + rblock];
+	if (owner == TAGLINE_SEGMENT_DEAD) {
+		return(0);
+	}
+	*tag = owner >> 8;
+	*lblock = owner & 0xff;
+	return(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_segment_victim
+// Description  : Pick the segment to clean: the closed segment in use with
+//                the fewest live blocks (greedy), if it has room to gain
+//                and its live blocks fit in the free space of the log
+//
+// Inputs       : max_live - the most live blocks the segment may hold
+//                disk - the disk of the segment (returned)
+//                rblock - the first block of the segment (returned)
+// Outputs      : 0 if a segment was picked, -1 if none qualifies
+
+int tagline_segment_victim(uint32_t max_live, RAIDDiskID *disk, RAIDBlockID *rblock) {
+
+	uint32_t per_disk = seg_blocks / TAGLINE_SEGMENT_BLOCKS, seg, best = seg_count, room;
+
+	// the blocks left in the open segment and the free ones
+	room = (seg_count - seg_stats.in_use) * TAGLINE_SEGMENT_BLOCKS;
+	if (seg_open != -1) {
+		room += TAGLINE_SEGMENT_BLOCKS - seg_next;
+	}
+	if (max_live > room) {
+		max_live = room;
+	}
+	if (max_live >= TAGLINE_SEGMENT_BLOCKS) {
+		max_live = TAGLINE_SEGMENT_BLOCKS - 1;
+	}
+	for (seg = 0; seg < seg_count; seg++) {
+		if ((seg_live[seg] > 0) && (seg_live[seg] <= max_live) && (seg != seg_open) &&
+				((best == seg_count) || (seg_live[seg] < seg_live[best]))) {
+			best = seg;
+		}
+	}
+	if (best == seg_count) {
+		return(-1);
+	}
+	*disk = best / per_disk;
+	*rblock = (best % per_disk) * TAGLINE_SEGMENT_BLOCKS;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_segment_cleaned
+// Description  : Count a segment the cleaner emptied
+//
+// Inputs       : moved - the live blocks it moved to the log head
+// Outputs      : none
+
+void tagline_segment_cleaned(uint32_t moved) {
+	seg_stats.cleaned++;
+	seg_stats.moved += moved;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_segment_free
+// Description  : Get the number of segments with no live blocks (other
+//                than the open one)
+//
+// Inputs       : none
+// Outputs      : the number of free segments
+
+uint32_t tagline_segment_free(void) {
+	return(seg_count - seg_stats.in_use);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_segment_stats
+// Description  : Get the counters for the segment log
+//
+// Inputs       : stats - the counters (returned)
+// Outputs      : none
+
+void tagline_segment_stats(TaglineSegmentStats *stats) {
+	*stats = seg_stats;
+}
@@ -0,0 +1,70 @@
+#ifndef TAGLINE_SEGMENT_INCLUDED
+#define TAGLINE_SEGMENT_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_segment.h
+//  Description    : This is the header file for the segment log used by the
+//                   log-structured write path: writes append to an open
+//                   track-sized segment and a cleaner compacts segments
+//                   that are mostly dead.
+//
+
+// Includes
+#include <stdint.h>
+#include "raid_bus.h"
+
+// Project Includes
+#include "tagline_driver.h"
+
+// Defines
+#define TAGLINE_SEGMENT_BLOCKS     RAID_TRACK_BLOCKS            // blocks per segment
+#define TAGLINE_SEGMENT_RESERVE    4                            // free segments kept for writes
+#define TAGLINE_SEGMENT_CLEAN_LIVE (TAGLINE_SEGMENT_BLOCKS / 4) // live blocks of a segment cleaned when idle
+
+//
+// Type definitions
+
+// Counters describing the segment log
+typedef struct {
+	uint32_t segments;  // the segments of the array
+	uint32_t in_use;    // the segments open or holding live blocks
+	uint64_t appended;  // the blocks appended to the log
+	uint64_t cleaned;   // the segments cleaned
+	uint64_t moved;     // the live blocks moved by the cleaner
+} TaglineSegmentStats;
+
+//
+// Interface functions
+
+int tagline_segment_init(uint32_t disks, uint32_t blocks);
+	// Start with no live blocks and no open segment
+
+void tagline_segment_close(void);
+	// Give back the unwritten end of the open segment and release the log
+
+uint32_t tagline_segment_append(uint32_t want, RAIDDiskID *disk, RAIDBlockID *rblock);
+	// Take up to want blocks at the head of the log, returning how many (0 if full)
+
+void tagline_segment_own(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, TagLineNumber tag, uint32_t lblock);
+	// Record the tagline blocks now stored in a run of blocks
+
+void tagline_segment_release(RAIDDiskID disk, RAIDBlockID rblock, uint32_t count);
+	// Mark blocks dead, freeing them (and their segment once it is all dead)
+
+int tagline_segment_owner(RAIDDiskID disk, RAIDBlockID rblock, TagLineNumber *tag, uint32_t *lblock);
+	// Find the tagline block stored in a block (1 if it is live, 0 if not)
+
+int tagline_segment_victim(uint32_t max_live, RAIDDiskID *disk, RAIDBlockID *rblock);
+	// Pick the closed segment with the fewest live blocks, at most max_live (-1 if none)
+
+void tagline_segment_cleaned(uint32_t moved);
+	// Count a cleaned segment and the live blocks it moved
+
+uint32_t tagline_segment_free(void);
+	// Get the number of free segments
+
+void tagline_segment_stats(TaglineSegmentStats *stats);
+	// Get the counters for the segment log
+
+#endif /* TAGLINE_SEGMENT_INCLUDED */
@@ -0,0 +1,326 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File          : tagline_server.c
+//  Description   : This is the RAID bus server: it hosts the array (on any
+//                  local bus backend) in its own process and serves the
+//                  net backend of the driver over a socket, one client at
+//                  a time (see tagline_net.h for the protocol).  Stores
+//                  are saved in the server's directory (clients can only
+//                  name files in it), so a driver keeping a metadata image
+//                  (-k) should run beside it.  There is no authentication:
+//                  the server listens on the loopback address unless told
+//                  otherwise.
+//
+
+// Include Files
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+// Project Includes
+#include <cmpsc311_log.h>
+#include "tagline_bus.h"
+#include "tagline_net.h"
+#include "tagline_log.h"
+
+// Defines
+#define SERVER_ARGUMENTS "hvl:a:p:B:"
+#define USAGE \
+	"USAGE: tagline_server [-h] [-v] [-l <logfile>] [-a <address>] [-p <port>] [-B <backend>]\n" \
+	"\n" \
+	"where:\n" \
+	"    -h - help mode (display this message)\n" \
+	"    -v - verbose output\n" \
+	"    -l - write log messages to the filename <logfile>\n" \
+	"    -a - listen on <address> (default 127.0.0.1; anyone who can reach\n" \
+	"         it can use the array)\n" \
+	"    -p - listen on <port> (default 22887)\n" \
+	"    -B - host the array on <backend>: lib (the RAID library, the\n" \
+	"         default), file[:<path>] or model[:<seek>:<track>:<block>]\n" \
+	"\n" \
+	"    Clients connect with tagline_sim -B net[:<host>[:<port>]].\n" \
+	"\n" \
+
+//
+// Functional Prototypes
+
+int serve_listen(const char *address, uint16_t port);
+int serve_store_name(const char *path);
+int serve_client(int sock, uint64_t *frame, char *in);
+int serve_frames(int sock, uint64_t *frame, char *in, int *opened);
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : main
+// Description  : The main function for the RAID bus server
+//
+// Inputs       : argc - the number of command line parameters
+//                argv - the parameters
+// Outputs      : 0 if successful, -1 if failure
+
+int main(int argc, char *argv[]) {
+
+	// Local variables
+	int ch, verbose = 0, log_initialized = 0, server, sock;
+	const char *address = TAGLINE_NET_HOST;
+	uint16_t port = TAGLINE_NET_PORT;
+	uint64_t *frame;
+	char *in;
+
+	// Process the command line parameters
+	while ((ch = getopt(argc, argv, SERVER_ARGUMENTS)) != -1) {
+
+		switch (ch) {
+		case 'h': // Help, print usage
+			fprintf(stderr, USAGE);
+			return( -1 );
+
+		case 'v': // Verbose Flag
+			verbose = 1;
+			break;
+
+		case 'l': // Set the log filename
+			initializeLogWithFilename(optarg);
+			log_initialized = 1;
+			break;
+
+		case 'a': // Set the address to listen on
+			address = optarg;
+			break;
+
+		case 'p': // Set the port
+			if ((atoi(optarg) <= 0) || (atoi(optarg) > UINT16_MAX)) {
+				fprintf(stderr, "Bad port [%s], aborting.\n", optarg);
+				return( -1 );
+			}
+			port = atoi(optarg);
+			break;
+
+		case 'B': // Choose the backend hosting the array
+			if ((strncmp(optarg, "net", 3) == 0) || tagline_bus_select(optarg)) {
+				fprintf(stderr, "Bad RAID bus backend [%s], aborting.\n", optarg);
+				return( -1 );
+			}
+			break;
+
+		default:  // Default (unknown)
+			fprintf(stderr, "Unknown command line option (%c), aborting.\n", ch);
+			return( -1 );
+		}
+	}
+
+	// Setup the log as needed
+	if (! log_initialized) {
+		initializeLogWithFilehandle(CMPSC311_LOG_STDERR);
+	}
+	if (verbose) {
+		tagline_log_enable(LOG_INFO_LEVEL);
+	}
+	if (optind != argc) {
+		fprintf( stderr, "Unexpected command line parameters, use -h to see usage, aborting.\n" );
+		return( -1 );
+	}
+
+	// The frame answered (header, opcodes, blocks read) and the frame asked
+	// (opcodes, blocks written)
+	frame = malloc(sizeof(uint64_t) * (1 + TAGLINE_NET_BATCH) + TAGLINE_NET_MAX_PAYLOAD);
+	in = malloc(sizeof(uint64_t) * TAGLINE_NET_BATCH + TAGLINE_NET_MAX_PAYLOAD);
+	if ((frame == NULL) || (in == NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "Unable to allocate frame buffers, aborting.");
+		return( -1 );
+	}
+
+	// Serve the clients in turn
+	if ((server = serve_listen(address, port)) == -1) {
+		return( -1 );
+	}
+	TAGLINE_LOG(LOG_OUTPUT_LEVEL, "RAID bus server on %s port %u, array on %s", address, port,
+			tagline_bus_backend()->name);
+	while (1) {
+		if ((sock = cmpsc311_accept_connection(server)) == -1) {
+			continue;
+		}
+		if (serve_client(sock, frame, in)) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "RAID bus client dropped after an error");
+		}
+		cmpsc311_close(sock);
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : serve_listen
+// Description  : Listen for clients on an address and port
+//
+// Inputs       : address - the IPv4 address to listen on
+//                port - the port to listen on
+// Outputs      : the listening socket, -1 if failure
+
+int serve_listen(const char *address, uint16_t port) {
+
+	struct sockaddr_in sin;
+	int sock, one = 1;
+
+	memset(&sin, 0x0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(port);
+	if (inet_pton(AF_INET, address, &sin.sin_addr) != 1) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "Bad address to listen on [%s]", address);
+		return(-1);
+	}
+	if ((sock = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "Unable to create socket, error: %s", strerror(errno));
+		return(-1);
+	}
+	setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(sock, (struct sockaddr *)&sin, sizeof(sin)) || listen(sock, 5)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "Unable to listen on %s port %u, error: %s", address, port, strerror(errno));
+		close(sock);
+		return(-1);
+	}
+	return(sock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : serve_store_name
+// Description  : Check a store a client asks to save is a plain file name
+//                in the server's directory
+//
+// Inputs       : path - the store file
+// Outputs      : 0 if it can be saved, -1 if not
+
+int serve_store_name(const char *path) {
+	if ((*path == '\0') || (strchr(path, '/') != NULL) || (strstr(path, "..") != NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "Refusing to save a store to [%s]", path);
+		return(-1);
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : serve_client
+// Description  : Serve a client until it disconnects.  An array the client
+//                initialized but did not close (it died, or sent a bad
+//                frame) is closed for it, so the next client can start.
+//
+// Inputs       : sock - the client connection
+//                frame - the frame buffer (answers are built in place)
+//                in - the buffer for the opcodes and blocks asked
+// Outputs      : 0 if the client disconnected, -1 if failure
+
+int serve_client(int sock, uint64_t *frame, char *in) {
+
+	int opened = 0, ret;
+
+	ret = serve_frames(sock, frame, in, &opened);
+	if (opened) {
+		TAGLINE_LOG(LOG_WARNING_LEVEL, "RAID bus client left the array open, closing it");
+		if (raid_request_failed(tagline_bus_backend()->request(make_raid_request(RAID_CLOSE, 0, 0, 0), NULL))) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "Unable to close the array a client left open");
+		}
+	}
+	return(ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : serve_frames
+// Description  : Answer the frames of a client until it disconnects.  The
+//                requests of a frame are performed in order; transfers a
+//                modelled backend times overlap, the frame being answered
+//                when the last completes.
+//
+// Inputs       : sock - the client connection
+//                frame - the frame buffer (answers are built in place)
+//                in - the buffer for the opcodes and blocks asked
+//                opened - is the array initialized and not closed (kept)
+// Outputs      : 0 if the client disconnected, -1 if failure
+
+int serve_frames(int sock, uint64_t *frame, char *in, int *opened) {
+
+	const TaglineBusBackend *bus = tagline_bus_backend();
+	char path[FILENAME_MAX], *out, *payload;
+	uint32_t count, bytes, i, inlen, outlen, inoff, outoff;
+	uint64_t hdr, until, done, *ops = (uint64_t *)in;
+	RAIDOpCode req, resp;
+	ssize_t got;
+	int one = 1;
+
+	// a client that disconnects between frames is done; the opcodes and
+	// blocks written of a frame are read in one call
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	while ((got = recv(sock, &hdr, sizeof(hdr), MSG_WAITALL)) == sizeof(hdr)) {
+		hdr = ntohll64(hdr);
+		count = TAGLINE_NET_COUNT(hdr);
+		bytes = TAGLINE_NET_BYTES(hdr);
+		if ((count == 0) || (count > TAGLINE_NET_BATCH) || (bytes > TAGLINE_NET_MAX_PAYLOAD) ||
+				cmpsc311_read_bytes(sock, count * sizeof(uint64_t) + bytes, in)) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "Bad RAID bus frame [count=%u, bytes=%u]", count, bytes);
+			return(-1);
+		}
+		payload = (char *)&ops[count];
+
+		// perform the requests, the blocks read following the answers
+		out = (char *)&frame[1 + count];
+		inoff = outoff = 0;
+		until = 0;
+		for (i = 0; i < count; i++) {
+			req = ntohll64(ops[i]);
+			inlen = tagline_net_payload(req, 0);
+			outlen = tagline_net_payload(req, 1);
+			if ((inoff + inlen > bytes) || (outoff + outlen > TAGLINE_NET_MAX_PAYLOAD)) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "Bad RAID bus frame payload [count=%u, bytes=%u]", count, bytes);
+				return(-1);
+			}
+			if (TAGLINE_OPC_GET(req, REQTYPE) == TAGLINE_NET_SAVE) {
+				if (inlen >= sizeof(path)) {
+					return(-1);
+				}
+				memcpy(path, &payload[inoff], inlen);
+				path[inlen] = '\0';
+				resp = (serve_store_name(path) || bus->save(path)) ? (req | TAGLINE_OPC_SET(STATUS, 1)) : req;
+			} else {
+				resp = bus->request(req, inlen ? (void *)&payload[inoff] : (outlen ? (void *)&out[outoff] : NULL));
+				if ((TAGLINE_OPC_GET(req, REQTYPE) == RAID_INIT) && (! raid_request_failed(resp))) {
+					*opened = 1;
+				} else if (TAGLINE_OPC_GET(req, REQTYPE) == RAID_CLOSE) {
+					*opened = 0;
+				}
+				if ((bus->schedule != NULL) && (! raid_request_failed(resp)) &&
+						((done = bus->schedule(req)) > until)) {
+					until = done;
+				}
+			}
+			frame[1 + i] = htonll64(resp);
+			inoff += inlen;
+			outoff += outlen;
+		}
+		if (inoff != bytes) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "Bad RAID bus frame payload [count=%u, bytes=%u]", count, bytes);
+			return(-1);
+		}
+		if (until) {
+			tagline_bus_wait(until);
+		}
+
+		// answer with one write
+		frame[0] = htonll64(TAGLINE_NET_FRAME(count, outoff));
+		if (cmpsc311_send_bytes(sock, (1 + count) * sizeof(uint64_t) + outoff, frame)) {
+			return(-1);
+		}
+	}
+	return((got == 0) ? 0 : -1);
+}
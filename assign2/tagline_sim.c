@@ -11,6 +11,7 @@
 
 // Include Files
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <unistd.h>
 #include <errno.h>
@@ -18,38 +19,159 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
 
 // Project Includes
 #include <cmpsc311_log.h>
 #include <cmpsc311_unittest.h>
 #include <raid_bus.h>
 #include "tagline_driver.h"
+#include "tagline_cache.h"
+#include "tagline_readahead.h"
+#include "tagline_trace.h"
+#include "tagline_bench.h"
+#include "tagline_log.h"
+#include "tagline_opcode.h"
+#include "tagline_extent.h"
+#include "tagline_policy.h"
+#include "tagline_alloc.h"
+#include "tagline_stripe.h"
+#include "tagline_journal.h"
+#include "tagline_meta.h"
 
 // Defines
-#define TLINE_ARGUMENTS "hvul:"
+#define TLINE_ARGUMENTS "hvuabmrsyl:c:p:q:j:k:i:J:t:S:F:B:T:A:"
 #define USAGE \
-	"USAGE: tagline_sim [-h] [-v] [-l <logfile>] [-c <sz>] <workload-file>\n" \
+	"USAGE: tagline_sim [-h] [-v] [-a] [-b] [-m] [-r] [-s] [-y] [-l <logfile>] [-j <jsonfile>] [-c <sz>] [-p <policy>] [-A <blocks>] [-q <depth>] [-k <image>] [-i <mode>] [-J <kb>] [-t <placement>] [-S <unit>] [-F <disk>] [-B <backend>] [-T <threads>] <workload-file>...\n" \
 	"\n" \
 	"where:\n" \
 	"    -h - help mode (display this message)\n" \
 	"    -u - run the unit tests instead of the simulator\n" \
 	"    -v - verbose output\n" \
+	"    -a - write log messages from a background thread\n" \
 	"    -l - write log messages to the filename <logfile>\n" \
+	"    -c - set the block cache size to <sz> blocks (0 disables)\n" \
+	"    -p - set the cache replacement policy (lru, 2q, arc)\n" \
+	"    -A - read at most <blocks> ahead of sequential reads of a tagline\n" \
+	"         (default 64, 0 disables)\n" \
+	"    -q - set the maximum number of outstanding driver requests to <depth>\n" \
+	"    -s - log-structured writes: append every write to a track-sized\n" \
+	"         segment, remap overwrites and clean mostly dead segments\n" \
+	"    -t - set the placement of new blocks (fit, track): next fit, or a\n" \
+	"         reserved track per track-sized range of each tagline\n" \
+	"    -y - report the tagline layout (extents and tracks) at each close\n" \
+	"    -S - stripe the array as RAID-5 (rotating parity) in units of <unit>\n" \
+	"         blocks (1, 2, 4, 8 or 16, so a stripe divides a track)\n" \
+	"    -F - with -S, lose <disk> after each INIT: its blocks are rebuilt\n" \
+	"         from the other disks on every read\n" \
+	"    -B - serve the RAID bus with <backend>: lib (the RAID library, the\n" \
+	"         default), file[:<path>] (the array in a file, read and written\n" \
+	"         in place), model[:<seek>:<track>:<block>] (the RAID library,\n" \
+	"         each transfer taking the time a disk would, in usec) or\n" \
+	"         net[:<host>[:<port>]] (the array of a tagline_server)\n" \
+	"    -k - keep the taglines across runs: save the metadata to <image> on\n" \
+	"         close and restart from it (and the saved store) on init\n" \
+	"    -i - set the init <mode> with -k: auto (warm if the image is usable),\n" \
+	"         cold (format everything) or warm (fail if it cannot restart)\n" \
+	"    -J - with -k, journal writes and compact the journal into a new image\n" \
+	"         when it reaches <kb> kilobytes (0 turns the journal off)\n" \
+	"    -b - benchmark: time each driver and bus call, report throughput and\n" \
+	"         latency percentiles per operation type\n" \
+	"    -j - benchmark, also writing the results as JSON to <jsonfile>\n" \
+	"    -m - parse the workload into memory first (or stream a binary trace),\n" \
+	"         then replay it in batches of <depth> requests and report the\n" \
+	"         time spent in the driver (binary traces always replay this way)\n" \
+	"    -r - replay the workload(s) under each cache policy, report hit ratios\n" \
+	"    -T - stress the driver instead of simulating a workload: <threads>\n" \
+	"         clients write, read back and delete taglines of their own at\n" \
+	"         once through the vectored calls, and the throughput of them all\n" \
+	"         is reported\n" \
 	"\n" \
-	"    <workload-file> - file contain the workload to simulate\n" \
+	"    <workload-file> - file contain the workload to simulate (not with -T)\n" \
 	"\n" \
 
+#define REPLAY_BUFSIZE (TAGLINE_BLOCK_SIZE * MAX_TAGLINE_BLOCK_NUMBER)  // bytes per batch slot
+#define REPLAY_CHUNK   65536                                             // ops per streamed chunk
+#define REPLAY_BUFFER(rs, k) (&(rs)->arena[(size_t)(k) * REPLAY_BUFSIZE])
+#define STRESS_TAGLINES   128    // the taglines the stress clients share out
+#define STRESS_OPS        16384  // the operations of all the stress clients
+#define STRESS_MAX_BLOCKS 16     // the most blocks a stress read or write moves
+
+//
+// Type definitions
+
+// The buffers and counters of a trace replay
+typedef struct {
+	char            *arena;        // one buffer per request of a batch
+	TaglineTraceOp **batch;        // the operations of the current batch
+	TagLineRequest  *reqs;         // the requests of the current batch
+	uint64_t        *submitted;    // when each request was submitted (benchmark)
+	double           load_time;    // seconds spent parsing or reading the trace
+	double           driver_time;  // seconds spent in the driver
+	uint64_t         ops;          // operations replayed
+	uint64_t         reads;        // read requests made
+	uint64_t         writes;       // write requests made
+	uint64_t         blocks;       // blocks transferred
+} ReplayState;
+
+// A client thread of the stress test
+typedef struct {
+	pthread_t  thread;                  // the client thread
+	uint32_t   id;                      // the client number (it owns the tags id, id+clients, ...)
+	uint32_t   clients;                 // the number of clients
+	uint32_t   ops;                     // the operations to perform
+	uint32_t   seed;                    // the random number state
+	uint64_t   reads;                   // read requests made
+	uint64_t   writes;                  // write requests made
+	uint64_t   deletes;                 // delete requests made
+	uint64_t   blocks;                  // blocks transferred
+	int        err;                     // did a request fail or read bad data?
+	uint8_t    text[STRESS_TAGLINES][MAX_TAGLINE_BLOCK_NUMBER];   // the pattern of each block
+	char       buf[TAGLINE_BLOCK_SIZE * MAX_TAGLINE_BLOCK_NUMBER];  // the blocks moved
+	struct iovec iov[MAX_TAGLINE_BLOCK_NUMBER];                   // the blocks of buf, in reverse order
+} StressClient;
+
+// A module's unit tests, run by -u
+typedef struct {
+	const char *name;   // the module tested
+	int (*test)(void);  // the tests (0 if they all pass)
+} UnitTest;
+
 //
 // Global Data
 int verbose;
 char rdbuf[TAGLINE_BLOCK_SIZE*MAX_TAGLINE_BLOCK_NUMBER]; // workload simulator read buffer
 char wrbuf[TAGLINE_BLOCK_SIZE*MAX_TAGLINE_BLOCK_NUMBER]; // workload simulator write buffer
 char tmbuf[TAGLINE_BLOCK_SIZE*MAX_TAGLINE_BLOCK_NUMBER]; // workload simulator temporary buffer
+uint32_t replay_depth = TAGLINE_DEFAULT_QUEUE_DEPTH;     // requests per replay batch
+int layout_report = 0;                                   // report the layout at each close
+
+// The unit tests run by -u, in order (the RAID library only allows its own
+// opcode functions to be called once its unit tests have run)
+UnitTest unit_test_list[] = {
+	{ "cmpsc311", cmpsc311_unittests },             // 311 library
+	{ "raid", raid_unit_test },                     // RAID library
+	{ "opcode", tagline_opcode_unit_test },         // RAID opcode codec
+	{ "extent", tagline_extent_unit_test },         // extent maps
+	{ "policy", tagline_policy_unit_test },         // cache replacement policies
+	{ "alloc", tagline_alloc_unit_test },           // free-space manager
+	{ "stripe", tagline_stripe_unit_test },         // RAID-5 stripes (on the RAID bus)
+	{ "journal", tagline_journal_unit_test },       // write-ahead journal replay
+	{ "meta", tagline_meta_unit_test },             // metadata image
+	{ "clean", tagline_clean_unit_test },           // segment cleaner (a log-mode driver)
+	{ "readahead", tagline_readahead_unit_test },   // readahead windows
+};
+int lost_disk = -1;                                      // the disk lost after each init (-1 if none)
+uint32_t stress_clients = 0;                             // client threads to stress with (0 is no stress test)
 
 //
 // Functional Prototypes
 
 int simulate_TagLines(char *wload);
+int replay_TagLines(char *wload);
+int report_cache_policies(int nfiles, char *wloads[]);
+int stress_TagLines(uint32_t clients);
 int tagline_read_block_validate(TagLineNumber tagnum, TagLineBlockNumber blocknum,
 		uint16_t num_blocks, char *text);
 
@@ -68,7 +190,14 @@ int tagline_read_block_validate(TagLineNumber tagnum, TagLineBlockNumber blocknu
 int main(int argc, char *argv[]) {
 
 	// Local variables
-	int ch, verbose = 0, unit_tests = -0, log_initialized = 0;
+	int ch, verbose = 0, unit_tests = -0, log_initialized = 0, policy_report = 0, replay = 0, bench = 0, err;
+	int async_log = 0, mode;
+	const char *init_modes[] = { "auto", "cold", "warm" };  // the TaglineInitMode names
+	char *json_file = NULL;
+	FILE *json;
+	TaglinePolicyType policy;
+	TaglinePlaceType place;
+	uint32_t t;
 
 	// Process the command line parameters
 	while ((ch = getopt(argc, argv, TLINE_ARGUMENTS)) != -1) {
@@ -86,11 +215,126 @@ int main(int argc, char *argv[]) {
 			unit_tests = 1;
 			break;
 
+		case 'q': // Set the request queue depth
+			if (set_tagline_queue_depth(atoi(optarg))) {
+				fprintf(stderr, "Bad queue depth [%s], aborting.\n", optarg);
+				return( -1 );
+			}
+			replay_depth = atoi(optarg);
+			break;
+
+		case 's': // Log-structured write path
+			set_tagline_log_structured(1);
+			break;
+
+		case 't': // Set the placement policy
+			if (tagline_place_type(optarg, &place) || set_tagline_placement(place)) {
+				fprintf(stderr, "Unknown placement policy [%s], aborting.\n", optarg);
+				return( -1 );
+			}
+			break;
+
+		case 'y': // Layout report flag
+			layout_report = 1;
+			break;
+
+		case 'S': // Stripe the array as RAID-5
+			if (set_tagline_stripe_unit(atoi(optarg))) {
+				fprintf(stderr, "Bad stripe unit [%s], aborting.\n", optarg);
+				return( -1 );
+			}
+			break;
+
+		case 'F': // Lose a disk after init
+			lost_disk = atoi(optarg);
+			if ((lost_disk < 0) || (lost_disk >= RAID_DISKS)) {
+				fprintf(stderr, "Bad disk to lose [%s], aborting.\n", optarg);
+				return( -1 );
+			}
+			break;
+
+		case 'T': // Stress the driver with client threads
+			if ((atoi(optarg) <= 0) || (atoi(optarg) > STRESS_TAGLINES)) {
+				fprintf(stderr, "Bad number of stress threads [%s], aborting.\n", optarg);
+				return( -1 );
+			}
+			stress_clients = atoi(optarg);
+			break;
+
+		case 'B': // Choose the RAID bus backend
+			if (set_tagline_bus_backend(optarg)) {
+				fprintf(stderr, "Bad RAID bus backend [%s], aborting.\n", optarg);
+				return( -1 );
+			}
+			break;
+
+		case 'k': // Keep the taglines in a metadata image
+			if (set_tagline_metadata_file(optarg)) {
+				return( -1 );
+			}
+			break;
+
+		case 'J': // Set the journal size limit
+			if (set_tagline_journal_limit(strtoull(optarg, NULL, 10) * 1024)) {
+				return( -1 );
+			}
+			break;
+
+		case 'i': // Set the init mode
+			for (mode = 0; (mode < sizeof(init_modes) / sizeof(init_modes[0])) && strcmp(optarg, init_modes[mode]); mode++);
+			if (set_tagline_init_mode(mode)) {
+				fprintf(stderr, "Bad init mode [%s], aborting.\n", optarg);
+				return( -1 );
+			}
+			break;
+
+		case 'a': // Asynchronous logging flag
+			async_log = 1;
+			break;
+
+		case 'b': // Benchmark flag
+			bench = 1;
+			break;
+
+		case 'j': // Benchmark JSON output file
+			json_file = optarg;
+			bench = 1;
+			break;
+
+		case 'm': // Parsed trace replay flag
+			replay = 1;
+			break;
+
+		case 'r': // Cache policy report flag
+			policy_report = 1;
+			break;
+
 		case 'l': // Set the log filename
 			initializeLogWithFilename(optarg);
 			log_initialized = 1;
 			break;
 
+		case 'c': // Set the cache size
+			if (set_tagline_cache_size(atoi(optarg))) {
+				fprintf(stderr, "Bad cache size [%s], aborting.\n", optarg);
+				return( -1 );
+			}
+			break;
+
+		case 'A': // Set the readahead
+			if (set_tagline_readahead(atoi(optarg))) {
+				fprintf(stderr, "Bad readahead [%s], aborting.\n", optarg);
+				return( -1 );
+			}
+			break;
+
+		case 'p': // Set the cache replacement policy
+			if (tagline_policy_type(optarg, &policy) || set_tagline_cache_policy(policy)) {
+				fprintf(stderr, "Unknown cache policy [%s], aborting.\n", optarg);
+				return( -1 );
+			}
+			break;
+
 		default:  // Default (unknown)
 			fprintf(stderr, "Unknown command line option (%c), aborting.\n", ch);
 			return( -1 );
@@ -102,27 +346,54 @@ int main(int argc, char *argv[]) {
 		initializeLogWithFilehandle(CMPSC311_LOG_STDERR);
 	}
 	if (verbose) {
-		enableLogLevels(LOG_INFO_LEVEL);
+		tagline_log_enable(LOG_INFO_LEVEL);
+	}
+	if (async_log) {
+		if (tagline_log_start_async()) {
+			return( -1 );
+		}
+		atexit(tagline_log_stop_async);
 	}
 
 	// If we are running the unit tests, do that
 	if (unit_tests) {
 
 		// Enable verbose, run the tests and check the results
-		enableLogLevels(LOG_INFO_LEVEL);
+		tagline_log_enable(LOG_INFO_LEVEL);
 
-		// 311 Library Unit Tests
-		if (cmpsc311_unittests()) {
-			logMessage(LOG_ERROR_LEVEL, "Tagline unit tests failed.\n\n");
-		} else {
-			logMessage(LOG_INFO_LEVEL, "Tagline unit tests completed successfully.\n\n");
+		// Run each module's tests, in the order of the table
+		for (t = 0; t < sizeof(unit_test_list) / sizeof(UnitTest); t++) {
+			if (unit_test_list[t].test()) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "Tagline unit tests failed [%s].\n\n", unit_test_list[t].name);
+			} else {
+				TAGLINE_LOG(LOG_INFO_LEVEL, "Tagline unit tests completed successfully [%s].\n\n",
+						unit_test_list[t].name);
+			}
 		}
 
-		// RAID unit tests
-		if (raid_unit_test()) {
-			logMessage(LOG_ERROR_LEVEL, "Tagline unit tests failed.\n\n");
-		} else {
-			logMessage(LOG_INFO_LEVEL, "Tagline unit tests completed successfully.\n\n");
+	} else if (stress_clients) {
+
+		// Run the stress test (it takes no workload)
+		if (optind != argc) {
+			fprintf( stderr, "Unexpected command line parameters, use -h to see usage, aborting.\n" );
+			return( -1 );
+		}
+		tagline_bench_enable(bench);
+		err = stress_TagLines(stress_clients);
+		tagline_bench_enable(0);
+		if (err) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "Tagline stress test failed.\n\n");
+			return( -1 );
+		}
+		TAGLINE_LOG(LOG_INFO_LEVEL, "Tagline stress test completed successfully.\n\n");
+		if (bench) {
+			tagline_bench_report("stress");
+			if (json_file != NULL) {
+				if (((json = fopen(json_file, "w")) == NULL) || tagline_bench_json("stress", json) || fclose(json)) {
+					TAGLINE_LOG(LOG_ERROR_LEVEL, "Failure writing benchmark results [%s]", json_file);
+					return( -1 );
+				}
+			}
 		}
 
 	} else {
@@ -136,11 +407,33 @@ int main(int argc, char *argv[]) {
 
 		}
 
+		// Compare the cache policies over the workloads
+		if (policy_report) {
+			return(report_cache_policies(argc - optind, &argv[optind]));
+		}
+
 		// Run the simulation
-		if (simulate_TagLines(argv[optind]) == 0) {
-			logMessage(LOG_INFO_LEVEL, "Tagline simulation completed successfully.\n\n");
+		if (tagline_trace_is_binary(argv[optind])) {
+			replay = 1;
+		}
+		tagline_bench_enable(bench);
+		err = replay ? replay_TagLines(argv[optind]) : simulate_TagLines(argv[optind]);
+		tagline_bench_enable(0);
+		if (err == 0) {
+			TAGLINE_LOG(LOG_INFO_LEVEL, "Tagline simulation completed successfully.\n\n");
 		} else {
-			logMessage(LOG_INFO_LEVEL, "Tagline simulation failed.\n\n");
+			TAGLINE_LOG(LOG_INFO_LEVEL, "Tagline simulation failed.\n\n");
+		}
+
+		// Report the benchmark results
+		if (bench && (err == 0)) {
+			tagline_bench_report(argv[optind]);
+			if (json_file != NULL) {
+				if (((json = fopen(json_file, "w")) == NULL) || tagline_bench_json(argv[optind], json) || fclose(json)) {
+					TAGLINE_LOG(LOG_ERROR_LEVEL, "Failure writing benchmark results [%s]", json_file);
+					return( -1 );
+				}
+			}
 		}
 	}
 
@@ -148,6 +441,75 @@ int main(int argc, char *argv[]) {
 	return( 0 );
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : report_layout
+// Description  : Print how the taglines are laid out (when asked to with
+//                -y), just before the driver closes
+//
+// Inputs       : none
+// Outputs      : none
+
+static void report_layout(void) {
+
+	TaglineLayoutStats layout;
+
+	if ((! layout_report) || tagline_layout_stats(&layout)) {
+		return;
+	}
+	TAGLINE_LOG(LOG_OUTPUT_LEVEL, "Layout: %u taglines, %lu blocks in %lu extents, %.2f extents per tagline",
+			layout.taglines, layout.blocks, layout.extents,
+			layout.taglines ? (double)layout.extents / layout.taglines : 0.0);
+	TAGLINE_LOG(LOG_OUTPUT_LEVEL, "Layout: %lu tracks touched (%lu at best, %.1f%% over), %u tracks reserved",
+			layout.tracks, layout.min_tracks,
+			layout.min_tracks ? (double)(layout.tracks - layout.min_tracks) * 100.0 / layout.min_tracks : 0.0,
+			layout.reserved);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : bench_read
+// Description  : Call tagline_read, timing it when benchmarking
+//
+// Inputs       : tag, bnum, blks, buf - the read (see tagline_read)
+// Outputs      : 0 if successful, -1 if failure
+
+static int bench_read(TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks, char *buf) {
+
+	uint64_t start;
+	int ret;
+
+	if (! tagline_bench_enabled) {
+		return(tagline_read(tag, bnum, blks, buf));
+	}
+	start = tagline_bench_now();
+	ret = tagline_read(tag, bnum, blks, buf);
+	tagline_bench_record(TAGLINE_BENCH_READ, tagline_bench_now() - start, blks * TAGLINE_BLOCK_SIZE);
+	return(ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : bench_write
+// Description  : Call tagline_write, timing it when benchmarking
+//
+// Inputs       : tag, bnum, blks, buf - the write (see tagline_write)
+// Outputs      : 0 if successful, -1 if failure
+
+static int bench_write(TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks, char *buf) {
+
+	uint64_t start;
+	int ret;
+
+	if (! tagline_bench_enabled) {
+		return(tagline_write(tag, bnum, blks, buf));
+	}
+	start = tagline_bench_now();
+	ret = tagline_write(tag, bnum, blks, buf);
+	tagline_bench_record(TAGLINE_BENCH_WRITE, tagline_bench_now() - start, blks * TAGLINE_BLOCK_SIZE);
+	return(ret);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Function     : simulate_Taglines
@@ -170,7 +532,7 @@ int simulate_TagLines(char *wload) {
 	// Open the workload file
 	linecount = 0;
 	if ((fhandle=fopen(wload, "r")) == NULL) {
-		logMessage(LOG_ERROR_LEVEL, "Failure opening the workload file [%s], error: %s.\n",
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "Failure opening the workload file [%s], error: %s.\n",
 			wload, strerror(errno));
 		return(-1);
 	}
@@ -186,7 +548,7 @@ int simulate_TagLines(char *wload) {
 			if (sscanf(line, "%s %hu %hu %u %s", command, &tagnum, &num_blocks, &blocknum, text) != 5) {
 
 				// Bad data, error out
-				logMessage(LOG_ERROR_LEVEL, "Tagline un-parsable workload string, aborting [%s], line %d",
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "Tagline un-parsable workload string, aborting [%s], line %d",
 						line, linecount);
 				fclose(fhandle);
 				return(-1);
@@ -194,25 +556,26 @@ int simulate_TagLines(char *wload) {
 			} else {
 
 				// Just log the contents
-				logMessage(LOG_INFO_LEVEL, "INPUT cmd=%s tag=%u #blks=%u start-blk=%u data=%s",
+				TAGLINE_LOG(LOG_INFO_LEVEL, "INPUT cmd=%s tag=%u #blks=%u start-blk=%u data=%s",
 						command, tagnum, num_blocks, blocknum, text);
 
 				// If there is write processing to perform
 				if (strncmp(command, "INIT", 5) == 0) {
 
 					// Call the initialize function for the tagline storae
-					if (tagline_driver_init(tagnum)) {
+					if (tagline_driver_init(tagnum) || ((lost_disk != -1) && tagline_fail_disk(lost_disk))) {
 						// Error out
-						logMessage(LOG_ERROR_LEVEL, "INIT failed on raid array (%d tags)", tagnum);
+						TAGLINE_LOG(LOG_ERROR_LEVEL, "INIT failed on raid array (%d tags)", tagnum);
 						err = 1;
 					}
 
 				} else if (strncmp(command, "CLOSE", 5) == 0) {
 
 					// Close the tagline storage device
+					report_layout();
 					if (tagline_close()) {
 						// Error out
-						logMessage(LOG_ERROR_LEVEL, "Close failed on raid array.");
+						TAGLINE_LOG(LOG_ERROR_LEVEL, "Close failed on raid array.");
 						err = 1;
 					}
 
@@ -221,7 +584,7 @@ int simulate_TagLines(char *wload) {
 					// First check to make sure our input is sane
 					if (strlen(text) != num_blocks) {
 						// Error out
-						logMessage(LOG_ERROR_LEVEL, "Text/number blocks mismatch in input data");
+						TAGLINE_LOG(LOG_ERROR_LEVEL, "Text/number blocks mismatch in input data");
 						err = 1;
 					} else {
 
@@ -231,17 +594,17 @@ int simulate_TagLines(char *wload) {
 						}
 
 						// Read the blocks from the tagline
-						if (tagline_read(tagnum, blocknum, num_blocks, tmbuf)) {
+						if (bench_read(tagnum, blocknum, num_blocks, tmbuf)) {
 							// Error out
-							logMessage(LOG_ERROR_LEVEL, "READ failed on tagline storage device (%u)", tagnum);
+							TAGLINE_LOG(LOG_ERROR_LEVEL, "READ failed on tagline storage device (%u)", tagnum);
 							err = 1;
 						}
 
 						// Now compare the read bytes to see if it is correct
 						if (memcmp(rdbuf, tmbuf, num_blocks*TAGLINE_BLOCK_SIZE)) {
 							// Error out
-							logMessage(LOG_ERROR_LEVEL, "Read blocks data mismatch return from tagline storage.");
-							logMessage(LOG_ERROR_LEVEL, "Mismatch [%d] != [%d]", (int)rdbuf[0], (int)tmbuf[0]);
+							TAGLINE_LOG(LOG_ERROR_LEVEL, "Read blocks data mismatch return from tagline storage.");
+							TAGLINE_LOG(LOG_ERROR_LEVEL, "Mismatch [%d] != [%d]", (int)rdbuf[0], (int)tmbuf[0]);
 							err = 1;
 						}
 
@@ -255,16 +618,25 @@ int simulate_TagLines(char *wload) {
 					}
 
 					// Call the block write function
-					if (tagline_write(tagnum, blocknum, num_blocks, wrbuf)) {
+					if (bench_write(tagnum, blocknum, num_blocks, wrbuf)) {
 						// Error out
-						logMessage(LOG_ERROR_LEVEL, "WRITE failed on tagline storage (%d)");
+						TAGLINE_LOG(LOG_ERROR_LEVEL, "WRITE failed on tagline storage (%u)", tagnum);
+						err = 1;
+					}
+
+				} else if (strncmp(command, "DELETE", 7) == 0) {
+
+					// Delete the tagline, freeing its blocks
+					if (tagline_delete(tagnum)) {
+						// Error out
+						TAGLINE_LOG(LOG_ERROR_LEVEL, "DELETE failed on tagline storage (%u)", tagnum);
 						err = 1;
 					}
 
 				} else if (strncmp(command, "tagline", 7) == 0) {
 
 					// Need to save some data here!
-					logMessage(LOG_INFO_LEVEL, "Getting tagline final data (%s)", command);
+					TAGLINE_LOG(LOG_INFO_LEVEL, "Getting tagline final data (%s)", command);
 
 					// TODO: this single block reads are only for first version
 					// do a bunch of reads to make sure that the data matches workload indicators
@@ -274,22 +646,22 @@ int simulate_TagLines(char *wload) {
 						txt[0] = text[i];
 						txt[1] = 0x0;
 						if (tagline_read_block_validate(tagnum, i, 1, txt)) {
-							logMessage(LOG_ERROR_LEVEL, "Tagline validation failed for tag line [%d], aborting.", tagnum);
+							TAGLINE_LOG(LOG_ERROR_LEVEL, "Tagline validation failed for tag line [%d], aborting.", tagnum);
 							return(-1);
 						} else {
-							logMessage(LOG_INFO_LEVEL, "Tagline validation successful for tag line [%d]", tagnum);
+							TAGLINE_LOG(LOG_INFO_LEVEL, "Tagline validation successful for tag line [%d]", tagnum);
 						}
 					}
 
 					// Finished validating, success!!!
-					logMessage(LOG_INFO_LEVEL, "Tagline validation successful for all taglines, success!!!!");
+					TAGLINE_LOG(LOG_INFO_LEVEL, "Tagline validation successful for all taglines, success!!!!");
 				}
 
 			}
 
 			// Check for the virtual level failing
 			if (err) {
-				logMessage(LOG_ERROR_LEVEL, "RAID system failed, aborting [%d]", err);
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "RAID system failed, aborting [%d]", err);
 				fclose(fhandle);
 				return(-1);
 			}
@@ -301,6 +673,577 @@ int simulate_TagLines(char *wload) {
 	return(0);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : replay_elapsed
+// Description  : Compute the seconds between two monotonic clock readings
+//
+// Inputs       : start - the earlier reading
+//                end - the later reading
+// Outputs      : the elapsed time in seconds
+
+static double replay_elapsed(struct timespec *start, struct timespec *end) {
+	return((end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : replay_check
+// Description  : Check that blocks read back hold their workload patterns
+//
+// Inputs       : buf - the blocks read
+//                text - the pattern byte of each block
+//                blocks - the number of blocks
+// Outputs      : 0 if the blocks match, -1 if not
+
+static int replay_check(char *buf, const char *text, uint32_t blocks) {
+
+	uint32_t i;
+
+	for (i = 0; i < blocks; i++) {
+		memset(rdbuf, text[i], TAGLINE_BLOCK_SIZE);
+		if (memcmp(rdbuf, &buf[i * TAGLINE_BLOCK_SIZE], TAGLINE_BLOCK_SIZE)) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "Read blocks data mismatch return from tagline storage.");
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "Mismatch [%d] != [%d]", (int)text[i], (int)buf[i * TAGLINE_BLOCK_SIZE]);
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : replay_ops
+// Description  : Replay the operations of a parsed trace.  Runs of reads
+//                and writes are submitted to the driver in batches of up to
+//                the queue depth.  Only the driver calls are timed; filling
+//                the write buffers and checking the reads are not.
+//
+// Inputs       : trace - the operations to replay
+//                rs - the replay buffers and counters
+// Outputs      : 0 if successful test, -1 if failure
+
+static int replay_ops(TaglineTrace *trace, ReplayState *rs) {
+
+	// Local variables
+	TaglineTraceOp *op;
+	struct timespec start, end;
+	uint32_t n, k, cnt;
+	char *buf, *text;
+	int err = 0;
+
+	// Walk the operations, batching the runs of reads and writes
+	for (n = 0; (n < trace->nops) && (! err); ) {
+		op = &trace->ops[n];
+		text = &trace->text[op->text];
+
+		if ((op->cmd == TAGLINE_OP_READ) || (op->cmd == TAGLINE_OP_WRITE)) {
+
+			// Gather the batch, filling in the write buffers
+			for (cnt = 0; (cnt < replay_depth) && (n < trace->nops) &&
+					((trace->ops[n].cmd == TAGLINE_OP_READ) || (trace->ops[n].cmd == TAGLINE_OP_WRITE)); cnt++, n++) {
+				op = rs->batch[cnt] = &trace->ops[n];
+				if (op->cmd == TAGLINE_OP_WRITE) {
+					buf = REPLAY_BUFFER(rs, cnt);
+					for (k = 0; k < op->blocks; k++) {
+						memset(&buf[k * TAGLINE_BLOCK_SIZE], trace->text[op->text + k], TAGLINE_BLOCK_SIZE);
+					}
+				}
+			}
+
+			// Submit the whole batch, then wait for all of it
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for (k = 0; k < cnt; k++) {
+				op = rs->batch[k];
+				if (tagline_bench_enabled) {
+					rs->submitted[k] = tagline_bench_now();
+				}
+				rs->reqs[k] = (op->cmd == TAGLINE_OP_WRITE) ?
+						tagline_write_async(op->tag, op->start, op->blocks, REPLAY_BUFFER(rs, k), NULL, NULL) :
+						tagline_read_async(op->tag, op->start, op->blocks, REPLAY_BUFFER(rs, k), NULL, NULL);
+			}
+			for (k = 0; k < cnt; k++) {
+				if (tagline_wait(rs->reqs[k])) {
+					TAGLINE_LOG(LOG_ERROR_LEVEL, "%s failed on tagline storage device (%u)",
+							TAGLINE_OP_LABELS[rs->batch[k]->cmd], rs->batch[k]->tag);
+					err = 1;
+				}
+				if (tagline_bench_enabled) {
+					op = rs->batch[k];
+					tagline_bench_record((op->cmd == TAGLINE_OP_WRITE) ? TAGLINE_BENCH_WRITE : TAGLINE_BENCH_READ,
+							tagline_bench_now() - rs->submitted[k], op->blocks * TAGLINE_BLOCK_SIZE);
+				}
+			}
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			rs->driver_time += replay_elapsed(&start, &end);
+
+			// Check what was read
+			for (k = 0; (k < cnt) && (! err); k++) {
+				op = rs->batch[k];
+				rs->blocks += op->blocks;
+				if (op->cmd == TAGLINE_OP_WRITE) {
+					rs->writes++;
+				} else {
+					rs->reads++;
+					err = (replay_check(REPLAY_BUFFER(rs, k), &trace->text[op->text], op->blocks) != 0);
+				}
+			}
+			continue;
+		}
+
+		// The other commands run one at a time
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		switch (op->cmd) {
+		case TAGLINE_OP_INIT:
+			if (tagline_driver_init(op->tag) || ((lost_disk != -1) && tagline_fail_disk(lost_disk))) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "INIT failed on raid array (%d tags)", op->tag);
+				err = 1;
+			}
+			break;
+
+		case TAGLINE_OP_CLOSE:
+			report_layout();
+			if (tagline_close()) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "Close failed on raid array.");
+				err = 1;
+			}
+			break;
+
+		case TAGLINE_OP_DELETE:
+			if (tagline_delete(op->tag)) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "DELETE failed on tagline storage (%u)", op->tag);
+				err = 1;
+			}
+			break;
+
+		case TAGLINE_OP_VALIDATE:
+			// Read every block of the tagline and check its final contents
+			for (k = 0; (k < op->length) && (! err); k++) {
+				if (bench_read(op->tag, k, 1, tmbuf)) {
+					TAGLINE_LOG(LOG_ERROR_LEVEL, "READ failed on tagline storage device (%u)", op->tag);
+					err = 1;
+				} else {
+					clock_gettime(CLOCK_MONOTONIC, &end);
+					rs->driver_time += replay_elapsed(&start, &end);
+					err = (replay_check(tmbuf, &text[k], 1) != 0);
+					rs->reads++;
+					rs->blocks++;
+					clock_gettime(CLOCK_MONOTONIC, &start);
+				}
+			}
+			if (err) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "Tagline validation failed for tag line [%d], aborting.", op->tag);
+			} else {
+				TAGLINE_LOG(LOG_INFO_LEVEL, "Tagline validation successful for all taglines, success!!!!");
+			}
+			break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		rs->driver_time += replay_elapsed(&start, &end);
+		n++;
+	}
+
+	rs->ops += n;
+	return(err ? -1 : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : replay_TagLines
+// Description  : Replay a workload from a parsed trace.  A text workload is
+//                parsed into memory before the replay starts; a binary
+//                trace is streamed in chunks.  The time spent loading the
+//                trace is reported apart from the time spent in the driver.
+//
+// Inputs       : wload - the name of the workload file
+// Outputs      : 0 if successful test, -1 if failure
+
+int replay_TagLines(char *wload) {
+
+	// Local variables
+	TaglineTrace trace;
+	TaglineTraceFile tf;
+	ReplayState rs;
+	struct timespec start, end;
+	int binary, nread = 0, err = 0;
+
+	// Set up a buffer for each request of a batch
+	memset(&rs, 0x0, sizeof(rs));
+	memset(&trace, 0x0, sizeof(trace));
+	if (((rs.arena = malloc((size_t)replay_depth * REPLAY_BUFSIZE)) == NULL) ||
+			((rs.batch = malloc(replay_depth * sizeof(TaglineTraceOp *))) == NULL) ||
+			((rs.reqs = malloc(replay_depth * sizeof(TagLineRequest))) == NULL) ||
+			((rs.submitted = malloc(replay_depth * sizeof(uint64_t))) == NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "Unable to allocate replay buffers (depth %u)", replay_depth);
+		free(rs.arena);
+		free(rs.batch);
+		free(rs.reqs);
+		return(-1);
+	}
+
+	// Parse a text workload whole, or open a binary one for streaming
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if ((binary = tagline_trace_is_binary(wload))) {
+		err = tagline_trace_open(wload, &tf);
+	} else {
+		err = tagline_trace_load(wload, &trace);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	rs.load_time += replay_elapsed(&start, &end);
+
+	// Replay the trace, a chunk at a time for binary traces
+	while (! err) {
+		if (binary) {
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			nread = tagline_trace_read(&tf, &trace, REPLAY_CHUNK);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			rs.load_time += replay_elapsed(&start, &end);
+			if (nread <= 0) {
+				err = (nread < 0);
+				break;
+			}
+		}
+		err = replay_ops(&trace, &rs);
+		if (! binary) {
+			break;
+		}
+	}
+
+	// Report the time spent in the driver
+	if (! err) {
+		TAGLINE_LOG(LOG_OUTPUT_LEVEL, "Replayed [%s]: %lu operations, %lu reads, %lu writes, %lu blocks",
+				wload, rs.ops, rs.reads, rs.writes, rs.blocks);
+		TAGLINE_LOG(LOG_OUTPUT_LEVEL, "Load %.6f sec, driver %.6f sec, %.0f ops/sec, %.2f MB/sec",
+				rs.load_time, rs.driver_time, (rs.driver_time > 0) ? (rs.reads + rs.writes) / rs.driver_time : 0.0,
+				(rs.driver_time > 0) ? (rs.blocks * TAGLINE_BLOCK_SIZE) / (rs.driver_time * 1024 * 1024) : 0.0);
+	} else {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "RAID system failed, aborting [%d]", err);
+	}
+
+	// Clean up and return
+	if (binary) {
+		tagline_trace_close(&tf);
+	}
+	free(rs.submitted);
+	free(rs.reqs);
+	free(rs.batch);
+	free(rs.arena);
+	tagline_trace_free(&trace);
+	return(err ? -1 : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : bench_readv
+// Description  : Call tagline_readv, timing it when benchmarking
+//
+// Inputs       : tag, bnum, iov, iovcnt - the read (see tagline_readv)
+//                blks - the number of blocks read
+// Outputs      : 0 if successful, -1 if failure
+
+static int bench_readv(TagLineNumber tag, TagLineBlockNumber bnum, const struct iovec *iov, int iovcnt,
+		uint8_t blks) {
+
+	uint64_t start;
+	int ret;
+
+	if (! tagline_bench_enabled) {
+		return(tagline_readv(tag, bnum, iov, iovcnt));
+	}
+	start = tagline_bench_now();
+	ret = tagline_readv(tag, bnum, iov, iovcnt);
+	tagline_bench_record(TAGLINE_BENCH_READ, tagline_bench_now() - start, blks * TAGLINE_BLOCK_SIZE);
+	return(ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : bench_writev
+// Description  : Call tagline_writev, timing it when benchmarking
+//
+// Inputs       : tag, bnum, iov, iovcnt - the write (see tagline_writev)
+//                blks - the number of blocks written
+// Outputs      : 0 if successful, -1 if failure
+
+static int bench_writev(TagLineNumber tag, TagLineBlockNumber bnum, const struct iovec *iov, int iovcnt,
+		uint8_t blks) {
+
+	uint64_t start;
+	int ret;
+
+	if (! tagline_bench_enabled) {
+		return(tagline_writev(tag, bnum, iov, iovcnt));
+	}
+	start = tagline_bench_now();
+	ret = tagline_writev(tag, bnum, iov, iovcnt);
+	tagline_bench_record(TAGLINE_BENCH_WRITE, tagline_bench_now() - start, blks * TAGLINE_BLOCK_SIZE);
+	return(ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : stress_block
+// Description  : Get the memory a stress client moves a block of a run
+//                through: the blocks are scattered through its buffer in
+//                reverse order, as a pool would hand them out, so the
+//                driver's vectored path sees a segment per block
+//
+// Inputs       : sc - the client
+//                k - the block of the run
+//                blks - the number of blocks in the run
+// Outputs      : the memory of the block
+
+static char *stress_block(StressClient *sc, uint32_t k, uint8_t blks) {
+	return(&sc->buf[(blks - 1 - k) * TAGLINE_BLOCK_SIZE]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : stress_vector
+// Description  : Build the vector of the blocks of a run of a stress client
+//
+// Inputs       : sc - the client
+//                blks - the number of blocks in the run
+// Outputs      : none
+
+static void stress_vector(StressClient *sc, uint8_t blks) {
+
+	uint32_t k;
+
+	for (k = 0; k < blks; k++) {
+		sc->iov[k].iov_base = stress_block(sc, k, blks);
+		sc->iov[k].iov_len = TAGLINE_BLOCK_SIZE;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : stress_write
+// Description  : Write a run of blocks of a tagline of a stress client,
+//                each block with a new pattern
+//
+// Inputs       : sc - the client
+//                tag - the tagline
+//                bnum - the first block
+//                blks - the number of blocks
+// Outputs      : 0 if successful, -1 if failure
+
+static int stress_write(StressClient *sc, TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks) {
+
+	uint32_t k;
+
+	for (k = 0; k < blks; k++) {
+		sc->text[tag][bnum + k] = (uint8_t)rand_r(&sc->seed);
+		memset(stress_block(sc, k, blks), sc->text[tag][bnum + k], TAGLINE_BLOCK_SIZE);
+	}
+	stress_vector(sc, blks);
+	if (bench_writev(tag, bnum, sc->iov, blks, blks)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "WRITE failed on tagline storage (%u)", tag);
+		return(-1);
+	}
+	sc->writes++;
+	sc->blocks += blks;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : stress_read
+// Description  : Read a run of blocks of a tagline of a stress client and
+//                check they hold what the client last wrote
+//
+// Inputs       : sc - the client
+//                tag - the tagline
+//                bnum - the first block
+//                blks - the number of blocks
+// Outputs      : 0 if successful, -1 if failure
+
+static int stress_read(StressClient *sc, TagLineNumber tag, TagLineBlockNumber bnum, uint8_t blks) {
+
+	uint32_t k, b;
+	char *mem;
+
+	stress_vector(sc, blks);
+	if (bench_readv(tag, bnum, sc->iov, blks, blks)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "READ failed on tagline storage device (%u)", tag);
+		return(-1);
+	}
+	for (k = 0; k < blks; k++) {
+		mem = stress_block(sc, k, blks);
+		for (b = 0; b < TAGLINE_BLOCK_SIZE; b++) {
+			if ((uint8_t)mem[b] != sc->text[tag][bnum + k]) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "Read blocks data mismatch return from tagline storage.");
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "Mismatch [%d] != [%d] (tagline %u, block %u)",
+						sc->text[tag][bnum + k], (uint8_t)mem[b], tag, bnum + k);
+				return(-1);
+			}
+		}
+	}
+	sc->reads++;
+	sc->blocks += blks;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : stress_client
+// Description  : The thread of a stress client: write its taglines whole,
+//                then read back, overwrite and now and then delete and
+//                rewrite runs of them at random
+//
+// Inputs       : arg - the client
+// Outputs      : NULL
+
+static void *stress_client(void *arg) {
+
+	StressClient *sc = arg;
+	TagLineNumber tag;
+	TagLineBlockNumber bnum;
+	uint32_t n, pick;
+	uint8_t blks;
+
+	for (tag = sc->id; (tag < STRESS_TAGLINES) && (! sc->err); tag += sc->clients) {
+		sc->err = stress_write(sc, tag, 0, MAX_TAGLINE_BLOCK_NUMBER);
+	}
+	for (n = 0; (n < sc->ops) && (! sc->err); n++) {
+		tag = sc->id + (rand_r(&sc->seed) % ((STRESS_TAGLINES - sc->id + sc->clients - 1) / sc->clients)) * sc->clients;
+		blks = 1 + rand_r(&sc->seed) % STRESS_MAX_BLOCKS;
+		bnum = rand_r(&sc->seed) % (MAX_TAGLINE_BLOCK_NUMBER - blks + 1);
+		pick = rand_r(&sc->seed) % 64;
+		if (pick == 0) {
+			if (tagline_delete(tag)) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "DELETE failed on tagline storage (%u)", tag);
+				sc->err = 1;
+			} else {
+				sc->deletes++;
+				sc->err = (stress_write(sc, tag, 0, MAX_TAGLINE_BLOCK_NUMBER) != 0);
+			}
+		} else if (pick < 32) {
+			sc->err = (stress_write(sc, tag, bnum, blks) != 0);
+		} else {
+			sc->err = (stress_read(sc, tag, bnum, blks) != 0);
+		}
+	}
+	return(NULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : stress_TagLines
+// Description  : Stress the driver with client threads, each working on
+//                taglines of its own (a tag belongs to the client its
+//                number is congruent to), and report the throughput of
+//                them all.  The operations are shared out evenly, so the
+//                time taken shows how much of the disk latency the clients
+//                overlap (the driver runs every request on one dispatcher).
+//
+// Inputs       : clients - the number of client threads
+// Outputs      : 0 if successful test, -1 if failure
+
+int stress_TagLines(uint32_t clients) {
+
+	// Local variables
+	StressClient *sc;
+	struct timespec start, end;
+	uint64_t reads = 0, writes = 0, deletes = 0, blocks = 0;
+	uint32_t c, started;
+	double secs;
+	int err = 0;
+
+	if ((sc = calloc(clients, sizeof(StressClient))) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "Unable to allocate stress clients (%u)", clients);
+		return(-1);
+	}
+	if (tagline_driver_init(STRESS_TAGLINES) || ((lost_disk != -1) && tagline_fail_disk(lost_disk))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "INIT failed on raid array (%d tags)", STRESS_TAGLINES);
+		free(sc);
+		return(-1);
+	}
+
+	// Run the clients together
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (started = 0; started < clients; started++) {
+		sc[started].id = started;
+		sc[started].clients = clients;
+		sc[started].ops = STRESS_OPS / clients;
+		sc[started].seed = started + 1;
+		if (pthread_create(&sc[started].thread, NULL, stress_client, &sc[started])) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "Unable to start stress client %u", started);
+			err = 1;
+			break;
+		}
+	}
+	for (c = 0; c < started; c++) {
+		pthread_join(sc[c].thread, NULL);
+		err |= sc[c].err;
+		reads += sc[c].reads;
+		writes += sc[c].writes;
+		deletes += sc[c].deletes;
+		blocks += sc[c].blocks;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	secs = replay_elapsed(&start, &end);
+
+	// Close the driver, then report
+	report_layout();
+	if (tagline_close()) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "Close failed on raid array.");
+		err = 1;
+	}
+	if (! err) {
+		TAGLINE_LOG(LOG_OUTPUT_LEVEL, "Stress: %u clients, %lu reads, %lu writes, %lu deletes, %lu blocks",
+				clients, reads, writes, deletes, blocks);
+		TAGLINE_LOG(LOG_OUTPUT_LEVEL, "Stress: %.6f sec, %.0f ops/sec, %.2f MB/sec", secs,
+				(secs > 0) ? (reads + writes + deletes) / secs : 0.0,
+				(secs > 0) ? (blocks * TAGLINE_BLOCK_SIZE) / (secs * 1024 * 1024) : 0.0);
+	}
+	free(sc);
+	return(err ? -1 : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : report_cache_policies
+// Description  : Replay each workload once under every cache replacement
+//                policy and report the hit ratio of the block cache.
+//
+// Inputs       : nfiles - the number of workload files
+//                wloads - the names of the workload files
+// Outputs      : 0 if successful test, -1 if failure
+
+int report_cache_policies(int nfiles, char *wloads[]) {
+
+	// Local variables
+	TaglineCacheStats stats;
+	uint64_t lookups;
+	int f, p;
+
+	TAGLINE_LOG(LOG_OUTPUT_LEVEL, "%-24s %-6s %10s %10s %10s %8s", "workload", "policy",
+			"hits", "misses", "evictions", "hit%");
+	for (f = 0; f < nfiles; f++) {
+		for (p = 0; p < TAGLINE_POLICY_MAXVAL; p++) {
+
+			// Replay the workload with this policy
+			set_tagline_cache_policy(p);
+			if (simulate_TagLines(wloads[f])) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "Tagline simulation failed [%s, %s]",
+						wloads[f], TAGLINE_POLICY_LABELS[p]);
+				return(-1);
+			}
+
+			// Report the counters of the cache
+			tagline_cache_stats(&stats);
+			lookups = stats.hits + stats.misses;
+			TAGLINE_LOG(LOG_OUTPUT_LEVEL, "%-24s %-6s %10lu %10lu %10lu %7.2f%%", wloads[f],
+					TAGLINE_POLICY_LABELS[p], stats.hits, stats.misses, stats.evictions,
+					(lookups) ? (100.0 * stats.hits) / lookups : 0.0);
+		}
+	}
+
+	// Return successfully
+	return(0);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Function     : tagline_read_block_read
@@ -323,7 +1266,7 @@ int tagline_read_block_validate(TagLineNumber tagnum, TagLineBlockNumber blocknu
 	if (strlen(text) != num_blocks) {
 
 		// Error out
-		logMessage(LOG_ERROR_LEVEL, "Text/number blocks mismatch in input data");
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "Text/number blocks mismatch in input data");
 		return(-1);
 
 	} else {
@@ -334,9 +1277,9 @@ int tagline_read_block_validate(TagLineNumber tagnum, TagLineBlockNumber blocknu
 		}
 
 		// Read the blocks from the tagline
-		if (tagline_read(tagnum, blocknum, num_blocks, tmbuf)) {
+		if (bench_read(tagnum, blocknum, num_blocks, tmbuf)) {
 			// Error out
-			logMessage(LOG_ERROR_LEVEL,
+			TAGLINE_LOG(LOG_ERROR_LEVEL,
 					"READ failed on tagline storage device (%u)", tagnum);
 			return(-1);
 		}
@@ -344,7 +1287,7 @@ int tagline_read_block_validate(TagLineNumber tagnum, TagLineBlockNumber blocknu
 		// Now compare the read bytes to see if it is correct
 		if (memcmp(rdbuf, tmbuf, num_blocks * TAGLINE_BLOCK_SIZE)) {
 			// Error out
-			logMessage(LOG_ERROR_LEVEL,
+			TAGLINE_LOG(LOG_ERROR_LEVEL,
 					"Read blocks data mismatch return from tagline storage.");
 			return(-1);
 		}
@@ -0,0 +1,710 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_stripe.c
+//  Description    : This is the implementation of the RAID-5 layer.  With
+//                   N disks the driver sees N-1 data disks; their tracks
+//                   are interleaved into one volume (track t of data disk
+//                   v is volume track t * (N-1) + v) and the volume is cut
+//                   into stripes of N-1 units, each stripe's parity unit on
+//                   a different disk (left-symmetric rotation).  A write
+//                   that covers a whole stripe computes the parity from the
+//                   new data alone; a partial one reads either the old data
+//                   and parity (read-modify-write) or the rest of the
+//                   stripe (reconstruct-write), whichever reads less.  With
+//                   one disk missing, its blocks are rebuilt from the
+//                   others on read and the writes keep the parity of the
+//                   surviving disks.
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_stripe.h"
+#include "tagline_io.h"
+#include "tagline_opcode.h"
+#include "tagline_log.h"
+
+// Defines
+#define TAGLINE_STRIPE_VECTOR 32   // bytes XORed at once
+#define TAGLINE_STRIPE_TESTS  200  // random writes of the unit test, before and after losing a disk
+#define TAGLINE_STRIPE_TRACKS 4    // the tracks of each data disk the unit test writes
+#define TAGLINE_STRIPE_COUNT(field, n) __atomic_fetch_add(&stripe_stats.field, (n), __ATOMIC_RELAXED)
+
+//
+// Type definitions
+
+// The vector the XOR kernel works in (the compiler picks the instructions)
+typedef uint64_t TaglineXorVector __attribute__((vector_size(TAGLINE_STRIPE_VECTOR)));
+
+//
+// Global data
+
+static uint32_t stripe_unit = 0;                           // blocks per stripe unit (0 if not striped)
+static uint32_t stripe_disks = 0;                          // the disks of the array
+static uint32_t stripe_blocks = 0;                         // the blocks per disk
+static RAIDDiskID stripe_failed = TAGLINE_STRIPE_NONE;     // the missing disk
+static pthread_mutex_t stripe_locks[TAGLINE_STRIPE_LOCKS]; // keep the parity of a stripe consistent
+static TaglineStripeStats stripe_stats;                    // the stripe counters
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_xor
+// Description  : XOR a buffer into another, a vector at a time
+//
+// Inputs       : dst - the buffer XORed into
+//                src - the buffer XORed in
+//                len - the bytes of each
+// Outputs      : none
+
+void tagline_stripe_xor(char *dst, const char *src, size_t len) {
+
+	TaglineXorVector a, b;
+	size_t at;
+
+	for (at = 0; at + sizeof(a) <= len; at += sizeof(a)) {
+		memcpy(&a, &dst[at], sizeof(a));
+		memcpy(&b, &src[at], sizeof(b));
+		a ^= b;
+		memcpy(&dst[at], &a, sizeof(a));
+	}
+	for (; at < len; at++) {
+		dst[at] ^= src[at];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_parity
+// Description  : Find the disk holding the parity of a stripe
+//
+// Inputs       : stripe - the stripe
+// Outputs      : the parity disk
+
+static RAIDDiskID tagline_stripe_parity(uint32_t stripe) {
+	return(stripe_disks - 1 - stripe % stripe_disks);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_disk
+// Description  : Find the disk holding a data unit of a stripe
+//
+// Inputs       : stripe - the stripe
+//                unit - the data unit (0 to the data disks - 1)
+// Outputs      : the disk of the unit
+
+static RAIDDiskID tagline_stripe_disk(uint32_t stripe, uint32_t unit) {
+	return((tagline_stripe_parity(stripe) + 1 + unit) % stripe_disks);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_volume
+// Description  : Find the volume block of a block of a data disk
+//
+// Inputs       : disk - the data disk
+//                rblock - the block
+// Outputs      : the volume block
+
+static uint64_t tagline_stripe_volume(RAIDDiskID disk, RAIDBlockID rblock) {
+	return(((uint64_t)(rblock / RAID_TRACK_BLOCKS) * (stripe_disks - 1) + disk) * RAID_TRACK_BLOCKS +
+			rblock % RAID_TRACK_BLOCKS);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_init
+// Description  : Stripe the array with rotating parity, every disk present
+//                (a freshly formatted array has consistent parity: zero).
+//                The data units of a stripe must divide a track, so a
+//                track of a data disk is written as whole stripes.
+//
+// Inputs       : disks - the disks of the array
+//                blocks - the blocks per disk
+//                unit - the blocks per stripe unit (0 turns striping off)
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_stripe_init(uint32_t disks, uint32_t blocks, uint32_t unit) {
+
+	int l;
+
+	tagline_stripe_close();
+	if (unit == 0) {
+		return(0);
+	}
+	if ((disks < 3) || (RAID_TRACK_BLOCKS % (unit * (disks - 1))) || (blocks % RAID_TRACK_BLOCKS)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : cannot stripe %u disks of %u blocks in units of %u", disks, blocks, unit);
+		return(-1);
+	}
+	for (l = 0; l < TAGLINE_STRIPE_LOCKS; l++) {
+		pthread_mutex_init(&stripe_locks[l], NULL);
+	}
+	stripe_unit = unit;
+	stripe_disks = disks;
+	stripe_blocks = blocks;
+	stripe_failed = TAGLINE_STRIPE_NONE;
+	memset(&stripe_stats, 0x0, sizeof(stripe_stats));
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_close
+// Description  : Turn striping off
+//
+// Inputs       : none
+// Outputs      : none
+
+void tagline_stripe_close(void) {
+
+	int l;
+
+	if (stripe_unit == 0) {
+		return;
+	}
+	for (l = 0; l < TAGLINE_STRIPE_LOCKS; l++) {
+		pthread_mutex_destroy(&stripe_locks[l]);
+	}
+	stripe_unit = stripe_disks = stripe_blocks = 0;
+	stripe_failed = TAGLINE_STRIPE_NONE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_enabled
+// Description  : Check if the array is striped
+//
+// Inputs       : none
+// Outputs      : 1 if striped, 0 if not
+
+int tagline_stripe_enabled(void) {
+	return(stripe_unit != 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_data_disks
+// Description  : Get the number of data disks the driver sees
+//
+// Inputs       : none
+// Outputs      : the data disks (one less than the disks of the array)
+
+uint32_t tagline_stripe_data_disks(void) {
+	return(stripe_disks - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_span
+// Description  : Get the blocks at the start of each disk that hold the
+//                first blocks of every data disk (and their parity)
+//
+// Inputs       : filled - the blocks of each data disk
+// Outputs      : the blocks of each disk
+
+uint32_t tagline_stripe_span(uint32_t filled) {
+
+	uint64_t last;
+
+	if (filled == 0) {
+		return(0);
+	}
+	last = tagline_stripe_volume(stripe_disks - 2, filled - 1);
+	return((uint32_t)(last / (stripe_unit * (stripe_disks - 1)) + 1) * stripe_unit);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_rebuild_rows
+// Description  : Rebuild rows of a unit of a stripe from the other disks
+//                (the caller holds the stripe lock)
+//
+// Inputs       : stripe - the stripe
+//                disk - the disk of the unit to rebuild
+//                lo, hi - the rows to rebuild
+//                dst - the memory for the rows (returned)
+//                tmp - scratch memory for the rows
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_stripe_rebuild_rows(uint32_t stripe, RAIDDiskID disk, uint32_t lo, uint32_t hi, char *dst, char *tmp) {
+
+	RAIDDiskID d;
+
+	memset(dst, 0x0, (size_t)(hi - lo) * RAID_BLOCK_SIZE);
+	for (d = 0; d < stripe_disks; d++) {
+		if (d == disk) {
+			continue;
+		}
+		if (tagline_disk_xfer(RAID_READ, d, stripe * stripe_unit + lo, hi - lo, tmp)) {
+			return(-1);
+		}
+		tagline_stripe_xor(dst, tmp, (size_t)(hi - lo) * RAID_BLOCK_SIZE);
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_read
+// Description  : Read part of a stripe, rebuilding the blocks of a missing
+//                disk from the others
+//
+// Inputs       : stripe - the stripe
+//                first, last - the data blocks of the stripe to read
+//                buf - the memory to read into
+//                work - scratch memory for a rebuilt unit
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_stripe_read(uint32_t stripe, uint32_t first, uint32_t last, char *buf, char *work) {
+
+	uint32_t unit, lo, hi;
+	RAIDDiskID d;
+	char *dst;
+	int ret;
+
+	for (unit = first / stripe_unit; unit <= (last - 1) / stripe_unit; unit++) {
+		lo = (unit == first / stripe_unit) ? first % stripe_unit : 0;
+		hi = (unit == (last - 1) / stripe_unit) ? (last - 1) % stripe_unit + 1 : stripe_unit;
+		dst = &buf[(size_t)(unit * stripe_unit + lo - first) * RAID_BLOCK_SIZE];
+		if ((d = tagline_stripe_disk(stripe, unit)) != stripe_failed) {
+			ret = tagline_disk_xfer(RAID_READ, d, stripe * stripe_unit + lo, hi - lo, dst);
+		} else {
+			pthread_mutex_lock(&stripe_locks[stripe % TAGLINE_STRIPE_LOCKS]);
+			ret = tagline_stripe_rebuild_rows(stripe, d, lo, hi, dst, work);
+			pthread_mutex_unlock(&stripe_locks[stripe % TAGLINE_STRIPE_LOCKS]);
+			TAGLINE_STRIPE_COUNT(degraded_reads, hi - lo);
+		}
+		if (ret) {
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_write
+// Description  : Write part of a stripe and its parity.  The parity comes
+//                from the new data alone when the stripe is written whole,
+//                otherwise from the old data and parity of the blocks
+//                written (read-modify-write) or from the rest of the rows
+//                written (reconstruct-write), whichever reads fewer blocks.
+//                A missing data disk written to is rebuilt first, so the
+//                parity of the surviving disks holds its new blocks.
+//
+// Inputs       : stripe - the stripe
+//                first, last - the data blocks of the stripe to write
+//                buf - the memory to write from
+//                work - scratch memory for the stripe (disks + 1 units)
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_stripe_write(uint32_t stripe, uint32_t first, uint32_t last, char *buf, char *work) {
+
+	uint32_t data = stripe_disks - 1, written = last - first, rlo, rhi, rows, unit, lo, hi;
+	RAIDDiskID parity = tagline_stripe_parity(stripe), lost = TAGLINE_STRIPE_NONE, d;
+	size_t usize = (size_t)stripe_unit * RAID_BLOCK_SIZE;
+	char *pbuf = &work[data * usize], *tmp = &work[stripe_disks * usize], *src;
+	int ret = 0;
+
+	// the rows written (all of them when the write crosses units)
+	if (first / stripe_unit == (last - 1) / stripe_unit) {
+		rlo = first % stripe_unit;
+		rhi = (last - 1) % stripe_unit + 1;
+	} else {
+		rlo = 0;
+		rhi = stripe_unit;
+	}
+	rows = rhi - rlo;
+
+	// a missing data disk written to has to be rebuilt
+	if ((stripe_failed != TAGLINE_STRIPE_NONE) && (stripe_failed != parity)) {
+		unit = (stripe_failed + stripe_disks - parity - 1) % stripe_disks;
+		if ((unit >= first / stripe_unit) && (unit <= (last - 1) / stripe_unit)) {
+			lost = stripe_failed;
+		}
+	}
+
+	pthread_mutex_lock(&stripe_locks[stripe % TAGLINE_STRIPE_LOCKS]);
+	if (stripe_failed != TAGLINE_STRIPE_NONE) {
+		TAGLINE_STRIPE_COUNT(degraded_writes, 1);
+	}
+
+	if (written == data * stripe_unit)
+	{
+		// a full stripe needs nothing from the disks
+		memset(pbuf, 0x0, usize);
+		for (unit = 0; unit < data; unit++) {
+			tagline_stripe_xor(pbuf, &buf[unit * usize], usize);
+		}
+		TAGLINE_STRIPE_COUNT(full_writes, 1);
+	}
+	else if (stripe_failed == parity)
+	{
+		// the parity is lost, there is nothing to keep
+	}
+	else if ((lost == TAGLINE_STRIPE_NONE) && ((stripe_failed != TAGLINE_STRIPE_NONE) || (written + rows <= data * rows - written)))
+	{
+		// read-modify-write: the parity of the rows, less the old data,
+		// plus the new
+		ret = tagline_disk_xfer(RAID_READ, parity, stripe * stripe_unit + rlo, rows, pbuf);
+		for (unit = first / stripe_unit; (unit <= (last - 1) / stripe_unit) && (ret == 0); unit++) {
+			lo = (unit == first / stripe_unit) ? first % stripe_unit : 0;
+			hi = (unit == (last - 1) / stripe_unit) ? (last - 1) % stripe_unit + 1 : stripe_unit;
+			src = &buf[(size_t)(unit * stripe_unit + lo - first) * RAID_BLOCK_SIZE];
+			ret = tagline_disk_xfer(RAID_READ, tagline_stripe_disk(stripe, unit), stripe * stripe_unit + lo, hi - lo, tmp);
+			tagline_stripe_xor(&pbuf[(size_t)(lo - rlo) * RAID_BLOCK_SIZE], tmp, (size_t)(hi - lo) * RAID_BLOCK_SIZE);
+			tagline_stripe_xor(&pbuf[(size_t)(lo - rlo) * RAID_BLOCK_SIZE], src, (size_t)(hi - lo) * RAID_BLOCK_SIZE);
+		}
+		TAGLINE_STRIPE_COUNT(rmw_writes, 1);
+	}
+	else
+	{
+		// reconstruct-write: the rows of every unit, old or new (a missing
+		// unit rebuilt from the parity), XORed together
+		for (unit = 0; (unit < data) && (ret == 0); unit++) {
+			lo = (unit == first / stripe_unit) ? first % stripe_unit : 0;
+			hi = (unit == (last - 1) / stripe_unit) ? (last - 1) % stripe_unit + 1 : stripe_unit;
+			d = tagline_stripe_disk(stripe, unit);
+			if ((unit >= first / stripe_unit) && (unit <= (last - 1) / stripe_unit) && (lo <= rlo) && (hi >= rhi)) {
+				continue;  // every row of the unit is new
+			}
+			if (d == lost) {
+				ret = tagline_stripe_rebuild_rows(stripe, d, rlo, rhi, &work[unit * usize], tmp);
+			} else {
+				ret = tagline_disk_xfer(RAID_READ, d, stripe * stripe_unit + rlo, rows, &work[unit * usize]);
+			}
+		}
+		memset(pbuf, 0x0, usize);
+		for (unit = 0; unit < data; unit++) {
+			if ((unit >= first / stripe_unit) && (unit <= (last - 1) / stripe_unit)) {
+				lo = (unit == first / stripe_unit) ? first % stripe_unit : 0;
+				hi = (unit == (last - 1) / stripe_unit) ? (last - 1) % stripe_unit + 1 : stripe_unit;
+				memcpy(&work[unit * usize + (size_t)(lo - rlo) * RAID_BLOCK_SIZE],
+						&buf[(size_t)(unit * stripe_unit + lo - first) * RAID_BLOCK_SIZE], (size_t)(hi - lo) * RAID_BLOCK_SIZE);
+			}
+			tagline_stripe_xor(pbuf, &work[unit * usize], (size_t)rows * RAID_BLOCK_SIZE);
+		}
+		if (lost == TAGLINE_STRIPE_NONE) {
+			TAGLINE_STRIPE_COUNT(rcw_writes, 1);
+		}
+	}
+
+	// write the new data on the disks there are, then the parity
+	for (unit = first / stripe_unit; (unit <= (last - 1) / stripe_unit) && (ret == 0); unit++) {
+		lo = (unit == first / stripe_unit) ? first % stripe_unit : 0;
+		hi = (unit == (last - 1) / stripe_unit) ? (last - 1) % stripe_unit + 1 : stripe_unit;
+		if ((d = tagline_stripe_disk(stripe, unit)) != stripe_failed) {
+			ret = tagline_disk_xfer(RAID_WRITE, d, stripe * stripe_unit + lo, hi - lo,
+					&buf[(size_t)(unit * stripe_unit + lo - first) * RAID_BLOCK_SIZE]);
+		}
+	}
+	if ((ret == 0) && (parity != stripe_failed)) {
+		ret = tagline_disk_xfer(RAID_WRITE, parity, stripe * stripe_unit + rlo, rows, pbuf);
+		TAGLINE_STRIPE_COUNT(parity_blocks, rows);
+	}
+	pthread_mutex_unlock(&stripe_locks[stripe % TAGLINE_STRIPE_LOCKS]);
+	return(ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_xfer
+// Description  : Transfer a run of blocks of a data disk.  The run is
+//                consecutive in the volume up to the end of a track, and
+//                is cut again at the end of each stripe.
+//
+// Inputs       : type - RAID_READ or RAID_WRITE
+//                disk - the data disk to transfer from/to
+//                rblock - the first block of the run
+//                count - the number of blocks in the run
+//                buf - the memory to transfer from/to
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_stripe_xfer(uint8_t type, RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, char *buf) {
+
+	uint32_t width = stripe_unit * (stripe_disks - 1), piece, first;
+	uint64_t vol;
+	char *work = NULL;
+	int ret = 0;
+
+	if ((disk >= stripe_disks - 1) || (rblock + count > stripe_blocks)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : striped transfer out of range [disk=%u, block=%u, blocks=%u]",
+				disk, rblock, count);
+		return(-1);
+	}
+
+	// the scratch memory holds a stripe, its parity and a unit more
+	if (((type == RAID_WRITE) || (stripe_failed != TAGLINE_STRIPE_NONE)) &&
+			((work = malloc((size_t)(stripe_disks + 1) * stripe_unit * RAID_BLOCK_SIZE)) == NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate stripe memory");
+		return(-1);
+	}
+	while ((count > 0) && (ret == 0)) {
+		vol = tagline_stripe_volume(disk, rblock);
+		first = vol % width;
+		piece = RAID_TRACK_BLOCKS - rblock % RAID_TRACK_BLOCKS;
+		if (piece > width - first) {
+			piece = width - first;
+		}
+		if (piece > count) {
+			piece = count;
+		}
+		if (type == RAID_READ) {
+			ret = tagline_stripe_read(vol / width, first, first + piece, buf, work);
+		} else {
+			ret = tagline_stripe_write(vol / width, first, first + piece, buf, work);
+		}
+		rblock += piece;
+		buf += (size_t)piece * RAID_BLOCK_SIZE;
+		count -= piece;
+	}
+	free(work);
+	return(ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_fail
+// Description  : Lose a disk of the array (with no transfers running): it
+//                is wiped, reads rebuild its blocks from the other disks
+//                and writes leave it out
+//
+// Inputs       : disk - the disk lost
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_stripe_fail(RAIDDiskID disk) {
+
+	if ((stripe_unit == 0) || (disk >= stripe_disks)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : cannot lose disk %u of an array without parity", disk);
+		return(-1);
+	}
+	if ((stripe_failed != TAGLINE_STRIPE_NONE) && (stripe_failed != disk)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : cannot lose disk %u, disk %u is already missing", disk, stripe_failed);
+		return(-1);
+	}
+	stripe_failed = disk;
+	if (raid_request_failed(tagline_bus_request(make_raid_request(RAID_FORMAT, 0, disk, 0), NULL))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID format failed on lost disk %u", disk);
+		return(-1);
+	}
+	TAGLINE_LOG(LOG_WARNING_LEVEL, "TAGLINE : disk %u lost, the array is degraded", disk);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_failed
+// Description  : Get the missing disk of the array
+//
+// Inputs       : none
+// Outputs      : the missing disk, TAGLINE_STRIPE_NONE if there is none
+
+RAIDDiskID tagline_stripe_failed(void) {
+	return(stripe_failed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_rebuild
+// Description  : Rewrite the first blocks of a disk from the other disks
+//                (with no transfers running); a missing disk is back once
+//                rebuilt
+//
+// Inputs       : disk - the disk to rebuild
+//                blocks - the blocks at its start to rebuild
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_stripe_rebuild(RAIDDiskID disk, uint32_t blocks) {
+
+	uint32_t stripe;
+	char *work;
+	int ret = 0;
+
+	if ((stripe_unit == 0) || (disk >= stripe_disks) ||
+			((stripe_failed != TAGLINE_STRIPE_NONE) && (stripe_failed != disk))) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : cannot rebuild disk %u", disk);
+		return(-1);
+	}
+	if ((work = malloc(2 * (size_t)stripe_unit * RAID_BLOCK_SIZE)) == NULL) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate stripe memory");
+		return(-1);
+	}
+	for (stripe = 0; (stripe * stripe_unit < blocks) && (stripe * stripe_unit < stripe_blocks) && (ret == 0); stripe++) {
+		ret = (tagline_stripe_rebuild_rows(stripe, disk, 0, stripe_unit, work, &work[(size_t)stripe_unit * RAID_BLOCK_SIZE]) ||
+				tagline_disk_xfer(RAID_WRITE, disk, stripe * stripe_unit, stripe_unit, work)) ? -1 : 0;
+	}
+	free(work);
+	if (ret == 0) {
+		stripe_failed = TAGLINE_STRIPE_NONE;
+		TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : disk %u rebuilt (%u stripes)", disk, stripe);
+	}
+	return(ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_stats
+// Description  : Get the counters for the stripe writes and reconstructions
+//
+// Inputs       : stats - the counters (returned)
+// Outputs      : none
+
+void tagline_stripe_stats(TaglineStripeStats *stats) {
+	*stats = stripe_stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_check
+// Description  : Read back the blocks the unit test wrote to each data disk
+//                and, with every disk present, check the units of each
+//                stripe XOR to zero
+//
+// Inputs       : shadow - the blocks written to each data disk
+//                blocks - the blocks written at the start of each data disk
+// Outputs      : 0 if they agree, -1 if not
+
+static int tagline_stripe_check(char *shadow, uint32_t blocks) {
+
+	uint32_t span = tagline_stripe_span(blocks), d;
+	size_t len = (size_t)blocks * RAID_BLOCK_SIZE, at;
+	char *buf, *sum;
+	int ret = 0;
+
+	if (((buf = malloc((len > (size_t)span * RAID_BLOCK_SIZE) ? len : (size_t)span * RAID_BLOCK_SIZE)) == NULL) ||
+			((sum = calloc(span, RAID_BLOCK_SIZE)) == NULL)) {
+		TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate stripe test memory");
+		free(buf);
+		return(-1);
+	}
+	for (d = 0; (d < stripe_disks - 1) && (ret == 0); d++) {
+		if (tagline_stripe_xfer(RAID_READ, d, 0, blocks, buf) || memcmp(buf, &shadow[d * len], len)) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : data disk %u reads back wrong%s", d,
+					(stripe_failed == TAGLINE_STRIPE_NONE) ? "" : " (degraded)");
+			ret = -1;
+		}
+	}
+	if (stripe_failed == TAGLINE_STRIPE_NONE) {
+		for (d = 0; (d < stripe_disks) && (ret == 0); d++) {
+			ret = tagline_disk_xfer(RAID_READ, d, 0, span, buf);
+			tagline_stripe_xor(sum, buf, (size_t)span * RAID_BLOCK_SIZE);
+		}
+		for (at = 0; (at < (size_t)span * RAID_BLOCK_SIZE) && (ret == 0); at++) {
+			if (sum[at] != 0) {
+				TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : parity of block %lu of the disks is wrong", at / RAID_BLOCK_SIZE);
+				ret = -1;
+			}
+		}
+	}
+	free(buf);
+	free(sum);
+	return(ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_scribble
+// Description  : Write random runs of random blocks to the data disks in
+//                the unit test, whole tracks (whole stripes) among them
+//
+// Inputs       : shadow - the blocks written to each data disk (updated)
+//                blocks - the blocks written at the start of each data disk
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_stripe_scribble(char *shadow, uint32_t blocks) {
+
+	char buf[RAID_TRACK_BLOCKS * RAID_BLOCK_SIZE];
+	uint32_t t, count, rblock, b;
+	RAIDDiskID disk;
+
+	for (t = 0; t < TAGLINE_STRIPE_TESTS; t++) {
+		disk = rand() % (stripe_disks - 1);
+		if (rand() % 4) {
+			rblock = rand() % blocks;
+			count = 1 + rand() % RAID_TRACK_BLOCKS;
+			count = (rblock + count > blocks) ? blocks - rblock : count;
+		} else {
+			rblock = (rand() % (blocks / RAID_TRACK_BLOCKS)) * RAID_TRACK_BLOCKS;
+			count = RAID_TRACK_BLOCKS;
+		}
+		for (b = 0; b < count * RAID_BLOCK_SIZE; b++) {
+			buf[b] = rand();
+		}
+		if (tagline_stripe_xfer(RAID_WRITE, disk, rblock, count, buf)) {
+			return(-1);
+		}
+		memcpy(&shadow[((size_t)disk * blocks + rblock) * RAID_BLOCK_SIZE], buf, (size_t)count * RAID_BLOCK_SIZE);
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_stripe_unit_test
+// Description  : On an array of the RAID bus, for several stripe units:
+//                write random runs, check the data and parity, lose a disk
+//                and check its blocks are rebuilt on read, write with it
+//                missing, then rebuild it and check again
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_stripe_unit_test(void) {
+
+	static const uint32_t units[] = { 1, 4, 16 };
+	uint32_t blocks = TAGLINE_STRIPE_TRACKS * RAID_TRACK_BLOCKS, u;
+	TaglineStripeStats stats;
+	RAIDDiskID lost;
+	char *shadow;
+	int ret = 0;
+
+	for (u = 0; (u < sizeof(units) / sizeof(units[0])) && (ret == 0); u++) {
+		if (raid_request_failed(tagline_bus_request(make_raid_request(RAID_INIT, RAID_DISKBLOCKS / RAID_TRACK_BLOCKS,
+				RAID_DISKS, 0), NULL))) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : RAID init failed");
+			return(-1);
+		}
+		if ((shadow = calloc((size_t)(RAID_DISKS - 1) * blocks, RAID_BLOCK_SIZE)) == NULL) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : unable to allocate stripe test memory");
+			ret = -1;
+		}
+
+		// whole, read-modify-write and reconstruct writes keep the parity
+		ret = ret || tagline_stripe_init(RAID_DISKS, RAID_DISKBLOCKS, units[u]) ||
+				tagline_stripe_scribble(shadow, blocks) || tagline_stripe_check(shadow, blocks);
+
+		// a lost disk (wiped) is rebuilt on read, and written around
+		lost = rand() % RAID_DISKS;
+		ret = ret || tagline_stripe_fail(lost) || tagline_stripe_check(shadow, blocks) ||
+				tagline_stripe_scribble(shadow, blocks) || tagline_stripe_check(shadow, blocks);
+
+		// once rebuilt from the others it holds its data and parity again
+		ret = ret || tagline_stripe_rebuild(lost, tagline_stripe_span(blocks)) ||
+				(tagline_stripe_failed() != TAGLINE_STRIPE_NONE) || tagline_stripe_check(shadow, blocks);
+		tagline_stripe_stats(&stats);
+		if ((ret == 0) && ((stats.full_writes == 0) || (stats.rmw_writes + stats.rcw_writes == 0) ||
+				(stats.degraded_writes == 0) || (stats.degraded_reads == 0))) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : stripe test missed a kind of transfer (unit %u)", units[u]);
+			ret = -1;
+		}
+		if (ret) {
+			TAGLINE_LOG(LOG_ERROR_LEVEL, "TAGLINE : stripe unit test failed (unit %u, disk %u lost)", units[u], lost);
+		}
+		tagline_stripe_close();
+		free(shadow);
+		tagline_bus_request(make_raid_request(RAID_CLOSE, 0, 0, 0), NULL);
+	}
+	if (ret) {
+		return(-1);
+	}
+
+	TAGLINE_LOG(LOG_INFO_LEVEL, "TAGLINE : stripe unit test passed (units of 1, 4 and 16 blocks)");
+	return(0);
+}
@@ -0,0 +1,77 @@
+#ifndef TAGLINE_STRIPE_INCLUDED
+#define TAGLINE_STRIPE_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_stripe.h
+//  Description    : This is the header file for the RAID-5 layer of the
+//                   tagline driver, which stripes the blocks of the data
+//                   disks the driver sees across the array with rotating
+//                   parity, and keeps running with one disk missing.
+//
+
+// Includes
+#include <stdint.h>
+#include <stddef.h>
+#include "raid_bus.h"
+
+// Defines
+#define TAGLINE_STRIPE_LOCKS        64                       // the stripe locks (stripes share them)
+#define TAGLINE_STRIPE_NONE         0xff                     // no disk is missing
+
+//
+// Type definitions
+
+// Counters describing the stripe writes and reconstructions
+typedef struct {
+	uint64_t full_writes;      // stripes written whole, parity from the new data alone
+	uint64_t rmw_writes;       // partial stripe writes by read-modify-write
+	uint64_t rcw_writes;       // partial stripe writes reading the rest of the stripe
+	uint64_t degraded_writes;  // stripe writes with a disk missing
+	uint64_t degraded_reads;   // blocks rebuilt from the other disks on read
+	uint64_t parity_blocks;    // parity blocks written
+} TaglineStripeStats;
+
+//
+// Interface functions
+
+int tagline_stripe_init(uint32_t disks, uint32_t blocks, uint32_t unit);
+	// Stripe the array (unit 0 turns striping off)
+
+void tagline_stripe_close(void);
+	// Turn striping off
+
+int tagline_stripe_enabled(void);
+	// Check if the array is striped
+
+uint32_t tagline_stripe_data_disks(void);
+	// Get the number of data disks the driver sees
+
+uint32_t tagline_stripe_span(uint32_t filled);
+	// Get the blocks of each disk holding the first filled blocks of every data disk
+
+int tagline_stripe_xfer(uint8_t type, RAIDDiskID disk, RAIDBlockID rblock, uint32_t count, char *buf);
+	// Transfer a run of blocks of a data disk, keeping the parity
+
+int tagline_stripe_fail(RAIDDiskID disk);
+	// Lose a disk: it is wiped and rebuilt from the others on every read
+
+RAIDDiskID tagline_stripe_failed(void);
+	// Get the missing disk (TAGLINE_STRIPE_NONE if there is none)
+
+int tagline_stripe_rebuild(RAIDDiskID disk, uint32_t blocks);
+	// Rewrite the first blocks of a disk from the others
+
+void tagline_stripe_stats(TaglineStripeStats *stats);
+	// Get the counters for the stripe writes and reconstructions
+
+void tagline_stripe_xor(char *dst, const char *src, size_t len);
+	// XOR a buffer into another
+
+//
+// Unit test
+
+int tagline_stripe_unit_test(void);
+	// Write, lose a disk, rebuild it, checking the data and parity on the RAID bus
+
+#endif /* TAGLINE_STRIPE_INCLUDED */
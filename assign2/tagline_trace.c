@@ -0,0 +1,528 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_trace.c
+//  Description    : This is the implementation of the parsed workload trace.
+//                   The workload file is mapped into memory and parsed in
+//                   a single pass into a compact array of operations, so a
+//                   replay pays no parsing cost.  Traces are stored in a
+//                   binary file format that is streamed back in chunks.
+//
+
+// Include Files
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include <endian.h>
+#include <cmpsc311_log.h>
+
+// Project Includes
+#include "tagline_trace.h"
+#include "tagline_driver.h"
+
+// Defines
+#define TAGLINE_TRACE_MINCAP 1024          // initial number of operations allocated
+#define TAGLINE_TRACE_IOBUF  (1024 * 1024)  // stream buffer for trace files
+
+// The command names used in the text workload format
+const char *TAGLINE_OP_LABELS[TAGLINE_OP_MAXVAL] = {
+	"INIT", "CLOSE", "READ", "WRITE", "tagline", "DELETE"
+};
+
+//
+// Functions
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_trace_token
+// Description  : Find the next whitespace separated token on a line
+//
+// Inputs       : pos - the parse position (updated past the token)
+//                end - the end of the line
+//                len - the length of the token (returned)
+// Outputs      : the start of the token, NULL if there is none
+
+static const char *tagline_trace_token(const char **pos, const char *end, uint32_t *len) {
+
+	const char *p = *pos, *tok;
+
+	while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r'))) {
+		p++;
+	}
+	if (p == end) {
+		return(NULL);
+	}
+	for (tok = p; (p < end) && (*p != ' ') && (*p != '\t') && (*p != '\r'); p++);
+	*len = p - tok;
+	*pos = p;
+	return(tok);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_trace_number
+// Description  : Parse the next token on a line as an unsigned number
+//
+// Inputs       : pos - the parse position (updated past the number)
+//                end - the end of the line
+//                max - the largest value allowed
+//                val - the number (returned)
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_trace_number(const char **pos, const char *end, uint32_t max, uint32_t *val) {
+
+	const char *tok;
+	uint32_t len, i;
+	uint64_t n = 0;
+
+	if (((tok = tagline_trace_token(pos, end, &len)) == NULL) || (len > 10)) {
+		return(-1);
+	}
+	for (i = 0; i < len; i++) {
+		if ((tok[i] < '0') || (tok[i] > '9')) {
+			return(-1);
+		}
+		n = n * 10 + (tok[i] - '0');
+	}
+	if (n > max) {
+		return(-1);
+	}
+	*val = n;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_trace_check
+// Description  : Sanity check the block count and pattern of an operation;
+//                a read or write moves 1 to MAX_TAGLINE_BLOCK_NUMBER blocks
+//                and has one pattern byte per block
+//
+// Inputs       : op - the operation to check
+// Outputs      : 0 if valid, -1 if not
+
+static int tagline_trace_check(TaglineTraceOp *op) {
+
+	if ((op->cmd == TAGLINE_OP_READ) || (op->cmd == TAGLINE_OP_WRITE)) {
+		if ((op->blocks == 0) || (op->blocks > MAX_TAGLINE_BLOCK_NUMBER) || (op->length != op->blocks)) {
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_trace_append
+// Description  : Add an operation and its pattern bytes to a trace
+//
+// Inputs       : trace - the trace to add to
+//                op - the operation (its text offset is filled in)
+//                text - the pattern bytes
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_trace_append(TaglineTrace *trace, TaglineTraceOp *op, const char *text) {
+
+	void *grown;
+	uint32_t newcap;
+
+	// Grow the operation array and text pool as needed
+	if (trace->nops == trace->capacity) {
+		newcap = (trace->capacity == 0) ? TAGLINE_TRACE_MINCAP : trace->capacity * 2;
+		if ((grown = realloc(trace->ops, newcap * sizeof(TaglineTraceOp))) == NULL) {
+			logMessage(LOG_ERROR_LEVEL, "TAGLINE : unable to grow trace to %u operations", newcap);
+			return(-1);
+		}
+		trace->ops = grown;
+		trace->capacity = newcap;
+	}
+	if (trace->textlen + op->length > trace->textcap) {
+		newcap = (trace->textcap == 0) ? TAGLINE_TRACE_MINCAP : trace->textcap * 2;
+		while (newcap < trace->textlen + op->length) {
+			newcap *= 2;
+		}
+		if ((grown = realloc(trace->text, newcap)) == NULL) {
+			logMessage(LOG_ERROR_LEVEL, "TAGLINE : unable to grow trace text to %u bytes", newcap);
+			return(-1);
+		}
+		trace->text = grown;
+		trace->textcap = newcap;
+	}
+
+	// Copy in the operation and its pattern
+	op->text = trace->textlen;
+	memcpy(&trace->text[trace->textlen], text, op->length);
+	trace->textlen += op->length;
+	trace->ops[trace->nops++] = *op;
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_trace_parse
+// Description  : Parse one workload line (CMD tag blocks start text)
+//
+// Inputs       : trace - the trace to add the operation to
+//                line - the start of the line
+//                end - the end of the line
+//                linecount - the line number (for errors)
+// Outputs      : 0 if successful, -1 if failure
+
+static int tagline_trace_parse(TaglineTrace *trace, const char *line, const char *end, uint32_t linecount) {
+
+	TaglineTraceOp op;
+	const char *pos = line, *cmd, *text;
+	uint32_t len, tag, blocks, start, textlen;
+	int i;
+
+	// Skip blank lines
+	if ((cmd = tagline_trace_token(&pos, end, &len)) == NULL) {
+		return(0);
+	}
+
+	// Pull out the fields, then find the command
+	if (tagline_trace_number(&pos, end, UINT16_MAX, &tag) ||
+			tagline_trace_number(&pos, end, UINT16_MAX, &blocks) ||
+			tagline_trace_number(&pos, end, UINT32_MAX, &start) ||
+			((text = tagline_trace_token(&pos, end, &textlen)) == NULL) ||
+			(textlen > UINT16_MAX)) {
+		logMessage(LOG_ERROR_LEVEL, "Tagline un-parsable workload string, aborting [%.*s], line %u",
+				(int)(end - line), line, linecount);
+		return(-1);
+	}
+	for (i = 0; (i < TAGLINE_OP_MAXVAL) &&
+			((strlen(TAGLINE_OP_LABELS[i]) != len) || strncmp(cmd, TAGLINE_OP_LABELS[i], len)); i++);
+	if (i == TAGLINE_OP_MAXVAL) {
+		logMessage(LOG_WARNING_LEVEL, "Tagline unknown workload command [%.*s], line %u ignored",
+				(int)len, cmd, linecount);
+		return(0);
+	}
+
+	// Sanity check the data, then add the operation
+	op.cmd = i;
+	op.unused = 0;
+	op.tag = tag;
+	op.start = start;
+	op.length = textlen;
+	if ((op.cmd == TAGLINE_OP_READ) || (op.cmd == TAGLINE_OP_WRITE)) {
+		if ((blocks == 0) || (blocks > MAX_TAGLINE_BLOCK_NUMBER)) {
+			logMessage(LOG_ERROR_LEVEL, "Bad block count %u (1 to %u) in input data, line %u",
+					blocks, MAX_TAGLINE_BLOCK_NUMBER, linecount);
+			return(-1);
+		}
+		op.blocks = blocks;
+	} else {
+		op.blocks = 0;
+	}
+	if (tagline_trace_check(&op)) {
+		logMessage(LOG_ERROR_LEVEL, "Text/number blocks mismatch in input data, line %u", linecount);
+		return(-1);
+	}
+	return(tagline_trace_append(trace, &op, text));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_trace_load
+// Description  : Map a text workload file and parse it into a trace
+//
+// Inputs       : wload - the name of the workload file
+//                trace - the trace to fill in
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_trace_load(const char *wload, TaglineTrace *trace) {
+
+	const char *base, *line, *end, *eol;
+	struct stat st;
+	uint32_t linecount = 0;
+	int fd, err = 0;
+
+	memset(trace, 0x0, sizeof(TaglineTrace));
+
+	// Map the workload file
+	if ((fd = open(wload, O_RDONLY)) == -1) {
+		logMessage(LOG_ERROR_LEVEL, "Failure opening the workload file [%s], error: %s.",
+			wload, strerror(errno));
+		return(-1);
+	}
+	if (fstat(fd, &st) || (st.st_size == 0)) {
+		logMessage(LOG_ERROR_LEVEL, "Empty or unreadable workload file [%s]", wload);
+		close(fd);
+		return(-1);
+	}
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		logMessage(LOG_ERROR_LEVEL, "Failure mapping the workload file [%s], error: %s.",
+			wload, strerror(errno));
+		return(-1);
+	}
+	madvise((void *)base, st.st_size, MADV_SEQUENTIAL);
+
+	// Parse it a line at a time
+	end = base + st.st_size;
+	for (line = base; (line < end) && (! err); line = eol + 1) {
+		if ((eol = memchr(line, '\n', end - line)) == NULL) {
+			eol = end;
+		}
+		err = tagline_trace_parse(trace, line, eol, ++linecount);
+	}
+	munmap((void *)base, st.st_size);
+
+	if (err) {
+		tagline_trace_free(trace);
+		return(-1);
+	}
+	logMessage(LOG_INFO_LEVEL, "Parsed workload [%s], %u operations", wload, trace->nops);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_trace_free
+// Description  : Release the memory held by a trace
+//
+// Inputs       : trace - the trace to release
+// Outputs      : none
+
+void tagline_trace_free(TaglineTrace *trace) {
+	free(trace->ops);
+	free(trace->text);
+	memset(trace, 0x0, sizeof(TaglineTrace));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_trace_is_binary
+// Description  : Check if a workload file is a binary trace
+//
+// Inputs       : wload - the name of the workload file
+// Outputs      : 1 if it starts with the trace magic, 0 otherwise
+
+int tagline_trace_is_binary(const char *wload) {
+
+	char magic[sizeof(TAGLINE_TRACE_MAGIC) - 1];
+	int fd, binary;
+
+	if ((fd = open(wload, O_RDONLY)) == -1) {
+		return(0);
+	}
+	binary = (read(fd, magic, sizeof(magic)) == sizeof(magic)) &&
+			(memcmp(magic, TAGLINE_TRACE_MAGIC, sizeof(magic)) == 0);
+	close(fd);
+	return(binary);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_trace_save
+// Description  : Write a trace to a binary trace file
+//
+// Inputs       : path - the name of the file to create
+//                trace - the trace to write
+//                compress - deflate the records if non-zero
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_trace_save(const char *path, TaglineTrace *trace, int compress) {
+
+	unsigned char hdr[TAGLINE_TRACE_HDRSIZE], rec[TAGLINE_TRACE_RECSIZE];
+	TaglineTraceOp *op;
+	uint16_t v16;
+	uint32_t v32;
+	uint64_t v64;
+	gzFile gz;
+	uint32_t n;
+	int fd, err = 0;
+
+	// Build the header
+	memset(hdr, 0x0, sizeof(hdr));
+	memcpy(hdr, TAGLINE_TRACE_MAGIC, sizeof(TAGLINE_TRACE_MAGIC) - 1);
+	v16 = htons(TAGLINE_TRACE_VERSION);
+	memcpy(&hdr[8], &v16, 2);
+	v16 = htons(compress ? TAGLINE_TRACE_COMPRESSED : 0);
+	memcpy(&hdr[10], &v16, 2);
+	v16 = htons(TAGLINE_TRACE_RECSIZE);
+	memcpy(&hdr[12], &v16, 2);
+	v64 = htobe64(trace->nops);
+	memcpy(&hdr[16], &v64, 8);
+	v64 = htobe64(trace->textlen);
+	memcpy(&hdr[24], &v64, 8);
+
+	// Write the header raw, then stream the records behind it
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+		logMessage(LOG_ERROR_LEVEL, "Failure creating trace file [%s], error: %s.", path, strerror(errno));
+		return(-1);
+	}
+	if ((write(fd, hdr, sizeof(hdr)) != sizeof(hdr)) ||
+			((gz = gzdopen(fd, compress ? "wb6" : "wbT")) == NULL)) {
+		logMessage(LOG_ERROR_LEVEL, "Failure writing trace file [%s]", path);
+		close(fd);
+		return(-1);
+	}
+	gzbuffer(gz, TAGLINE_TRACE_IOBUF);
+	for (n = 0; (n < trace->nops) && (! err); n++) {
+		op = &trace->ops[n];
+		rec[0] = op->cmd;
+		rec[1] = 0;
+		v16 = htons(op->tag);
+		memcpy(&rec[2], &v16, 2);
+		v16 = htons((op->cmd == TAGLINE_OP_VALIDATE) ? op->length : op->blocks);
+		memcpy(&rec[4], &v16, 2);
+		v16 = htons(op->length);
+		memcpy(&rec[6], &v16, 2);
+		v32 = htonl(op->start);
+		memcpy(&rec[8], &v32, 4);
+		err = (gzwrite(gz, rec, sizeof(rec)) != sizeof(rec)) ||
+				((op->length > 0) && (gzwrite(gz, &trace->text[op->text], op->length) != op->length));
+	}
+	if ((gzclose(gz) != Z_OK) || err) {
+		logMessage(LOG_ERROR_LEVEL, "Failure writing trace file [%s]", path);
+		return(-1);
+	}
+
+	logMessage(LOG_INFO_LEVEL, "Saved trace [%s], %u operations%s", path, trace->nops,
+			compress ? " (compressed)" : "");
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_trace_open
+// Description  : Open a binary trace file, check its header and get ready
+//                to stream its records
+//
+// Inputs       : path - the name of the trace file
+//                tf - the trace file state to fill in
+// Outputs      : 0 if successful, -1 if failure
+
+int tagline_trace_open(const char *path, TaglineTraceFile *tf) {
+
+	unsigned char hdr[TAGLINE_TRACE_HDRSIZE];
+	uint16_t v16;
+	uint64_t v64;
+	int fd;
+
+	memset(tf, 0x0, sizeof(TaglineTraceFile));
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		logMessage(LOG_ERROR_LEVEL, "Failure opening trace file [%s], error: %s.", path, strerror(errno));
+		return(-1);
+	}
+
+	// Read and check the header
+	if ((read(fd, hdr, sizeof(hdr)) != sizeof(hdr)) ||
+			memcmp(hdr, TAGLINE_TRACE_MAGIC, sizeof(TAGLINE_TRACE_MAGIC) - 1)) {
+		logMessage(LOG_ERROR_LEVEL, "Trace file [%s] has no trace header", path);
+		close(fd);
+		return(-1);
+	}
+	memcpy(&v16, &hdr[8], 2);
+	tf->version = ntohs(v16);
+	memcpy(&v16, &hdr[10], 2);
+	tf->flags = ntohs(v16);
+	memcpy(&v16, &hdr[12], 2);
+	tf->recsize = ntohs(v16);
+	memcpy(&v64, &hdr[16], 8);
+	tf->nops = be64toh(v64);
+	memcpy(&v64, &hdr[24], 8);
+	tf->textlen = be64toh(v64);
+	if ((tf->version == 0) || (tf->version > TAGLINE_TRACE_VERSION) || (tf->recsize < TAGLINE_TRACE_RECSIZE)) {
+		logMessage(LOG_ERROR_LEVEL, "Trace file [%s] has unsupported format (version %u, record %u)",
+				path, tf->version, tf->recsize);
+		close(fd);
+		return(-1);
+	}
+
+	// Stream the records (gzip reads uncompressed data transparently)
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	if ((tf->file = gzdopen(fd, "rb")) == NULL) {
+		logMessage(LOG_ERROR_LEVEL, "Failure opening trace stream [%s]", path);
+		close(fd);
+		return(-1);
+	}
+	gzbuffer(tf->file, TAGLINE_TRACE_IOBUF);
+	return(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_trace_read
+// Description  : Read the next operations of a binary trace file into a
+//                trace, replacing what the trace held
+//
+// Inputs       : tf - the open trace file
+//                trace - the trace to fill
+//                maxops - the most operations to read
+// Outputs      : the number of operations read (0 at the end), -1 if failure
+
+int tagline_trace_read(TaglineTraceFile *tf, TaglineTrace *trace, uint32_t maxops) {
+
+	unsigned char rec[UINT16_MAX];
+	char text[UINT16_MAX];
+	TaglineTraceOp op;
+	uint16_t v16, blocks;
+	uint32_t v32;
+
+	trace->nops = 0;
+	trace->textlen = 0;
+	while ((trace->nops < maxops) && (tf->read < tf->nops)) {
+
+		// Decode the record and pull in its pattern bytes
+		if (gzread(tf->file, rec, tf->recsize) != tf->recsize) {
+			logMessage(LOG_ERROR_LEVEL, "Trace file truncated at operation %lu", tf->read);
+			return(-1);
+		}
+		op.cmd = rec[0];
+		op.unused = 0;
+		memcpy(&v16, &rec[2], 2);
+		op.tag = ntohs(v16);
+		memcpy(&v16, &rec[4], 2);
+		blocks = ntohs(v16);
+		memcpy(&v16, &rec[6], 2);
+		op.length = ntohs(v16);
+		memcpy(&v32, &rec[8], 4);
+		op.start = ntohl(v32);
+		if (op.cmd >= TAGLINE_OP_MAXVAL) {
+			logMessage(LOG_ERROR_LEVEL, "Trace file has bad command %u at operation %lu", op.cmd, tf->read);
+			return(-1);
+		}
+		if ((op.cmd == TAGLINE_OP_READ) || (op.cmd == TAGLINE_OP_WRITE)) {
+			op.blocks = (blocks > MAX_TAGLINE_BLOCK_NUMBER) ? 0 : blocks;
+		} else {
+			op.blocks = 0;
+		}
+		if (tagline_trace_check(&op) || (tf->textread + op.length > tf->textlen)) {
+			logMessage(LOG_ERROR_LEVEL, "Trace file has bad %s of %u blocks (%u pattern bytes) at operation %lu",
+					TAGLINE_OP_LABELS[op.cmd], blocks, op.length, tf->read);
+			return(-1);
+		}
+		if ((op.length > 0) && (gzread(tf->file, text, op.length) != op.length)) {
+			logMessage(LOG_ERROR_LEVEL, "Trace file truncated at operation %lu", tf->read);
+			return(-1);
+		}
+		if (tagline_trace_append(trace, &op, text)) {
+			return(-1);
+		}
+		tf->textread += op.length;
+		tf->read++;
+	}
+	return(trace->nops);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : tagline_trace_close
+// Description  : Close a binary trace file
+//
+// Inputs       : tf - the trace file to close
+// Outputs      : none
+
+void tagline_trace_close(TaglineTraceFile *tf) {
+	if (tf->file != NULL) {
+		gzclose(tf->file);
+	}
+	memset(tf, 0x0, sizeof(TaglineTraceFile));
+}
@@ -0,0 +1,111 @@
+#ifndef TAGLINE_TRACE_INCLUDED
+#define TAGLINE_TRACE_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : tagline_trace.h
+//  Description    : This is the header file for the parsed workload trace,
+//                   the in-memory form of a workload that the simulator
+//                   replays without re-parsing the text, and for the
+//                   binary trace file format it is stored in.
+//
+
+// Includes
+#include <stdint.h>
+#include <zlib.h>
+
+// Defines
+#define TAGLINE_TRACE_MAGIC      "TAGTRACE"  // first bytes of a binary trace
+#define TAGLINE_TRACE_VERSION    1           // the newest format version
+#define TAGLINE_TRACE_COMPRESSED 0x0001      // flag: records are deflated
+#define TAGLINE_TRACE_HDRSIZE    32          // bytes in the file header
+#define TAGLINE_TRACE_RECSIZE    12          // bytes in a version 1 record
+
+//
+// The binary trace file is a header followed by one record per operation,
+// all fields in network byte order:
+//
+//   header : magic[8] version:16 flags:16 recsize:16 unused:16 nops:64 textlen:64
+//   record : cmd:8 unused:8 tag:16 blocks:16 length:16 start:32 text[length]
+//
+// The records are deflated (gzip) when the COMPRESSED flag is set.  A
+// reader skips any record bytes past the fields it knows, so later
+// versions can append fields to the record.
+
+//
+// Type definitions
+
+// The workload commands
+typedef enum {
+	TAGLINE_OP_INIT     = 0,  // initialize the driver (tag is maxlines)
+	TAGLINE_OP_CLOSE    = 1,  // close the driver
+	TAGLINE_OP_READ     = 2,  // read and check blocks of a tagline
+	TAGLINE_OP_WRITE    = 3,  // write blocks of a tagline
+	TAGLINE_OP_VALIDATE = 4,  // check the final contents of a tagline
+	TAGLINE_OP_DELETE   = 5,  // delete a tagline
+	TAGLINE_OP_MAXVAL   = 6,  // the number of commands
+} TaglineOpType;
+
+// One workload operation; the pattern bytes (one per block) live in the
+// text pool of the trace.  The block count is the driver's uint8_t count
+// and is only kept for READ and WRITE; a VALIDATE checks length blocks.
+typedef struct {
+	uint8_t  cmd;     // the TaglineOpType of the operation
+	uint8_t  blocks;  // the number of blocks (1 to MAX_TAGLINE_BLOCK_NUMBER)
+	uint16_t tag;     // the tagline number (maxlines for INIT)
+	uint16_t length;  // the number of pattern bytes
+	uint16_t unused;  // padding (keeps the operation at 16 bytes)
+	uint32_t start;   // the first block
+	uint32_t text;    // offset of the pattern bytes in the text pool
+} TaglineTraceOp;
+
+// A parsed workload
+typedef struct {
+	TaglineTraceOp *ops;       // the operations, in workload order
+	uint32_t        nops;      // the number of operations
+	uint32_t        capacity;  // the number of operations allocated
+	char           *text;      // the pattern byte pool
+	uint32_t        textlen;   // the number of pattern bytes used
+	uint32_t        textcap;   // the number of pattern bytes allocated
+} TaglineTrace;
+
+// An open binary trace file being read
+typedef struct {
+	gzFile   file;     // the (possibly compressed) record stream
+	uint16_t version;  // the format version of the file
+	uint16_t flags;    // the format flags of the file
+	uint16_t recsize;  // the bytes of each record before its text
+	uint64_t nops;     // the number of operations in the file
+	uint64_t read;     // the number of operations read so far
+	uint64_t textlen;  // the number of pattern bytes in the file
+	uint64_t textread; // the number of pattern bytes read so far
+} TaglineTraceFile;
+
+// The command names used in the text workload format
+extern const char *TAGLINE_OP_LABELS[TAGLINE_OP_MAXVAL];
+
+//
+// Interface functions
+
+int tagline_trace_load(const char *wload, TaglineTrace *trace);
+	// Map a text workload file and parse it into a trace
+
+void tagline_trace_free(TaglineTrace *trace);
+	// Release the memory held by a trace
+
+int tagline_trace_is_binary(const char *wload);
+	// Check if a workload file is a binary trace (1 yes, 0 no)
+
+int tagline_trace_save(const char *path, TaglineTrace *trace, int compress);
+	// Write a trace to a binary trace file
+
+int tagline_trace_open(const char *path, TaglineTraceFile *tf);
+	// Open a binary trace file for streaming
+
+int tagline_trace_read(TaglineTraceFile *tf, TaglineTrace *trace, uint32_t maxops);
+	// Read the next operations of a binary trace into a trace (returns count)
+
+void tagline_trace_close(TaglineTraceFile *tf);
+	// Close a binary trace file
+
+#endif /* TAGLINE_TRACE_INCLUDED */